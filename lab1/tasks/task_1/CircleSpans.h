@@ -0,0 +1,206 @@
+#ifndef CIRCLESPANS_H
+#define CIRCLESPANS_H
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+
+// Наибольший радиус, для которого строки круга берутся из таблицы.
+// Таблица строится при компиляции; для больших радиусов — пошаговый алгоритм.
+#ifndef CIRCLE_SPAN_MAX_RADIUS
+#define CIRCLE_SPAN_MAX_RADIUS 64
+#endif
+
+static_assert(CIRCLE_SPAN_MAX_RADIUS >= 0 && CIRCLE_SPAN_MAX_RADIUS <= 255, "span widths are stored as bytes");
+
+// Строки кругов радиусов 0..MaxRadius. Для радиуса r и строки dy (0..r):
+//   outer — наибольшее dx, при котором dx * dx + dy * dy <= r * r (те же пиксели,
+//           что у FillCircleSquare);
+//   inner — до какого |dx| строка контура пуста: пиксель контура — пиксель круга,
+//           у которого хотя бы один из четырёх соседей снаружи.
+// Радиусы лежат подряд треугольником: строки радиуса r начинаются с r * (r + 1) / 2.
+template <int MaxRadius>
+struct CircleSpanTable
+{
+    static constexpr int ENTRY_COUNT = (MaxRadius + 1) * (MaxRadius + 2) / 2;
+
+    uint8_t outer[ENTRY_COUNT] = {};
+    int8_t inner[ENTRY_COUNT] = {};
+
+    static constexpr int Offset(int radius)
+    {
+        return radius * (radius + 1) / 2;
+    }
+
+    constexpr CircleSpanTable()
+    {
+        for (int radius = 0; radius <= MaxRadius; ++radius)
+        {
+            // Полуширина убывает с ростом dy, так что dx только уменьшается
+            int dx = radius;
+            for (int dy = 0; dy <= radius; ++dy)
+            {
+                while (dx * dx + dy * dy > radius * radius)
+                    --dx;
+                outer[Offset(radius) + dy] = (uint8_t)dx;
+            }
+            for (int dy = 0; dy <= radius; ++dy)
+            {
+                int next = dy < radius ? outer[Offset(radius) + dy + 1] : -1;
+                int width = outer[Offset(radius) + dy];
+                inner[Offset(radius) + dy] = (int8_t)std::min(next, width - 1);
+            }
+        }
+    }
+};
+
+inline constexpr CircleSpanTable<CIRCLE_SPAN_MAX_RADIUS> g_circleSpans{};
+
+// Форматы пикселей: тип пикселя и упаковка цвета из ARGB8888
+struct PixelArgb8888
+{
+    using Pixel = uint32_t;
+    static constexpr Pixel Pack(uint32_t argb) { return argb; }
+};
+
+struct PixelRgb565
+{
+    using Pixel = uint16_t;
+    static constexpr Pixel Pack(uint32_t argb)
+    {
+        return (Pixel)(((argb >> 8) & 0xF800) | ((argb >> 5) & 0x07E0) | ((argb >> 3) & 0x001F));
+    }
+};
+
+struct PixelGray8
+{
+    using Pixel = uint8_t;
+    static constexpr Pixel Pack(uint32_t argb)
+    {
+        return (Pixel)((((argb >> 16) & 0xFF) * 77 + ((argb >> 8) & 0xFF) * 150 + (argb & 0xFF) * 29) >> 8);
+    }
+};
+
+// Заливка отрезка строки; для однобайтовых пикселей — memset
+template <typename Pixel>
+struct SpanWriter
+{
+    static void Fill(Pixel* row, int left, int right, Pixel value)
+    {
+        std::fill(row + left, row + right + 1, value);
+    }
+};
+
+template <>
+struct SpanWriter<uint8_t>
+{
+    static void Fill(uint8_t* row, int left, int right, uint8_t value)
+    {
+        std::memset(row + left, value, (size_t)(right - left + 1));
+    }
+};
+
+// Поверхность в формате Format; pitch — в пикселях. Границы отсечения включительно.
+template <typename Format>
+struct SpanTarget
+{
+    typename Format::Pixel* pixels;
+    int pitch;
+    int clipLeft, clipTop, clipRight, clipBottom;
+
+    void FillSpan(int y, int left, int right, typename Format::Pixel value) const
+    {
+        if (y < clipTop || y > clipBottom)
+            return;
+        left = std::max(left, clipLeft);
+        right = std::min(right, clipRight);
+        if (left <= right)
+            SpanWriter<typename Format::Pixel>::Fill(pixels + (size_t)y * pitch, left, right, value);
+    }
+};
+
+// Залитый круг пошагово, без таблицы: полуширина строки уточняется от предыдущей
+template <typename Format>
+void FillCircleIncremental(const SpanTarget<Format>& target, int cx, int cy, int radius, typename Format::Pixel value)
+{
+    int dx = radius;
+    for (int dy = 0; dy <= radius; ++dy)
+    {
+        while (dx * dx + dy * dy > radius * radius)
+            --dx;
+        target.FillSpan(cy - dy, cx - dx, cx + dx, value);
+        if (dy != 0)
+            target.FillSpan(cy + dy, cx - dx, cx + dx, value);
+    }
+}
+
+// Контур (4-связная граница залитого круга) пошагово
+template <typename Format>
+void DrawCircleOutlineIncremental(const SpanTarget<Format>& target, int cx, int cy, int radius, typename Format::Pixel value)
+{
+    int dx = radius;
+    int next = radius;
+    for (int dy = 0; dy <= radius; ++dy)
+    {
+        while (dx * dx + dy * dy > radius * radius)
+            --dx;
+        next = std::min(next, dx);
+        while (next >= 0 && next * next + (dy + 1) * (dy + 1) > radius * radius)
+            --next;
+        int inner = std::min(dy < radius ? next : -1, dx - 1);
+        target.FillSpan(cy - dy, cx - dx, cx - inner - 1, value);
+        target.FillSpan(cy - dy, cx + inner + 1, cx + dx, value);
+        if (dy != 0)
+        {
+            target.FillSpan(cy + dy, cx - dx, cx - inner - 1, value);
+            target.FillSpan(cy + dy, cx + inner + 1, cx + dx, value);
+        }
+    }
+}
+
+// Залитый круг: для малых радиусов строки берутся из таблицы, без арифметики на пиксель
+template <typename Format>
+void FillCircleSpans(const SpanTarget<Format>& target, int cx, int cy, int radius, typename Format::Pixel value)
+{
+    if (radius > CIRCLE_SPAN_MAX_RADIUS)
+    {
+        FillCircleIncremental(target, cx, cy, radius, value);
+        return;
+    }
+    const uint8_t* outer = g_circleSpans.outer + g_circleSpans.Offset(radius);
+    target.FillSpan(cy, cx - outer[0], cx + outer[0], value);
+    for (int dy = 1; dy <= radius; ++dy)
+    {
+        target.FillSpan(cy - dy, cx - outer[dy], cx + outer[dy], value);
+        target.FillSpan(cy + dy, cx - outer[dy], cx + outer[dy], value);
+    }
+}
+
+// Контур круга по таблице: в каждой строке два отрезка [-outer, -inner - 1] и [inner + 1, outer]
+template <typename Format>
+void DrawCircleOutlineSpans(const SpanTarget<Format>& target, int cx, int cy, int radius, typename Format::Pixel value)
+{
+    if (radius > CIRCLE_SPAN_MAX_RADIUS)
+    {
+        DrawCircleOutlineIncremental(target, cx, cy, radius, value);
+        return;
+    }
+    const uint8_t* outer = g_circleSpans.outer + g_circleSpans.Offset(radius);
+    const int8_t* inner = g_circleSpans.inner + g_circleSpans.Offset(radius);
+    for (int dy = 0; dy <= radius; ++dy)
+    {
+        int left = cx - outer[dy];
+        int right = cx + outer[dy];
+        int gapLeft = cx - inner[dy] - 1;
+        int gapRight = cx + inner[dy] + 1;
+        target.FillSpan(cy - dy, left, gapLeft, value);
+        target.FillSpan(cy - dy, gapRight, right, value);
+        if (dy != 0)
+        {
+            target.FillSpan(cy + dy, left, gapLeft, value);
+            target.FillSpan(cy + dy, gapRight, right, value);
+        }
+    }
+}
+
+#endif  // CIRCLESPANS_H
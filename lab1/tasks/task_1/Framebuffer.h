@@ -0,0 +1,50 @@
+#ifndef FRAMEBUFFER_H
+#define FRAMEBUFFER_H
+
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+
+// Программный кадр 32bpp ARGB8888, строки подряд без выравнивания.
+// На экран выводится одной загрузкой в SDL_Texture, а не SDL_RenderDrawPoint на каждый пиксель.
+struct Framebuffer
+{
+    int width = 0;
+    int height = 0;
+    std::vector<uint32_t> pixels;
+
+    void Resize(int newWidth, int newHeight)
+    {
+        width = newWidth;
+        height = newHeight;
+        pixels.assign((size_t)width * height, 0);
+    }
+
+    void Clear(uint32_t color)
+    {
+        std::fill(pixels.begin(), pixels.end(), color);
+    }
+
+    uint32_t* Row(int y)
+    {
+        return pixels.data() + (size_t)y * width;
+    }
+};
+
+// Прямоугольник отсечения в пикселях, границы включительно
+struct ClipRect
+{
+    int left, top, right, bottom;
+};
+
+inline ClipRect FullClip(const Framebuffer& target)
+{
+    return { 0, 0, target.width - 1, target.height - 1 };
+}
+
+inline uint32_t PackColor(uint8_t r, uint8_t g, uint8_t b, uint8_t a = 255)
+{
+    return ((uint32_t)a << 24) | ((uint32_t)r << 16) | ((uint32_t)g << 8) | b;
+}
+
+#endif  // FRAMEBUFFER_H
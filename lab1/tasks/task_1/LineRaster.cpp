@@ -0,0 +1,277 @@
+#include "LineRaster.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <utility>
+
+namespace
+{
+    // Деление с округлением вверх для любого знака делимого, делитель положителен
+    int64_t CeilDiv(int64_t numerator, int64_t denominator)
+    {
+        return numerator >= 0 ? (numerator + denominator - 1) / denominator : -(-numerator / denominator);
+    }
+
+    // Смешивание цвета с пикселем: coverage (0..1) умножается на альфу цвета.
+    // Каналы обрабатываются парами (A и G, R и B) в одном 32-битном умножении.
+    void BlendPixel(uint32_t& pixel, uint32_t color, float coverage)
+    {
+        uint32_t alpha = (uint32_t)(coverage * (float)(color >> 24) * (256.0f / 255.0f) + 0.5f);
+        if (alpha == 0)
+            return;
+        uint32_t source = color | 0xFF000000u;
+        uint32_t inverse = 256 - alpha;
+        uint32_t redBlue = ((source & 0x00FF00FFu) * alpha + (pixel & 0x00FF00FFu) * inverse) >> 8;
+        uint32_t alphaGreen = ((source >> 8) & 0x00FF00FFu) * alpha + ((pixel >> 8) & 0x00FF00FFu) * inverse;
+        pixel = (redBlue & 0x00FF00FFu) | (alphaGreen & 0xFF00FF00u);
+    }
+
+    float FractionalPart(float value)
+    {
+        return value - std::floor(value);
+    }
+}
+
+bool ClipLineLiangBarsky(float& x0, float& y0, float& x1, float& y1, float left, float top, float right, float bottom)
+{
+    float dx = x1 - x0;
+    float dy = y1 - y0;
+    float enter = 0.0f;
+    float exit = 1.0f;
+    // Для каждой из четырёх границ: p — проекция направления, q — расстояние до границы
+    const float p[4] = { -dx, dx, -dy, dy };
+    const float q[4] = { x0 - left, right - x0, y0 - top, bottom - y0 };
+    for (int i = 0; i < 4; ++i)
+    {
+        if (p[i] == 0.0f)
+        {
+            if (q[i] < 0.0f)
+                return false;
+            continue;
+        }
+        float t = q[i] / p[i];
+        if (p[i] < 0.0f)
+            enter = std::max(enter, t);
+        else
+            exit = std::min(exit, t);
+        if (enter > exit)
+            return false;
+    }
+    float startX = x0;
+    float startY = y0;
+    x0 = startX + dx * enter;
+    y0 = startY + dy * enter;
+    x1 = startX + dx * exit;
+    y1 = startY + dy * exit;
+    return true;
+}
+
+void DrawLineBresenham(Framebuffer& target, int x0, int y0, int x1, int y1, uint32_t color, const ClipRect& clip)
+{
+    // Главная ось — та, вдоль которой линия длиннее; на каждом шаге k по ней
+    // смещение по второй оси m(k) = floor((2 * k * |dMinor| + |dMajor|) / (2 * |dMajor|))
+    bool steep = std::abs(y1 - y0) > std::abs(x1 - x0);
+    int major0 = steep ? y0 : x0;
+    int minor0 = steep ? x0 : y0;
+    int majorDelta = steep ? y1 - y0 : x1 - x0;
+    int minorDelta = steep ? x1 - x0 : y1 - y0;
+    int majorStep = majorDelta < 0 ? -1 : 1;
+    int minorStep = minorDelta < 0 ? -1 : 1;
+    int64_t majorLength = std::abs(majorDelta);
+    int64_t minorLength = std::abs(minorDelta);
+    int majorLow = steep ? clip.top : clip.left;
+    int majorHigh = steep ? clip.bottom : clip.right;
+    int minorLow = steep ? clip.left : clip.top;
+    int minorHigh = steep ? clip.right : clip.bottom;
+
+    // Диапазон шагов по главной оси
+    int64_t first = 0;
+    int64_t last = majorLength;
+    if (majorStep > 0)
+    {
+        first = std::max<int64_t>(first, majorLow - major0);
+        last = std::min<int64_t>(last, majorHigh - major0);
+    }
+    else
+    {
+        first = std::max<int64_t>(first, major0 - majorHigh);
+        last = std::min<int64_t>(last, major0 - majorLow);
+    }
+
+    // m(k) не убывает, поэтому границы по второй оси тоже дают непрерывный диапазон шагов
+    int64_t offsetLow = minorStep > 0 ? minorLow - minor0 : minor0 - minorHigh;
+    int64_t offsetHigh = minorStep > 0 ? minorHigh - minor0 : minor0 - minorLow;
+    if (minorLength == 0)
+    {
+        if (offsetLow > 0 || offsetHigh < 0)
+            return;
+    }
+    else
+    {
+        first = std::max(first, CeilDiv(2 * majorLength * offsetLow - majorLength, 2 * minorLength));
+        last = std::min(last, CeilDiv(2 * majorLength * (offsetHigh + 1) - majorLength, 2 * minorLength) - 1);
+    }
+    if (first > last)
+        return;
+
+    int64_t twoMajor = 2 * majorLength;
+    int64_t offset = 0;
+    int64_t error = 0;
+    if (majorLength > 0)
+    {
+        int64_t numerator = 2 * first * minorLength + majorLength;
+        offset = numerator / twoMajor;
+        error = numerator - offset * twoMajor;
+    }
+
+    int64_t majorPosition = major0 + majorStep * first;
+    int64_t minorPosition = minor0 + minorStep * offset;
+    int64_t x = steep ? minorPosition : majorPosition;
+    int64_t y = steep ? majorPosition : minorPosition;
+    uint32_t* pixels = target.pixels.data();
+    int64_t index = y * target.width + x;
+    int64_t majorStride = steep ? (int64_t)majorStep * target.width : majorStep;
+    int64_t minorStride = steep ? minorStep : (int64_t)minorStep * target.width;
+    int64_t twoMinor = 2 * minorLength;
+    for (int64_t step = first; step <= last; ++step)
+    {
+        pixels[index] = color;
+        index += majorStride;
+        error += twoMinor;
+        if (error >= twoMajor)
+        {
+            error -= twoMajor;
+            index += minorStride;
+        }
+    }
+}
+
+void DrawLineWu(Framebuffer& target, float x0, float y0, float x1, float y1, uint32_t color, const ClipRect& clip)
+{
+    // Отрезок отсекается с запасом в два пикселя: ослабленные концы, появившиеся
+    // на границе отсечения, остаются за пределами clip и не рисуются
+    if (!ClipLineLiangBarsky(x0, y0, x1, y1, clip.left - 2.0f, clip.top - 2.0f, clip.right + 2.0f, clip.bottom + 2.0f))
+        return;
+
+    bool steep = std::abs(y1 - y0) > std::abs(x1 - x0);
+    if (steep)
+    {
+        std::swap(x0, y0);
+        std::swap(x1, y1);
+    }
+    if (x0 > x1)
+    {
+        std::swap(x0, x1);
+        std::swap(y0, y1);
+    }
+    int majorLow = steep ? clip.top : clip.left;
+    int majorHigh = steep ? clip.bottom : clip.right;
+    int minorLow = steep ? clip.left : clip.top;
+    int minorHigh = steep ? clip.right : clip.bottom;
+
+    uint32_t* pixels = target.pixels.data();
+    int width = target.width;
+    // После отсечения главная ось уже в пределах clip, остаётся проверить вторую:
+    // пара пикселей шага может выйти за неё на один пиксель
+    auto plot = [&](int major, int minor, float coverage)
+    {
+        if (minor < minorLow || minor > minorHigh)
+            return;
+        size_t index = steep ? (size_t)major * width + minor : (size_t)minor * width + major;
+        BlendPixel(pixels[index], color, coverage);
+    };
+
+    float dx = x1 - x0;
+    float dy = y1 - y0;
+    float gradient = dx == 0.0f ? 1.0f : dy / dx;
+
+    // Концы: покрытие умножается на долю пикселя, занятую отрезком по главной оси
+    int start = (int)std::floor(x0 + 0.5f);
+    float startY = y0 + gradient * (start - x0);
+    float startGap = 1.0f - FractionalPart(x0 + 0.5f);
+    int end = (int)std::floor(x1 + 0.5f);
+    float endY = y1 + gradient * (end - x1);
+    float endGap = FractionalPart(x1 + 0.5f);
+    if (start == end)
+    {
+        // Отрезок короче пикселя: один столбец с покрытием, равным длине
+        startGap = x1 - x0;
+    }
+
+    if (start >= majorLow && start <= majorHigh)
+    {
+        int minor = (int)std::floor(startY);
+        plot(start, minor, (1.0f - FractionalPart(startY)) * startGap);
+        plot(start, minor + 1, FractionalPart(startY) * startGap);
+    }
+    if (end != start && end >= majorLow && end <= majorHigh)
+    {
+        int minor = (int)std::floor(endY);
+        plot(end, minor, (1.0f - FractionalPart(endY)) * endGap);
+        plot(end, minor + 1, FractionalPart(endY) * endGap);
+    }
+
+    int first = std::max(start + 1, majorLow);
+    int last = std::min(end - 1, majorHigh);
+    float intersection = startY + gradient * (first - start);
+    for (int major = first; major <= last; ++major)
+    {
+        int minor = (int)std::floor(intersection);
+        float fraction = intersection - minor;
+        plot(major, minor, 1.0f - fraction);
+        plot(major, minor + 1, fraction);
+        intersection += gradient;
+    }
+}
+
+void DrawThickLine(Framebuffer& target, float x0, float y0, float x1, float y1, float width, uint32_t color,
+                   const ClipRect& clip)
+{
+    if (width <= 1.0f)
+    {
+        DrawLineBresenham(target, (int)std::floor(x0 + 0.5f), (int)std::floor(y0 + 0.5f), (int)std::floor(x1 + 0.5f),
+                          (int)std::floor(y1 + 0.5f), color, clip);
+        return;
+    }
+
+    // Углы прямоугольника: концы, сдвинутые на половину ширины по нормали.
+    // У точки нормаль любая — получается квадрат со стороной width.
+    float dx = x1 - x0;
+    float dy = y1 - y0;
+    float length = std::sqrt(dx * dx + dy * dy);
+    float normalX = length > 0.0f ? -dy / length : 0.0f;
+    float normalY = length > 0.0f ? dx / length : 1.0f;
+    float alongX = length > 0.0f ? 0.0f : 0.5f * width;
+    float half = 0.5f * width;
+    const float cornerX[4] = { x0 + normalX * half - alongX, x1 + normalX * half + alongX,
+                               x1 - normalX * half + alongX, x0 - normalX * half - alongX };
+    const float cornerY[4] = { y0 + normalY * half, y1 + normalY * half, y1 - normalY * half, y0 - normalY * half };
+
+    float minY = *std::min_element(cornerY, cornerY + 4);
+    float maxY = *std::max_element(cornerY, cornerY + 4);
+    int top = std::max((int)std::ceil(minY), clip.top);
+    int bottom = std::min((int)std::floor(maxY), clip.bottom);
+    for (int y = top; y <= bottom; ++y)
+    {
+        // Прямоугольник выпуклый: строка пересекает его одним отрезком
+        float left = 1e30f;
+        float right = -1e30f;
+        for (int edge = 0; edge < 4; ++edge)
+        {
+            float ax = cornerX[edge];
+            float ay = cornerY[edge];
+            float bx = cornerX[(edge + 1) % 4];
+            float by = cornerY[(edge + 1) % 4];
+            if ((y < ay && y < by) || (y > ay && y > by))
+                continue;
+            float x = ay == by ? std::min(ax, bx) : ax + (y - ay) * (bx - ax) / (by - ay);
+            float xOther = ay == by ? std::max(ax, bx) : x;
+            left = std::min(left, x);
+            right = std::max(right, xOther);
+        }
+        int spanLeft = std::max((int)std::ceil(left), clip.left);
+        int spanRight = std::min((int)std::floor(right), clip.right);
+        if (spanLeft <= spanRight)
+            std::fill(target.Row(y) + spanLeft, target.Row(y) + spanRight + 1, color);
+    }
+}
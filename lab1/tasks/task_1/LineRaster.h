@@ -0,0 +1,27 @@
+#ifndef LINERASTER_H
+#define LINERASTER_H
+
+#include <cstdint>
+
+#include "Framebuffer.h"
+
+// Линии пишутся прямо в Framebuffer. Отсечение выполняется один раз до растеризации,
+// поэтому во внутреннем цикле нет проверки границ на каждый пиксель.
+// Центры пикселей — целые координаты, как у RoundToPixel в PrimitiveBatch.
+
+// Отсечение отрезка по Лянгу–Барски; false, если отрезок целиком снаружи
+bool ClipLineLiangBarsky(float& x0, float& y0, float& x1, float& y1, float left, float top, float right, float bottom);
+
+// Целочисленный Брезенхем. Отсечение точное: рисуются ровно те пиксели неотсечённой
+// линии, что попадают в clip, так что соседние плитки стыкуются без щелей и наложений.
+void DrawLineBresenham(Framebuffer& target, int x0, int y0, int x1, int y1, uint32_t color, const ClipRect& clip);
+
+// Сглаженная линия Ву: по два пикселя на шаг главной оси, смешивание с учётом альфы цвета
+void DrawLineWu(Framebuffer& target, float x0, float y0, float x1, float y1, uint32_t color, const ClipRect& clip);
+
+// Толстая линия с плоскими концами: прямоугольник заливается строками.
+// Ширина не больше одного пикселя рисуется Брезенхемом.
+void DrawThickLine(Framebuffer& target, float x0, float y0, float x1, float y1, float width, uint32_t color,
+                   const ClipRect& clip);
+
+#endif  // LINERASTER_H
@@ -0,0 +1,72 @@
+#include "Particles.h"
+#include <random>
+
+void ParticleSystem::Spawn(size_t count, int width, int height, uint32_t seed)
+{
+    std::mt19937 random(seed);
+    std::uniform_real_distribution<float> positionX(0.0f, (float)width);
+    std::uniform_real_distribution<float> positionY(0.0f, (float)height);
+    std::uniform_real_distribution<float> velocity(-150.0f, 150.0f);
+    std::uniform_int_distribution<int> size(1, 3);
+    std::uniform_int_distribution<int> channel(64, 255);
+
+    x.resize(count);
+    y.resize(count);
+    vx.resize(count);
+    vy.resize(count);
+    radius.resize(count);
+    color.resize(count);
+    for (size_t i = 0; i < count; ++i)
+    {
+        x[i] = positionX(random);
+        y[i] = positionY(random);
+        vx[i] = velocity(random);
+        vy[i] = velocity(random);
+        radius[i] = (float)size(random);
+        color[i] = PackColor((uint8_t)channel(random), (uint8_t)channel(random), (uint8_t)channel(random));
+    }
+}
+
+void ParticleSystem::Update(float dt, int width, int height)
+{
+    const float gravity = 200.0f;
+    float maxX = (float)width;
+    float maxY = (float)height;
+    size_t count = x.size();
+
+    for (size_t i = 0; i < count; ++i)
+    {
+        vy[i] += gravity * dt;
+        x[i] += vx[i] * dt;
+        y[i] += vy[i] * dt;
+    }
+    // Отскок отдельным проходом, чтобы цикл выше оставался без ветвлений
+    for (size_t i = 0; i < count; ++i)
+    {
+        if (x[i] < 0.0f)
+        {
+            x[i] = -x[i];
+            vx[i] = -vx[i];
+        }
+        else if (x[i] > maxX)
+        {
+            x[i] = 2.0f * maxX - x[i];
+            vx[i] = -vx[i];
+        }
+        if (y[i] > maxY)
+        {
+            y[i] = 2.0f * maxY - y[i];
+            vy[i] = -vy[i];
+        }
+        else if (y[i] < 0.0f)
+        {
+            y[i] = -y[i];
+            vy[i] = -vy[i];
+        }
+    }
+}
+
+void ParticleSystem::Submit(PrimitiveBatch& batch) const
+{
+    batch.AddCircles(x.data(), y.data(), radius.data(), color.data(), x.size());
+}
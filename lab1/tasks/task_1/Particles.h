@@ -0,0 +1,27 @@
+#ifndef PARTICLES_H
+#define PARTICLES_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "PrimitiveBatch.h"
+
+// Система частиц в раскладке "структура массивов": обновление идёт по
+// отдельным массивам координат и скоростей, а в PrimitiveBatch они
+// копируются целыми массивами.
+class ParticleSystem
+{
+public:
+    void Spawn(size_t count, int width, int height, uint32_t seed);
+    // Гравитация и упругий отскок от краёв экрана
+    void Update(float dt, int width, int height);
+    void Submit(PrimitiveBatch& batch) const;
+    size_t GetCount() const { return x.size(); }
+
+private:
+    std::vector<float> x, y, vx, vy, radius;
+    std::vector<uint32_t> color;
+};
+
+#endif  // PARTICLES_H
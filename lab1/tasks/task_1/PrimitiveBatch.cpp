@@ -0,0 +1,275 @@
+#include "PrimitiveBatch.h"
+#include "CircleSpans.h"
+#include "LineRaster.h"
+#include <cmath>
+
+namespace
+{
+    // Прямоугольник пикселей, границы включительно
+    struct PixelBounds
+    {
+        int left, top, right, bottom;
+    };
+
+    // floor(value + 0.5) без вызова std::floor: приведение отсекает к нулю,
+    // для отрицательных дробных значений вычитаем единицу
+    int RoundToPixel(float value)
+    {
+        float shifted = value + 0.5f;
+        int truncated = (int)shifted;
+        return truncated - (shifted < (float)truncated);
+    }
+
+    bool ClipBounds(PixelBounds& bounds, const PixelBounds& clip)
+    {
+        bounds.left = std::max(bounds.left, clip.left);
+        bounds.top = std::max(bounds.top, clip.top);
+        bounds.right = std::min(bounds.right, clip.right);
+        bounds.bottom = std::min(bounds.bottom, clip.bottom);
+        return bounds.left <= bounds.right && bounds.top <= bounds.bottom;
+    }
+
+    // Примитивы пакета с номерами [first, last) в сквозной нумерации
+    // "прямоугольники, круги, линии", с габаритами, обрезанными по экрану;
+    // полностью невидимые пропускаются
+    template <typename Visit>
+    void ForEachPrimitive(const PrimitiveBatch& batch, const PixelBounds& screen, size_t first, size_t last, Visit visit)
+    {
+        const RectArrays& rects = batch.GetRects();
+        const CircleArrays& circles = batch.GetCircles();
+        const LineArrays& lines = batch.GetLines();
+        size_t circlesStart = rects.x.size();
+        size_t linesStart = circlesStart + circles.x.size();
+
+        for (size_t i = first; i < std::min(last, circlesStart); ++i)
+        {
+            TileEntry entry = { RoundToPixel(rects.x[i]), RoundToPixel(rects.y[i]),
+                                RoundToPixel(rects.x[i] + rects.width[i]) - 1,
+                                RoundToPixel(rects.y[i] + rects.height[i]) - 1, rects.color[i], TileBinner::Rect };
+            PixelBounds bounds = { entry.a, entry.b, entry.c, entry.d };
+            if (ClipBounds(bounds, screen))
+                visit(entry, bounds);
+        }
+        for (size_t i = std::max(first, circlesStart); i < std::min(last, linesStart); ++i)
+        {
+            size_t circle = i - circlesStart;
+            int r = RoundToPixel(circles.radius[circle]);
+            TileEntry entry = { RoundToPixel(circles.x[circle]), RoundToPixel(circles.y[circle]), r, 0,
+                                circles.color[circle], TileBinner::Circle };
+            PixelBounds bounds = { entry.a - r, entry.b - r, entry.a + r, entry.b + r };
+            if (ClipBounds(bounds, screen))
+                visit(entry, bounds);
+        }
+        for (size_t i = std::max(first, linesStart); i < last; ++i)
+        {
+            size_t line = i - linesStart;
+            TileEntry entry = { RoundToPixel(lines.x0[line]), RoundToPixel(lines.y0[line]), RoundToPixel(lines.x1[line]),
+                                RoundToPixel(lines.y1[line]), lines.color[line], TileBinner::Line };
+            PixelBounds bounds = { std::min(entry.a, entry.c), std::min(entry.b, entry.d), std::max(entry.a, entry.c),
+                                   std::max(entry.b, entry.d) };
+            if (ClipBounds(bounds, screen))
+                visit(entry, bounds);
+        }
+    }
+
+    // Те же пиксели, что и у FillCircleSquare: dx * dx + dy * dy <= r * r, но строками;
+    // полуширины строк малых кругов берутся из таблицы CircleSpans.h
+    void FillCircle(Framebuffer& target, const TileEntry& circle, const PixelBounds& clip)
+    {
+        if (circle.c < 0)
+            return;
+        SpanTarget<PixelArgb8888> spans = { target.pixels.data(), target.width, clip.left, clip.top, clip.right, clip.bottom };
+        FillCircleSpans(spans, circle.a, circle.b, circle.c, circle.color);
+    }
+
+    void FillRect(Framebuffer& target, const TileEntry& rect, const PixelBounds& clip)
+    {
+        PixelBounds bounds = { rect.a, rect.b, rect.c, rect.d };
+        if (!ClipBounds(bounds, clip))
+            return;
+        for (int y = bounds.top; y <= bounds.bottom; ++y)
+            std::fill(target.Row(y) + bounds.left, target.Row(y) + bounds.right + 1, rect.color);
+    }
+
+    // Брезенхем с точным отсечением по плитке: пиксели совпадают с неразрезанной линией
+    void DrawLine(Framebuffer& target, const TileEntry& line, const PixelBounds& clip)
+    {
+        DrawLineBresenham(target, line.a, line.b, line.c, line.d, line.color, { clip.left, clip.top, clip.right, clip.bottom });
+    }
+
+    void DrawEntry(const TileEntry& entry, Framebuffer& target, const PixelBounds& clip)
+    {
+        switch (entry.type)
+        {
+        case TileBinner::Rect:
+            FillRect(target, entry, clip);
+            break;
+        case TileBinner::Circle:
+            FillCircle(target, entry, clip);
+            break;
+        case TileBinner::Line:
+            DrawLine(target, entry, clip);
+            break;
+        }
+    }
+}
+
+void PrimitiveBatch::AddCircle(float x, float y, float radius, uint32_t color)
+{
+    circles.x.push_back(x);
+    circles.y.push_back(y);
+    circles.radius.push_back(radius);
+    circles.color.push_back(color);
+}
+
+void PrimitiveBatch::AddRect(float x, float y, float width, float height, uint32_t color)
+{
+    rects.x.push_back(x);
+    rects.y.push_back(y);
+    rects.width.push_back(width);
+    rects.height.push_back(height);
+    rects.color.push_back(color);
+}
+
+void PrimitiveBatch::AddLine(float x0, float y0, float x1, float y1, uint32_t color)
+{
+    lines.x0.push_back(x0);
+    lines.y0.push_back(y0);
+    lines.x1.push_back(x1);
+    lines.y1.push_back(y1);
+    lines.color.push_back(color);
+}
+
+void PrimitiveBatch::AddCircles(const float* x, const float* y, const float* radius, const uint32_t* color, size_t count)
+{
+    circles.x.insert(circles.x.end(), x, x + count);
+    circles.y.insert(circles.y.end(), y, y + count);
+    circles.radius.insert(circles.radius.end(), radius, radius + count);
+    circles.color.insert(circles.color.end(), color, color + count);
+}
+
+// Массивы очищаются без освобождения памяти: следующий кадр заполнит их заново
+void PrimitiveBatch::Clear()
+{
+    circles.x.clear();
+    circles.y.clear();
+    circles.radius.clear();
+    circles.color.clear();
+    rects.x.clear();
+    rects.y.clear();
+    rects.width.clear();
+    rects.height.clear();
+    rects.color.clear();
+    lines.x0.clear();
+    lines.y0.clear();
+    lines.x1.clear();
+    lines.y1.clear();
+    lines.color.clear();
+}
+
+size_t PrimitiveBatch::GetPrimitiveCount() const
+{
+    return circles.x.size() + rects.x.size() + lines.x0.size();
+}
+
+void TileBinner::Bin(const PrimitiveBatch& batch, int newWidth, int newHeight, TileScheduler* scheduler)
+{
+    width = newWidth;
+    height = newHeight;
+    tilesX = (width + TILE_SIZE - 1) / TILE_SIZE;
+    tilesY = (height + TILE_SIZE - 1) / TILE_SIZE;
+    size_t tileCount = (size_t)tilesX * tilesY;
+    PixelBounds screen = { 0, 0, width - 1, height - 1 };
+
+    // Кусков больше, чем потоков, чтобы было что красть; мелкий пакет — одним куском
+    size_t total = batch.GetPrimitiveCount();
+    int chunks = 1;
+    if (scheduler != nullptr && scheduler->GetThreadCount() > 1)
+        chunks = (int)std::max<size_t>(1, std::min<size_t>(scheduler->GetThreadCount() * 4, total / 16384));
+    chunkCursors.assign((size_t)chunks * tileCount, 0);
+
+    auto forEachChunk = [&](const std::function<void(int, int)>& work)
+    {
+        if (chunks > 1)
+            scheduler->ParallelFor(chunks, work);
+        else
+            work(0, 0);
+    };
+
+    // Первый проход: сколько записей каждый кусок отдаёт каждой плитке
+    forEachChunk([&](int chunk, int)
+    {
+        uint32_t* counts = chunkCursors.data() + (size_t)chunk * tileCount;
+        ForEachPrimitive(batch, screen, total * chunk / chunks, total * (chunk + 1) / chunks,
+                         [this, counts](const TileEntry&, const PixelBounds& bounds)
+        {
+            for (int ty = bounds.top / TILE_SIZE; ty <= bounds.bottom / TILE_SIZE; ++ty)
+                for (int tx = bounds.left / TILE_SIZE; tx <= bounds.right / TILE_SIZE; ++tx)
+                    ++counts[(size_t)ty * tilesX + tx];
+        });
+    });
+
+    // Места в плитке идут по порядку кусков, поэтому порядок примитивов сохраняется
+    offsets.resize(tileCount + 1);
+    uint32_t running = 0;
+    for (size_t tile = 0; tile < tileCount; ++tile)
+    {
+        offsets[tile] = running;
+        for (int chunk = 0; chunk < chunks; ++chunk)
+        {
+            uint32_t& cursor = chunkCursors[(size_t)chunk * tileCount + tile];
+            uint32_t count = cursor;
+            cursor = running;
+            running += count;
+        }
+    }
+    offsets[tileCount] = running;
+
+    // Второй проход раскладывает записи по уже известным местам
+    entries.resize(running);
+    forEachChunk([&](int chunk, int)
+    {
+        uint32_t* cursors = chunkCursors.data() + (size_t)chunk * tileCount;
+        ForEachPrimitive(batch, screen, total * chunk / chunks, total * (chunk + 1) / chunks,
+                         [this, cursors](const TileEntry& entry, const PixelBounds& bounds)
+        {
+            for (int ty = bounds.top / TILE_SIZE; ty <= bounds.bottom / TILE_SIZE; ++ty)
+                for (int tx = bounds.left / TILE_SIZE; tx <= bounds.right / TILE_SIZE; ++tx)
+                    entries[cursors[(size_t)ty * tilesX + tx]++] = entry;
+        });
+    });
+}
+
+void RasterizeTile(const TileBinner& binner, int tile, Framebuffer& target)
+{
+    int left = (tile % binner.GetTilesX()) * TileBinner::TILE_SIZE;
+    int top = (tile / binner.GetTilesX()) * TileBinner::TILE_SIZE;
+    PixelBounds clip = { left, top, std::min(left + TileBinner::TILE_SIZE, target.width) - 1,
+                         std::min(top + TileBinner::TILE_SIZE, target.height) - 1 };
+    for (const TileEntry* entry = binner.TileBegin(tile); entry != binner.TileEnd(tile); ++entry)
+        DrawEntry(*entry, target, clip);
+}
+
+void RasterizeBatch(const PrimitiveBatch& batch, TileBinner& binner, Framebuffer& target, TileScheduler* scheduler)
+{
+    binner.Bin(batch, target.width, target.height, scheduler);
+    if (scheduler == nullptr)
+    {
+        for (int tile = 0; tile < binner.GetTileCount(); ++tile)
+            RasterizeTile(binner, tile, target);
+        return;
+    }
+    scheduler->ParallelFor(binner.GetTileCount(), [&](int tile, int)
+    {
+        RasterizeTile(binner, tile, target);
+    });
+}
+
+void RasterizeBatchDirect(const PrimitiveBatch& batch, Framebuffer& target)
+{
+    PixelBounds screen = { 0, 0, target.width - 1, target.height - 1 };
+    ForEachPrimitive(batch, screen, 0, batch.GetPrimitiveCount(), [&target, &screen](const TileEntry& entry, const PixelBounds&)
+    {
+        DrawEntry(entry, target, screen);
+    });
+}
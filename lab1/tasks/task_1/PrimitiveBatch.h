@@ -0,0 +1,112 @@
+#ifndef PRIMITIVEBATCH_H
+#define PRIMITIVEBATCH_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "Framebuffer.h"
+#include "TileScheduler.h"
+
+// Примитивы в раскладке "структура массивов": каждое поле — свой массив,
+// так что проход по координатам не тянет в кэш цвета и наоборот.
+struct CircleArrays
+{
+    std::vector<float> x, y, radius;
+    std::vector<uint32_t> color;
+};
+
+struct RectArrays
+{
+    std::vector<float> x, y, width, height;
+    std::vector<uint32_t> color;
+};
+
+struct LineArrays
+{
+    std::vector<float> x0, y0, x1, y1;
+    std::vector<uint32_t> color;
+};
+
+// Набор примитивов одного кадра. Цвета уже упакованы в ARGB8888, альфа не смешивается.
+class PrimitiveBatch
+{
+public:
+    void AddCircle(float x, float y, float radius, uint32_t color);
+    void AddRect(float x, float y, float width, float height, uint32_t color);
+    void AddLine(float x0, float y0, float x1, float y1, uint32_t color);
+    // Готовые массивы (например, частицы) добавляются целиком
+    void AddCircles(const float* x, const float* y, const float* radius, const uint32_t* color, size_t count);
+    void Clear();
+
+    size_t GetPrimitiveCount() const;
+    const CircleArrays& GetCircles() const { return circles; }
+    const RectArrays& GetRects() const { return rects; }
+    const LineArrays& GetLines() const { return lines; }
+
+private:
+    CircleArrays circles;
+    RectArrays rects;
+    LineArrays lines;
+};
+
+// Примитив, уже приведённый к целым пиксельным координатам, в списке плитки.
+// Круг: a, b — центр, c — радиус; прямоугольник: a, b, c, d — границы
+// включительно; линия: (a, b) — (c, d).
+struct TileEntry
+{
+    int32_t a, b, c, d;
+    uint32_t color;
+    uint32_t type;
+};
+
+// Раскладка примитивов по плиткам экрана TILE_SIZE x TILE_SIZE. Списки плиток
+// лежат в одном массиве (подсчёт, префиксные суммы, заполнение), без выделений
+// на каждую плитку, и хранят сами примитивы, а не индексы: плитка читает свой
+// список подряд, не прыгая по массивам пакета. Порядок внутри плитки:
+// прямоугольники, круги, линии, внутри типа — порядок добавления.
+// С планировщиком раскладка идёт кусками пакета параллельно; места кусков
+// внутри плитки идут по порядку кусков, так что результат тот же, что и в одном потоке.
+class TileBinner
+{
+public:
+    static const int TILE_SIZE = 64;
+
+    enum PrimitiveType : uint32_t
+    {
+        Rect = 0,
+        Circle = 1,
+        Line = 2
+    };
+
+    void Bin(const PrimitiveBatch& batch, int width, int height, TileScheduler* scheduler = nullptr);
+
+    int GetTilesX() const { return tilesX; }
+    int GetTilesY() const { return tilesY; }
+    int GetTileCount() const { return tilesX * tilesY; }
+    const TileEntry* TileBegin(int tile) const { return entries.data() + offsets[tile]; }
+    const TileEntry* TileEnd(int tile) const { return entries.data() + offsets[tile + 1]; }
+
+private:
+    int width = 0;
+    int height = 0;
+    int tilesX = 0;
+    int tilesY = 0;
+    std::vector<uint32_t> offsets;
+    std::vector<uint32_t> chunkCursors;  // [кусок][плитка]
+    std::vector<TileEntry> entries;
+};
+
+// Рисует все примитивы одной плитки за один проход, запись только внутри плитки
+void RasterizeTile(const TileBinner& binner, int tile, Framebuffer& target);
+
+// Раскладка по плиткам и отрисовка всех плиток. С планировщиком плитки рисуются
+// параллельно; каждую плитку целиком рисует один поток, поэтому кадр совпадает
+// с однопоточным до пикселя при любом числе потоков.
+void RasterizeBatch(const PrimitiveBatch& batch, TileBinner& binner, Framebuffer& target,
+                    TileScheduler* scheduler = nullptr);
+
+// Отрисовка по одному примитиву без плиток — для сравнения в бенчмарке
+void RasterizeBatchDirect(const PrimitiveBatch& batch, Framebuffer& target);
+
+#endif  // PRIMITIVEBATCH_H
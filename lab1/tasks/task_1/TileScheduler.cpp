@@ -0,0 +1,142 @@
+#include "TileScheduler.h"
+
+namespace
+{
+    uint64_t PackRange(uint32_t begin, uint32_t end)
+    {
+        return ((uint64_t)begin << 32) | end;
+    }
+}
+
+TileScheduler::TileScheduler(int requestedThreads)
+    : threadCount(requestedThreads > 0 ? requestedThreads : DefaultThreadCount())
+{
+    ranges.reset(new WorkerRange[threadCount]);
+    for (int worker = 0; worker < threadCount; ++worker)
+        ranges[worker].range.store(0);
+    for (int worker = 1; worker < threadCount; ++worker)
+        threads.emplace_back(&TileScheduler::WorkerMain, this, worker);
+}
+
+TileScheduler::~TileScheduler()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    wake.notify_all();
+    for (std::thread& thread : threads)
+        thread.join();
+}
+
+int TileScheduler::DefaultThreadCount()
+{
+    unsigned count = std::thread::hardware_concurrency();
+    return count > 0 ? (int)count : 1;
+}
+
+void TileScheduler::ParallelFor(int count, const std::function<void(int, int)>& work)
+{
+    if (threadCount == 1 || count <= 1)
+    {
+        for (int index = 0; index < count; ++index)
+            work(index, 0);
+        return;
+    }
+
+    for (int worker = 0; worker < threadCount; ++worker)
+    {
+        uint32_t begin = (uint32_t)((int64_t)count * worker / threadCount);
+        uint32_t end = (uint32_t)((int64_t)count * (worker + 1) / threadCount);
+        ranges[worker].range.store(PackRange(begin, end), std::memory_order_relaxed);
+    }
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        task = &work;
+        running = threadCount - 1;
+        ++generation;
+    }
+    wake.notify_all();
+
+    RunWorker(0);
+
+    std::unique_lock<std::mutex> lock(mutex);
+    done.wait(lock, [this] { return running == 0; });
+    task = nullptr;
+}
+
+void TileScheduler::WorkerMain(int worker)
+{
+    uint64_t seen = 0;
+    for (;;)
+    {
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            wake.wait(lock, [this, seen] { return stopping || generation != seen; });
+            if (stopping)
+                return;
+            seen = generation;
+        }
+
+        RunWorker(worker);
+
+        std::lock_guard<std::mutex> lock(mutex);
+        if (--running == 0)
+            done.notify_one();
+    }
+}
+
+void TileScheduler::RunWorker(int worker)
+{
+    int index;
+    while (PopFront(worker, index) || Steal(worker, index))
+        (*task)(index, worker);
+}
+
+bool TileScheduler::PopFront(int worker, int& index)
+{
+    std::atomic<uint64_t>& slot = ranges[worker].range;
+    uint64_t current = slot.load(std::memory_order_acquire);
+    for (;;)
+    {
+        uint32_t begin = (uint32_t)(current >> 32);
+        uint32_t end = (uint32_t)current;
+        if (begin >= end)
+            return false;
+        if (slot.compare_exchange_weak(current, PackRange(begin + 1, end), std::memory_order_acq_rel))
+        {
+            index = (int)begin;
+            return true;
+        }
+    }
+}
+
+// Свой отрезок пуст: забираем заднюю половину первого непустого чужого.
+// Пока поток крадёт, его собственный отрезок пуст, и другие воры его не трогают,
+// поэтому остаток украденного можно записать в него простым store.
+bool TileScheduler::Steal(int thief, int& index)
+{
+    for (int offset = 1; offset < threadCount; ++offset)
+    {
+        std::atomic<uint64_t>& slot = ranges[(thief + offset) % threadCount].range;
+        uint64_t current = slot.load(std::memory_order_acquire);
+        for (;;)
+        {
+            uint32_t begin = (uint32_t)(current >> 32);
+            uint32_t end = (uint32_t)current;
+            if (begin >= end)
+                break;
+            uint32_t keep = (end - begin) / 2;
+            if (slot.compare_exchange_weak(current, PackRange(begin, begin + keep), std::memory_order_acq_rel))
+            {
+                uint32_t first = begin + keep;
+                if (first + 1 < end)
+                    ranges[thief].range.store(PackRange(first + 1, end), std::memory_order_release);
+                steals.fetch_add(1, std::memory_order_relaxed);
+                index = (int)first;
+                return true;
+            }
+        }
+    }
+    return false;
+}
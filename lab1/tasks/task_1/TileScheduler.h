@@ -0,0 +1,58 @@
+#ifndef TILESCHEDULER_H
+#define TILESCHEDULER_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Пул потоков для параллельного цикла по плиткам. Индексы [0, count) делятся
+// на равные непрерывные отрезки по потокам; поток берёт индексы с начала своего
+// отрезка, а закончив, крадёт заднюю половину чужого. Отрезок хранится одним
+// атомарным словом (начало, конец), так что и взятие, и кража — один CAS.
+// Вызывающий поток работает как поток 0.
+class TileScheduler
+{
+public:
+    explicit TileScheduler(int threadCount = 0);
+    ~TileScheduler();
+    TileScheduler(const TileScheduler&) = delete;
+    TileScheduler& operator=(const TileScheduler&) = delete;
+
+    // task(index, worker) для каждого index из [0, count); возвращает управление, когда всё сделано
+    void ParallelFor(int count, const std::function<void(int, int)>& task);
+
+    int GetThreadCount() const { return threadCount; }
+    uint64_t GetStealCount() const { return steals.load(std::memory_order_relaxed); }
+    static int DefaultThreadCount();
+
+private:
+    struct alignas(64) WorkerRange
+    {
+        std::atomic<uint64_t> range;
+    };
+
+    void WorkerMain(int worker);
+    void RunWorker(int worker);
+    bool PopFront(int worker, int& index);
+    bool Steal(int thief, int& index);
+
+    int threadCount;
+    std::vector<std::thread> threads;
+    std::unique_ptr<WorkerRange[]> ranges;
+    const std::function<void(int, int)>* task = nullptr;
+
+    std::mutex mutex;
+    std::condition_variable wake;
+    std::condition_variable done;
+    uint64_t generation = 0;
+    int running = 0;
+    bool stopping = false;
+    std::atomic<uint64_t> steals{ 0 };
+};
+
+#endif  // TILESCHEDULER_H
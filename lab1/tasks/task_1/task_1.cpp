@@ -1,5 +1,31 @@
-﻿#include <SDL.h>
+﻿// Сборка: g++ -O2 -std=c++17 -pthread task_1.cpp PrimitiveBatch.cpp LineRaster.cpp Particles.cpp TileScheduler.cpp $(sdl2-config --cflags --libs)
+//   (-DCIRCLE_SPAN_MAX_RADIUS=N меняет предел табличных кругов, по умолчанию 64)
+// Режимы:
+//   task_1                      круг radius = 4 через PutPixel
+//   task_1 --particles [N]      N частиц (по умолчанию 200000) через пакетный API
+//   task_1 --threads N          число потоков отрисовки частиц (по умолчанию все ядра)
+//   task_1 --benchmark          без окна: пропускная способность пакетной отрисовки
+//   task_1 --benchmark threads  без окна: ускорение на 1, 2, 4, 8 и всех ядрах
+//   task_1 --benchmark circles  без окна: табличные круги против FillCircleSquare
+//   task_1 --benchmark lines    без окна: Брезенхем, Ву и толстые линии против DDA с PutPixel
+#include <SDL.h>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <iomanip>
 #include <iostream>
+#include <set>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "CircleSpans.h"
+#include "Framebuffer.h"
+#include "LineRaster.h"
+#include "Particles.h"
+#include "PrimitiveBatch.h"
+#include "TileScheduler.h"
 
 void PutPixel
 (
@@ -35,7 +61,16 @@ void DrawCircle
 
     while (x >= y) 
     {
-   
+        // Восемь симметричных точек октантов
+        PutPixel(renderer, centerX + x, centerY + y, screenWidth, screenHeight, color);
+        PutPixel(renderer, centerX + y, centerY + x, screenWidth, screenHeight, color);
+        PutPixel(renderer, centerX - y, centerY + x, screenWidth, screenHeight, color);
+        PutPixel(renderer, centerX - x, centerY + y, screenWidth, screenHeight, color);
+        PutPixel(renderer, centerX - x, centerY - y, screenWidth, screenHeight, color);
+        PutPixel(renderer, centerX - y, centerY - x, screenWidth, screenHeight, color);
+        PutPixel(renderer, centerX + y, centerY - x, screenWidth, screenHeight, color);
+        PutPixel(renderer, centerX + x, centerY - y, screenWidth, screenHeight, color);
+
         y++;
 
         if (decisionOver2 <= 0) 
@@ -70,8 +105,476 @@ void FillCircleSquare(SDL_Renderer* renderer, int centerX, int centerY, int radi
     }
 }
 
+void RunCircleDemo(SDL_Renderer* renderer, int screenWidth, int screenHeight)
+{
+    SDL_Event event;
+    bool quit = false;
+    int centerX = screenWidth / 2;
+    int centerY = screenHeight / 2;
+    int radius = 4;
+    SDL_Color outlineColor = { 255, 255, 255, 255 }; 
+    SDL_Color fillColor = { 0, 255, 0, 255 };     
+
+    while (!quit) 
+    {
+        while (SDL_PollEvent(&event) != 0) 
+        {
+            if (event.type == SDL_QUIT) 
+            {
+                quit = true;
+            }
+        }
+
+        SDL_SetRenderDrawColor(renderer, 0, 0, 0, 255);
+        SDL_RenderClear(renderer);
+
+        DrawCircle(renderer, centerX, centerY, radius, screenWidth, screenHeight, outlineColor);
+
+        FillCircleSquare(renderer, centerX, centerY, radius, screenWidth, screenHeight, fillColor);
+
+        SDL_RenderPresent(renderer);
+    }
+}
+
+void RunParticleDemo(SDL_Window* window, SDL_Renderer* renderer, int screenWidth, int screenHeight, size_t particleCount,
+                     int threadCount)
+{
+    // Кадр рисуется в памяти и целиком загружается в текстуру
+    SDL_Texture* texture = SDL_CreateTexture(renderer, SDL_PIXELFORMAT_ARGB8888, SDL_TEXTUREACCESS_STREAMING, screenWidth, screenHeight);
+    if (texture == nullptr)
+    {
+        std::cout << "Texture creation failed: " << SDL_GetError() << std::endl;
+        return;
+    }
+
+    Framebuffer framebuffer;
+    framebuffer.Resize(screenWidth, screenHeight);
+    ParticleSystem particles;
+    particles.Spawn(particleCount, screenWidth, screenHeight, 1);
+    PrimitiveBatch batch;
+    TileBinner binner;
+    TileScheduler scheduler(threadCount);
+
+    using Clock = std::chrono::steady_clock;
+    Clock::time_point lastFrame = Clock::now();
+    Clock::time_point lastReport = lastFrame;
+    double rasterMs = 0.0;
+    int frames = 0;
+
+    SDL_Event event;
+    bool quit = false;
+    while (!quit)
+    {
+        while (SDL_PollEvent(&event) != 0)
+        {
+            if (event.type == SDL_QUIT)
+            {
+                quit = true;
+            }
+        }
+
+        Clock::time_point now = Clock::now();
+        float dt = std::min(std::chrono::duration<float>(now - lastFrame).count(), 0.05f);
+        lastFrame = now;
+        particles.Update(dt, screenWidth, screenHeight);
+
+        Clock::time_point rasterStart = Clock::now();
+        batch.Clear();
+        particles.Submit(batch);
+        framebuffer.Clear(PackColor(0, 0, 0));
+        RasterizeBatch(batch, binner, framebuffer, &scheduler);
+        rasterMs += std::chrono::duration<double, std::milli>(Clock::now() - rasterStart).count();
+
+        SDL_UpdateTexture(texture, nullptr, framebuffer.pixels.data(), framebuffer.width * 4);
+        SDL_RenderCopy(renderer, texture, nullptr, nullptr);
+        SDL_RenderPresent(renderer);
+
+        // Раз в секунду — частота кадров и время отрисовки в заголовке окна
+        ++frames;
+        double sinceReport = std::chrono::duration<double>(now - lastReport).count();
+        if (sinceReport >= 1.0)
+        {
+            std::string title = "Particles: " + std::to_string(particleCount) + ", " +
+                                std::to_string(scheduler.GetThreadCount()) + " threads, " +
+                                std::to_string((int)(frames / sinceReport)) + " fps, raster " +
+                                std::to_string(rasterMs / frames).substr(0, 5) + " ms";
+            SDL_SetWindowTitle(window, title.c_str());
+            lastReport = now;
+            rasterMs = 0.0;
+            frames = 0;
+        }
+    }
+
+    SDL_DestroyTexture(texture);
+}
+
+// Пакетная отрисовка по плиткам против отрисовки по одному примитиву
+// на кадре 1920x1080; заодно проверяется, что результаты совпадают
+int RunBatchBenchmark()
+{
+    using Clock = std::chrono::steady_clock;
+    const int width = 1920;
+    const int height = 1080;
+    const int frames = 10;
+    const size_t counts[] = { 10000, 100000, 1000000 };
+
+    Framebuffer binned;
+    Framebuffer direct;
+    binned.Resize(width, height);
+    direct.Resize(width, height);
+    PrimitiveBatch batch;
+    TileBinner binner;
+
+    std::cout << std::fixed << std::setprecision(2);
+    std::cout << "particles   binned ms/frame (bin + raster)  Mprims/s   direct ms/frame  Mprims/s   identical" << std::endl;
+    for (size_t count : counts)
+    {
+        ParticleSystem particles;
+        particles.Spawn(count, width, height, 1);
+        double binnedMs = 0.0;
+        double binMs = 0.0;
+        double tilesMs = 0.0;
+        double directMs = 0.0;
+        bool identical = true;
+        for (int frame = 0; frame < frames; ++frame)
+        {
+            particles.Update(1.0f / 60.0f, width, height);
+
+            Clock::time_point start = Clock::now();
+            batch.Clear();
+            particles.Submit(batch);
+            binned.Clear(PackColor(0, 0, 0));
+            Clock::time_point binStart = Clock::now();
+            binner.Bin(batch, width, height);
+            Clock::time_point tilesStart = Clock::now();
+            for (int tile = 0; tile < binner.GetTileCount(); ++tile)
+            {
+                RasterizeTile(binner, tile, binned);
+            }
+            Clock::time_point end = Clock::now();
+            binnedMs += std::chrono::duration<double, std::milli>(end - start).count();
+            binMs += std::chrono::duration<double, std::milli>(tilesStart - binStart).count();
+            tilesMs += std::chrono::duration<double, std::milli>(end - tilesStart).count();
+
+            start = Clock::now();
+            batch.Clear();
+            particles.Submit(batch);
+            direct.Clear(PackColor(0, 0, 0));
+            RasterizeBatchDirect(batch, direct);
+            directMs += std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+
+            identical = identical && binned.pixels == direct.pixels;
+        }
+        binnedMs /= frames;
+        binMs /= frames;
+        tilesMs /= frames;
+        directMs /= frames;
+        std::cout << std::setw(9) << count << std::setw(18) << binnedMs << " (" << std::setw(6) << binMs << " + "
+                  << std::setw(6) << tilesMs << ")" << std::setw(10) << count / (binnedMs * 1000.0)
+                  << std::setw(18) << directMs << std::setw(10) << count / (directMs * 1000.0)
+                  << std::setw(12) << (identical ? "yes" : "NO") << std::endl;
+    }
+    return 0;
+}
+
+// Однопоточная отрисовка по плиткам против параллельной; каждый кадр
+// сравнивается с однопоточным эталоном попиксельно
+int RunThreadBenchmark()
+{
+    using Clock = std::chrono::steady_clock;
+    const int width = 1920;
+    const int height = 1080;
+    const int frames = 10;
+    const size_t count = 1000000;
+
+    ParticleSystem particles;
+    particles.Spawn(count, width, height, 1);
+    particles.Update(1.0f / 60.0f, width, height);
+    PrimitiveBatch batch;
+    particles.Submit(batch);
+    TileBinner binner;
+
+    Framebuffer reference;
+    reference.Resize(width, height);
+    double singleMs = 0.0;
+    for (int frame = 0; frame < frames; ++frame)
+    {
+        Clock::time_point start = Clock::now();
+        reference.Clear(PackColor(0, 0, 0));
+        RasterizeBatch(batch, binner, reference);
+        singleMs += std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+    }
+    singleMs /= frames;
+
+    int hardwareThreads = TileScheduler::DefaultThreadCount();
+    std::set<int> threadCounts = { 1, 2, 4, 8, hardwareThreads };
+
+    std::cout << std::fixed << std::setprecision(2);
+    std::cout << count << " particles, " << width << "x" << height << ", hardware threads: " << hardwareThreads << std::endl;
+    std::cout << "single-threaded path: " << singleMs << " ms/frame" << std::endl;
+    std::cout << "threads   ms/frame   speedup   steals/frame   identical" << std::endl;
+
+    Framebuffer target;
+    target.Resize(width, height);
+    for (int threads : threadCounts)
+    {
+        TileScheduler scheduler(threads);
+        target.Clear(PackColor(0, 0, 0));
+        RasterizeBatch(batch, binner, target, &scheduler);
+        uint64_t stealsBefore = scheduler.GetStealCount();
+
+        double parallelMs = 0.0;
+        bool identical = true;
+        for (int frame = 0; frame < frames; ++frame)
+        {
+            Clock::time_point start = Clock::now();
+            target.Clear(PackColor(0, 0, 0));
+            RasterizeBatch(batch, binner, target, &scheduler);
+            parallelMs += std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+            identical = identical && target.pixels == reference.pixels;
+        }
+        parallelMs /= frames;
+        std::cout << std::setw(7) << threads << std::setw(11) << parallelMs << std::setw(9) << singleMs / parallelMs << "x"
+                  << std::setw(15) << (scheduler.GetStealCount() - stealsBefore) / (double)frames
+                  << std::setw(12) << (identical ? "yes" : "NO") << std::endl;
+    }
+    return 0;
+}
+
+// FillCircleSquare с записью в память вместо SDL_RenderDrawPoint: тот же перебор
+// квадрата с проверкой каждого пикселя, без накладных расходов рендерера
+void FillCircleSquareMemory(Framebuffer& target, int centerX, int centerY, int radius, uint32_t color)
+{
+    for (int cX = centerX - radius; cX <= centerX + radius; ++cX)
+    {
+        for (int cY = centerY - radius; cY <= centerY + radius; ++cY)
+        {
+            if ((cX - centerX) * (cX - centerX) + (cY - centerY) * (cY - centerY) <= radius * radius &&
+                cX >= 0 && cX < target.width && cY >= 0 && cY < target.height)
+            {
+                target.Row(cY)[cX] = color;
+            }
+        }
+    }
+}
+
+// Пропускная способность малых кругов: таблица строк в трёх форматах пикселей,
+// пошаговый алгоритм, попиксельный FillCircleSquare в памяти и через программный
+// рендерер SDL; результаты таблицы и FillCircleSquare сравниваются попиксельно
+int RunCircleBenchmark()
+{
+    using Clock = std::chrono::steady_clock;
+    const int width = 1920;
+    const int height = 1080;
+    const int radii[] = { 1, 2, 3, 4, 6, 8, 16, 32, 64, 96 };
+    const uint32_t color = PackColor(0, 255, 0);
+
+    Framebuffer spans;
+    Framebuffer reference;
+    spans.Resize(width, height);
+    reference.Resize(width, height);
+    std::vector<uint16_t> pixels565((size_t)width * height);
+    std::vector<uint8_t> pixelsGray((size_t)width * height);
+    SpanTarget<PixelArgb8888> argbTarget = { spans.pixels.data(), width, 0, 0, width - 1, height - 1 };
+    SpanTarget<PixelRgb565> rgb565Target = { pixels565.data(), width, 0, 0, width - 1, height - 1 };
+    SpanTarget<PixelGray8> grayTarget = { pixelsGray.data(), width, 0, 0, width - 1, height - 1 };
+
+    // Программный рендерер SDL рисует в поверхность и не требует окна
+    SDL_Surface* surface = SDL_CreateRGBSurfaceWithFormat(0, width, height, 32, SDL_PIXELFORMAT_ARGB8888);
+    SDL_Renderer* renderer = surface != nullptr ? SDL_CreateSoftwareRenderer(surface) : nullptr;
+    SDL_Color fillColor = { 0, 255, 0, 255 };
+
+    // Каждый замер — одна и та же последовательность центров, часть кругов у края кадра
+    auto measure = [&](int count, int radius, auto draw)
+    {
+        uint32_t seed = 12345;
+        Clock::time_point start = Clock::now();
+        for (int i = 0; i < count; ++i)
+        {
+            seed = seed * 1664525u + 1013904223u;
+            int x = (int)((seed >> 8) % (uint32_t)(width + 2 * radius)) - radius;
+            seed = seed * 1664525u + 1013904223u;
+            int y = (int)((seed >> 8) % (uint32_t)(height + 2 * radius)) - radius;
+            draw(x, y, radius);
+        }
+        double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+        return count / seconds / 1e6;
+    };
+
+    std::cout << "table radius limit: " << CIRCLE_SPAN_MAX_RADIUS << ", frame " << width << "x" << height << std::endl;
+    std::cout << "Mcircles/s:" << std::endl;
+    std::cout << "radius   ARGB8888    RGB565     Gray8  incremental  per-pixel  SDL square  speedup  outline  identical"
+              << std::endl;
+    std::cout << std::fixed << std::setprecision(3);
+    for (int radius : radii)
+    {
+        int count = std::max(2000, (int)(40000000 / ((2 * radius + 1) * (2 * radius + 1))));
+
+        spans.Clear(0);
+        reference.Clear(0);
+        double argb = measure(count, radius, [&](int x, int y, int r) { FillCircleSpans(argbTarget, x, y, r, color); });
+        double rgb565 = measure(count, radius, [&](int x, int y, int r) { FillCircleSpans(rgb565Target, x, y, r, PixelRgb565::Pack(color)); });
+        double gray = measure(count, radius, [&](int x, int y, int r) { FillCircleSpans(grayTarget, x, y, r, PixelGray8::Pack(color)); });
+        double incremental = measure(count, radius, [&](int x, int y, int r) { FillCircleIncremental(argbTarget, x, y, r, color); });
+        double perPixel = measure(count, radius, [&](int x, int y, int r) { FillCircleSquareMemory(reference, x, y, r, color); });
+        bool identical = spans.pixels == reference.pixels;
+
+        std::string sdl = "n/a";
+        if (renderer != nullptr)
+        {
+            int sdlCount = std::max(200, count / 50);
+            double rate = measure(sdlCount, radius, [&](int x, int y, int r) { FillCircleSquare(renderer, x, y, r, width, height, fillColor); });
+            std::ostringstream text;
+            text << std::fixed << std::setprecision(3) << rate;
+            sdl = text.str();
+        }
+
+        double outline = measure(count, radius, [&](int x, int y, int r) { DrawCircleOutlineSpans(argbTarget, x, y, r, color); });
+
+        std::cout << std::setw(6) << radius << std::setw(11) << argb << std::setw(10) << rgb565 << std::setw(10) << gray
+                  << std::setw(13) << incremental << std::setw(11) << perPixel << std::setw(12) << sdl
+                  << std::setw(8) << std::setprecision(1) << argb / perPixel << "x" << std::setprecision(3)
+                  << std::setw(9) << outline << std::setw(11) << (identical ? "yes" : "NO") << std::endl;
+    }
+
+    if (renderer != nullptr)
+        SDL_DestroyRenderer(renderer);
+    if (surface != nullptr)
+        SDL_FreeSurface(surface);
+    return 0;
+}
+
+// Линия по точкам, как через PutPixel: DDA с проверкой границ на каждом пикселе
+void DrawLineDda(Framebuffer& target, int x0, int y0, int x1, int y1, uint32_t color)
+{
+    int dx = x1 - x0;
+    int dy = y1 - y0;
+    int steps = std::max(std::abs(dx), std::abs(dy));
+    float stepX = steps > 0 ? (float)dx / steps : 0.0f;
+    float stepY = steps > 0 ? (float)dy / steps : 0.0f;
+    for (int step = 0; step <= steps; ++step)
+    {
+        int x = (int)std::floor(x0 + stepX * step + 0.5f);
+        int y = (int)std::floor(y0 + stepY * step + 0.5f);
+        if (x >= 0 && x < target.width && y >= 0 && y < target.height)
+        {
+            target.Row(y)[x] = color;
+        }
+    }
+}
+
+// Пропускная способность линий: короткие, длинные и длинные, большей частью
+// лежащие за пределами кадра (там особенно заметно отсечение до растеризации)
+int RunLineBenchmark()
+{
+    using Clock = std::chrono::steady_clock;
+    const int width = 1920;
+    const int height = 1080;
+    const uint32_t color = PackColor(255, 255, 255);
+
+    struct LineSet
+    {
+        const char* name;
+        int count;
+        int length;
+        int margin;
+    };
+    const LineSet sets[] = {
+        { "short (~10 px)", 2000000, 10, 0 },
+        { "long (~1000 px)", 20000, 1000, 0 },
+        { "long, mostly off-screen", 20000, 1000, 4000 },
+    };
+
+    Framebuffer target;
+    target.Resize(width, height);
+    ClipRect clip = FullClip(target);
+
+    std::cout << std::fixed << std::setprecision(3);
+    std::cout << "Mlines/s, frame " << width << "x" << height << std::endl;
+    std::cout << "set                           DDA+check  Bresenham    speedup         Wu  thick w=4" << std::endl;
+    for (const LineSet& set : sets)
+    {
+        std::vector<int> coordinates((size_t)set.count * 4);
+        uint32_t seed = 12345;
+        auto next = [&seed](int range)
+        {
+            seed = seed * 1664525u + 1013904223u;
+            return (int)((seed >> 8) % (uint32_t)range);
+        };
+        for (int i = 0; i < set.count; ++i)
+        {
+            int x = next(width + 2 * set.margin) - set.margin;
+            int y = next(height + 2 * set.margin) - set.margin;
+            coordinates[i * 4 + 0] = x;
+            coordinates[i * 4 + 1] = y;
+            coordinates[i * 4 + 2] = x + next(2 * set.length + 1) - set.length;
+            coordinates[i * 4 + 3] = y + next(2 * set.length + 1) - set.length;
+        }
+
+        auto measure = [&](auto draw)
+        {
+            target.Clear(0);
+            Clock::time_point start = Clock::now();
+            for (int i = 0; i < set.count; ++i)
+            {
+                const int* line = &coordinates[(size_t)i * 4];
+                draw(line[0], line[1], line[2], line[3]);
+            }
+            double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+            return set.count / seconds / 1e6;
+        };
+
+        double dda = measure([&](int x0, int y0, int x1, int y1) { DrawLineDda(target, x0, y0, x1, y1, color); });
+        double bresenham = measure([&](int x0, int y0, int x1, int y1) { DrawLineBresenham(target, x0, y0, x1, y1, color, clip); });
+        double wu = measure([&](int x0, int y0, int x1, int y1)
+                            { DrawLineWu(target, (float)x0, (float)y0, (float)x1, (float)y1, color, clip); });
+        double thick = measure([&](int x0, int y0, int x1, int y1)
+                               { DrawThickLine(target, (float)x0, (float)y0, (float)x1, (float)y1, 4.0f, color, clip); });
+        std::cout << std::left << std::setw(28) << set.name << std::right << std::setw(11) << dda << std::setw(11)
+                  << bresenham << std::setw(10) << std::setprecision(1) << bresenham / dda << "x" << std::setprecision(3)
+                  << std::setw(11) << wu << std::setw(11) << thick << std::endl;
+    }
+    return 0;
+}
+
 int main(int argc, char* argv[]) 
 {
+    bool particleMode = false;
+    size_t particleCount = 200000;
+    int threadCount = 0;
+    for (int i = 1; i < argc; ++i)
+    {
+        std::string argument = argv[i];
+        if (argument == "--benchmark")
+        {
+            if (i + 1 < argc && std::string(argv[i + 1]) == "threads")
+            {
+                return RunThreadBenchmark();
+            }
+            if (i + 1 < argc && std::string(argv[i + 1]) == "circles")
+            {
+                return RunCircleBenchmark();
+            }
+            if (i + 1 < argc && std::string(argv[i + 1]) == "lines")
+            {
+                return RunLineBenchmark();
+            }
+            return RunBatchBenchmark();
+        }
+        if (argument == "--threads" && i + 1 < argc)
+        {
+            threadCount = std::atoi(argv[++i]);
+        }
+        if (argument == "--particles")
+        {
+            particleMode = true;
+            if (i + 1 < argc && argv[i + 1][0] >= '0' && argv[i + 1][0] <= '9')
+            {
+                particleCount = std::strtoul(argv[++i], nullptr, 10);
+            }
+        }
+    }
+
     if (SDL_Init(SDL_INIT_VIDEO) < 0) 
     {
         std::cout << "SDL initialization failed: " << SDL_GetError() << std::endl;
@@ -105,32 +608,13 @@ int main(int argc, char* argv[])
         return 1;
     }
 
-    SDL_Event event;
-    bool quit = false;
-    int centerX = screenWidth / 2;
-    int centerY = screenHeight / 2;
-    int radius = 4;
-    SDL_Color outlineColor = { 255, 255, 255, 255 }; 
-    SDL_Color fillColor = { 0, 255, 0, 255 };     
-
-    while (!quit) 
+    if (particleMode)
     {
-        while (SDL_PollEvent(&event) != 0) 
-        {
-            if (event.type == SDL_QUIT) 
-            {
-                quit = true;
-            }
-        }
-
-        SDL_SetRenderDrawColor(renderer, 0, 0, 0, 255);
-        SDL_RenderClear(renderer);
-
-        DrawCircle(renderer, centerX, centerY, radius, screenWidth, screenHeight, outlineColor);
-
-        FillCircleSquare(renderer, centerX, centerY, radius, screenWidth, screenHeight, fillColor);
-
-        SDL_RenderPresent(renderer);
+        RunParticleDemo(window, renderer, screenWidth, screenHeight, particleCount, threadCount);
+    }
+    else
+    {
+        RunCircleDemo(renderer, screenWidth, screenHeight);
     }
 
     SDL_DestroyRenderer(renderer);
@@ -0,0 +1,205 @@
+#include "AnimationPlayer.h"
+#include <chrono>
+#include <utility>
+
+#include "SurfaceDraw.h"
+#include "Trace.h"
+
+namespace {
+double MillisecondsSince(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+}  // namespace
+
+AnimationPlayer::AnimationPlayer()
+    : stopping(false), decodeMs(0.0), framesDecoded(0), playing(false), stalled(false), nextFrameMs(0.0),
+      frameIndex(0), loopsLeft(0), hasPrevious(false) {}
+
+AnimationPlayer::~AnimationPlayer() {
+    Stop();
+}
+
+bool AnimationPlayer::Start(std::unique_ptr<AnimationSource> newSource, const Surface& newCanvas, double nowMs) {
+    Stop();
+    if (!newSource || newSource->GetFrameCount() == 0 || !newCanvas.pixels ||
+        newCanvas.width < newSource->GetWidth() || newCanvas.height < newSource->GetHeight()) {
+        return false;
+    }
+
+    // Кадр не больше холста, поэтому буферы кольца — размером с холст
+    SurfacePool& pool = SurfacePool::Instance();
+    for (Slot& slot : slots) {
+        if (!pool.Acquire(newSource->GetWidth(), newSource->GetHeight(), slot.patch)) {
+            Stop();
+            return false;
+        }
+    }
+    source = std::move(newSource);
+    canvas = newCanvas;
+    stats = AnimationStats();
+    for (uint32_t i = 0; i < RING_SIZE; ++i) {
+        freeSlots.TryPush(i);
+    }
+
+    playing = true;
+    stalled = false;
+    nextFrameMs = nowMs;
+    frameIndex = 0;
+    loopsLeft = source->GetLoopCount();
+    hasPrevious = false;
+    stopping = false;
+    decodeMs = 0.0;
+    framesDecoded = 0;
+    decoder = std::thread(&AnimationPlayer::DecodeLoop, this);
+    return true;
+}
+
+void AnimationPlayer::Stop() {
+    if (decoder.joinable()) {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+        }
+        slotFreed.notify_one();
+        decoder.join();
+        stats.decodeMs = decodeMs;
+        stats.framesDecoded = framesDecoded;
+    }
+
+    // Рабочего потока уже нет, очереди можно опустошить с этой стороны
+    uint32_t index;
+    while (freeSlots.TryPop(index)) {}
+    while (readySlots.TryPop(index)) {}
+    SurfacePool& pool = SurfacePool::Instance();
+    for (Slot& slot : slots) {
+        pool.Release(slot.patch);
+    }
+    pool.Release(saved);
+    source.reset();
+    canvas = Surface();
+    playing = false;
+}
+
+void AnimationPlayer::DecodeLoop() {
+    bool ready = source->BeginDecoding();
+    size_t count = source->GetFrameCount();
+    size_t next = 0;
+    while (!stopping) {
+        uint32_t index;
+        if (!freeSlots.TryPop(index)) {
+            std::unique_lock<std::mutex> lock(mutex);
+            slotFreed.wait(lock, [this]() { return stopping || !freeSlots.IsEmpty(); });
+            continue;
+        }
+
+        TRACE_SCOPE("DecodeAnimationFrame");
+        auto start = std::chrono::steady_clock::now();
+        Slot& slot = slots[index];
+        slot.index = next;
+        slot.frame = AnimationFrame();
+        slot.decoded = ready && source->DecodeFrame(next, slot.frame, slot.patch);
+        decodeMs += MillisecondsSince(start);
+        framesDecoded++;
+        readySlots.TryPush(index);
+        next = (next + 1) % count;
+    }
+    source->EndDecoding();
+}
+
+bool AnimationPlayer::Advance(double nowMs) {
+    if (!playing) return false;
+
+    size_t composed = 0;
+    while (playing && nowMs >= nextFrameMs) {
+        uint32_t index;
+        if (!readySlots.TryPop(index)) {
+            // Кадр покажется, как только будет готов, а расписание сдвинется от этого момента.
+            // Пустое кольцо после догоняющих кадров — отставание UI, а не декодера.
+            if (!stalled && composed == 0 && hasPrevious) stats.stalls++;
+            stalled = true;
+            break;
+        }
+
+        const Slot& slot = slots[index];
+        if (!slot.decoded) {
+            playing = false;
+        }
+        else if (slot.index == 0 && hasPrevious && loopsLeft == 1) {
+            // Все проходы показаны: на холсте остаётся последний кадр
+            playing = false;
+        }
+        else {
+            if (slot.index == 0 && hasPrevious && loopsLeft > 1) loopsLeft--;
+            Compose(slot);
+            nextFrameMs = (stalled ? nowMs : nextFrameMs) + slot.frame.delayMs;
+            stalled = false;
+            composed++;
+        }
+
+        freeSlots.TryPush(index);
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+        }
+        slotFreed.notify_one();
+    }
+
+    if (composed > 0) {
+        stats.framesShown++;
+        stats.framesDropped += composed - 1;
+    }
+    return composed > 0;
+}
+
+void AnimationPlayer::Compose(const Slot& slot) {
+    TRACE_SCOPE("ComposeAnimationFrame");
+    auto start = std::chrono::steady_clock::now();
+    const AnimationFrame& frame = slot.frame;
+
+    bool coversCanvas = frame.blend == FrameBlend::Source && frame.left == 0 && frame.top == 0 &&
+                        frame.width == canvas.width && frame.height == canvas.height;
+    if (slot.index == 0 && !coversCanvas) {
+        // Каждый проход начинается с прозрачного холста
+        FillSurfaceRect(canvas, 0, 0, canvas.width, canvas.height, 0);
+        stats.pixelsComposed += static_cast<size_t>(canvas.width) * canvas.height;
+    }
+    else if (slot.index != 0 && hasPrevious) {
+        Dispose();
+    }
+
+    previous = frame;
+    if (frame.disposal == FrameDisposal::Previous) {
+        // Участок сохраняется на тех же координатах; буфер нужен не всем анимациям
+        if (saved.pixels || SurfacePool::Instance().Acquire(canvas.width, canvas.height, saved)) {
+            CopySurfaceRect(saved, frame.left, frame.top, canvas, frame.left, frame.top, frame.width, frame.height);
+        }
+        else {
+            previous.disposal = FrameDisposal::None;
+        }
+    }
+
+    if (frame.blend == FrameBlend::Source) {
+        CopySurfaceRect(canvas, frame.left, frame.top, slot.patch, 0, 0, frame.width, frame.height);
+    }
+    else {
+        BlendSurfaceRect(canvas, frame.left, frame.top, slot.patch, 0, 0, frame.width, frame.height);
+    }
+    stats.pixelsComposed += static_cast<size_t>(frame.width) * frame.height;
+    hasPrevious = true;
+    frameIndex = slot.index;
+    stats.composeMs += MillisecondsSince(start);
+}
+
+void AnimationPlayer::Dispose() {
+    switch (previous.disposal) {
+    case FrameDisposal::Background:
+        FillSurfaceRect(canvas, previous.left, previous.top, previous.width, previous.height, 0);
+        break;
+    case FrameDisposal::Previous:
+        CopySurfaceRect(canvas, previous.left, previous.top, saved, previous.left, previous.top, previous.width,
+                        previous.height);
+        break;
+    default:
+        return;
+    }
+    stats.pixelsComposed += static_cast<size_t>(previous.width) * previous.height;
+}
@@ -0,0 +1,88 @@
+#ifndef ANIMATIONPLAYER_H
+#define ANIMATIONPLAYER_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+#include "AnimationSource.h"
+#include "SpscQueue.h"
+
+struct AnimationStats {
+  size_t framesShown = 0;    // кадров, после которых холст показывался
+  size_t framesDropped = 0;  // составлены, но перекрыты следующим до показа: поток UI опоздал
+  size_t stalls = 0;         // кадру пора на экран, а декодер его ещё не выдал
+  size_t pixelsComposed = 0;
+  double composeMs = 0.0;    // в потоке UI
+  double decodeMs = 0.0;     // в рабочем потоке; читать после Stop()
+  size_t framesDecoded = 0;  // то же
+};
+
+// Проигрывание анимации на холст. Рабочий поток декодирует кадры наперёд в кольцо
+// из RING_SIZE буферов; поток UI по таймеру вызывает Advance(), и плеер переносит
+// на холст все кадры, срок которых наступил. Каждый кадр трогает только свой
+// прямоугольник: сначала выполняется утилизация предыдущего кадра (очистка или
+// возврат сохранённого участка), затем кадр копируется или накладывается.
+// Весь холст очищается только в начале каждого прохода анимации.
+class AnimationPlayer {
+ public:
+  static const size_t RING_SIZE = 4;
+
+  AnimationPlayer();
+  ~AnimationPlayer();
+  AnimationPlayer(const AnimationPlayer&) = delete;
+  AnimationPlayer& operator=(const AnimationPlayer&) = delete;
+
+  // canvas — буфер размером с анимацию, принадлежит вызывающему и должен жить до
+  // Stop(). nowMs — любые монотонные часы, в тех же единицах потом идёт Advance().
+  bool Start(std::unique_ptr<AnimationSource> source, const Surface& canvas, double nowMs);
+  void Stop();
+  // true — холст изменился и его стоит показать
+  bool Advance(double nowMs);
+
+  bool IsPlaying() const { return playing; }
+  size_t GetFrameIndex() const { return frameIndex; }  // последний составленный кадр
+  size_t GetFrameCount() const { return source ? source->GetFrameCount() : 0; }
+  const AnimationStats& GetStats() const { return stats; }
+
+ private:
+  struct Slot {
+    Surface patch;
+    AnimationFrame frame;
+    size_t index = 0;
+    bool decoded = false;
+  };
+
+  void DecodeLoop();
+  void Compose(const Slot& slot);
+  void Dispose();
+
+  std::unique_ptr<AnimationSource> source;
+  Surface canvas;
+  Surface saved;  // участок под кадром с утилизацией Previous
+  Slot slots[RING_SIZE];
+  SpscQueue<uint32_t, RING_SIZE> freeSlots;   // UI -> декодер
+  SpscQueue<uint32_t, RING_SIZE> readySlots;  // декодер -> UI
+  std::thread decoder;
+  std::mutex mutex;
+  std::condition_variable slotFreed;
+  std::atomic<bool> stopping;
+  double decodeMs;  // только рабочий поток, в stats переносится в Stop()
+  size_t framesDecoded;
+
+  // Всё ниже — только поток UI
+  bool playing;
+  bool stalled;
+  double nextFrameMs;
+  size_t frameIndex;
+  int loopsLeft;  // 0 — бесконечно
+  AnimationFrame previous;
+  bool hasPrevious;
+  AnimationStats stats;
+};
+
+#endif  // ANIMATIONPLAYER_H
@@ -0,0 +1,392 @@
+#include "AnimationSource.h"
+
+#ifdef _WIN32
+#include <windows.h>
+#include <wincodec.h>
+#include <wrl/client.h>
+#include <algorithm>
+#include <array>
+#include <cstring>
+#include <utility>
+#include <vector>
+
+#include "MappedFile.h"
+
+#pragma comment(lib, "windowscodecs.lib")
+
+using Microsoft::WRL::ComPtr;
+
+namespace {
+bool CreateFileDecoder(const std::wstring& filePath, ComPtr<IWICImagingFactory>& factory,
+                       ComPtr<IWICBitmapDecoder>& decoder) {
+    if (FAILED(CoCreateInstance(CLSID_WICImagingFactory, nullptr, CLSCTX_INPROC_SERVER, IID_PPV_ARGS(&factory)))) {
+        return false;
+    }
+    return SUCCEEDED(factory->CreateDecoderFromFilename(filePath.c_str(), nullptr, GENERIC_READ,
+                                                        WICDecodeMetadataCacheOnDemand, &decoder));
+}
+
+// Целое из метаданных GIF: поля бывают VT_UI1, VT_UI2 и VT_UI4
+bool ReadMetadataUInt(IWICMetadataQueryReader* reader, const wchar_t* name, UINT& value) {
+    PROPVARIANT variant;
+    PropVariantInit(&variant);
+    bool ok = SUCCEEDED(reader->GetMetadataByName(name, &variant));
+    if (ok) {
+        switch (variant.vt) {
+        case VT_UI1: value = variant.bVal; break;
+        case VT_UI2: value = variant.uiVal; break;
+        case VT_UI4: value = variant.ulVal; break;
+        default: ok = false; break;
+        }
+    }
+    PropVariantClear(&variant);
+    return ok;
+}
+
+bool IsByteVector(const PROPVARIANT& variant, size_t minSize) {
+    return variant.vt == (VT_UI1 | VT_VECTOR) && variant.caub.cElems >= minSize;
+}
+
+// Расширение NETSCAPE2.0 хранит число повторов после первого показа; без него GIF
+// проигрывается один раз
+int ReadGifLoopCount(IWICMetadataQueryReader* reader) {
+    PROPVARIANT variant;
+    PropVariantInit(&variant);
+    bool netscape = SUCCEEDED(reader->GetMetadataByName(L"/appext/Application", &variant)) &&
+                    IsByteVector(variant, 11) && memcmp(variant.caub.pElems, "NETSCAPE2.0", 11) == 0;
+    PropVariantClear(&variant);
+    if (!netscape) return 1;
+
+    int repeats = 0;
+    if (SUCCEEDED(reader->GetMetadataByName(L"/appext/Data", &variant)) && IsByteVector(variant, 4) &&
+        variant.caub.pElems[1] == 1) {
+        repeats = variant.caub.pElems[2] | (variant.caub.pElems[3] << 8);
+    }
+    PropVariantClear(&variant);
+    return repeats == 0 ? 0 : repeats + 1;
+}
+
+void ClipToCanvas(AnimationFrame& frame, UINT frameWidth, UINT frameHeight, int canvasWidth, int canvasHeight) {
+    frame.width = std::max(0, std::min(static_cast<int>(frameWidth), canvasWidth - frame.left));
+    frame.height = std::max(0, std::min(static_cast<int>(frameHeight), canvasHeight - frame.top));
+}
+
+bool CopyFramePixels(IWICImagingFactory* factory, IWICBitmapSource* source, const AnimationFrame& frame,
+                     const Surface& patch) {
+    if (frame.width == 0 || frame.height == 0) return true;
+
+    ComPtr<IWICFormatConverter> converter;
+    if (FAILED(factory->CreateFormatConverter(&converter))) return false;
+    if (FAILED(converter->Initialize(source, GUID_WICPixelFormat32bppBGRA, WICBitmapDitherTypeNone, nullptr, 0.0,
+                                     WICBitmapPaletteTypeCustom))) {
+        return false;
+    }
+    WICRect rect = { 0, 0, frame.width, frame.height };
+    return SUCCEEDED(converter->CopyPixels(&rect, patch.stride, patch.stride * frame.height, patch.pixels));
+}
+
+// Общая часть источников: свой декодер в рабочем потоке плеера, в режиме MTA
+class WicAnimationSource : public AnimationSource {
+ public:
+  WicAnimationSource(int width, int height, size_t frameCount, int loopCount)
+      : width(width), height(height), frameCount(frameCount), loopCount(loopCount), comInitialized(false) {}
+
+  int GetWidth() const override { return width; }
+  int GetHeight() const override { return height; }
+  size_t GetFrameCount() const override { return frameCount; }
+  int GetLoopCount() const override { return loopCount; }
+
+  bool BeginDecoding() override {
+      comInitialized = SUCCEEDED(CoInitializeEx(nullptr, COINIT_MULTITHREADED));
+      return SUCCEEDED(CoCreateInstance(CLSID_WICImagingFactory, nullptr, CLSCTX_INPROC_SERVER,
+                                        IID_PPV_ARGS(&factory)));
+  }
+
+  void EndDecoding() override {
+      ReleaseDecoder();
+      factory.Reset();
+      if (comInitialized) CoUninitialize();
+      comInitialized = false;
+  }
+
+ protected:
+  virtual void ReleaseDecoder() {}
+
+  int width;
+  int height;
+  size_t frameCount;
+  int loopCount;
+  bool comInitialized;
+  ComPtr<IWICImagingFactory> factory;
+};
+
+class GifSource : public WicAnimationSource {
+ public:
+  GifSource(const std::wstring& filePath, int width, int height, size_t frameCount, int loopCount)
+      : WicAnimationSource(width, height, frameCount, loopCount), filePath(filePath) {}
+
+  bool BeginDecoding() override {
+      return WicAnimationSource::BeginDecoding() &&
+             SUCCEEDED(factory->CreateDecoderFromFilename(filePath.c_str(), nullptr, GENERIC_READ,
+                                                          WICDecodeMetadataCacheOnDemand, &decoder));
+  }
+
+  bool DecodeFrame(size_t index, AnimationFrame& frame, const Surface& patch) override {
+      ComPtr<IWICBitmapFrameDecode> source;
+      ComPtr<IWICMetadataQueryReader> reader;
+      if (!decoder || FAILED(decoder->GetFrame(static_cast<UINT>(index), &source))) return false;
+      if (FAILED(source->GetMetadataQueryReader(&reader))) return false;
+
+      UINT left = 0;
+      UINT top = 0;
+      UINT delay = 0;
+      UINT disposal = 0;
+      ReadMetadataUInt(reader.Get(), L"/imgdesc/Left", left);
+      ReadMetadataUInt(reader.Get(), L"/imgdesc/Top", top);
+      ReadMetadataUInt(reader.Get(), L"/grctlext/Delay", delay);
+      ReadMetadataUInt(reader.Get(), L"/grctlext/Disposal", disposal);
+
+      UINT frameWidth = 0;
+      UINT frameHeight = 0;
+      source->GetSize(&frameWidth, &frameHeight);
+      frame.left = static_cast<int>(left);
+      frame.top = static_cast<int>(top);
+      ClipToCanvas(frame, frameWidth, frameHeight, width, height);
+      // Задержку меньше 20 мс браузеры показывают как 100 мс, файлы на это рассчитаны
+      frame.delayMs = delay < 2 ? 100 : static_cast<int>(delay) * 10;
+      frame.disposal = disposal == 2 ? FrameDisposal::Background
+                       : disposal == 3 ? FrameDisposal::Previous
+                                       : FrameDisposal::None;
+      frame.blend = FrameBlend::Over;
+      return CopyFramePixels(factory.Get(), source.Get(), frame, patch);
+  }
+
+ protected:
+  void ReleaseDecoder() override { decoder.Reset(); }
+
+ private:
+  std::wstring filePath;
+  ComPtr<IWICBitmapDecoder> decoder;
+};
+
+uint32_t ReadBigEndian32(const uint8_t* data) {
+    return (static_cast<uint32_t>(data[0]) << 24) | (static_cast<uint32_t>(data[1]) << 16) |
+           (static_cast<uint32_t>(data[2]) << 8) | data[3];
+}
+
+uint32_t ReadBigEndian16(const uint8_t* data) {
+    return (static_cast<uint32_t>(data[0]) << 8) | data[1];
+}
+
+void AppendBigEndian32(std::vector<uint8_t>& out, uint32_t value) {
+    out.push_back(static_cast<uint8_t>(value >> 24));
+    out.push_back(static_cast<uint8_t>(value >> 16));
+    out.push_back(static_cast<uint8_t>(value >> 8));
+    out.push_back(static_cast<uint8_t>(value));
+}
+
+uint32_t Crc32(const uint8_t* data, size_t size) {
+    static const std::array<uint32_t, 256> table = []() {
+        std::array<uint32_t, 256> result;
+        for (uint32_t i = 0; i < 256; ++i) {
+            uint32_t c = i;
+            for (int bit = 0; bit < 8; ++bit) c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+            result[i] = c;
+        }
+        return result;
+    }();
+    uint32_t crc = 0xFFFFFFFFu;
+    for (size_t i = 0; i < size; ++i) crc = table[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+    return crc ^ 0xFFFFFFFFu;
+}
+
+void AppendChunk(std::vector<uint8_t>& out, const char* type, const uint8_t* data, size_t size) {
+    AppendBigEndian32(out, static_cast<uint32_t>(size));
+    size_t start = out.size();
+    out.insert(out.end(), type, type + 4);
+    if (size > 0) out.insert(out.end(), data, data + size);
+    AppendBigEndian32(out, Crc32(out.data() + start, size + 4));
+}
+
+const uint8_t PNG_SIGNATURE[8] = { 137, 80, 78, 71, 13, 10, 26, 10 };
+
+// Разбор APNG: кадр — это fcTL и следующие за ним IDAT/fdAT
+struct ApngLayout {
+    struct Frame {
+        AnimationFrame frame;
+        uint32_t width = 0;  // до отсечения: это размер PNG кадра
+        uint32_t height = 0;
+        std::vector<std::pair<size_t, size_t>> data;  // смещение и длина сжатых данных в файле
+    };
+
+    uint8_t header[13] = {};         // содержимое IHDR
+    std::vector<uint8_t> ancillary;  // чанки между IHDR и IDAT целиком (PLTE, tRNS, gAMA...)
+    std::vector<Frame> frames;
+    int loopCount = 0;
+};
+
+// WIC о кадрах APNG не знает, поэтому каждый кадр пересобирается в обычный PNG
+// своего размера (IHDR, общие чанки, данные кадра как IDAT) и декодируется из
+// памяти. Файл отображён: сжатые данные не копируются до декодирования кадра.
+class ApngSource : public WicAnimationSource {
+ public:
+  explicit ApngSource(ApngLayout&& layout)
+      : WicAnimationSource(static_cast<int>(ReadBigEndian32(layout.header)),
+                           static_cast<int>(ReadBigEndian32(layout.header + 4)), layout.frames.size(),
+                           layout.loopCount),
+        layout(std::move(layout)) {}
+
+  bool Open(const std::wstring& filePath) { return file.Open(filePath); }
+
+  bool DecodeFrame(size_t index, AnimationFrame& frame, const Surface& patch) override {
+      const ApngLayout::Frame& source = layout.frames[index];
+      frame = source.frame;
+
+      png.assign(PNG_SIGNATURE, PNG_SIGNATURE + sizeof(PNG_SIGNATURE));
+      uint8_t frameHeader[13];
+      memcpy(frameHeader, layout.header, sizeof(frameHeader));
+      for (int i = 0; i < 4; ++i) {
+          frameHeader[i] = static_cast<uint8_t>(source.width >> (24 - 8 * i));
+          frameHeader[4 + i] = static_cast<uint8_t>(source.height >> (24 - 8 * i));
+      }
+      AppendChunk(png, "IHDR", frameHeader, sizeof(frameHeader));
+      png.insert(png.end(), layout.ancillary.begin(), layout.ancillary.end());
+      for (const auto& [offset, length] : source.data) {
+          AppendChunk(png, "IDAT", file.GetData() + offset, length);
+      }
+      AppendChunk(png, "IEND", nullptr, 0);
+
+      ComPtr<IWICStream> stream;
+      ComPtr<IWICBitmapDecoder> decoder;
+      ComPtr<IWICBitmapFrameDecode> decoded;
+      if (FAILED(factory->CreateStream(&stream))) return false;
+      if (FAILED(stream->InitializeFromMemory(png.data(), static_cast<DWORD>(png.size())))) return false;
+      if (FAILED(factory->CreateDecoderFromStream(stream.Get(), nullptr, WICDecodeMetadataCacheOnDemand,
+                                                  &decoder))) {
+          return false;
+      }
+      if (FAILED(decoder->GetFrame(0, &decoded))) return false;
+      return CopyFramePixels(factory.Get(), decoded.Get(), frame, patch);
+  }
+
+ protected:
+  void ReleaseDecoder() override { png = std::vector<uint8_t>(); }
+
+ private:
+  ApngLayout layout;
+  MappedFile file;
+  std::vector<uint8_t> png;  // буфер пересборки, переиспользуется от кадра к кадру
+};
+
+bool ParseApng(const uint8_t* bytes, size_t size, ApngLayout& layout) {
+    if (size < sizeof(PNG_SIGNATURE) || memcmp(bytes, PNG_SIGNATURE, sizeof(PNG_SIGNATURE)) != 0) return false;
+
+    bool hasHeader = false;
+    bool animated = false;
+    bool seenData = false;
+    for (size_t pos = sizeof(PNG_SIGNATURE); pos + 12 <= size;) {
+        uint32_t length = ReadBigEndian32(bytes + pos);
+        if (length > size - pos - 12) return false;
+        const char* type = reinterpret_cast<const char*>(bytes + pos + 4);
+        const uint8_t* data = bytes + pos + 8;
+        size_t next = pos + 12 + length;
+
+        if (memcmp(type, "IHDR", 4) == 0 && length == 13) {
+            memcpy(layout.header, data, sizeof(layout.header));
+            hasHeader = true;
+        }
+        else if (memcmp(type, "acTL", 4) == 0 && length >= 8) {
+            animated = true;
+            layout.loopCount = static_cast<int>(std::min<uint32_t>(ReadBigEndian32(data + 4), 0x7FFFFFFF));
+        }
+        else if (memcmp(type, "fcTL", 4) == 0 && length >= 26 && hasHeader) {
+            ApngLayout::Frame frame;
+            frame.width = std::min<uint32_t>(ReadBigEndian32(data + 4), 0x7FFFFFFF);
+            frame.height = std::min<uint32_t>(ReadBigEndian32(data + 8), 0x7FFFFFFF);
+            frame.frame.left = static_cast<int>(std::min<uint32_t>(ReadBigEndian32(data + 12), 0x7FFFFFFF));
+            frame.frame.top = static_cast<int>(std::min<uint32_t>(ReadBigEndian32(data + 16), 0x7FFFFFFF));
+            ClipToCanvas(frame.frame, frame.width, frame.height, static_cast<int>(ReadBigEndian32(layout.header)),
+                         static_cast<int>(ReadBigEndian32(layout.header + 4)));
+            // Задержка — дробь секунды; знаменатель 0 означает сотые
+            uint32_t numerator = ReadBigEndian16(data + 20);
+            uint32_t denominator = ReadBigEndian16(data + 22);
+            frame.frame.delayMs = std::max(10, static_cast<int>(numerator * 1000 / (denominator ? denominator : 100)));
+            uint8_t disposal = data[24];
+            // "Вернуть предыдущее" у первого кадра по спецификации значит очистку
+            if (disposal == 2 && layout.frames.empty()) disposal = 1;
+            frame.frame.disposal = disposal == 1 ? FrameDisposal::Background
+                                   : disposal == 2 ? FrameDisposal::Previous
+                                                   : FrameDisposal::None;
+            frame.frame.blend = data[25] == 1 ? FrameBlend::Over : FrameBlend::Source;
+            layout.frames.push_back(std::move(frame));
+        }
+        else if (memcmp(type, "IDAT", 4) == 0) {
+            // IDAT — первый кадр, только если перед ним был fcTL; иначе это картинка вне анимации
+            seenData = true;
+            if (!layout.frames.empty()) layout.frames.back().data.emplace_back(pos + 8, length);
+        }
+        else if (memcmp(type, "fdAT", 4) == 0 && length > 4) {
+            if (!layout.frames.empty()) layout.frames.back().data.emplace_back(pos + 12, length - 4);
+        }
+        else if (memcmp(type, "IEND", 4) == 0) {
+            break;
+        }
+        else if (!seenData) {
+            layout.ancillary.insert(layout.ancillary.end(), bytes + pos, bytes + next);
+        }
+        pos = next;
+    }
+
+    if (!hasHeader || !animated || layout.frames.size() < 2) return false;
+    for (const ApngLayout::Frame& frame : layout.frames) {
+        if (frame.data.empty()) return false;
+    }
+    return ReadBigEndian32(layout.header) > 0 && ReadBigEndian32(layout.header + 4) > 0;
+}
+
+std::unique_ptr<AnimationSource> OpenGif(const std::wstring& filePath) {
+    ComPtr<IWICImagingFactory> factory;
+    ComPtr<IWICBitmapDecoder> decoder;
+    ComPtr<IWICMetadataQueryReader> reader;
+    GUID container;
+    UINT frameCount = 0;
+    if (!CreateFileDecoder(filePath, factory, decoder)) return nullptr;
+    if (FAILED(decoder->GetContainerFormat(&container)) || !IsEqualGUID(container, GUID_ContainerFormatGif)) {
+        return nullptr;
+    }
+    if (FAILED(decoder->GetFrameCount(&frameCount)) || frameCount < 2) return nullptr;
+    if (FAILED(decoder->GetMetadataQueryReader(&reader))) return nullptr;
+
+    UINT width = 0;
+    UINT height = 0;
+    if (!ReadMetadataUInt(reader.Get(), L"/logscrdesc/Width", width) ||
+        !ReadMetadataUInt(reader.Get(), L"/logscrdesc/Height", height) || width == 0 || height == 0) {
+        return nullptr;
+    }
+    return std::make_unique<GifSource>(filePath, static_cast<int>(width), static_cast<int>(height), frameCount,
+                                       ReadGifLoopCount(reader.Get()));
+}
+
+std::unique_ptr<AnimationSource> OpenApng(const std::wstring& filePath) {
+    ApngLayout layout;
+    {
+        MappedFile file;
+        if (!file.Open(filePath) || !ParseApng(file.GetData(), file.GetSize(), layout)) return nullptr;
+    }
+    auto source = std::make_unique<ApngSource>(std::move(layout));
+    if (!source->Open(filePath)) return nullptr;
+    return source;
+}
+}  // namespace
+
+std::unique_ptr<AnimationSource> OpenAnimation(const std::wstring& filePath) {
+    std::unique_ptr<AnimationSource> source = OpenApng(filePath);
+    return source ? std::move(source) : OpenGif(filePath);
+}
+
+#else
+std::unique_ptr<AnimationSource> OpenAnimation(const std::wstring& filePath) {
+    (void)filePath;
+    return nullptr;
+}
+#endif
@@ -0,0 +1,49 @@
+#ifndef ANIMATIONSOURCE_H
+#define ANIMATIONSOURCE_H
+
+#include <cstddef>
+#include <memory>
+#include <string>
+
+#include "SurfacePool.h"
+
+// Что делать с прямоугольником кадра перед следующим кадром (GIF и APNG)
+enum class FrameDisposal { None, Background, Previous };
+// Source заменяет пиксели холста вместе с альфой, Over накладывает поверх
+enum class FrameBlend { Source, Over };
+
+struct AnimationFrame {
+  int left = 0;  // прямоугольник кадра на холсте
+  int top = 0;
+  int width = 0;
+  int height = 0;
+  int delayMs = 100;
+  FrameDisposal disposal = FrameDisposal::None;
+  FrameBlend blend = FrameBlend::Over;
+};
+
+// Последовательность кадров анимации. Кадр — только его прямоугольник, холст
+// собирает AnimationPlayer. DecodeFrame и пара BeginDecoding/EndDecoding
+// вызываются из рабочего потока плеера, остальное — из любого.
+class AnimationSource {
+ public:
+  virtual ~AnimationSource() {}
+
+  virtual int GetWidth() const = 0;  // размер холста
+  virtual int GetHeight() const = 0;
+  virtual size_t GetFrameCount() const = 0;
+  virtual int GetLoopCount() const = 0;  // 0 — бесконечно
+
+  virtual bool BeginDecoding() { return true; }
+  virtual void EndDecoding() {}
+  // Пиксели кадра index (32bpp BGRA) в левый верхний угол patch размером с холст;
+  // прямоугольник кадра уже отсечён по холсту
+  virtual bool DecodeFrame(size_t index, AnimationFrame& frame, const Surface& patch) = 0;
+};
+
+// Анимированный GIF или APNG; nullptr, если файл не анимирован или не читается.
+// Декодирование через WIC, поэтому только в сборке под Windows; поток должен быть
+// инициализирован для COM.
+std::unique_ptr<AnimationSource> OpenAnimation(const std::wstring& filePath);
+
+#endif  // ANIMATIONSOURCE_H
@@ -0,0 +1,127 @@
+#include "EventScript.h"
+#include <fstream>
+#include <sstream>
+
+namespace {
+PlatformEvent MakeEvent(PlatformEvent::Type type, int x = 0, int y = 0) {
+    PlatformEvent event;
+    event.type = type;
+    event.x = x;
+    event.y = y;
+    return event;
+}
+
+struct ScriptLine {
+    int number;
+    std::string text;
+};
+
+// Разбирает строки [begin, end) в events; на "end" возвращает номер строки после него
+bool ParseBlock(const std::vector<ScriptLine>& lines, size_t begin, bool nested, std::vector<PlatformEvent>& events,
+                size_t& next, std::string& error) {
+    for (size_t i = begin; i < lines.size(); ++i) {
+        std::istringstream stream(lines[i].text);
+        std::string command;
+        stream >> command;
+        auto fail = [&](const std::string& message) {
+            error = "line " + std::to_string(lines[i].number) + ": " + message;
+            return false;
+        };
+
+        if (command == "end") {
+            if (!nested) return fail("'end' without 'repeat'");
+            next = i + 1;
+            return true;
+        }
+        if (command == "repeat") {
+            int count = 0;
+            if (!(stream >> count) || count < 0) return fail("repeat needs a count");
+            std::vector<PlatformEvent> body;
+            size_t after = 0;
+            if (!ParseBlock(lines, i + 1, true, body, after, error)) return false;
+            for (int n = 0; n < count; ++n) {
+                events.insert(events.end(), body.begin(), body.end());
+            }
+            i = after - 1;
+            continue;
+        }
+
+        int a = 0, b = 0, c = 0, d = 0, e = 0;
+        if (command == "down" || command == "up" || command == "move" || command == "dblclick") {
+            if (!(stream >> a >> b)) return fail(command + " needs X Y");
+            PlatformEvent::Type type = command == "down" ? PlatformEvent::MouseDown
+                                       : command == "up" ? PlatformEvent::MouseUp
+                                       : command == "move" ? PlatformEvent::MouseMove
+                                                           : PlatformEvent::DoubleClick;
+            events.push_back(MakeEvent(type, a, b));
+        }
+        else if (command == "wheel") {
+            if (!(stream >> a >> b >> c)) return fail("wheel needs DELTA X Y");
+            PlatformEvent event = MakeEvent(PlatformEvent::MouseWheel, b, c);
+            event.wheelDelta = a * PlatformEvent::WHEEL_STEP;
+            events.push_back(event);
+        }
+        else if (command == "key") {
+            if (!(stream >> a)) return fail("key needs a code");
+            PlatformEvent event = MakeEvent(PlatformEvent::KeyDown);
+            event.key = a;
+            events.push_back(event);
+        }
+        else if (command == "command") {
+            if (!(stream >> a)) return fail("command needs an id");
+            PlatformEvent event = MakeEvent(PlatformEvent::Command);
+            event.command = a;
+            events.push_back(event);
+        }
+        else if (command == "resize") {
+            if (!(stream >> a >> b) || a <= 0 || b <= 0) return fail("resize needs W H");
+            PlatformEvent event = MakeEvent(PlatformEvent::Resize);
+            event.width = a;
+            event.height = b;
+            events.push_back(event);
+        }
+        else if (command == "drag") {
+            if (!(stream >> a >> b >> c >> d >> e) || e < 1) return fail("drag needs X0 Y0 X1 Y1 STEPS");
+            events.push_back(MakeEvent(PlatformEvent::MouseDown, a, b));
+            for (int step = 1; step <= e; ++step) {
+                events.push_back(MakeEvent(PlatformEvent::MouseMove, a + (c - a) * step / e, b + (d - b) * step / e));
+            }
+            events.push_back(MakeEvent(PlatformEvent::MouseUp, c, d));
+        }
+        else {
+            return fail("unknown command '" + command + "'");
+        }
+    }
+    if (nested) {
+        error = "'repeat' without 'end'";
+        return false;
+    }
+    next = lines.size();
+    return true;
+}
+}  // namespace
+
+bool ParseEventScript(const std::string& text, std::vector<PlatformEvent>& events, std::string& error) {
+    std::vector<ScriptLine> lines;
+    std::istringstream stream(text);
+    std::string line;
+    for (int number = 1; std::getline(stream, line); ++number) {
+        size_t comment = line.find('#');
+        if (comment != std::string::npos) line.resize(comment);
+        if (line.find_first_not_of(" \t\r") == std::string::npos) continue;
+        lines.push_back({ number, line });
+    }
+    size_t next = 0;
+    return ParseBlock(lines, 0, false, events, next, error);
+}
+
+bool LoadEventScript(const std::filesystem::path& path, std::vector<PlatformEvent>& events, std::string& error) {
+    std::ifstream file(path, std::ios::binary);
+    if (!file) {
+        error = "cannot open " + path.string();
+        return false;
+    }
+    std::ostringstream text;
+    text << file.rdbuf();
+    return ParseEventScript(text.str(), events, error);
+}
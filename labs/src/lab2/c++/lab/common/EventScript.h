@@ -0,0 +1,22 @@
+#ifndef EVENTSCRIPT_H
+#define EVENTSCRIPT_H
+
+#include <filesystem>
+#include <string>
+#include <vector>
+
+#include "Platform.h"
+
+// Сценарий событий для OffscreenHost, по команде в строке:
+//   down X Y | up X Y | move X Y | dblclick X Y
+//   wheel DELTA X Y          DELTA в щелчках колеса (1 = WHEEL_STEP)
+//   key CODE                 виртуальный код клавиши (27 — Escape, 36 — Home)
+//   command ID               пункт меню
+//   resize W H
+//   drag X0 Y0 X1 Y1 STEPS   down, STEPS шагов move по прямой, up
+//   repeat N ... end         блок повторяется N раз, блоки вкладываются
+// Пустые строки и всё после # пропускаются.
+bool ParseEventScript(const std::string& text, std::vector<PlatformEvent>& events, std::string& error);
+bool LoadEventScript(const std::filesystem::path& path, std::vector<PlatformEvent>& events, std::string& error);
+
+#endif  // EVENTSCRIPT_H
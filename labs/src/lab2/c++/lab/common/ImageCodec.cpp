@@ -0,0 +1,310 @@
+#include "ImageCodec.h"
+#include <algorithm>
+#include <cctype>
+#include <cstring>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#ifdef _WIN32
+#include <windows.h>
+#include <wincodec.h>
+#include <wrl/client.h>
+
+#include "ScaledDecoder.h"
+
+#pragma comment(lib, "windowscodecs.lib")
+#endif
+
+namespace {
+#pragma pack(push, 1)
+struct BmpFileHeader {
+    uint16_t type;
+    uint32_t size;
+    uint16_t reserved1;
+    uint16_t reserved2;
+    uint32_t offBits;
+};
+
+struct BmpInfoHeader {
+    uint32_t size;
+    int32_t width;
+    int32_t height;
+    uint16_t planes;
+    uint16_t bitCount;
+    uint32_t compression;
+    uint32_t sizeImage;
+    int32_t xPelsPerMeter;
+    int32_t yPelsPerMeter;
+    uint32_t clrUsed;
+    uint32_t clrImportant;
+};
+#pragma pack(pop)
+
+const uint32_t BMP_RGB = 0;
+const uint32_t BMP_BITFIELDS = 3;
+
+bool ReadWholeFile(const std::filesystem::path& path, std::vector<uint8_t>& data) {
+    std::ifstream file(path, std::ios::binary | std::ios::ate);
+    if (!file) return false;
+    std::streamsize size = file.tellg();
+    if (size <= 0) return false;
+    data.resize(static_cast<size_t>(size));
+    file.seekg(0);
+    return static_cast<bool>(file.read(reinterpret_cast<char*>(data.data()), size));
+}
+
+bool ReadBmp(const std::vector<uint8_t>& data, Surface& surface) {
+    if (data.size() < sizeof(BmpFileHeader) + sizeof(BmpInfoHeader)) return false;
+
+    BmpFileHeader fileHeader;
+    BmpInfoHeader info;
+    std::memcpy(&fileHeader, data.data(), sizeof(fileHeader));
+    std::memcpy(&info, data.data() + sizeof(fileHeader), sizeof(info));
+    if (fileHeader.type != 0x4D42 || info.size < sizeof(BmpInfoHeader)) return false;
+    if (info.bitCount != 24 && info.bitCount != 32) return false;
+    if (info.compression != BMP_RGB && !(info.compression == BMP_BITFIELDS && info.bitCount == 32)) return false;
+
+    int width = info.width;
+    bool topDown = info.height < 0;
+    int height = topDown ? -info.height : info.height;
+    if (width <= 0 || height <= 0) return false;
+
+    int bytesPerPixel = info.bitCount / 8;
+    size_t rowSize = (static_cast<size_t>(width) * bytesPerPixel + 3) & ~static_cast<size_t>(3);
+    if (fileHeader.offBits + rowSize * height > data.size()) return false;
+
+    if (!SurfacePool::Instance().Acquire(width, height, surface)) return false;
+    // 32bpp BI_RGB по спецификации без альфы, поэтому альфа всегда непрозрачная
+    for (int y = 0; y < height; ++y) {
+        int srcY = topDown ? y : height - 1 - y;
+        const uint8_t* src = data.data() + fileHeader.offBits + rowSize * srcY;
+        uint8_t* dst = surface.pixels + static_cast<size_t>(y) * surface.stride;
+        for (int x = 0; x < width; ++x) {
+            dst[0] = src[0];
+            dst[1] = src[1];
+            dst[2] = src[2];
+            dst[3] = 255;
+            src += bytesPerPixel;
+            dst += 4;
+        }
+    }
+    return true;
+}
+
+bool WriteBmp(const std::filesystem::path& path, const Surface& surface) {
+    size_t rowSize = static_cast<size_t>(surface.width) * 4;
+    size_t imageSize = rowSize * surface.height;
+
+    BmpFileHeader fileHeader = {};
+    fileHeader.type = 0x4D42;
+    fileHeader.offBits = sizeof(BmpFileHeader) + sizeof(BmpInfoHeader);
+    fileHeader.size = static_cast<uint32_t>(fileHeader.offBits + imageSize);
+
+    BmpInfoHeader info = {};
+    info.size = sizeof(BmpInfoHeader);
+    info.width = surface.width;
+    info.height = -surface.height;  // сверху вниз: строки пишутся подряд, без переворота
+    info.planes = 1;
+    info.bitCount = 32;
+    info.compression = BMP_RGB;
+    info.sizeImage = static_cast<uint32_t>(imageSize);
+
+    std::ofstream file(path, std::ios::binary);
+    if (!file) return false;
+    file.write(reinterpret_cast<const char*>(&fileHeader), sizeof(fileHeader));
+    file.write(reinterpret_cast<const char*>(&info), sizeof(info));
+    for (int y = 0; y < surface.height; ++y) {
+        file.write(reinterpret_cast<const char*>(surface.pixels + static_cast<size_t>(y) * surface.stride),
+                   static_cast<std::streamsize>(rowSize));
+    }
+    return static_cast<bool>(file);
+}
+
+bool ReadPpmToken(const std::vector<uint8_t>& data, size_t& pos, int& value) {
+    while (pos < data.size()) {
+        if (data[pos] == '#') {
+            while (pos < data.size() && data[pos] != '\n') pos++;
+        }
+        else if (std::isspace(data[pos])) {
+            pos++;
+        }
+        else {
+            break;
+        }
+    }
+    if (pos >= data.size() || !std::isdigit(data[pos])) return false;
+    value = 0;
+    while (pos < data.size() && std::isdigit(data[pos])) {
+        value = value * 10 + (data[pos++] - '0');
+        if (value > (1 << 24)) return false;
+    }
+    return true;
+}
+
+bool ReadPpm(const std::vector<uint8_t>& data, Surface& surface) {
+    if (data.size() < 2 || data[0] != 'P' || data[1] != '6') return false;
+
+    size_t pos = 2;
+    int width = 0;
+    int height = 0;
+    int maxValue = 0;
+    if (!ReadPpmToken(data, pos, width) || !ReadPpmToken(data, pos, height) ||
+        !ReadPpmToken(data, pos, maxValue)) {
+        return false;
+    }
+    pos++;  // один пробельный символ перед данными
+    if (width <= 0 || height <= 0 || maxValue != 255) return false;
+    if (pos + static_cast<size_t>(width) * height * 3 > data.size()) return false;
+
+    if (!SurfacePool::Instance().Acquire(width, height, surface)) return false;
+    const uint8_t* src = data.data() + pos;
+    for (int y = 0; y < height; ++y) {
+        uint8_t* dst = surface.pixels + static_cast<size_t>(y) * surface.stride;
+        for (int x = 0; x < width; ++x) {
+            dst[0] = src[2];
+            dst[1] = src[1];
+            dst[2] = src[0];
+            dst[3] = 255;
+            src += 3;
+            dst += 4;
+        }
+    }
+    return true;
+}
+
+bool WritePpm(const std::filesystem::path& path, const Surface& surface) {
+    std::ofstream file(path, std::ios::binary);
+    if (!file) return false;
+    file << "P6\n" << surface.width << " " << surface.height << "\n255\n";
+
+    std::vector<uint8_t> row(static_cast<size_t>(surface.width) * 3);
+    for (int y = 0; y < surface.height; ++y) {
+        const uint8_t* src = surface.pixels + static_cast<size_t>(y) * surface.stride;
+        for (int x = 0; x < surface.width; ++x) {
+            row[x * 3] = src[x * 4 + 2];
+            row[x * 3 + 1] = src[x * 4 + 1];
+            row[x * 3 + 2] = src[x * 4];
+        }
+        file.write(reinterpret_cast<const char*>(row.data()), static_cast<std::streamsize>(row.size()));
+    }
+    return static_cast<bool>(file);
+}
+
+#ifdef _WIN32
+bool WriteWic(const std::filesystem::path& path, const Surface& surface, const GUID& container) {
+    using Microsoft::WRL::ComPtr;
+
+    ComPtr<IWICImagingFactory> factory;
+    if (FAILED(CoCreateInstance(CLSID_WICImagingFactory, nullptr, CLSCTX_INPROC_SERVER, IID_PPV_ARGS(&factory)))) {
+        return false;
+    }
+    ComPtr<IWICStream> stream;
+    if (FAILED(factory->CreateStream(&stream))) return false;
+    if (FAILED(stream->InitializeFromFilename(path.c_str(), GENERIC_WRITE))) return false;
+
+    ComPtr<IWICBitmapEncoder> encoder;
+    if (FAILED(factory->CreateEncoder(container, nullptr, &encoder))) return false;
+    if (FAILED(encoder->Initialize(stream.Get(), WICBitmapEncoderNoCache))) return false;
+
+    ComPtr<IWICBitmapFrameEncode> frame;
+    if (FAILED(encoder->CreateNewFrame(&frame, nullptr))) return false;
+    if (FAILED(frame->Initialize(nullptr))) return false;
+    frame->SetSize(surface.width, surface.height);
+
+    // JPEG не умеет альфу: кодер сам предложит ближайший формат, тогда конвертируем
+    WICPixelFormatGUID format = GUID_WICPixelFormat32bppBGRA;
+    frame->SetPixelFormat(&format);
+    if (IsEqualGUID(format, GUID_WICPixelFormat32bppBGRA)) {
+        if (FAILED(frame->WritePixels(surface.height, surface.stride, surface.stride * surface.height,
+                                      surface.pixels))) {
+            return false;
+        }
+    }
+    else {
+        ComPtr<IWICBitmap> bitmap;
+        if (FAILED(factory->CreateBitmapFromMemory(surface.width, surface.height, GUID_WICPixelFormat32bppBGRA,
+                                                   surface.stride, surface.stride * surface.height,
+                                                   surface.pixels, &bitmap))) {
+            return false;
+        }
+        ComPtr<IWICFormatConverter> converter;
+        if (FAILED(factory->CreateFormatConverter(&converter))) return false;
+        if (FAILED(converter->Initialize(bitmap.Get(), format, WICBitmapDitherTypeNone, nullptr, 0.0,
+                                         WICBitmapPaletteTypeCustom))) {
+            return false;
+        }
+        if (FAILED(frame->WriteSource(converter.Get(), nullptr))) return false;
+    }
+    return SUCCEEDED(frame->Commit()) && SUCCEEDED(encoder->Commit());
+}
+#endif
+}  // namespace
+
+ImageFormat FormatFromName(const std::string& name) {
+    std::string lower = name;
+    std::transform(lower.begin(), lower.end(), lower.begin(), [](unsigned char c) { return std::tolower(c); });
+    if (!lower.empty() && lower[0] == '.') lower.erase(0, 1);
+
+    if (lower == "bmp") return ImageFormat::Bmp;
+    if (lower == "ppm") return ImageFormat::Ppm;
+    if (lower == "png") return ImageFormat::Png;
+    if (lower == "jpg" || lower == "jpeg") return ImageFormat::Jpeg;
+    return ImageFormat::Unknown;
+}
+
+ImageFormat FormatFromPath(const std::filesystem::path& path) {
+    return FormatFromName(path.extension().string());
+}
+
+const char* FormatExtension(ImageFormat format) {
+    switch (format) {
+    case ImageFormat::Bmp: return ".bmp";
+    case ImageFormat::Ppm: return ".ppm";
+    case ImageFormat::Png: return ".png";
+    case ImageFormat::Jpeg: return ".jpg";
+    default: return "";
+    }
+}
+
+bool IsFormatSupported(ImageFormat format) {
+#ifdef _WIN32
+    return format != ImageFormat::Unknown;
+#else
+    return format == ImageFormat::Bmp || format == ImageFormat::Ppm;
+#endif
+}
+
+bool ReadImage(const std::filesystem::path& path, int maxWidth, int maxHeight, Surface& surface) {
+    surface = Surface();
+    ImageFormat format = FormatFromPath(path);
+
+#ifdef _WIN32
+    // Тот же путь, что у просмотрщика: JPEG уменьшается ещё при декодировании
+    if (format == ImageFormat::Png || format == ImageFormat::Jpeg) {
+        return DecodeImageToSurface(path.wstring(), maxWidth, maxHeight, surface);
+    }
+#else
+    (void)maxWidth;
+    (void)maxHeight;
+#endif
+
+    if (format != ImageFormat::Bmp && format != ImageFormat::Ppm) return false;
+    std::vector<uint8_t> data;
+    if (!ReadWholeFile(path, data)) return false;
+    return format == ImageFormat::Bmp ? ReadBmp(data, surface) : ReadPpm(data, surface);
+}
+
+bool WriteImage(const std::filesystem::path& path, const Surface& surface, ImageFormat format) {
+    if (!surface.pixels) return false;
+
+    switch (format) {
+    case ImageFormat::Bmp: return WriteBmp(path, surface);
+    case ImageFormat::Ppm: return WritePpm(path, surface);
+#ifdef _WIN32
+    case ImageFormat::Png: return WriteWic(path, surface, GUID_ContainerFormatPng);
+    case ImageFormat::Jpeg: return WriteWic(path, surface, GUID_ContainerFormatJpeg);
+#endif
+    default: return false;
+    }
+}
@@ -0,0 +1,22 @@
+#ifndef IMAGECODEC_H
+#define IMAGECODEC_H
+
+#include <filesystem>
+
+#include "SurfacePool.h"
+
+enum class ImageFormat { Unknown, Bmp, Ppm, Png, Jpeg };
+
+// Кодеки без оконной системы. BMP и PPM читаются и пишутся везде;
+// PNG и JPEG — только в сборке под Windows (через WIC).
+ImageFormat FormatFromPath(const std::filesystem::path& path);
+ImageFormat FormatFromName(const std::string& name);
+const char* FormatExtension(ImageFormat format);
+bool IsFormatSupported(ImageFormat format);
+
+// maxWidth/maxHeight — подсказка: декодер может сразу уменьшить изображение,
+// но результат бывает и больше (если формат этого не умеет). Пиксели 32bpp BGRA.
+bool ReadImage(const std::filesystem::path& path, int maxWidth, int maxHeight, Surface& surface);
+bool WriteImage(const std::filesystem::path& path, const Surface& surface, ImageFormat format);
+
+#endif  // IMAGECODEC_H
@@ -0,0 +1,221 @@
+#include "ImageDiff.h"
+#include <algorithm>
+#include <climits>
+#include <cmath>
+#include <cstdlib>
+#include <limits>
+#include <memory>
+
+#include "ThreadPool.h"
+#include "Trace.h"
+
+#if IMAGEDIFF_SSE2
+#include <emmintrin.h>
+#endif
+
+namespace {
+const int BLOCK = ImageDiff::REGION_BLOCK;
+// Меньше этого сравнение идёт в вызывающем потоке: раздача задач дороже
+const size_t PARALLEL_THRESHOLD = 256 * 1024;
+// Столько шагов по 4 пикселя суммы квадратов помещаются в 32-битные дорожки
+const int SQUARES_FLUSH_STEPS = 4096;
+
+// Крайние изменённые пиксели блока; left > right — изменений нет
+struct BlockBounds {
+    int left = INT_MAX;
+    int top = INT_MAX;
+    int right = INT_MIN;
+    int bottom = INT_MIN;
+
+    bool IsEmpty() const { return left > right; }
+    void Add(int x0, int x1, int y) {
+        left = std::min(left, x0);
+        right = std::max(right, x1);
+        top = std::min(top, y);
+        bottom = std::max(bottom, y);
+    }
+};
+
+struct alignas(64) BandResult {
+    uint64_t sumSquares = 0;
+    uint64_t changed = 0;
+    int maxDifference = 0;
+};
+
+struct DiffJob {
+    const Surface* a;
+    const Surface* b;
+    const Surface* difference;
+    int width;
+    int threshold;
+    BlockBounds* blocks;
+    int blocksX;
+};
+
+#if IMAGEDIFF_SSE2
+uint64_t SumLanes(__m128i lanes) {
+    alignas(16) uint32_t values[4];
+    _mm_store_si128(reinterpret_cast<__m128i*>(values), lanes);
+    return static_cast<uint64_t>(values[0]) + values[1] + values[2] + values[3];
+}
+
+int MaxByte(__m128i bytes) {
+    alignas(16) uint8_t values[16];
+    _mm_store_si128(reinterpret_cast<__m128i*>(values), bytes);
+    return *std::max_element(values, values + 16);
+}
+#endif
+
+void DiffRows(const DiffJob& job, int top, int bottom, BandResult& result) {
+    for (int y = top; y < bottom; ++y) {
+        const uint8_t* rowA = job.a->pixels + static_cast<size_t>(y) * job.a->stride;
+        const uint8_t* rowB = job.b->pixels + static_cast<size_t>(y) * job.b->stride;
+        uint8_t* rowDiff = job.difference ? job.difference->pixels + static_cast<size_t>(y) * job.difference->stride
+                                          : nullptr;
+        BlockBounds* blockRow = job.blocks + static_cast<size_t>(y / BLOCK) * job.blocksX;
+        int x = 0;
+
+#if IMAGEDIFF_SSE2
+        // Разность без знака — насыщающее вычитание в обе стороны; альфа обнуляется.
+        // Изменённые байты — те, что остаются ненулевыми после вычитания порога.
+        const __m128i zero = _mm_setzero_si128();
+        const __m128i rgbMask = _mm_set1_epi32(0x00FFFFFF);
+        const __m128i opaque = _mm_set1_epi32(static_cast<int>(0xFF000000u));
+        const __m128i limit = _mm_set1_epi8(static_cast<char>(job.threshold));
+        __m128i squares = zero;
+        __m128i maxBytes = zero;
+        int steps = 0;
+        for (; x + 4 <= job.width; x += 4) {
+            __m128i pa = _mm_loadu_si128(reinterpret_cast<const __m128i*>(rowA + x * 4));
+            __m128i pb = _mm_loadu_si128(reinterpret_cast<const __m128i*>(rowB + x * 4));
+            __m128i d = _mm_and_si128(_mm_or_si128(_mm_subs_epu8(pa, pb), _mm_subs_epu8(pb, pa)), rgbMask);
+            if (rowDiff) _mm_storeu_si128(reinterpret_cast<__m128i*>(rowDiff + x * 4), _mm_or_si128(d, opaque));
+            maxBytes = _mm_max_epu8(maxBytes, d);
+            __m128i low = _mm_unpacklo_epi8(d, zero);
+            __m128i high = _mm_unpackhi_epi8(d, zero);
+            squares = _mm_add_epi32(squares, _mm_add_epi32(_mm_madd_epi16(low, low), _mm_madd_epi16(high, high)));
+            if (++steps == SQUARES_FLUSH_STEPS) {
+                result.sumSquares += SumLanes(squares);
+                squares = zero;
+                steps = 0;
+            }
+
+            int changedBytes = _mm_movemask_epi8(_mm_cmpeq_epi8(_mm_subs_epu8(d, limit), zero)) ^ 0xFFFF;
+            if (changedBytes == 0) continue;
+            // По 4 бита маски на пиксель; четвёрка пикселей целиком в одном блоке
+            int first = 0;
+            while (((changedBytes >> (first * 4)) & 0xF) == 0) first++;
+            int last = 3;
+            while (((changedBytes >> (last * 4)) & 0xF) == 0) last--;
+            for (int lane = first; lane <= last; ++lane) {
+                if ((changedBytes >> (lane * 4)) & 0xF) result.changed++;
+            }
+            blockRow[x / BLOCK].Add(x + first, x + last, y);
+        }
+        result.sumSquares += SumLanes(squares);
+        result.maxDifference = std::max(result.maxDifference, MaxByte(maxBytes));
+#endif
+
+        const uint32_t* pixelsA = reinterpret_cast<const uint32_t*>(rowA);
+        const uint32_t* pixelsB = reinterpret_cast<const uint32_t*>(rowB);
+        uint32_t* pixelsDiff = reinterpret_cast<uint32_t*>(rowDiff);
+        for (; x < job.width; ++x) {
+            uint32_t pa = pixelsA[x];
+            uint32_t pb = pixelsB[x];
+            int blue = std::abs(static_cast<int>(pa & 0xFF) - static_cast<int>(pb & 0xFF));
+            int green = std::abs(static_cast<int>((pa >> 8) & 0xFF) - static_cast<int>((pb >> 8) & 0xFF));
+            int red = std::abs(static_cast<int>((pa >> 16) & 0xFF) - static_cast<int>((pb >> 16) & 0xFF));
+            if (pixelsDiff) pixelsDiff[x] = 0xFF000000u | (red << 16) | (green << 8) | blue;
+            result.sumSquares += static_cast<uint64_t>(blue * blue + green * green + red * red);
+            int largest = std::max(blue, std::max(green, red));
+            result.maxDifference = std::max(result.maxDifference, largest);
+            if (largest > job.threshold) {
+                result.changed++;
+                blockRow[x / BLOCK].Add(x, x, y);
+            }
+        }
+    }
+}
+
+// Связные (8 соседей) группы блоков с изменениями -> рамки по их крайним пикселям
+void CollectRegions(std::vector<BlockBounds>& blocks, int blocksX, int blocksY, std::vector<DiffRegion>& regions) {
+    std::vector<int> stack;
+    for (size_t start = 0; start < blocks.size(); ++start) {
+        if (blocks[start].IsEmpty()) continue;
+        BlockBounds region = blocks[start];
+        blocks[start] = BlockBounds();
+        stack.assign(1, static_cast<int>(start));
+        while (!stack.empty()) {
+            int index = stack.back();
+            stack.pop_back();
+            int blockX = index % blocksX;
+            int blockY = index / blocksX;
+            for (int ny = std::max(blockY - 1, 0); ny <= std::min(blockY + 1, blocksY - 1); ++ny) {
+                for (int nx = std::max(blockX - 1, 0); nx <= std::min(blockX + 1, blocksX - 1); ++nx) {
+                    BlockBounds& neighbour = blocks[static_cast<size_t>(ny) * blocksX + nx];
+                    if (neighbour.IsEmpty()) continue;
+                    region.Add(neighbour.left, neighbour.right, neighbour.top);
+                    region.Add(neighbour.left, neighbour.right, neighbour.bottom);
+                    neighbour = BlockBounds();
+                    stack.push_back(ny * blocksX + nx);
+                }
+            }
+        }
+        DiffRegion found;
+        found.x = region.left;
+        found.y = region.top;
+        found.width = region.right - region.left + 1;
+        found.height = region.bottom - region.top + 1;
+        regions.push_back(found);
+    }
+    std::sort(regions.begin(), regions.end(), [](const DiffRegion& first, const DiffRegion& second) {
+        return static_cast<int64_t>(first.width) * first.height > static_cast<int64_t>(second.width) * second.height;
+    });
+}
+}  // namespace
+
+bool CompareImages(const Surface& a, const Surface& b, int threshold, ThreadPool* pool, ImageDiff& result,
+                   Surface* difference) {
+    TRACE_SCOPE("CompareImages");
+    result = ImageDiff();
+    int width = std::min(a.width, b.width);
+    int height = std::min(a.height, b.height);
+    if (!a.pixels || !b.pixels || width <= 0 || height <= 0) return false;
+    if (difference && !SurfacePool::Instance().Acquire(width, height, *difference)) return false;
+
+    int blocksX = (width + BLOCK - 1) / BLOCK;
+    int blocksY = (height + BLOCK - 1) / BLOCK;
+    std::vector<BlockBounds> blocks(static_cast<size_t>(blocksX) * blocksY);
+    DiffJob job = { &a, &b, difference, width, std::clamp(threshold, 0, 255), blocks.data(), blocksX };
+
+    // Полосы из целых строк блоков: каждая пишет только в свои блоки
+    size_t pixels = static_cast<size_t>(width) * height;
+    size_t bands = pool && pixels >= PARALLEL_THRESHOLD ? std::min<size_t>(pool->GetThreadCount(), blocksY) : 1;
+    std::unique_ptr<BandResult[]> partials(new BandResult[bands]);
+    if (bands <= 1) {
+        DiffRows(job, 0, height, partials[0]);
+    }
+    else {
+        for (size_t band = 0; band < bands; ++band) {
+            int top = static_cast<int>(blocksY * band / bands) * BLOCK;
+            int bottom = std::min(static_cast<int>(blocksY * (band + 1) / bands) * BLOCK, height);
+            BandResult* partial = &partials[band];
+            pool->Submit([&job, top, bottom, partial]() { DiffRows(job, top, bottom, *partial); });
+        }
+        pool->WaitIdle();
+    }
+
+    uint64_t sumSquares = 0;
+    for (size_t band = 0; band < bands; ++band) {
+        sumSquares += partials[band].sumSquares;
+        result.changedPixels += partials[band].changed;
+        result.maxDifference = std::max(result.maxDifference, partials[band].maxDifference);
+    }
+    result.width = width;
+    result.height = height;
+    result.mse = static_cast<double>(sumSquares) / (3.0 * pixels);
+    result.psnr = sumSquares == 0 ? std::numeric_limits<double>::infinity()
+                                  : 10.0 * std::log10(255.0 * 255.0 / result.mse);
+    CollectRegions(blocks, blocksX, blocksY, result.regions);
+    return true;
+}
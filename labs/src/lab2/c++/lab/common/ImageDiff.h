@@ -0,0 +1,49 @@
+#ifndef IMAGEDIFF_H
+#define IMAGEDIFF_H
+
+#include <cstdint>
+#include <vector>
+
+#include "SurfacePool.h"
+
+// SSE2 есть у любого x64 и включён по умолчанию и в MSVC, и в GCC/Clang; на
+// остальных платформах CompareImages идёт скалярным циклом
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define IMAGEDIFF_SSE2 1
+#else
+#define IMAGEDIFF_SSE2 0
+#endif
+
+class ThreadPool;
+
+// Прямоугольник, внутри которого изображения различаются, в пикселях
+struct DiffRegion {
+  int x = 0;
+  int y = 0;
+  int width = 0;
+  int height = 0;
+};
+
+// Итог сравнения по каналам RGB; альфа не сравнивается
+struct ImageDiff {
+  static const int REGION_BLOCK = 32;
+
+  int width = 0;  // сравнивалась общая часть: при разных размерах — левый верхний угол
+  int height = 0;
+  uint64_t changedPixels = 0;  // хоть один канал отличается больше порога
+  int maxDifference = 0;
+  double mse = 0.0;   // средний квадрат разности на канал
+  double psnr = 0.0;  // дБ; бесконечность — изображения совпадают
+  std::vector<DiffRegion> regions;  // по убыванию площади
+};
+
+// Попиксельное сравнение a и b. Строки делятся на полосы по числу потоков pool
+// (nullptr — всё в вызывающем потоке), внутри строки по 4 пикселя за шаг на SSE2.
+// Изменённые пиксели отмечаются в блоках REGION_BLOCK x REGION_BLOCK; соседние
+// (и по диагонали) блоки сливаются в одну область, её рамка — по крайним
+// изменённым пикселям. difference, если задан, получает |a - b| по каналам с
+// непрозрачной альфой (буфер из SurfacePool, освобождает вызывающий).
+bool CompareImages(const Surface& a, const Surface& b, int threshold, ThreadPool* pool, ImageDiff& result,
+                   Surface* difference = nullptr);
+
+#endif  // IMAGEDIFF_H
@@ -0,0 +1,223 @@
+#include "ImageStats.h"
+#include <algorithm>
+#include <cstring>
+#include <memory>
+
+#include "ThreadPool.h"
+#include "Trace.h"
+
+namespace {
+// Меньше этого полоса считается в вызывающем потоке: раздача задач дороже
+const size_t PARALLEL_THRESHOLD = 256 * 1024;
+
+// Соседние пиксели чаще всего одного цвета, и инкремент одной ячейки ждал бы
+// предыдущей записи в неё же. Четыре копии гистограммы по очереди пикселей
+// разрывают эту цепочку; копии складываются при слиянии.
+const int COPIES = 4;
+
+struct alignas(64) PartialHistogram {
+    uint32_t counts[COPIES][ImageHistogram::CHANNELS][256];
+};
+
+struct Rect {
+    int x;
+    int y;
+    int width;
+    int height;
+
+    size_t Area() const { return static_cast<size_t>(width) * height; }
+};
+
+bool ClipToSurface(const Surface& surface, Rect& rect) {
+    int left = std::max(rect.x, 0);
+    int top = std::max(rect.y, 0);
+    int right = std::min(rect.x + rect.width, surface.width);
+    int bottom = std::min(rect.y + rect.height, surface.height);
+    rect = { left, top, std::max(right - left, 0), std::max(bottom - top, 0) };
+    return surface.pixels && rect.width > 0 && rect.height > 0;
+}
+
+void CountRows(const Surface& surface, const Rect& rect, PartialHistogram& partial) {
+    memset(&partial, 0, sizeof(partial));
+    auto& a = partial.counts[0];
+    auto& b = partial.counts[1];
+    auto& c = partial.counts[2];
+    auto& d = partial.counts[3];
+    for (int row = rect.y; row < rect.y + rect.height; ++row) {
+        const uint8_t* line = surface.pixels + static_cast<size_t>(row) * surface.stride;
+        const uint32_t* pixels = reinterpret_cast<const uint32_t*>(line) + rect.x;
+        int i = 0;
+        for (; i + 4 <= rect.width; i += 4) {
+            uint32_t p0 = pixels[i];
+            uint32_t p1 = pixels[i + 1];
+            uint32_t p2 = pixels[i + 2];
+            uint32_t p3 = pixels[i + 3];
+            a[0][p0 & 0xFF]++;
+            a[1][(p0 >> 8) & 0xFF]++;
+            a[2][(p0 >> 16) & 0xFF]++;
+            a[3][p0 >> 24]++;
+            b[0][p1 & 0xFF]++;
+            b[1][(p1 >> 8) & 0xFF]++;
+            b[2][(p1 >> 16) & 0xFF]++;
+            b[3][p1 >> 24]++;
+            c[0][p2 & 0xFF]++;
+            c[1][(p2 >> 8) & 0xFF]++;
+            c[2][(p2 >> 16) & 0xFF]++;
+            c[3][p2 >> 24]++;
+            d[0][p3 & 0xFF]++;
+            d[1][(p3 >> 8) & 0xFF]++;
+            d[2][(p3 >> 16) & 0xFF]++;
+            d[3][p3 >> 24]++;
+        }
+        for (; i < rect.width; ++i) {
+            uint32_t p = pixels[i];
+            a[0][p & 0xFF]++;
+            a[1][(p >> 8) & 0xFF]++;
+            a[2][(p >> 16) & 0xFF]++;
+            a[3][p >> 24]++;
+        }
+    }
+}
+
+// Плоские циклы сложения — их векторизует компилятор
+void MergePartial(const PartialHistogram& partial, ImageHistogram& result) {
+    for (int channel = 0; channel < ImageHistogram::CHANNELS; ++channel) {
+        uint64_t* out = result.counts[channel];
+        for (int value = 0; value < 256; ++value) {
+            out[value] += static_cast<uint64_t>(partial.counts[0][channel][value]) + partial.counts[1][channel][value] +
+                          partial.counts[2][channel][value] + partial.counts[3][channel][value];
+        }
+    }
+}
+
+// Части a, не попавшие в b: до двух полос во всю высоту a и до двух между ними
+int Difference(const Rect& a, const Rect& b, Rect out[4]) {
+    int left = std::max(a.x, b.x);
+    int right = std::min(a.x + a.width, b.x + b.width);
+    int top = std::max(a.y, b.y);
+    int bottom = std::min(a.y + a.height, b.y + b.height);
+    if (left >= right || top >= bottom) {
+        out[0] = a;
+        return 1;
+    }
+    int count = 0;
+    if (a.x < left) out[count++] = { a.x, a.y, left - a.x, a.height };
+    if (right < a.x + a.width) out[count++] = { right, a.y, a.x + a.width - right, a.height };
+    if (a.y < top) out[count++] = { left, a.y, right - left, top - a.y };
+    if (bottom < a.y + a.height) out[count++] = { left, bottom, right - left, a.y + a.height - bottom };
+    return count;
+}
+}  // namespace
+
+void ImageHistogram::Add(const ImageHistogram& other) {
+    for (int channel = 0; channel < CHANNELS; ++channel) {
+        for (int value = 0; value < 256; ++value) counts[channel][value] += other.counts[channel][value];
+    }
+    pixels += other.pixels;
+}
+
+void ImageHistogram::Subtract(const ImageHistogram& other) {
+    for (int channel = 0; channel < CHANNELS; ++channel) {
+        for (int value = 0; value < 256; ++value) counts[channel][value] -= other.counts[channel][value];
+    }
+    pixels -= other.pixels;
+}
+
+ChannelSummary SummarizeChannel(const ImageHistogram& histogram, int channel) {
+    ChannelSummary summary;
+    const uint64_t* counts = histogram.counts[channel];
+    if (histogram.pixels == 0) return summary;
+
+    summary.min = 0;
+    while (summary.min < 255 && counts[summary.min] == 0) summary.min++;
+    summary.max = 255;
+    while (summary.max > 0 && counts[summary.max] == 0) summary.max--;
+    uint64_t sum = 0;
+    for (int value = 0; value < 256; ++value) sum += counts[value] * value;
+    summary.mean = static_cast<double>(sum) / histogram.pixels;
+    summary.clippedLow = counts[0];
+    summary.clippedHigh = counts[255];
+    return summary;
+}
+
+void ComputeHistogram(const Surface& surface, int x, int y, int width, int height, ThreadPool* pool,
+                      ImageHistogram& result) {
+    TRACE_SCOPE("ComputeHistogram");
+    result = ImageHistogram();
+    Rect rect = { x, y, width, height };
+    if (!ClipToSurface(surface, rect)) return;
+    result.pixels = rect.Area();
+
+    size_t bands = pool ? std::min<size_t>(pool->GetThreadCount(), rect.height) : 1;
+    if (bands <= 1 || rect.Area() < PARALLEL_THRESHOLD) {
+        auto partial = std::make_unique<PartialHistogram>();
+        CountRows(surface, rect, *partial);
+        MergePartial(*partial, result);
+        return;
+    }
+
+    std::unique_ptr<PartialHistogram[]> partials(new PartialHistogram[bands]);
+    for (size_t band = 0; band < bands; ++band) {
+        int top = rect.y + static_cast<int>(rect.height * band / bands);
+        int bottom = rect.y + static_cast<int>(rect.height * (band + 1) / bands);
+        Rect part = { rect.x, top, rect.width, bottom - top };
+        PartialHistogram* partial = &partials[band];
+        pool->Submit([&surface, part, partial]() { CountRows(surface, part, *partial); });
+    }
+    pool->WaitIdle();
+    for (size_t band = 0; band < bands; ++band) {
+        MergePartial(partials[band], result);
+    }
+}
+
+size_t RegionHistogram::Update(const Surface& surface, int x, int y, int width, int height, ThreadPool* pool) {
+    Rect next = { x, y, width, height };
+    ClipToSurface(surface, next);
+    Rect current = { regionX, regionY, regionWidth, regionHeight };
+    bool sameSource = valid && surface.pixels == source && surface.width == sourceWidth &&
+                      surface.height == sourceHeight;
+    if (sameSource && next.x == current.x && next.y == current.y && next.width == current.width &&
+        next.height == current.height) {
+        return 0;
+    }
+
+    size_t scanned = next.Area();
+    if (sameSource && current.Area() > 0 && next.Area() > 0) {
+        Rect removed[4];
+        Rect added[4];
+        int removedCount = Difference(current, next, removed);
+        int addedCount = Difference(next, current, added);
+        size_t cost = 0;
+        for (int i = 0; i < removedCount; ++i) cost += removed[i].Area();
+        for (int i = 0; i < addedCount; ++i) cost += added[i].Area();
+
+        if (cost < scanned) {
+            ImageHistogram strip;
+            for (int i = 0; i < removedCount; ++i) {
+                ComputeHistogram(surface, removed[i].x, removed[i].y, removed[i].width, removed[i].height, pool, strip);
+                histogram.Subtract(strip);
+            }
+            for (int i = 0; i < addedCount; ++i) {
+                ComputeHistogram(surface, added[i].x, added[i].y, added[i].width, added[i].height, pool, strip);
+                histogram.Add(strip);
+            }
+            scanned = cost;
+        }
+        else {
+            ComputeHistogram(surface, next.x, next.y, next.width, next.height, pool, histogram);
+        }
+    }
+    else {
+        ComputeHistogram(surface, next.x, next.y, next.width, next.height, pool, histogram);
+    }
+
+    source = surface.pixels;
+    sourceWidth = surface.width;
+    sourceHeight = surface.height;
+    regionX = next.x;
+    regionY = next.y;
+    regionWidth = next.width;
+    regionHeight = next.height;
+    valid = true;
+    return scanned;
+}
@@ -0,0 +1,67 @@
+#ifndef IMAGESTATS_H
+#define IMAGESTATS_H
+
+#include <cstddef>
+#include <cstdint>
+
+#include "SurfacePool.h"
+
+class ThreadPool;
+
+// Гистограммы каналов 32bpp BGRA; индекс канала — номер байта в пикселе
+struct ImageHistogram {
+  static const int CHANNELS = 4;
+  enum Channel { BLUE = 0, GREEN = 1, RED = 2, ALPHA = 3 };
+
+  uint64_t counts[CHANNELS][256] = {};
+  uint64_t pixels = 0;
+
+  void Add(const ImageHistogram& other);
+  void Subtract(const ImageHistogram& other);
+};
+
+// Всё выводится из гистограммы, отдельного прохода по пикселям не нужно
+struct ChannelSummary {
+  int min = 0;
+  int max = 0;
+  double mean = 0.0;
+  uint64_t clippedLow = 0;   // значение 0
+  uint64_t clippedHigh = 0;  // значение 255
+};
+
+ChannelSummary SummarizeChannel(const ImageHistogram& histogram, int channel);
+
+// Гистограмма прямоугольника (отсекается по surface). С пулом прямоугольник делится
+// на полосы строк по числу потоков; у каждой полосы своя частичная гистограмма,
+// они складываются в конце. nullptr — всё в вызывающем потоке.
+void ComputeHistogram(const Surface& surface, int x, int y, int width, int height, ThreadPool* pool,
+                      ImageHistogram& result);
+
+// Гистограмма окна, которое двигается по изображению. При сдвиге и изменении
+// размера сканируются только полосы, вышедшие из окна (вычитаются) и вошедшие
+// в него (добавляются); с нуля — если так выходит дешевле или сменилось изображение.
+class RegionHistogram {
+ public:
+  // Возвращает число просканированных пикселей
+  size_t Update(const Surface& surface, int x, int y, int width, int height, ThreadPool* pool);
+  void Reset() { valid = false; }
+
+  const ImageHistogram& Get() const { return histogram; }
+  int GetX() const { return regionX; }
+  int GetY() const { return regionY; }
+  int GetWidth() const { return regionWidth; }
+  int GetHeight() const { return regionHeight; }
+
+ private:
+  ImageHistogram histogram;
+  const uint8_t* source = nullptr;
+  int sourceWidth = 0;
+  int sourceHeight = 0;
+  int regionX = 0;
+  int regionY = 0;
+  int regionWidth = 0;
+  int regionHeight = 0;
+  bool valid = false;
+};
+
+#endif  // IMAGESTATS_H
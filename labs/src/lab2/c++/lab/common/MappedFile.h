@@ -0,0 +1,34 @@
+#ifndef MAPPEDFILE_H
+#define MAPPEDFILE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+
+// Файл, отображённый в память только для чтения.
+class MappedFile {
+ public:
+  MappedFile();
+  ~MappedFile();
+  MappedFile(const MappedFile&) = delete;
+  MappedFile& operator=(const MappedFile&) = delete;
+
+  bool Open(const std::filesystem::path& path);
+  void Close();
+
+  const uint8_t* GetData() const { return data; }
+  size_t GetSize() const { return size; }
+  bool IsOpen() const { return data != nullptr; }
+
+ private:
+  const uint8_t* data;
+  size_t size;
+#ifdef _WIN32
+  void* fileHandle;
+  void* mappingHandle;
+#else
+  int fileDescriptor;
+#endif
+};
+
+#endif  // MAPPEDFILE_H
@@ -0,0 +1,139 @@
+// fopen/getenv без предупреждений C4996 (в проектах включён /sdl)
+#ifdef _MSC_VER
+#define _CRT_SECURE_NO_WARNINGS
+#endif
+
+#include "MemoryAccounting.h"
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+
+#include "SurfacePool.h"
+
+namespace {
+const char* const TAG_NAMES[MEMORY_TAG_COUNT] = { "other", "viewer", "canvas", "icons", "caches", "frames" };
+
+struct TagCounters {
+    std::atomic<size_t> liveBytes{0};
+    std::atomic<size_t> peakBytes{0};
+    std::atomic<size_t> allocations{0};
+    std::atomic<size_t> releases{0};
+};
+
+// Последний элемент — сумма по всем меткам
+TagCounters g_counters[MEMORY_TAG_COUNT + 1];
+thread_local MemoryTag g_currentTag = MEMORY_OTHER;
+std::string g_reportPath;
+
+void RaisePeak(std::atomic<size_t>& peak, size_t value) {
+    size_t current = peak.load(std::memory_order_relaxed);
+    while (current < value && !peak.compare_exchange_weak(current, value, std::memory_order_relaxed)) {
+    }
+}
+
+void Add(TagCounters& counters, size_t bytes) {
+    size_t live = counters.liveBytes.fetch_add(bytes, std::memory_order_relaxed) + bytes;
+    counters.allocations.fetch_add(1, std::memory_order_relaxed);
+    RaisePeak(counters.peakBytes, live);
+}
+
+void Subtract(TagCounters& counters, size_t bytes) {
+    counters.liveBytes.fetch_sub(bytes, std::memory_order_relaxed);
+    counters.releases.fetch_add(1, std::memory_order_relaxed);
+}
+
+MemoryTagStats Snapshot(const TagCounters& counters) {
+    MemoryTagStats stats;
+    stats.liveBytes = counters.liveBytes.load(std::memory_order_relaxed);
+    stats.peakBytes = counters.peakBytes.load(std::memory_order_relaxed);
+    stats.allocations = counters.allocations.load(std::memory_order_relaxed);
+    stats.releases = counters.releases.load(std::memory_order_relaxed);
+    return stats;
+}
+
+double Megabytes(size_t bytes) {
+    return bytes / (1024.0 * 1024.0);
+}
+}  // namespace
+
+const char* MemoryTagName(MemoryTag tag) {
+    return tag < MEMORY_TAG_COUNT ? TAG_NAMES[tag] : "?";
+}
+
+MemoryTag CurrentMemoryTag() {
+    return g_currentTag;
+}
+
+void MemoryAllocated(MemoryTag tag, size_t bytes) {
+    Add(g_counters[tag < MEMORY_TAG_COUNT ? tag : MEMORY_OTHER], bytes);
+    Add(g_counters[MEMORY_TAG_COUNT], bytes);
+}
+
+void MemoryReleased(MemoryTag tag, size_t bytes) {
+    Subtract(g_counters[tag < MEMORY_TAG_COUNT ? tag : MEMORY_OTHER], bytes);
+    Subtract(g_counters[MEMORY_TAG_COUNT], bytes);
+}
+
+MemoryTagStats GetMemoryTagStats(MemoryTag tag) {
+    return Snapshot(g_counters[tag < MEMORY_TAG_COUNT ? tag : MEMORY_OTHER]);
+}
+
+MemoryTagStats GetMemoryTotalStats() {
+    return Snapshot(g_counters[MEMORY_TAG_COUNT]);
+}
+
+void ResetMemoryPeaks() {
+    for (TagCounters& counters : g_counters) {
+        counters.peakBytes.store(counters.liveBytes.load(std::memory_order_relaxed), std::memory_order_relaxed);
+        counters.allocations.store(0, std::memory_order_relaxed);
+        counters.releases.store(0, std::memory_order_relaxed);
+    }
+}
+
+std::string MemoryReport() {
+    std::string report = "Memory by subsystem       live MB    peak MB   allocs  releases\n";
+    char line[160];
+    for (int tag = 0; tag <= MEMORY_TAG_COUNT; ++tag) {
+        MemoryTagStats stats = Snapshot(g_counters[tag]);
+        if (tag < MEMORY_TAG_COUNT && stats.allocations == 0 && stats.liveBytes == 0) continue;
+        std::snprintf(line, sizeof(line), "  %-20s %10.2f %10.2f %8zu %9zu\n",
+                      tag < MEMORY_TAG_COUNT ? TAG_NAMES[tag] : "total", Megabytes(stats.liveBytes),
+                      Megabytes(stats.peakBytes), stats.allocations, stats.releases);
+        report += line;
+    }
+    SurfacePoolStats pool = SurfacePool::Instance().GetStats();
+    std::snprintf(line, sizeof(line),
+                  "Surface pool: %.2f MB live, %.2f MB cached, peak %.2f MB, %zu heap allocations, %zu reuses\n",
+                  Megabytes(pool.liveBytes), Megabytes(pool.cachedBytes), Megabytes(pool.peakBytes),
+                  pool.allocations, pool.reuseHits);
+    report += line;
+    return report;
+}
+
+bool MemoryReportInitFromEnvironment() {
+    const char* path = std::getenv("LAB_MEMORY");
+    if (!path || !*path) return false;
+    g_reportPath = path;
+    return true;
+}
+
+void MemoryWriteReports() {
+    if (g_reportPath.empty()) return;
+    std::string report = MemoryReport();
+    if (g_reportPath == "-") {
+        std::fputs(report.c_str(), stdout);
+        return;
+    }
+    FILE* file = std::fopen(g_reportPath.c_str(), "w");
+    if (!file) return;
+    std::fputs(report.c_str(), file);
+    std::fclose(file);
+}
+
+MemoryTagScope::MemoryTagScope(MemoryTag tag) : previous(g_currentTag) {
+    g_currentTag = tag;
+}
+
+MemoryTagScope::~MemoryTagScope() {
+    g_currentTag = previous;
+}
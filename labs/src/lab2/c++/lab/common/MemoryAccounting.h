@@ -0,0 +1,64 @@
+#ifndef MEMORYACCOUNTING_H
+#define MEMORYACCOUNTING_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+// Учёт памяти по подсистемам. Каждый буфер SurfacePool при выдаче получает метку
+// текущего потока (MEMORY_TAG_SCOPE, как TRACE_SCOPE) и возвращает байты ей же при
+// освобождении, куда бы буфер ни переехал; крупные буферы мимо пула учитываются
+// явно (MemoryAllocated/MemoryReleased). По меткам — живые и пиковые байты.
+// Отчёт — MemoryReport() по запросу; переменная окружения LAB_MEMORY=<файл>
+// пишет его при выходе (MemoryWriteReports), "-" — в stdout.
+
+enum MemoryTag : uint8_t {
+  MEMORY_OTHER,   // без метки
+  MEMORY_VIEWER,  // изображения просмотрщика, сравнение, анимация
+  MEMORY_CANVAS,  // холст task_2, подложка, копии плиток выделения
+  MEMORY_ICONS,   // иконки task_3
+  MEMORY_CACHES,  // миниатюры и кэши
+  MEMORY_FRAMES,  // буферы кадров окна
+  MEMORY_TAG_COUNT
+};
+
+struct MemoryTagStats {
+  size_t liveBytes = 0;
+  size_t peakBytes = 0;
+  size_t allocations = 0;
+  size_t releases = 0;
+};
+
+const char* MemoryTagName(MemoryTag tag);
+MemoryTag CurrentMemoryTag();
+
+void MemoryAllocated(MemoryTag tag, size_t bytes);
+void MemoryReleased(MemoryTag tag, size_t bytes);
+
+MemoryTagStats GetMemoryTagStats(MemoryTag tag);
+// Сумма по всем меткам; пик — одновременный, а не сумма пиков
+MemoryTagStats GetMemoryTotalStats();
+// Пики становятся равны текущим живым байтам, счётчики обнуляются
+void ResetMemoryPeaks();
+
+// Таблица по меткам и строка о свободных буферах SurfacePool
+std::string MemoryReport();
+bool MemoryReportInitFromEnvironment();
+void MemoryWriteReports();
+
+class MemoryTagScope {
+ public:
+  explicit MemoryTagScope(MemoryTag tag);
+  ~MemoryTagScope();
+  MemoryTagScope(const MemoryTagScope&) = delete;
+  MemoryTagScope& operator=(const MemoryTagScope&) = delete;
+
+ private:
+  MemoryTag previous;
+};
+
+#define MEMORY_CONCAT_INNER(a, b) a##b
+#define MEMORY_CONCAT(a, b) MEMORY_CONCAT_INNER(a, b)
+#define MEMORY_TAG_SCOPE(tag) MemoryTagScope MEMORY_CONCAT(memoryTagScope, __LINE__)(tag)
+
+#endif  // MEMORYACCOUNTING_H
@@ -0,0 +1,94 @@
+#include "OffscreenPlatform.h"
+#include <algorithm>
+#include <chrono>
+
+#include "MemoryAccounting.h"
+
+namespace {
+using Clock = std::chrono::steady_clock;
+
+double MillisecondsBetween(Clock::time_point start, Clock::time_point end) {
+    return std::chrono::duration<double, std::milli>(end - start).count();
+}
+
+// Текст без шрифтов не растеризуется, только подсчитывается
+class OffscreenCanvas : public PlatformCanvas {
+ public:
+  OffscreenCanvas(const Surface& surface, size_t& textRuns) : surface(surface), textRuns(textRuns) {}
+  const Surface& GetSurface() override { return surface; }
+  void DrawString(int, int, const std::wstring&, uint32_t) override { textRuns++; }
+
+ private:
+  const Surface& surface;
+  size_t& textRuns;
+};
+}  // namespace
+
+OffscreenHost::OffscreenHost(int width, int height)
+    : width(0), height(0), invalid(true), captured(false), textRuns(0) {
+    ResizeFrame(width, height);
+}
+
+OffscreenHost::~OffscreenHost() {
+    SurfacePool::Instance().Release(frame);
+}
+
+bool OffscreenHost::ResizeFrame(int newWidth, int newHeight) {
+    newWidth = std::max(newWidth, 1);
+    newHeight = std::max(newHeight, 1);
+    if (frame.pixels && frame.width == newWidth && frame.height == newHeight) return true;
+    SurfacePool::Instance().Release(frame);
+    MEMORY_TAG_SCOPE(MEMORY_FRAMES);
+    if (!SurfacePool::Instance().Acquire(newWidth, newHeight, frame)) return false;
+    width = newWidth;
+    height = newHeight;
+    invalid = true;
+    return true;
+}
+
+void OffscreenHost::ShowMessage(const std::wstring& text, const std::wstring& caption) {
+    messages.push_back(caption.empty() ? text : caption + L": " + text);
+}
+
+void OffscreenHost::Paint(PlatformApp& app) {
+    invalid = false;
+    OffscreenCanvas canvas(frame, textRuns);
+    app.OnPaint(canvas);
+}
+
+OffscreenRunStats OffscreenHost::Run(PlatformApp& app, const std::vector<PlatformEvent>& events) {
+    OffscreenRunStats stats;
+    std::vector<double> latencies;
+    latencies.reserve(events.size());
+    size_t textRunsBefore = textRuns;
+    Clock::time_point runStart = Clock::now();
+
+    for (const PlatformEvent& event : events) {
+        Clock::time_point eventStart = Clock::now();
+        if (event.type == PlatformEvent::Resize) {
+            ResizeFrame(event.width, event.height);
+        }
+        app.OnEvent(event, *this);
+        Clock::time_point eventEnd = Clock::now();
+        stats.eventMs += MillisecondsBetween(eventStart, eventEnd);
+        stats.events++;
+
+        if (invalid) {
+            Paint(app);
+            Clock::time_point paintEnd = Clock::now();
+            stats.paintMs += MillisecondsBetween(eventEnd, paintEnd);
+            latencies.push_back(MillisecondsBetween(eventStart, paintEnd));
+            stats.frames++;
+        }
+    }
+
+    stats.totalMs = MillisecondsBetween(runStart, Clock::now());
+    stats.textRuns = textRuns - textRunsBefore;
+    if (!latencies.empty()) {
+        std::sort(latencies.begin(), latencies.end());
+        stats.latencyP50Ms = latencies[latencies.size() / 2];
+        stats.latencyP99Ms = latencies[std::min(latencies.size() - 1, latencies.size() * 99 / 100)];
+        stats.latencyMaxMs = latencies.back();
+    }
+    return stats;
+}
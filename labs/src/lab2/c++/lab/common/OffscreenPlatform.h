@@ -0,0 +1,62 @@
+#ifndef OFFSCREENPLATFORM_H
+#define OFFSCREENPLATFORM_H
+
+#include <string>
+#include <vector>
+
+#include "Platform.h"
+
+struct OffscreenRunStats {
+  size_t events = 0;
+  size_t frames = 0;        // перерисовок после Invalidate
+  size_t textRuns = 0;      // вызовов DrawString (текст в памяти не рисуется)
+  double eventMs = 0.0;     // суммарно в OnEvent
+  double paintMs = 0.0;     // суммарно в OnPaint
+  double totalMs = 0.0;
+  // Время от события до готового кадра для событий, вызвавших перерисовку
+  double latencyP50Ms = 0.0;
+  double latencyP99Ms = 0.0;
+  double latencyMaxMs = 0.0;
+};
+
+// Окно в памяти: кадр — Surface из SurfacePool, события подаются списком.
+// После каждого события, пометившего кадр устаревшим, кадр сразу перерисовывается,
+// как если бы WM_PAINT приходил без задержки. Resize меняет размер кадра до того,
+// как событие увидит приложение. Сообщения и заголовок копятся для проверки.
+class OffscreenHost : public PlatformHost {
+ public:
+  OffscreenHost(int width, int height);
+  ~OffscreenHost() override;
+  OffscreenHost(const OffscreenHost&) = delete;
+  OffscreenHost& operator=(const OffscreenHost&) = delete;
+
+  OffscreenRunStats Run(PlatformApp& app, const std::vector<PlatformEvent>& events);
+  // Первый кадр до всяких событий
+  void Paint(PlatformApp& app);
+
+  const Surface& GetFrame() const { return frame; }
+  const std::wstring& GetTitle() const { return title; }
+  const std::vector<std::wstring>& GetMessages() const { return messages; }
+  bool IsCaptured() const { return captured; }
+
+  int GetWidth() const override { return width; }
+  int GetHeight() const override { return height; }
+  void Invalidate() override { invalid = true; }
+  void SetCapture(bool capture) override { captured = capture; }
+  void SetTitle(const std::wstring& newTitle) override { title = newTitle; }
+  void ShowMessage(const std::wstring& text, const std::wstring& caption) override;
+
+ private:
+  bool ResizeFrame(int newWidth, int newHeight);
+
+  int width;
+  int height;
+  Surface frame;
+  bool invalid;
+  bool captured;
+  size_t textRuns;
+  std::wstring title;
+  std::vector<std::wstring> messages;
+};
+
+#endif  // OFFSCREENPLATFORM_H
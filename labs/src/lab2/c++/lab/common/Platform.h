@@ -0,0 +1,66 @@
+#ifndef PLATFORM_H
+#define PLATFORM_H
+
+#include <cstdint>
+#include <string>
+
+#include "SurfacePool.h"
+
+// Тонкая прослойка между логикой приложения и оконной системой. Логика получает
+// события PlatformEvent и рисует кадр в PlatformCanvas; окно ей представляет
+// PlatformHost. Реализации: Win32Host (Win32Platform.h) и OffscreenHost
+// (OffscreenPlatform.h) — окно в памяти, которое кормится событиями из сценария.
+
+// Коды клавиш совпадают с виртуальными кодами Win32
+enum PlatformKey {
+  KEY_ESCAPE = 0x1B,
+  KEY_HOME = 0x24,
+};
+
+// Событие в клиентских координатах окна
+struct PlatformEvent {
+  enum Type { MouseDown, MouseUp, MouseMove, MouseWheel, DoubleClick, KeyDown, Command, Resize };
+
+  Type type = MouseMove;
+  int x = 0;
+  int y = 0;
+  int wheelDelta = 0;  // кратно WHEEL_STEP на щелчок колеса
+  int key = 0;         // PlatformKey
+  int command = 0;     // номер пункта меню
+  int width = 0;       // новый размер клиентской области (Resize)
+  int height = 0;
+
+  static const int WHEEL_STEP = 120;
+};
+
+// Кадр для рисования: пиксели 32bpp BGRA (как PixelFormat32bppARGB) и текст
+// средствами платформы. Текст ложится поверх пикселей кадра.
+class PlatformCanvas {
+ public:
+  virtual ~PlatformCanvas() = default;
+  virtual const Surface& GetSurface() = 0;
+  virtual void DrawString(int x, int y, const std::wstring& text, uint32_t color) = 0;
+};
+
+// Что логика может попросить у окна
+class PlatformHost {
+ public:
+  virtual ~PlatformHost() = default;
+  virtual int GetWidth() const = 0;
+  virtual int GetHeight() const = 0;
+  // Кадр устарел; окно перерисует его, когда сочтёт нужным
+  virtual void Invalidate() = 0;
+  virtual void SetCapture(bool capture) = 0;
+  virtual void SetTitle(const std::wstring& title) = 0;
+  virtual void ShowMessage(const std::wstring& text, const std::wstring& caption) = 0;
+};
+
+// Логика приложения без привязки к оконной системе
+class PlatformApp {
+ public:
+  virtual ~PlatformApp() = default;
+  virtual void OnEvent(const PlatformEvent& event, PlatformHost& host) = 0;
+  virtual void OnPaint(PlatformCanvas& canvas) = 0;
+};
+
+#endif  // PLATFORM_H
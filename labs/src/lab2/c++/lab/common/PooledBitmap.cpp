@@ -0,0 +1,96 @@
+#include "PooledBitmap.h"
+#include <utility>
+
+PooledBitmap::PooledBitmap() : pBitmap(nullptr) {}
+
+PooledBitmap::~PooledBitmap() {
+    Release();
+}
+
+bool PooledBitmap::Reset(int width, int height) {
+    if (pBitmap && surface.width == width && surface.height == height) {
+        return true;
+    }
+
+    Release();
+    if (!SurfacePool::Instance().Acquire(width, height, surface)) {
+        return false;
+    }
+    pBitmap = new Gdiplus::Bitmap(width, height, surface.stride, PixelFormat32bppARGB, surface.pixels);
+    if (pBitmap->GetLastStatus() != Gdiplus::Ok) {
+        Release();
+        return false;
+    }
+    return true;
+}
+
+bool PooledBitmap::EnsureSize(int width, int height) {
+    if (pBitmap && surface.width >= width && surface.height >= height) {
+        return true;
+    }
+
+    // Растём только по нужному измерению и сразу на четверть больше
+    int newWidth = width > surface.width ? width + width / 4 : surface.width;
+    int newHeight = height > surface.height ? height + height / 4 : surface.height;
+    return Reset(newWidth, newHeight);
+}
+
+bool PooledBitmap::LoadFromFile(const std::wstring& filePath) {
+    Gdiplus::Bitmap decoded(filePath.c_str());
+    if (decoded.GetLastStatus() != Gdiplus::Ok) {
+        Release();
+        return false;
+    }
+
+    int width = decoded.GetWidth();
+    int height = decoded.GetHeight();
+    if (!Reset(width, height)) {
+        return false;
+    }
+
+    // Декодер сразу пишет в наш буфер, без промежуточной копии
+    Gdiplus::Rect rect(0, 0, width, height);
+    Gdiplus::BitmapData data;
+    data.Width = width;
+    data.Height = height;
+    data.Stride = surface.stride;
+    data.PixelFormat = PixelFormat32bppARGB;
+    data.Scan0 = surface.pixels;
+    data.Reserved = 0;
+    if (decoded.LockBits(&rect, Gdiplus::ImageLockModeRead | Gdiplus::ImageLockModeUserInputBuf,
+                         PixelFormat32bppARGB, &data) != Gdiplus::Ok) {
+        Release();
+        return false;
+    }
+    decoded.UnlockBits(&data);
+    return true;
+}
+
+// Забирает уже заполненный буфер из пула; source после вызова пуст
+bool PooledBitmap::Adopt(Surface& source) {
+    Release();
+    surface = source;
+    source = Surface();
+    pBitmap = new Gdiplus::Bitmap(surface.width, surface.height, surface.stride, PixelFormat32bppARGB,
+                                  surface.pixels);
+    if (pBitmap->GetLastStatus() != Gdiplus::Ok) {
+        Release();
+        return false;
+    }
+    return true;
+}
+
+void PooledBitmap::Release() {
+    if (pBitmap) {
+        delete pBitmap;
+        pBitmap = nullptr;
+    }
+    if (surface.pixels) {
+        SurfacePool::Instance().Release(surface);
+    }
+}
+
+void PooledBitmap::Swap(PooledBitmap& other) {
+    std::swap(surface, other.surface);
+    std::swap(pBitmap, other.pBitmap);
+}
@@ -0,0 +1,39 @@
+#ifndef POOLEDBITMAP_H
+#define POOLEDBITMAP_H
+
+#include <windows.h>
+#include <gdiplus.h>
+#include <string>
+
+#include "SurfacePool.h"
+
+// Gdiplus::Bitmap поверх буфера из SurfacePool. Пока размер не меняется,
+// Reset() не выделяет память вовсе; при смене размера блок уходит обратно в пул.
+// EnsureSize() только растёт (с запасом), поэтому поверхность может быть больше
+// запрошенной области.
+class PooledBitmap {
+ public:
+  PooledBitmap();
+  ~PooledBitmap();
+  PooledBitmap(const PooledBitmap&) = delete;
+  PooledBitmap& operator=(const PooledBitmap&) = delete;
+
+  bool Reset(int width, int height);
+  bool EnsureSize(int width, int height);
+  bool LoadFromFile(const std::wstring& filePath);
+  bool Adopt(Surface& source);
+  void Release();
+  void Swap(PooledBitmap& other);
+
+  Gdiplus::Bitmap* Get() const { return pBitmap; }
+  const Surface& GetSurface() const { return surface; }
+  int GetWidth() const { return surface.width; }
+  int GetHeight() const { return surface.height; }
+  explicit operator bool() const { return pBitmap != nullptr; }
+
+ private:
+  Surface surface;
+  Gdiplus::Bitmap* pBitmap;
+};
+
+#endif  // POOLEDBITMAP_H
@@ -0,0 +1,63 @@
+#include "Resample.h"
+#include <algorithm>
+#include <vector>
+
+void FitSize(int fullWidth, int fullHeight, int maxWidth, int maxHeight, int& width, int& height) {
+    width = fullWidth;
+    height = fullHeight;
+    if (maxWidth <= 0 || maxHeight <= 0) return;
+    if (fullWidth <= maxWidth && fullHeight <= maxHeight) return;
+
+    double scaleX = static_cast<double>(maxWidth) / fullWidth;
+    double scaleY = static_cast<double>(maxHeight) / fullHeight;
+    double scale = scaleX < scaleY ? scaleX : scaleY;
+    width = static_cast<int>(fullWidth * scale + 0.5);
+    height = static_cast<int>(fullHeight * scale + 0.5);
+    if (width < 1) width = 1;
+    if (height < 1) height = 1;
+}
+
+bool ResampleSurface(const Surface& src, int width, int height, Surface& dst) {
+    if (!src.pixels || !SurfacePool::Instance().Acquire(width, height, dst)) return false;
+
+    // Границы исходных столбцов для каждого столбца результата считаем один раз
+    std::vector<int> columnStart(width + 1);
+    for (int x = 0; x <= width; ++x) {
+        columnStart[x] = static_cast<int>(static_cast<long long>(x) * src.width / width);
+    }
+    std::vector<uint32_t> sums(static_cast<size_t>(width) * 4);
+
+    for (int y = 0; y < height; ++y) {
+        int y0 = static_cast<int>(static_cast<long long>(y) * src.height / height);
+        int y1 = static_cast<int>(static_cast<long long>(y + 1) * src.height / height);
+        if (y1 <= y0) y1 = y0 + 1;
+
+        std::fill(sums.begin(), sums.end(), 0u);
+        for (int sy = y0; sy < y1; ++sy) {
+            const uint8_t* row = src.pixels + static_cast<size_t>(sy) * src.stride;
+            for (int x = 0; x < width; ++x) {
+                int x0 = columnStart[x];
+                int x1 = columnStart[x + 1] > x0 ? columnStart[x + 1] : x0 + 1;
+                uint32_t* sum = &sums[static_cast<size_t>(x) * 4];
+                for (const uint8_t* p = row + x0 * 4; p < row + x1 * 4; p += 4) {
+                    sum[0] += p[0];
+                    sum[1] += p[1];
+                    sum[2] += p[2];
+                    sum[3] += p[3];
+                }
+            }
+        }
+
+        uint8_t* out = dst.pixels + static_cast<size_t>(y) * dst.stride;
+        for (int x = 0; x < width; ++x) {
+            int x0 = columnStart[x];
+            int x1 = columnStart[x + 1] > x0 ? columnStart[x + 1] : x0 + 1;
+            uint32_t count = static_cast<uint32_t>((x1 - x0) * (y1 - y0));
+            const uint32_t* sum = &sums[static_cast<size_t>(x) * 4];
+            for (int c = 0; c < 4; ++c) {
+                out[x * 4 + c] = static_cast<uint8_t>((sum[c] + count / 2) / count);
+            }
+        }
+    }
+    return true;
+}
@@ -0,0 +1,14 @@
+#ifndef RESAMPLE_H
+#define RESAMPLE_H
+
+#include "SurfacePool.h"
+
+// Вписывает fullWidth x fullHeight в maxWidth x maxHeight с сохранением пропорций.
+// Меньшие изображения не увеличиваются.
+void FitSize(int fullWidth, int fullHeight, int maxWidth, int maxHeight, int& width, int& height);
+
+// Уменьшение усреднением по площади (box filter); при увеличении — ближайший сосед.
+// dst берётся из SurfacePool.
+bool ResampleSurface(const Surface& src, int width, int height, Surface& dst);
+
+#endif  // RESAMPLE_H
@@ -0,0 +1,120 @@
+#include "ScaledDecoder.h"
+#include <wincodec.h>
+#include <wrl/client.h>
+
+#include "Resample.h"
+
+#pragma comment(lib, "windowscodecs.lib")
+
+using Microsoft::WRL::ComPtr;
+
+namespace {
+// Пробует уменьшить кадр средствами самого декодера. Возвращает промежуточный
+// битмап не меньше запрошенного размера либо nullptr, если декодер не умеет.
+ComPtr<IWICBitmapSource> DecodeNativeScaled(IWICImagingFactory* factory, IWICBitmapFrameDecode* frame,
+                                            UINT fullWidth, UINT fullHeight, UINT width, UINT height) {
+    ComPtr<IWICBitmapSourceTransform> transform;
+    if (FAILED(frame->QueryInterface(IID_PPV_ARGS(&transform)))) return nullptr;
+
+    UINT scaledWidth = width;
+    UINT scaledHeight = height;
+    if (FAILED(transform->GetClosestSize(&scaledWidth, &scaledHeight))) return nullptr;
+    if (scaledWidth < width || scaledHeight < height) return nullptr;
+    if (scaledWidth >= fullWidth && scaledHeight >= fullHeight) return nullptr;
+
+    WICPixelFormatGUID format = GUID_WICPixelFormat32bppBGRA;
+    if (FAILED(transform->GetClosestPixelFormat(&format))) return nullptr;
+
+    ComPtr<IWICBitmap> bitmap;
+    if (FAILED(factory->CreateBitmap(scaledWidth, scaledHeight, format, WICBitmapCacheOnLoad, &bitmap))) {
+        return nullptr;
+    }
+
+    WICRect rect = { 0, 0, static_cast<INT>(scaledWidth), static_cast<INT>(scaledHeight) };
+    ComPtr<IWICBitmapLock> lock;
+    if (FAILED(bitmap->Lock(&rect, WICBitmapLockWrite, &lock))) return nullptr;
+
+    UINT stride = 0;
+    UINT bufferSize = 0;
+    BYTE* buffer = nullptr;
+    lock->GetStride(&stride);
+    lock->GetDataPointer(&bufferSize, &buffer);
+    HRESULT hr = transform->CopyPixels(nullptr, scaledWidth, scaledHeight, &format, WICBitmapTransformRotate0,
+                                       stride, bufferSize, buffer);
+    lock.Reset();
+    if (FAILED(hr)) return nullptr;
+    return bitmap;
+}
+}  // namespace
+
+bool DecodeImageToSurface(const std::wstring& filePath, int maxWidth, int maxHeight, Surface& surface,
+                          DecodeInfo* info) {
+    ComPtr<IWICImagingFactory> factory;
+    if (FAILED(CoCreateInstance(CLSID_WICImagingFactory, nullptr, CLSCTX_INPROC_SERVER, IID_PPV_ARGS(&factory)))) {
+        return false;
+    }
+
+    ComPtr<IWICBitmapDecoder> decoder;
+    if (FAILED(factory->CreateDecoderFromFilename(filePath.c_str(), nullptr, GENERIC_READ,
+                                                  WICDecodeMetadataCacheOnDemand, &decoder))) {
+        return false;
+    }
+
+    ComPtr<IWICBitmapFrameDecode> frame;
+    if (FAILED(decoder->GetFrame(0, &frame))) return false;
+
+    UINT fullWidth = 0;
+    UINT fullHeight = 0;
+    frame->GetSize(&fullWidth, &fullHeight);
+
+    int fitWidth = 0;
+    int fitHeight = 0;
+    FitSize(static_cast<int>(fullWidth), static_cast<int>(fullHeight), maxWidth, maxHeight, fitWidth, fitHeight);
+    UINT width = static_cast<UINT>(fitWidth);
+    UINT height = static_cast<UINT>(fitHeight);
+
+    ComPtr<IWICBitmapSource> source = frame;
+    bool nativeScaling = false;
+    if (width < fullWidth || height < fullHeight) {
+        ComPtr<IWICBitmapSource> scaled = DecodeNativeScaled(factory.Get(), frame.Get(), fullWidth, fullHeight,
+                                                             width, height);
+        if (scaled) {
+            source = scaled;
+            nativeScaling = true;
+        }
+
+        UINT sourceWidth = 0;
+        UINT sourceHeight = 0;
+        source->GetSize(&sourceWidth, &sourceHeight);
+        if (sourceWidth != width || sourceHeight != height) {
+            // Построчный масштаб: полный кадр целиком в памяти не держится
+            ComPtr<IWICBitmapScaler> scaler;
+            if (FAILED(factory->CreateBitmapScaler(&scaler))) return false;
+            if (FAILED(scaler->Initialize(source.Get(), width, height, WICBitmapInterpolationModeFant))) return false;
+            source = scaler;
+        }
+    }
+
+    ComPtr<IWICFormatConverter> converter;
+    if (FAILED(factory->CreateFormatConverter(&converter))) return false;
+    if (FAILED(converter->Initialize(source.Get(), GUID_WICPixelFormat32bppBGRA, WICBitmapDitherTypeNone, nullptr,
+                                     0.0, WICBitmapPaletteTypeCustom))) {
+        return false;
+    }
+
+    SurfacePool& pool = SurfacePool::Instance();
+    if (!pool.Acquire(static_cast<int>(width), static_cast<int>(height), surface)) return false;
+    if (FAILED(converter->CopyPixels(nullptr, surface.stride, surface.stride * surface.height, surface.pixels))) {
+        pool.Release(surface);
+        return false;
+    }
+
+    if (info) {
+        info->fullWidth = static_cast<int>(fullWidth);
+        info->fullHeight = static_cast<int>(fullHeight);
+        info->decodedWidth = static_cast<int>(width);
+        info->decodedHeight = static_cast<int>(height);
+        info->nativeScaling = nativeScaling;
+    }
+    return true;
+}
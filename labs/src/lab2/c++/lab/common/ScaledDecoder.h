@@ -0,0 +1,26 @@
+#ifndef SCALEDDECODER_H
+#define SCALEDDECODER_H
+
+#include <string>
+
+#include "SurfacePool.h"
+
+struct DecodeInfo {
+  int fullWidth = 0;
+  int fullHeight = 0;
+  int decodedWidth = 0;
+  int decodedHeight = 0;
+  bool nativeScaling = false;  // декодер сам уменьшил картинку (масштаб DCT у JPEG)
+};
+
+// Декодирует первый кадр файла так, чтобы он вписался в maxWidth x maxHeight
+// с сохранением пропорций. Если декодер умеет уменьшать при декодировании
+// (JPEG: 1/2, 1/4, 1/8), полный размер не распаковывается вовсе; остаток
+// масштаба делает потоковый IWICBitmapScaler (для PNG это весь масштаб).
+// maxWidth/maxHeight <= 0 означают полный размер.
+// Результат — буфер 32bpp BGRA из SurfacePool; вызывающий возвращает его через Release().
+// Поток должен быть инициализирован для COM.
+bool DecodeImageToSurface(const std::wstring& filePath, int maxWidth, int maxHeight, Surface& surface,
+                          DecodeInfo* info = nullptr);
+
+#endif  // SCALEDDECODER_H
@@ -0,0 +1,151 @@
+#include "SharedTiles.h"
+#include <algorithm>
+#include <cstring>
+
+#include "SurfaceDraw.h"
+
+namespace {
+// Отсечение прямоугольника по [0, width) x [0, height); false — пусто
+bool ClipRect(int width, int height, int& x, int& y, int& rectWidth, int& rectHeight) {
+    int left = std::max(x, 0);
+    int top = std::max(y, 0);
+    int right = std::min(x + rectWidth, width);
+    int bottom = std::min(y + rectHeight, height);
+    x = left;
+    y = top;
+    rectWidth = right - left;
+    rectHeight = bottom - top;
+    return rectWidth > 0 && rectHeight > 0;
+}
+}  // namespace
+
+PixelTile::~PixelTile() {
+    if (owned) SurfacePool::Instance().Release(pixels);
+}
+
+void TileView::Clear() {
+    tiles.clear();
+    width = 0;
+    height = 0;
+    tilesX = 0;
+    tilesY = 0;
+}
+
+void TileView::CopyRectTo(const Surface& target, int x, int y, int sourceX, int sourceY, int rectWidth,
+                          int rectHeight) const {
+    if (tiles.empty()) return;
+    // Отсечение по виду, затем по цели; сдвиг переносится на обе стороны
+    int clippedX = sourceX;
+    int clippedY = sourceY;
+    if (!ClipRect(width, height, clippedX, clippedY, rectWidth, rectHeight)) return;
+    x += clippedX - sourceX;
+    y += clippedY - sourceY;
+    int targetX = x;
+    int targetY = y;
+    if (!ClipRect(target.width, target.height, targetX, targetY, rectWidth, rectHeight)) return;
+    clippedX += targetX - x;
+    clippedY += targetY - y;
+
+    // Координаты в сетке плиток вида
+    int gridLeft = clippedX + offsetX;
+    int gridTop = clippedY + offsetY;
+    int gridRight = gridLeft + rectWidth;
+    int gridBottom = gridTop + rectHeight;
+    for (int tileY = gridTop / tileSize; tileY * tileSize < gridBottom; ++tileY) {
+        int top = std::max(gridTop, tileY * tileSize);
+        int bottom = std::min(gridBottom, (tileY + 1) * tileSize);
+        for (int tileX = gridLeft / tileSize; tileX * tileSize < gridRight; ++tileX) {
+            int left = std::max(gridLeft, tileX * tileSize);
+            int right = std::min(gridRight, (tileX + 1) * tileSize);
+            const PixelTile& tile = *tiles[static_cast<size_t>(tileY) * tilesX + tileX];
+            CopySurfaceRect(target, targetX + left - gridLeft, targetY + top - gridTop, tile.pixels,
+                            left - tileX * tileSize, top - tileY * tileSize, right - left, bottom - top);
+        }
+    }
+}
+
+CanvasTiles::~CanvasTiles() {
+    Release();
+}
+
+void CanvasTiles::Attach(const Surface& newCanvas) {
+    Release();
+    canvas = newCanvas;
+    tilesX = (canvas.width + TILE_SIZE - 1) / TILE_SIZE;
+    tilesY = (canvas.height + TILE_SIZE - 1) / TILE_SIZE;
+    tiles.assign(static_cast<size_t>(tilesX) * tilesY, nullptr);
+}
+
+void CanvasTiles::Release() {
+    if (canvas.pixels) Detach(0, 0, canvas.width, canvas.height);
+    tiles.clear();
+    canvas = Surface();
+    tilesX = 0;
+    tilesY = 0;
+}
+
+bool CanvasTiles::View(int x, int y, int width, int height, TileView& view) {
+    view.Clear();
+    if (!canvas.pixels || !ClipRect(canvas.width, canvas.height, x, y, width, height)) return false;
+
+    int firstX = x / TILE_SIZE;
+    int firstY = y / TILE_SIZE;
+    int lastX = (x + width - 1) / TILE_SIZE;
+    int lastY = (y + height - 1) / TILE_SIZE;
+    view.width = width;
+    view.height = height;
+    view.offsetX = x - firstX * TILE_SIZE;
+    view.offsetY = y - firstY * TILE_SIZE;
+    view.tilesX = lastX - firstX + 1;
+    view.tilesY = lastY - firstY + 1;
+    view.tileSize = TILE_SIZE;
+    view.tiles.reserve(static_cast<size_t>(view.tilesX) * view.tilesY);
+    for (int tileY = firstY; tileY <= lastY; ++tileY) {
+        for (int tileX = firstX; tileX <= lastX; ++tileX) {
+            std::shared_ptr<PixelTile>& tile = tiles[static_cast<size_t>(tileY) * tilesX + tileX];
+            if (!tile) {
+                tile = std::make_shared<PixelTile>();
+                tile->pixels.pixels = canvas.pixels + static_cast<size_t>(tileY) * TILE_SIZE * canvas.stride +
+                                      static_cast<size_t>(tileX) * TILE_SIZE * 4;
+                tile->pixels.width = std::min(TILE_SIZE, canvas.width - tileX * TILE_SIZE);
+                tile->pixels.height = std::min(TILE_SIZE, canvas.height - tileY * TILE_SIZE);
+                tile->pixels.stride = canvas.stride;
+            }
+            view.tiles.push_back(tile);
+        }
+    }
+    return true;
+}
+
+size_t CanvasTiles::Detach(int x, int y, int width, int height, bool* failed) {
+    if (!canvas.pixels || !ClipRect(canvas.width, canvas.height, x, y, width, height)) return 0;
+
+    size_t copied = 0;
+    for (int tileY = y / TILE_SIZE; tileY <= (y + height - 1) / TILE_SIZE; ++tileY) {
+        for (int tileX = x / TILE_SIZE; tileX <= (x + width - 1) / TILE_SIZE; ++tileX) {
+            std::shared_ptr<PixelTile>& tile = tiles[static_cast<size_t>(tileY) * tilesX + tileX];
+            if (!tile) continue;
+            // Окно больше никому не нужно: холст заведёт новое при следующем View()
+            if (tile.use_count() == 1) {
+                tile.reset();
+                continue;
+            }
+            Surface copy;
+            if (!SurfacePool::Instance().Acquire(tile->pixels.width, tile->pixels.height, copy)) {
+                if (failed) *failed = true;
+                continue;
+            }
+            for (int row = 0; row < copy.height; ++row) {
+                memcpy(copy.pixels + static_cast<size_t>(row) * copy.stride,
+                       tile->pixels.pixels + static_cast<size_t>(row) * tile->pixels.stride,
+                       static_cast<size_t>(copy.width) * 4);
+            }
+            // Держатели видят тот же объект PixelTile, теперь уже со своими пикселями
+            tile->pixels = copy;
+            tile->owned = true;
+            tile.reset();
+            copied++;
+        }
+    }
+    return copied;
+}
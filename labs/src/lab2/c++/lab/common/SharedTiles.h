@@ -0,0 +1,84 @@
+#ifndef SHAREDTILES_H
+#define SHAREDTILES_H
+
+#include <cstddef>
+#include <memory>
+#include <vector>
+
+#include "SurfacePool.h"
+
+// Плитка пикселей, которую делят холст и виды на него. Пока плитку никто не
+// трогал, её пиксели — окно прямо в буфер холста, со stride холста. Перед записью
+// в этот участок холст отдаёт держателям частную копию (CanvasTiles::Detach), и
+// дальше они смотрят уже в неё; копия берётся из SurfacePool.
+struct PixelTile {
+  Surface pixels;
+  bool owned = false;
+
+  PixelTile() = default;
+  ~PixelTile();
+  PixelTile(const PixelTile&) = delete;
+  PixelTile& operator=(const PixelTile&) = delete;
+};
+
+// Прямоугольник изображения как набор ссылок на плитки. Копирование вида
+// копирует только ссылки; пиксели живут, пока на плитку ссылается хоть кто-то.
+class TileView {
+ public:
+  int GetWidth() const { return width; }
+  int GetHeight() const { return height; }
+  bool IsEmpty() const { return tiles.empty(); }
+  size_t GetTileCount() const { return tiles.size(); }
+  void Clear();
+
+  // Прямоугольник width x height из (sourceX, sourceY) вида в (x, y) цели, с заменой
+  // альфы; отсекается и по виду, и по цели
+  void CopyRectTo(const Surface& target, int x, int y, int sourceX, int sourceY, int width, int height) const;
+
+ private:
+  friend class CanvasTiles;
+
+  int width = 0;
+  int height = 0;
+  int offsetX = 0;  // положение точки (0, 0) вида внутри первой плитки
+  int offsetY = 0;
+  int tilesX = 0;
+  int tilesY = 0;
+  int tileSize = 0;
+  std::vector<std::shared_ptr<PixelTile>> tiles;
+};
+
+// Разбиение плоского холста на плитки для видов без копирования. Плитки-окна
+// заводятся лениво, при первом View() над ними; без видов Detach() ничего не стоит.
+// Холст сам пишет в свой буфер как обычно, но до записи обязан вызвать Detach()
+// для затрагиваемого прямоугольника, а до замены или освобождения буфера — Release().
+class CanvasTiles {
+ public:
+  static constexpr int TILE_SIZE = 64;
+
+  CanvasTiles() = default;
+  ~CanvasTiles();
+  CanvasTiles(const CanvasTiles&) = delete;
+  CanvasTiles& operator=(const CanvasTiles&) = delete;
+
+  void Attach(const Surface& canvas);
+  void Release();
+
+  // Прямоугольник холста (отсекается по его границам) как вид; false — пустое пересечение
+  bool View(int x, int y, int width, int height, TileView& view);
+
+  // Общие с видами плитки прямоугольника получают частные копии, холст может писать.
+  // Возвращает число скопированных плиток. failed выставляется, если на копию не
+  // хватило памяти: держатели такой плитки увидят новую запись.
+  size_t Detach(int x, int y, int width, int height, bool* failed = nullptr);
+
+  const Surface& GetCanvas() const { return canvas; }
+
+ private:
+  Surface canvas;
+  int tilesX = 0;
+  int tilesY = 0;
+  std::vector<std::shared_ptr<PixelTile>> tiles;  // nullptr — окно ещё никому не выдавалось
+};
+
+#endif  // SHAREDTILES_H
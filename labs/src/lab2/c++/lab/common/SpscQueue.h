@@ -0,0 +1,42 @@
+#ifndef SPSCQUEUE_H
+#define SPSCQUEUE_H
+
+#include <atomic>
+#include <cstddef>
+
+// Кольцевая очередь без блокировок для одного писателя и одного читателя.
+// Capacity — степень двойки; при переполнении TryPush возвращает false,
+// и писатель сам решает, что делать с отброшенным элементом.
+template <typename T, size_t Capacity>
+class SpscQueue {
+  static_assert(Capacity >= 2 && (Capacity & (Capacity - 1)) == 0, "Capacity must be a power of two");
+
+ public:
+  SpscQueue() : head(0), tail(0) {}
+
+  bool TryPush(const T& item) {
+    size_t currentTail = tail.load(std::memory_order_relaxed);
+    if (currentTail - head.load(std::memory_order_acquire) == Capacity) return false;
+    items[currentTail & (Capacity - 1)] = item;
+    tail.store(currentTail + 1, std::memory_order_release);
+    return true;
+  }
+
+  bool TryPop(T& item) {
+    size_t currentHead = head.load(std::memory_order_relaxed);
+    if (currentHead == tail.load(std::memory_order_acquire)) return false;
+    item = items[currentHead & (Capacity - 1)];
+    head.store(currentHead + 1, std::memory_order_release);
+    return true;
+  }
+
+  bool IsEmpty() const { return head.load(std::memory_order_acquire) == tail.load(std::memory_order_acquire); }
+
+ private:
+  T items[Capacity];
+  // Индексы на разных строках кэша, чтобы писатель и читатель не мешали друг другу
+  alignas(64) std::atomic<size_t> head;
+  alignas(64) std::atomic<size_t> tail;
+};
+
+#endif  // SPSCQUEUE_H
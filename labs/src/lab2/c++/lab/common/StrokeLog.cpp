@@ -0,0 +1,187 @@
+#include "StrokeLog.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+
+namespace {
+const char LOG_MAGIC[8] = { 'S', 'T', 'R', 'K', 'L', 'O', 'G', '1' };
+const uint32_t LOG_VERSION = 1;
+// Дальше любого холста; floor(x / CELL_SIZE) и границы с кистью остаются в int
+const float MAX_COORDINATE = 1.0e7f;
+
+struct LogHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t strokeCount;
+    uint32_t pointCount;
+    uint32_t reserved;
+};
+
+int CellOf(float coordinate) {
+    return static_cast<int>(std::floor(coordinate / StrokeLog::CELL_SIZE));
+}
+
+// NaN не проходит ни одно сравнение, поэтому отсекается вместе с бесконечностями
+bool IsValidCoordinate(float value) {
+    return value >= -MAX_COORDINATE && value <= MAX_COORDINATE;
+}
+}  // namespace
+
+StrokeLog::StrokeLog() {
+    Clear();
+}
+
+void StrokeLog::Clear() {
+    strokes.clear();
+    points.clear();
+    cells.clear();
+    boundsLeft = boundsTop = 1e30f;
+    boundsRight = boundsBottom = -1e30f;
+}
+
+void StrokeLog::BeginStroke(uint32_t color, float size, float x, float y) {
+    StrokeRecord stroke = { static_cast<uint32_t>(points.size()), 1, color, size };
+    strokes.push_back(stroke);
+    points.push_back({ x, y });
+}
+
+void StrokeLog::AddPoint(float x, float y) {
+    if (strokes.empty()) return;
+    points.push_back({ x, y });
+    strokes.back().pointCount++;
+    IndexSegment(static_cast<uint32_t>(points.size() - 1));
+}
+
+uint64_t StrokeLog::CellKey(int cellX, int cellY) {
+    return (static_cast<uint64_t>(static_cast<uint32_t>(cellX)) << 32) | static_cast<uint32_t>(cellY);
+}
+
+void StrokeLog::IndexSegment(uint32_t endPoint) {
+    const StrokePoint& a = points[endPoint - 1];
+    const StrokePoint& b = points[endPoint];
+    float radius = strokes.back().size * 0.5f;
+    float left = std::min(a.x, b.x) - radius;
+    float top = std::min(a.y, b.y) - radius;
+    float right = std::max(a.x, b.x) + radius;
+    float bottom = std::max(a.y, b.y) + radius;
+
+    boundsLeft = std::min(boundsLeft, left);
+    boundsTop = std::min(boundsTop, top);
+    boundsRight = std::max(boundsRight, right);
+    boundsBottom = std::max(boundsBottom, bottom);
+
+    // Отрезки кисти короткие, обычно это одна-две ячейки
+    for (int cellY = CellOf(top); cellY <= CellOf(bottom); ++cellY) {
+        for (int cellX = CellOf(left); cellX <= CellOf(right); ++cellX) {
+            cells[CellKey(cellX, cellY)].push_back(endPoint);
+        }
+    }
+}
+
+void StrokeLog::Query(float left, float top, float right, float bottom, std::vector<uint32_t>& segments) const {
+    segments.clear();
+    if (cells.empty()) return;
+
+    // Запрос шире нарисованного — обрезаем, чтобы не перебирать пустые ячейки
+    left = std::max(left, boundsLeft);
+    top = std::max(top, boundsTop);
+    right = std::min(right, boundsRight);
+    bottom = std::min(bottom, boundsBottom);
+    if (left > right || top > bottom) return;
+
+    for (int cellY = CellOf(top); cellY <= CellOf(bottom); ++cellY) {
+        for (int cellX = CellOf(left); cellX <= CellOf(right); ++cellX) {
+            auto it = cells.find(CellKey(cellX, cellY));
+            if (it != cells.end()) {
+                segments.insert(segments.end(), it->second.begin(), it->second.end());
+            }
+        }
+    }
+    std::sort(segments.begin(), segments.end());
+    segments.erase(std::unique(segments.begin(), segments.end()), segments.end());
+}
+
+uint32_t StrokeLog::StrokeForPoint(uint32_t pointIndex) const {
+    auto it = std::upper_bound(strokes.begin(), strokes.end(), pointIndex,
+                               [](uint32_t index, const StrokeRecord& stroke) { return index < stroke.firstPoint; });
+    return static_cast<uint32_t>(it - strokes.begin()) - 1;
+}
+
+bool StrokeLog::GetBounds(float& left, float& top, float& right, float& bottom) const {
+    if (cells.empty()) return false;
+    left = boundsLeft;
+    top = boundsTop;
+    right = boundsRight;
+    bottom = boundsBottom;
+    return true;
+}
+
+bool StrokeLog::Save(const std::filesystem::path& path) const {
+    std::ofstream stream(path, std::ios::binary | std::ios::trunc);
+    if (!stream) return false;
+
+    LogHeader header;
+    std::memcpy(header.magic, LOG_MAGIC, sizeof(LOG_MAGIC));
+    header.version = LOG_VERSION;
+    header.strokeCount = static_cast<uint32_t>(strokes.size());
+    header.pointCount = static_cast<uint32_t>(points.size());
+    header.reserved = 0;
+    stream.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    stream.write(reinterpret_cast<const char*>(strokes.data()), strokes.size() * sizeof(StrokeRecord));
+    stream.write(reinterpret_cast<const char*>(points.data()), points.size() * sizeof(StrokePoint));
+    return static_cast<bool>(stream);
+}
+
+bool StrokeLog::Load(const std::filesystem::path& path) {
+    std::ifstream stream(path, std::ios::binary);
+    if (!stream) return false;
+
+    LogHeader header;
+    if (!stream.read(reinterpret_cast<char*>(&header), sizeof(header)) ||
+        std::memcmp(header.magic, LOG_MAGIC, sizeof(LOG_MAGIC)) != 0 || header.version != LOG_VERSION) {
+        return false;
+    }
+
+    // Счётчики заголовка сверяются с размером файла до выделения памяти под них:
+    // испорченный заголовок иначе просит гигабайты и кончается bad_alloc
+    std::error_code error;
+    uintmax_t fileSize = std::filesystem::file_size(path, error);
+    if (error || fileSize < sizeof(header)) return false;
+    uint64_t payload = static_cast<uint64_t>(header.strokeCount) * sizeof(StrokeRecord) +
+                       static_cast<uint64_t>(header.pointCount) * sizeof(StrokePoint);
+    if (payload > fileSize - sizeof(header)) return false;
+
+    std::vector<StrokeRecord> loadedStrokes(header.strokeCount);
+    std::vector<StrokePoint> loadedPoints(header.pointCount);
+    stream.read(reinterpret_cast<char*>(loadedStrokes.data()), loadedStrokes.size() * sizeof(StrokeRecord));
+    stream.read(reinterpret_cast<char*>(loadedPoints.data()), loadedPoints.size() * sizeof(StrokePoint));
+    if (!stream) return false;
+
+    // Штрихи должны покрывать массив точек подряд, иначе файл испорчен. Сумма в 64
+    // битах: в 32 подобранные длины переполняются и проходят проверку
+    uint64_t expected = 0;
+    for (const StrokeRecord& stroke : loadedStrokes) {
+        if (stroke.firstPoint != expected || stroke.pointCount == 0) return false;
+        if (static_cast<uint64_t>(stroke.firstPoint) + stroke.pointCount > header.pointCount) return false;
+        if (!(stroke.size >= 0.0f && stroke.size <= MAX_COORDINATE)) return false;
+        expected += stroke.pointCount;
+    }
+    if (expected != header.pointCount) return false;
+    for (const StrokePoint& point : loadedPoints) {
+        if (!IsValidCoordinate(point.x) || !IsValidCoordinate(point.y)) return false;
+    }
+
+    // Индекс не хранится в файле: он строится заново тем же путём, что и при рисовании
+    Clear();
+    points.reserve(loadedPoints.size());
+    strokes.reserve(loadedStrokes.size());
+    for (const StrokeRecord& stroke : loadedStrokes) {
+        const StrokePoint* first = &loadedPoints[stroke.firstPoint];
+        BeginStroke(stroke.color, stroke.size, first->x, first->y);
+        for (uint32_t i = 1; i < stroke.pointCount; ++i) {
+            AddPoint(first[i].x, first[i].y);
+        }
+    }
+    return true;
+}
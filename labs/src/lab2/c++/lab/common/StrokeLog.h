@@ -0,0 +1,61 @@
+#ifndef STROKELOG_H
+#define STROKELOG_H
+
+#include <cstdint>
+#include <filesystem>
+#include <unordered_map>
+#include <vector>
+
+// Точка штриха в координатах документа (пиксели холста при масштабе 1).
+struct StrokePoint {
+  float x;
+  float y;
+};
+
+// Штрих — непрерывный отрезок массива точек журнала.
+struct StrokeRecord {
+  uint32_t firstPoint;
+  uint32_t pointCount;
+  uint32_t color;  // ARGB
+  float size;
+};
+
+// Журнал штрихов только на дописывание. Отрезок задаётся индексом своей
+// конечной точки, так что отдельного массива отрезков нет. Пространственный
+// индекс — равномерная сетка ячеек CELL_SIZE x CELL_SIZE, в каждой ячейке
+// номера отрезков, задевающих её с учётом толщины кисти.
+class StrokeLog {
+ public:
+  static const int CELL_SIZE = 128;
+
+  StrokeLog();
+
+  void BeginStroke(uint32_t color, float size, float x, float y);
+  void AddPoint(float x, float y);
+  void Clear();
+
+  // Номера отрезков, задевающих прямоугольник документа, по возрастанию и без повторов
+  void Query(float left, float top, float right, float bottom, std::vector<uint32_t>& segments) const;
+  // Штрих, которому принадлежит точка
+  uint32_t StrokeForPoint(uint32_t pointIndex) const;
+
+  bool Save(const std::filesystem::path& path) const;
+  bool Load(const std::filesystem::path& path);
+
+  const std::vector<StrokeRecord>& GetStrokes() const { return strokes; }
+  const std::vector<StrokePoint>& GetPoints() const { return points; }
+  size_t GetSegmentCount() const { return points.size() - strokes.size(); }
+  // Габариты всего нарисованного, включая толщину кисти
+  bool GetBounds(float& left, float& top, float& right, float& bottom) const;
+
+ private:
+  static uint64_t CellKey(int cellX, int cellY);
+  void IndexSegment(uint32_t endPoint);
+
+  std::vector<StrokeRecord> strokes;
+  std::vector<StrokePoint> points;
+  std::unordered_map<uint64_t, std::vector<uint32_t>> cells;
+  float boundsLeft, boundsTop, boundsRight, boundsBottom;
+};
+
+#endif  // STROKELOG_H
@@ -0,0 +1,116 @@
+#include "StrokeRaster.h"
+#include <algorithm>
+#include <cmath>
+
+namespace {
+struct PixelBox {
+    int left, top, right, bottom;
+};
+
+// Покрытие толстого отрезка (капсулы) в пикселях прямоугольника tile
+void AccumulateSegment(double ax, double ay, double bx, double by, double radius, const PixelBox& tile,
+                       float* coverage, PixelBox& dirty) {
+    int left = std::max<int>(tile.left, static_cast<int>(std::floor(std::min(ax, bx) - radius - 1)));
+    int top = std::max<int>(tile.top, static_cast<int>(std::floor(std::min(ay, by) - radius - 1)));
+    int right = std::min<int>(tile.right, static_cast<int>(std::ceil(std::max(ax, bx) + radius + 1)));
+    int bottom = std::min<int>(tile.bottom, static_cast<int>(std::ceil(std::max(ay, by) + radius + 1)));
+    if (left >= right || top >= bottom) return;
+
+    dirty.left = std::min(dirty.left, left);
+    dirty.top = std::min(dirty.top, top);
+    dirty.right = std::max(dirty.right, right);
+    dirty.bottom = std::max(dirty.bottom, bottom);
+
+    double dx = bx - ax;
+    double dy = by - ay;
+    double lengthSq = dx * dx + dy * dy;
+    double inverseLengthSq = lengthSq > 1e-12 ? 1.0 / lengthSq : 0.0;
+    int tileWidth = tile.right - tile.left;
+
+    for (int y = top; y < bottom; ++y) {
+        double py = y + 0.5 - ay;
+        float* row = coverage + static_cast<size_t>(y - tile.top) * tileWidth - tile.left;
+        for (int x = left; x < right; ++x) {
+            double px = x + 0.5 - ax;
+            double t = std::clamp((px * dx + py * dy) * inverseLengthSq, 0.0, 1.0);
+            double ex = px - t * dx;
+            double ey = py - t * dy;
+            double distance = std::sqrt(ex * ex + ey * ey);
+            float value = static_cast<float>(std::clamp(radius + 0.5 - distance, 0.0, 1.0));
+            if (value > row[x]) row[x] = value;
+        }
+    }
+}
+
+// Смешивает накопленное покрытие штриха с целью и обнуляет его
+void ResolveStroke(uint32_t color, const PixelBox& tile, const PixelBox& dirty, float* coverage,
+                   const Surface& target) {
+    float alpha = (color >> 24) / 255.0f;
+    float blue = static_cast<float>(color & 0xFF);
+    float green = static_cast<float>((color >> 8) & 0xFF);
+    float red = static_cast<float>((color >> 16) & 0xFF);
+    int tileWidth = tile.right - tile.left;
+
+    for (int y = dirty.top; y < dirty.bottom; ++y) {
+        float* row = coverage + static_cast<size_t>(y - tile.top) * tileWidth - tile.left;
+        uint8_t* pixel = target.pixels + static_cast<size_t>(y) * target.stride + dirty.left * 4;
+        for (int x = dirty.left; x < dirty.right; ++x, pixel += 4) {
+            float amount = row[x] * alpha;
+            row[x] = 0.0f;
+            if (amount <= 0.0f) continue;
+            pixel[0] = static_cast<uint8_t>(pixel[0] + (blue - pixel[0]) * amount + 0.5f);
+            pixel[1] = static_cast<uint8_t>(pixel[1] + (green - pixel[1]) * amount + 0.5f);
+            pixel[2] = static_cast<uint8_t>(pixel[2] + (red - pixel[2]) * amount + 0.5f);
+            pixel[3] = static_cast<uint8_t>(pixel[3] + (255 - pixel[3]) * amount + 0.5f);
+        }
+    }
+}
+}  // namespace
+
+size_t RasterizeStrokes(const StrokeLog& log, const StrokeView& view, const Surface& target, int left, int top,
+                        int right, int bottom, StrokeRasterScratch& scratch) {
+    left = std::max(left, 0);
+    top = std::max(top, 0);
+    right = std::min(right, target.width);
+    bottom = std::min(bottom, target.height);
+    if (left >= right || top >= bottom || view.scale <= 0.0) return 0;
+
+    // Запрос к индексу в координатах документа; толщину кисти индекс уже учёл
+    double inverseScale = 1.0 / view.scale;
+    log.Query(static_cast<float>(view.originX + (left - 1) * inverseScale),
+              static_cast<float>(view.originY + (top - 1) * inverseScale),
+              static_cast<float>(view.originX + (right + 1) * inverseScale),
+              static_cast<float>(view.originY + (bottom + 1) * inverseScale), scratch.segments);
+    if (scratch.segments.empty()) return 0;
+
+    PixelBox tile = { left, top, right, bottom };
+    scratch.coverage.assign(static_cast<size_t>(right - left) * (bottom - top), 0.0f);
+    float* coverage = scratch.coverage.data();
+
+    const std::vector<StrokeRecord>& strokes = log.GetStrokes();
+    const std::vector<StrokePoint>& points = log.GetPoints();
+    const PixelBox empty = { right, bottom, left, top };
+
+    // Номера отрезков отсортированы, поэтому отрезки одного штриха идут подряд
+    uint32_t strokeIndex = log.StrokeForPoint(scratch.segments.front());
+    PixelBox dirty = empty;
+    for (uint32_t segment : scratch.segments) {
+        const StrokeRecord* stroke = &strokes[strokeIndex];
+        if (segment >= stroke->firstPoint + stroke->pointCount) {
+            if (dirty.left < dirty.right) ResolveStroke(stroke->color, tile, dirty, coverage, target);
+            dirty = empty;
+            while (segment >= strokes[strokeIndex].firstPoint + strokes[strokeIndex].pointCount) ++strokeIndex;
+            stroke = &strokes[strokeIndex];
+        }
+
+        const StrokePoint& a = points[segment - 1];
+        const StrokePoint& b = points[segment];
+        // Тоньше пикселя штрих не становится, иначе при отдалении он бы исчезал
+        double radius = std::max(stroke->size * view.scale * 0.5, 0.5);
+        AccumulateSegment((a.x - view.originX) * view.scale, (a.y - view.originY) * view.scale,
+                          (b.x - view.originX) * view.scale, (b.y - view.originY) * view.scale, radius, tile,
+                          coverage, dirty);
+    }
+    if (dirty.left < dirty.right) ResolveStroke(strokes[strokeIndex].color, tile, dirty, coverage, target);
+    return scratch.segments.size();
+}
@@ -0,0 +1,31 @@
+#ifndef STROKERASTER_H
+#define STROKERASTER_H
+
+#include <cstdint>
+#include <vector>
+
+#include "StrokeLog.h"
+#include "SurfacePool.h"
+
+// Точка документа (originX, originY) попадает в пиксель (0, 0) цели,
+// scale — пикселей цели на единицу документа.
+struct StrokeView {
+  double originX;
+  double originY;
+  double scale;
+};
+
+// Рабочие буферы растеризации; один экземпляр на поток, между вызовами не освобождаются.
+struct StrokeRasterScratch {
+  std::vector<uint32_t> segments;
+  std::vector<float> coverage;
+};
+
+// Рисует штрихи журнала поверх прямоугольника [left, right) x [top, bottom) цели
+// (32bpp BGRA) со сглаживанием. Отрезки берутся из пространственного индекса;
+// покрытие внутри одного штриха объединяется по максимуму, чтобы стыки
+// отрезков не темнели. Возвращает число нарисованных отрезков.
+size_t RasterizeStrokes(const StrokeLog& log, const StrokeView& view, const Surface& target, int left, int top,
+                        int right, int bottom, StrokeRasterScratch& scratch);
+
+#endif  // STROKERASTER_H
@@ -0,0 +1,150 @@
+#include "SurfaceDraw.h"
+#include <algorithm>
+#include <cstring>
+#include <vector>
+
+namespace {
+uint32_t* RowOf(const Surface& surface, int y) {
+    return reinterpret_cast<uint32_t*>(surface.pixels + static_cast<size_t>(y) * surface.stride);
+}
+
+// Координата источника для столбца (строки) результата: два соседних пикселя и вес
+// второго из 256. Центры пикселей совмещаются, края повторяются.
+struct SampleStep {
+    int first;
+    int second;
+    uint32_t weight;
+};
+
+void BuildSteps(int start, int count, int offset, int destinationSize, int sourceSize, bool nearest,
+                std::vector<SampleStep>& steps) {
+    steps.resize(count);
+    for (int i = 0; i < count; ++i) {
+        // (i + 0.5) * source / destination - 0.5 в 8 дробных битах
+        long long position = ((2LL * (start + i - offset) + 1) * sourceSize * 256) / (2LL * destinationSize) - 128;
+        if (nearest) position += 128;
+        long long whole = position >> 8;
+        int first = static_cast<int>(std::clamp<long long>(whole, 0, sourceSize - 1));
+        int second = static_cast<int>(std::clamp<long long>(whole + 1, 0, sourceSize - 1));
+        steps[i] = { first, nearest ? first : second, nearest ? 0u : static_cast<uint32_t>(position & 0xFF) };
+    }
+}
+
+// Смешивание двух пикселей покомпонентно: пары каналов (B, R) и (G, A) за одно умножение
+uint32_t Lerp(uint32_t a, uint32_t b, uint32_t weight) {
+    if (weight == 0 || a == b) return a;
+    uint32_t inverse = 256 - weight;
+    uint32_t redBlue = ((a & 0x00FF00FFu) * inverse + (b & 0x00FF00FFu) * weight) >> 8;
+    uint32_t alphaGreen = ((a >> 8) & 0x00FF00FFu) * inverse + ((b >> 8) & 0x00FF00FFu) * weight;
+    return (redBlue & 0x00FF00FFu) | (alphaGreen & 0xFF00FF00u);
+}
+
+// Наложение с неумноженной альфой: цвет смешивается по альфе источника,
+// альфа результата — a + d * (1 - a)
+uint32_t BlendOver(uint32_t source, uint32_t destination) {
+    uint32_t alpha = source >> 24;
+    if (alpha == 255) return source;
+    if (alpha == 0) return destination;
+    uint32_t weight = alpha + (alpha >> 7);
+    uint32_t color = Lerp(destination, source, weight) & 0x00FFFFFFu;
+    uint32_t destinationAlpha = destination >> 24;
+    uint32_t resultAlpha = alpha + destinationAlpha * (255 - alpha) / 255;
+    return color | (resultAlpha << 24);
+}
+
+// Общее отсечение для переноса без масштаба; false — пересечения нет
+bool ClipTransfer(const Surface& target, int& x, int& y, const Surface& source, int& sourceX, int& sourceY,
+                  int& width, int& height) {
+    if (!target.pixels || !source.pixels) return false;
+    int shiftX = std::max({ 0, -x, -sourceX });
+    int shiftY = std::max({ 0, -y, -sourceY });
+    x += shiftX;
+    sourceX += shiftX;
+    width -= shiftX;
+    y += shiftY;
+    sourceY += shiftY;
+    height -= shiftY;
+    width = std::min({ width, target.width - x, source.width - sourceX });
+    height = std::min({ height, target.height - y, source.height - sourceY });
+    return width > 0 && height > 0;
+}
+}  // namespace
+
+void FillSurfaceRect(const Surface& target, int x, int y, int width, int height, uint32_t color) {
+    int left = std::max(x, 0);
+    int top = std::max(y, 0);
+    int right = std::min(x + width, target.width);
+    int bottom = std::min(y + height, target.height);
+    if (left >= right || top >= bottom) return;
+    for (int row = top; row < bottom; ++row) {
+        uint32_t* pixels = RowOf(target, row);
+        std::fill(pixels + left, pixels + right, color);
+    }
+}
+
+void DrawSurfaceChessboard(const Surface& target, int width, int height, int tileSize, uint32_t dark, uint32_t light) {
+    width = std::min(width, target.width);
+    height = std::min(height, target.height);
+    if (width <= 0 || height <= 0 || tileSize <= 0) return;
+
+    // Две готовые строки: чётные и нечётные ряды клеток
+    std::vector<uint32_t> rows[2];
+    for (int parity = 0; parity < 2; ++parity) {
+        rows[parity].resize(width);
+        for (int x = 0; x < width; ++x) {
+            bool isDark = ((x / tileSize) + parity) % 2 == 0;
+            rows[parity][x] = isDark ? dark : light;
+        }
+    }
+    for (int y = 0; y < height; ++y) {
+        memcpy(RowOf(target, y), rows[(y / tileSize) % 2].data(), static_cast<size_t>(width) * 4);
+    }
+}
+
+void DrawSurfaceScaled(const Surface& target, const Surface& source, int x, int y, int width, int height,
+                       bool nearest) {
+    if (!target.pixels || !source.pixels || width <= 0 || height <= 0) return;
+    int left = std::max(x, 0);
+    int top = std::max(y, 0);
+    int right = static_cast<int>(std::min<long long>(static_cast<long long>(x) + width, target.width));
+    int bottom = static_cast<int>(std::min<long long>(static_cast<long long>(y) + height, target.height));
+    if (left >= right || top >= bottom) return;
+
+    std::vector<SampleStep> columns;
+    std::vector<SampleStep> rows;
+    BuildSteps(left, right - left, x, width, source.width, nearest, columns);
+    BuildSteps(top, bottom - top, y, height, source.height, nearest, rows);
+
+    for (int row = top; row < bottom; ++row) {
+        const SampleStep& step = rows[row - top];
+        const uint32_t* upper = RowOf(source, step.first);
+        const uint32_t* lower = RowOf(source, step.second);
+        uint32_t* out = RowOf(target, row) + left;
+        for (size_t column = 0; column < columns.size(); ++column) {
+            const SampleStep& c = columns[column];
+            uint32_t above = Lerp(upper[c.first], upper[c.second], c.weight);
+            uint32_t below = Lerp(lower[c.first], lower[c.second], c.weight);
+            out[column] = BlendOver(Lerp(above, below, step.weight), out[column]);
+        }
+    }
+}
+
+void CopySurfaceRect(const Surface& target, int x, int y, const Surface& source, int sourceX, int sourceY,
+                     int width, int height) {
+    if (!ClipTransfer(target, x, y, source, sourceX, sourceY, width, height)) return;
+    for (int row = 0; row < height; ++row) {
+        memcpy(RowOf(target, y + row) + x, RowOf(source, sourceY + row) + sourceX, static_cast<size_t>(width) * 4);
+    }
+}
+
+void BlendSurfaceRect(const Surface& target, int x, int y, const Surface& source, int sourceX, int sourceY,
+                      int width, int height) {
+    if (!ClipTransfer(target, x, y, source, sourceX, sourceY, width, height)) return;
+    for (int row = 0; row < height; ++row) {
+        const uint32_t* in = RowOf(source, sourceY + row) + sourceX;
+        uint32_t* out = RowOf(target, y + row) + x;
+        for (int column = 0; column < width; ++column) {
+            out[column] = BlendOver(in[column], out[column]);
+        }
+    }
+}
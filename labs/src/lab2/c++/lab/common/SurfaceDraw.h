@@ -0,0 +1,31 @@
+#ifndef SURFACEDRAW_H
+#define SURFACEDRAW_H
+
+#include <cstdint>
+
+#include "SurfacePool.h"
+
+// Программное рисование в Surface (32bpp BGRA, альфа не предумножена) без
+// оконной системы. Все функции отсекают по границам цели.
+
+// Сплошная заливка прямоугольника, альфа цвета записывается как есть
+void FillSurfaceRect(const Surface& target, int x, int y, int width, int height, uint32_t color);
+
+// Шахматная подложка под прозрачные изображения, клетки отсчитываются от (0, 0) цели
+void DrawSurfaceChessboard(const Surface& target, int width, int height, int tileSize, uint32_t dark, uint32_t light);
+
+// Копия source, растянутая в прямоугольник (x, y, width, height), наложенная поверх
+// цели с учётом альфы. Уменьшение и увеличение — билинейно, как DrawImage в GDI+
+// по умолчанию; nearest выбирает ближайший пиксель (быстрее, для крупного масштаба).
+void DrawSurfaceScaled(const Surface& target, const Surface& source, int x, int y, int width, int height,
+                       bool nearest = false);
+
+// Прямоугольник width x height из (sourceX, sourceY) источника в (x, y) цели без
+// масштаба: CopySurfaceRect заменяет пиксели вместе с альфой, BlendSurfaceRect
+// накладывает их поверх. Отсекается и по источнику, и по цели.
+void CopySurfaceRect(const Surface& target, int x, int y, const Surface& source, int sourceX, int sourceY,
+                     int width, int height);
+void BlendSurfaceRect(const Surface& target, int x, int y, const Surface& source, int sourceX, int sourceY,
+                      int width, int height);
+
+#endif  // SURFACEDRAW_H
@@ -0,0 +1,136 @@
+#include "SurfacePool.h"
+#include <cstdlib>
+
+#ifdef _WIN32
+#include <malloc.h>
+#endif
+
+SurfacePool& SurfacePool::Instance() {
+    static SurfacePool pool;
+    return pool;
+}
+
+SurfacePool::SurfacePool(size_t maxCachedBytes) : maxCachedBytes(maxCachedBytes) {}
+
+SurfacePool::~SurfacePool() {
+    Trim();
+}
+
+int SurfacePool::StrideFor(int width) {
+    const int align = static_cast<int>(SURFACE_ALIGNMENT);
+    return (width * 4 + align - 1) / align * align;
+}
+
+size_t SurfacePool::BucketCapacity(size_t bytes) {
+    const size_t minBucket = 4096;
+    if (bytes <= minBucket) return minBucket;
+
+    // Четыре класса на октаву: перерасход памяти не больше ~25%
+    size_t top = 1;
+    while ((top << 1) <= bytes) top <<= 1;
+    size_t step = top / 4;
+    return (bytes + step - 1) / step * step;
+}
+
+bool SurfacePool::Acquire(int width, int height, Surface& surface) {
+    surface = Surface();
+    if (width <= 0 || height <= 0) return false;
+
+    int stride = StrideFor(width);
+    size_t capacity = BucketCapacity(static_cast<size_t>(stride) * height);
+
+    void* block = nullptr;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        auto it = freeLists.find(capacity);
+        if (it != freeLists.end() && !it->second.empty()) {
+            block = it->second.back();
+            it->second.pop_back();
+            stats.cachedBytes -= capacity;
+            stats.reuseHits++;
+        }
+    }
+
+    if (!block) {
+        block = AllocateBlock(capacity);
+        if (!block) return false;
+        std::lock_guard<std::mutex> lock(mutex);
+        stats.allocations++;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stats.liveBytes += capacity;
+        if (stats.liveBytes + stats.cachedBytes > stats.peakBytes) {
+            stats.peakBytes = stats.liveBytes + stats.cachedBytes;
+        }
+    }
+
+    surface.pixels = static_cast<uint8_t*>(block);
+    surface.width = width;
+    surface.height = height;
+    surface.stride = stride;
+    surface.capacity = capacity;
+    surface.memoryTag = CurrentMemoryTag();
+    MemoryAllocated(surface.memoryTag, capacity);
+    return true;
+}
+
+void SurfacePool::Release(Surface& surface) {
+    if (!surface.pixels) return;
+
+    void* block = surface.pixels;
+    size_t capacity = surface.capacity;
+    MemoryReleased(surface.memoryTag, capacity);
+    surface = Surface();
+
+    std::lock_guard<std::mutex> lock(mutex);
+    stats.liveBytes -= capacity;
+    stats.releases++;
+    if (stats.cachedBytes + capacity > maxCachedBytes) {
+        FreeBlock(block);
+        return;
+    }
+    freeLists[capacity].push_back(block);
+    stats.cachedBytes += capacity;
+}
+
+void SurfacePool::Trim() {
+    std::lock_guard<std::mutex> lock(mutex);
+    for (auto& bucket : freeLists) {
+        for (void* block : bucket.second) {
+            FreeBlock(block);
+        }
+    }
+    freeLists.clear();
+    stats.cachedBytes = 0;
+}
+
+SurfacePoolStats SurfacePool::GetStats() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return stats;
+}
+
+void SurfacePool::ResetCounters() {
+    std::lock_guard<std::mutex> lock(mutex);
+    stats.allocations = 0;
+    stats.reuseHits = 0;
+    stats.releases = 0;
+    stats.peakBytes = stats.liveBytes + stats.cachedBytes;
+}
+
+void* SurfacePool::AllocateBlock(size_t capacity) {
+#ifdef _WIN32
+    return _aligned_malloc(capacity, SURFACE_ALIGNMENT);
+#else
+    return std::aligned_alloc(SURFACE_ALIGNMENT, capacity);
+#endif
+}
+
+void SurfacePool::FreeBlock(void* block) {
+#ifdef _WIN32
+    _aligned_free(block);
+#else
+    std::free(block);
+#endif
+}
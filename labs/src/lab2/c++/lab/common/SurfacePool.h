@@ -0,0 +1,65 @@
+#ifndef SURFACEPOOL_H
+#define SURFACEPOOL_H
+
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <vector>
+
+#include "MemoryAccounting.h"
+
+// Пиксельный буфер 32bpp, выданный пулом. Строки выровнены по SURFACE_ALIGNMENT.
+struct Surface {
+  uint8_t* pixels = nullptr;
+  int width = 0;
+  int height = 0;
+  int stride = 0;
+  size_t capacity = 0;  // размер блока в байтах (класс размера пула)
+  MemoryTag memoryTag = MEMORY_OTHER;  // подсистема, на которую записан блок
+};
+
+struct SurfacePoolStats {
+  size_t allocations = 0;  // обращений к куче за новым блоком
+  size_t reuseHits = 0;    // выдач из свободного списка
+  size_t releases = 0;
+  size_t liveBytes = 0;    // выдано и ещё не возвращено
+  size_t cachedBytes = 0;  // лежит в свободных списках
+  size_t peakBytes = 0;    // максимум liveBytes + cachedBytes
+};
+
+// Пул буферов, разбитых по классам размера (4 класса на октаву).
+// Повторный запрос того же размера обслуживается без обращения к куче.
+// Выданный блок записывается на метку памяти потока (MemoryAccounting.h).
+class SurfacePool {
+ public:
+  static const size_t SURFACE_ALIGNMENT = 64;
+
+  static SurfacePool& Instance();
+
+  explicit SurfacePool(size_t maxCachedBytes = 256u * 1024u * 1024u);
+  ~SurfacePool();
+  SurfacePool(const SurfacePool&) = delete;
+  SurfacePool& operator=(const SurfacePool&) = delete;
+
+  bool Acquire(int width, int height, Surface& surface);
+  void Release(Surface& surface);
+  void Trim();
+
+  SurfacePoolStats GetStats() const;
+  void ResetCounters();
+
+  static int StrideFor(int width);
+  static size_t BucketCapacity(size_t bytes);
+
+ private:
+  void* AllocateBlock(size_t capacity);
+  void FreeBlock(void* block);
+
+  size_t maxCachedBytes;
+  std::map<size_t, std::vector<void*>> freeLists;
+  SurfacePoolStats stats;
+  mutable std::mutex mutex;
+};
+
+#endif  // SURFACEPOOL_H
@@ -0,0 +1,130 @@
+#include "ThreadPool.h"
+
+#include "MemoryAccounting.h"
+
+namespace {
+// Очередь рабочего, на котором сейчас выполняется код (для вложенных Submit)
+thread_local ThreadPool* currentPool = nullptr;
+thread_local size_t currentIndex = 0;
+}  // namespace
+
+size_t ThreadPool::DefaultThreadCount() {
+    size_t count = std::thread::hardware_concurrency();
+    return count > 0 ? count : 4;
+}
+
+ThreadPool::ThreadPool(size_t threadCount, size_t maxPending)
+    : queued(0), active(0), maxPending(maxPending), stopping(false), nextQueue(0), steals(0) {
+    if (threadCount == 0) threadCount = DefaultThreadCount();
+    for (size_t i = 0; i < threadCount; ++i) {
+        queues.push_back(std::make_unique<WorkerQueue>());
+    }
+    for (size_t i = 0; i < threadCount; ++i) {
+        threads.emplace_back(&ThreadPool::WorkerLoop, this, i);
+    }
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard<std::mutex> lock(stateMutex);
+        stopping = true;
+    }
+    workAvailable.notify_all();
+    for (std::thread& thread : threads) {
+        thread.join();
+    }
+}
+
+void ThreadPool::Submit(std::function<void()> task) {
+    // Буферы, выделенные задачей, записываются на метку того, кто её поставил
+    MemoryTag tag = CurrentMemoryTag();
+    if (tag != MEMORY_OTHER) {
+        task = [tag, inner = std::move(task)]() {
+            MEMORY_TAG_SCOPE(tag);
+            inner();
+        };
+    }
+    bool fromWorker = currentPool == this;
+    size_t index = fromWorker ? currentIndex : nextQueue++ % queues.size();
+
+    // Рабочий не ждёт места сам у себя, иначе пул может встать
+    if (maxPending > 0 && !fromWorker) {
+        std::unique_lock<std::mutex> lock(stateMutex);
+        spaceAvailable.wait(lock, [this] { return queued + active < maxPending; });
+        queued++;
+    }
+    else {
+        std::lock_guard<std::mutex> lock(stateMutex);
+        queued++;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(queues[index]->mutex);
+        queues[index]->tasks.push_back(std::move(task));
+    }
+    workAvailable.notify_one();
+}
+
+void ThreadPool::WaitIdle() {
+    std::unique_lock<std::mutex> lock(stateMutex);
+    idle.wait(lock, [this] { return queued == 0 && active == 0; });
+}
+
+bool ThreadPool::TryPop(size_t index, std::function<void()>& task) {
+    {
+        WorkerQueue& own = *queues[index];
+        std::lock_guard<std::mutex> lock(own.mutex);
+        if (!own.tasks.empty()) {
+            task = std::move(own.tasks.back());
+            own.tasks.pop_back();
+            return true;
+        }
+    }
+
+    for (size_t offset = 1; offset < queues.size(); ++offset) {
+        WorkerQueue& victim = *queues[(index + offset) % queues.size()];
+        std::lock_guard<std::mutex> lock(victim.mutex);
+        if (!victim.tasks.empty()) {
+            task = std::move(victim.tasks.front());
+            victim.tasks.pop_front();
+            steals++;
+            return true;
+        }
+    }
+    return false;
+}
+
+void ThreadPool::WorkerLoop(size_t index) {
+    currentPool = this;
+    currentIndex = index;
+
+    for (;;) {
+        std::function<void()> task;
+        {
+            std::unique_lock<std::mutex> lock(stateMutex);
+            workAvailable.wait(lock, [this] { return stopping || queued > 0; });
+            if (stopping && queued == 0) return;
+        }
+
+        if (!TryPop(index, task)) {
+            // Задачу уже забрал другой рабочий, а счётчик ещё не обновлён
+            std::this_thread::yield();
+            continue;
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(stateMutex);
+            queued--;
+            active++;
+        }
+
+        task();
+
+        {
+            std::lock_guard<std::mutex> lock(stateMutex);
+            active--;
+            if (queued == 0 && active == 0) idle.notify_all();
+        }
+        spaceAvailable.notify_one();
+    }
+}
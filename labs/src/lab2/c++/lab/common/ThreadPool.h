@@ -0,0 +1,56 @@
+#ifndef THREADPOOL_H
+#define THREADPOOL_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Пул потоков с собственной очередью у каждого рабочего. Рабочий берёт задачи
+// с конца своей очереди, а когда она пуста — крадёт с начала чужих.
+// maxPending ограничивает число задач в очередях и в работе: Submit() снаружи
+// пула блокируется, пока место не освободится (обратное давление).
+// Задача выполняется с меткой памяти потока, вызвавшего Submit().
+class ThreadPool {
+ public:
+  explicit ThreadPool(size_t threadCount = 0, size_t maxPending = 0);
+  ~ThreadPool();
+  ThreadPool(const ThreadPool&) = delete;
+  ThreadPool& operator=(const ThreadPool&) = delete;
+
+  void Submit(std::function<void()> task);
+  void WaitIdle();
+
+  size_t GetThreadCount() const { return threads.size(); }
+  size_t GetStealCount() const { return steals; }
+  static size_t DefaultThreadCount();
+
+ private:
+  struct WorkerQueue {
+    std::deque<std::function<void()>> tasks;
+    std::mutex mutex;
+  };
+
+  void WorkerLoop(size_t index);
+  bool TryPop(size_t index, std::function<void()>& task);
+
+  std::vector<std::unique_ptr<WorkerQueue>> queues;
+  std::vector<std::thread> threads;
+  std::mutex stateMutex;
+  std::condition_variable workAvailable;
+  std::condition_variable spaceAvailable;
+  std::condition_variable idle;
+  size_t queued;
+  size_t active;
+  size_t maxPending;
+  bool stopping;
+  std::atomic<size_t> nextQueue;
+  std::atomic<size_t> steals;
+};
+
+#endif  // THREADPOOL_H
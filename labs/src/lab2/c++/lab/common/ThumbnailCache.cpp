@@ -0,0 +1,356 @@
+#include "ThumbnailCache.h"
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <string>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <cerrno>
+#include <fcntl.h>
+#include <sys/file.h>
+#include <unistd.h>
+#endif
+
+#include "MemoryAccounting.h"
+
+namespace {
+const char PACK_MAGIC[8] = { 'T', 'H', 'M', 'B', 'P', 'A', 'K', '1' };
+
+struct PackHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t reserved;
+};
+
+struct PackRecord {
+    uint64_t key;
+    uint32_t width;
+    uint32_t height;
+    uint32_t dataSize;  // width * height * 4, строки без выравнивания
+    uint32_t reserved;
+};
+
+const uint32_t PACK_VERSION = 1;
+
+uint64_t Fnv1a(const void* data, size_t size, uint64_t hash) {
+    const uint8_t* bytes = static_cast<const uint8_t*>(data);
+    for (size_t i = 0; i < size; ++i) {
+        hash ^= bytes[i];
+        hash *= 1099511628211ull;
+    }
+    return hash;
+}
+}  // namespace
+
+#ifdef _WIN32
+ThumbnailCache::ThumbnailCache() : packHandle(INVALID_HANDLE_VALUE) {}
+#else
+ThumbnailCache::ThumbnailCache() : packDescriptor(-1) {}
+#endif
+
+ThumbnailCache::~ThumbnailCache() {
+    Close();
+}
+
+uint64_t ThumbnailCache::MakeKey(const std::filesystem::path& path, uint64_t modifiedTime, uint64_t fileSize) {
+    const std::filesystem::path::string_type& native = path.native();
+    uint64_t hash = Fnv1a(native.data(), native.size() * sizeof(native[0]), 14695981039346656037ull);
+    hash = Fnv1a(&modifiedTime, sizeof(modifiedTime), hash);
+    return Fnv1a(&fileSize, sizeof(fileSize), hash);
+}
+
+bool ThumbnailCache::MakeKey(const std::filesystem::directory_entry& entry, uint64_t& key) {
+    std::error_code error;
+    uint64_t fileSize = entry.file_size(error);
+    if (error) return false;
+    auto modified = entry.last_write_time(error);
+    if (error) return false;
+    key = MakeKey(entry.path(), static_cast<uint64_t>(modified.time_since_epoch().count()), fileSize);
+    return true;
+}
+
+size_t ThumbnailCache::IndexMapped() {
+    const uint8_t* data = mapped.GetData();
+    size_t size = mapped.GetSize();
+
+    PackHeader header;
+    if (size < sizeof(header)) return 0;
+    std::memcpy(&header, data, sizeof(header));
+    if (std::memcmp(header.magic, PACK_MAGIC, sizeof(PACK_MAGIC)) != 0 || header.version != PACK_VERSION) return 0;
+
+    size_t offset = sizeof(header);
+    while (offset + sizeof(PackRecord) <= size) {
+        PackRecord record;
+        std::memcpy(&record, data + offset, sizeof(record));
+        size_t dataStart = offset + sizeof(record);
+        if (record.dataSize != static_cast<uint64_t>(record.width) * record.height * 4 ||
+            record.dataSize > size - dataStart) {
+            break;
+        }
+        index[record.key] = { data + dataStart, static_cast<int>(record.width), static_cast<int>(record.height) };
+        offset = dataStart + record.dataSize;
+    }
+    return offset;
+}
+
+bool ThumbnailCache::Compact(uint64_t maxLiveBytes) {
+    // Живые записи — последние по каждому ключу, от новых к старым, пока хватает лимита
+    std::vector<const uint8_t*> records;
+    records.reserve(index.size());
+    for (const auto& entry : index) {
+        records.push_back(entry.second.pixels - sizeof(PackRecord));
+    }
+    std::sort(records.begin(), records.end(), [](const uint8_t* a, const uint8_t* b) { return a > b; });
+
+    uint64_t liveBytes = sizeof(PackHeader);
+    size_t kept = 0;
+    for (const uint8_t* start : records) {
+        PackRecord record;
+        std::memcpy(&record, start, sizeof(record));
+        uint64_t recordBytes = sizeof(record) + static_cast<uint64_t>(record.dataSize);
+        if (liveBytes + recordBytes > maxLiveBytes + sizeof(PackHeader)) break;
+        liveBytes += recordBytes;
+        kept++;
+    }
+    if (mapped.GetSize() < 2 * liveBytes) return false;
+    records.resize(kept);
+    std::sort(records.begin(), records.end());
+
+    // Пишем рядом и подменяем; если файл держит другое окно (Windows не даст его заменить), остаётся старый
+    std::filesystem::path temporary = packPath;
+    temporary += L".tmp";
+    std::error_code error;
+    {
+        std::ofstream stream(temporary, std::ios::binary | std::ios::trunc);
+        PackHeader header = {};
+        std::memcpy(header.magic, PACK_MAGIC, sizeof(PACK_MAGIC));
+        header.version = PACK_VERSION;
+        stream.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        for (const uint8_t* start : records) {
+            PackRecord record;
+            std::memcpy(&record, start, sizeof(record));
+            stream.write(reinterpret_cast<const char*>(start),
+                         static_cast<std::streamsize>(sizeof(record) + record.dataSize));
+        }
+        if (!stream) {
+            stream.close();
+            std::filesystem::remove(temporary, error);
+            return false;
+        }
+    }
+
+    index.clear();
+    mapped.Close();
+    UnlockPack();
+    ClosePack();
+    std::filesystem::rename(temporary, packPath, error);
+    if (error) std::filesystem::remove(temporary, error);
+
+    // Окна, открывшие старый файл раньше, дописывают в него до своего следующего Open()
+    if (!OpenPack(packPath)) return false;
+    LockPack();
+    if (mapped.Open(packPath)) IndexMapped();
+    return true;
+}
+
+bool ThumbnailCache::Open(const std::filesystem::path& path, uint64_t maxLiveBytes) {
+    Close();
+    std::lock_guard<std::mutex> lock(mutex);
+    packPath = path;
+
+    std::error_code error;
+    std::filesystem::create_directories(path.parent_path(), error);
+    if (!OpenPack(path)) return false;
+
+    // Под блокировкой другое окно не дописывает запись, так что оборванный хвост — след сбоя
+    LockPack();
+    size_t validEnd = 0;
+    if (mapped.Open(path)) {
+        validEnd = IndexMapped();
+
+        // Хвост после сбоя при записи отрезаем, иначе новые записи окажутся за мусором
+        if (validEnd != mapped.GetSize()) {
+            index.clear();
+            mapped.Close();
+            if (!TruncatePack(validEnd)) {
+                // Дописывать за мусор нельзя: кэш работает только в памяти
+                UnlockPack();
+                ClosePack();
+                return false;
+            }
+            if (validEnd != 0 && mapped.Open(path)) IndexMapped();
+        }
+    }
+
+    bool ok = true;
+    if (validEnd == 0) {
+        PackHeader header = {};
+        std::memcpy(header.magic, PACK_MAGIC, sizeof(PACK_MAGIC));
+        header.version = PACK_VERSION;
+        ok = WritePack(&header, sizeof(header));
+    }
+    else {
+        Compact(maxLiveBytes);
+        ok = IsPackOpen();
+    }
+    if (IsPackOpen()) UnlockPack();
+    if (!ok) ClosePack();
+    return ok;
+}
+
+void ThumbnailCache::Close() {
+    std::lock_guard<std::mutex> lock(mutex);
+    ClosePack();
+    index.clear();
+    for (const auto& entry : recent) {
+        MemoryReleased(MEMORY_CACHES, entry.second.size());
+    }
+    recent.clear();
+    mapped.Close();
+}
+
+bool ThumbnailCache::Find(uint64_t key, ThumbnailView& view) const {
+    std::lock_guard<std::mutex> lock(mutex);
+    auto it = index.find(key);
+    if (it == index.end()) return false;
+    view.pixels = it->second.pixels;
+    view.width = it->second.width;
+    view.height = it->second.height;
+    view.stride = it->second.width * 4;
+    return true;
+}
+
+bool ThumbnailCache::Insert(uint64_t key, const Surface& thumbnail) {
+    if (!thumbnail.pixels) return false;
+
+    PackRecord record = {};
+    record.key = key;
+    record.width = static_cast<uint32_t>(thumbnail.width);
+    record.height = static_cast<uint32_t>(thumbnail.height);
+    record.dataSize = record.width * record.height * 4;
+
+    // Запись целиком, пиксели без выравнивания строк: так она и ляжет в файл одним вызовом
+    std::vector<uint8_t> bytes(sizeof(record) + record.dataSize);
+    std::memcpy(bytes.data(), &record, sizeof(record));
+    uint8_t* pixels = bytes.data() + sizeof(record);
+    size_t rowSize = static_cast<size_t>(thumbnail.width) * 4;
+    for (int y = 0; y < thumbnail.height; ++y) {
+        std::memcpy(pixels + rowSize * y, thumbnail.pixels + static_cast<size_t>(y) * thumbnail.stride, rowSize);
+    }
+
+    std::lock_guard<std::mutex> lock(mutex);
+    if (index.count(key)) return true;
+    if (IsPackOpen()) {
+        LockPack();
+        bool written = WritePack(bytes.data(), bytes.size());
+        UnlockPack();
+        // Недописанную запись отрежет следующий Open(); до него в файл больше не пишем
+        if (!written) ClosePack();
+    }
+
+    // Узлы unordered_map не переезжают при рехэше, поэтому указатель остаётся валидным
+    std::vector<uint8_t>& stored = recent[key];
+    stored = std::move(bytes);
+    MemoryAllocated(MEMORY_CACHES, stored.size());
+    index[key] = { stored.data() + sizeof(record), thumbnail.width, thumbnail.height };
+    return true;
+}
+
+size_t ThumbnailCache::GetEntryCount() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return index.size();
+}
+
+#ifdef _WIN32
+namespace {
+// Блокируется байт далеко за концом файла: чтение и отображение другим окнам не мешает
+const DWORD LOCK_OFFSET_HIGH = 0x7FFFFFFF;
+}  // namespace
+
+bool ThumbnailCache::OpenPack(const std::filesystem::path& path) {
+    packHandle = CreateFileW(path.c_str(), GENERIC_READ | GENERIC_WRITE, FILE_SHARE_READ | FILE_SHARE_WRITE, nullptr,
+                             OPEN_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr);
+    return packHandle != INVALID_HANDLE_VALUE;
+}
+
+void ThumbnailCache::ClosePack() {
+    if (packHandle != INVALID_HANDLE_VALUE) CloseHandle(packHandle);
+    packHandle = INVALID_HANDLE_VALUE;
+}
+
+bool ThumbnailCache::IsPackOpen() const {
+    return packHandle != INVALID_HANDLE_VALUE;
+}
+
+void ThumbnailCache::LockPack() {
+    OVERLAPPED overlapped = {};
+    overlapped.OffsetHigh = LOCK_OFFSET_HIGH;
+    LockFileEx(packHandle, LOCKFILE_EXCLUSIVE_LOCK, 0, 1, 0, &overlapped);
+}
+
+void ThumbnailCache::UnlockPack() {
+    OVERLAPPED overlapped = {};
+    overlapped.OffsetHigh = LOCK_OFFSET_HIGH;
+    UnlockFileEx(packHandle, 0, 1, 0, &overlapped);
+}
+
+bool ThumbnailCache::WritePack(const void* data, size_t size) {
+    LARGE_INTEGER zero = {};
+    if (!SetFilePointerEx(packHandle, zero, nullptr, FILE_END)) return false;
+    const char* bytes = static_cast<const char*>(data);
+    while (size > 0) {
+        DWORD written = 0;
+        DWORD chunk = static_cast<DWORD>(std::min<size_t>(size, 1u << 30));
+        if (!WriteFile(packHandle, bytes, chunk, &written, nullptr) || written == 0) return false;
+        bytes += written;
+        size -= written;
+    }
+    return true;
+}
+
+bool ThumbnailCache::TruncatePack(uint64_t size) {
+    LARGE_INTEGER position;
+    position.QuadPart = static_cast<LONGLONG>(size);
+    return SetFilePointerEx(packHandle, position, nullptr, FILE_BEGIN) && SetEndOfFile(packHandle);
+}
+#else
+bool ThumbnailCache::OpenPack(const std::filesystem::path& path) {
+    packDescriptor = open(path.c_str(), O_RDWR | O_CREAT | O_APPEND | O_CLOEXEC, 0644);
+    return packDescriptor >= 0;
+}
+
+void ThumbnailCache::ClosePack() {
+    if (packDescriptor >= 0) close(packDescriptor);
+    packDescriptor = -1;
+}
+
+bool ThumbnailCache::IsPackOpen() const {
+    return packDescriptor >= 0;
+}
+
+void ThumbnailCache::LockPack() {
+    while (flock(packDescriptor, LOCK_EX) != 0 && errno == EINTR) {}
+}
+
+void ThumbnailCache::UnlockPack() {
+    flock(packDescriptor, LOCK_UN);
+}
+
+bool ThumbnailCache::WritePack(const void* data, size_t size) {
+    const char* bytes = static_cast<const char*>(data);
+    while (size > 0) {
+        ssize_t written = write(packDescriptor, bytes, size);
+        if (written < 0 && errno == EINTR) continue;
+        if (written <= 0) return false;
+        bytes += written;
+        size -= static_cast<size_t>(written);
+    }
+    return true;
+}
+
+bool ThumbnailCache::TruncatePack(uint64_t size) {
+    return ftruncate(packDescriptor, static_cast<off_t>(size)) == 0;
+}
+#endif
@@ -0,0 +1,81 @@
+#ifndef THUMBNAILCACHE_H
+#define THUMBNAILCACHE_H
+
+#include <cstdint>
+#include <filesystem>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+#include "MappedFile.h"
+#include "SurfacePool.h"
+
+// Миниатюра внутри кэша. Пиксели 32bpp BGRA, живут до Close()/Open().
+struct ThumbnailView {
+  const uint8_t* pixels = nullptr;
+  int width = 0;
+  int height = 0;
+  int stride = 0;
+};
+
+// Кэш миниатюр в одном pack-файле: заголовок, затем записи
+// [ключ, размеры, пиксели] подряд. При открытии файл отображается в память
+// и индексируется; новые миниатюры дописываются в конец и до следующего
+// Open() отдаются из памяти. Оборванная последняя запись отрезается.
+// Ключ — хэш пути, времени изменения и размера файла, так что изменённый
+// файл просто получает новую запись.
+// Несколько окон могут держать один pack: дописывание, отрезание хвоста и
+// сжатие идут под блокировкой файла. Старые записи (изменённые файлы, повторы
+// ключей) копятся, поэтому Open() переписывает файл, когда он вдвое больше
+// живых записей; живыми считаются самые новые записи в пределах maxLiveBytes.
+class ThumbnailCache {
+ public:
+  static const uint64_t MAX_LIVE_BYTES = 256ull << 20;
+
+  ThumbnailCache();
+  ~ThumbnailCache();
+  ThumbnailCache(const ThumbnailCache&) = delete;
+  ThumbnailCache& operator=(const ThumbnailCache&) = delete;
+
+  static uint64_t MakeKey(const std::filesystem::path& path, uint64_t modifiedTime, uint64_t fileSize);
+  static bool MakeKey(const std::filesystem::directory_entry& entry, uint64_t& key);
+
+  bool Open(const std::filesystem::path& packPath, uint64_t maxLiveBytes = MAX_LIVE_BYTES);
+  void Close();
+
+  bool Find(uint64_t key, ThumbnailView& view) const;
+  bool Insert(uint64_t key, const Surface& thumbnail);
+  size_t GetEntryCount() const;
+
+ private:
+  struct Location {
+    const uint8_t* pixels;
+    int width;
+    int height;
+  };
+
+  size_t IndexMapped();
+  bool Compact(uint64_t maxLiveBytes);
+
+  // Файл pack для записи; блокировка — между процессами, mutex — между потоками
+  bool OpenPack(const std::filesystem::path& path);
+  void ClosePack();
+  bool IsPackOpen() const;
+  void LockPack();
+  void UnlockPack();
+  bool WritePack(const void* data, size_t size);
+  bool TruncatePack(uint64_t size);
+
+  std::filesystem::path packPath;
+  MappedFile mapped;
+#ifdef _WIN32
+  void* packHandle;
+#else
+  int packDescriptor;
+#endif
+  std::unordered_map<uint64_t, Location> index;
+  std::unordered_map<uint64_t, std::vector<uint8_t>> recent;
+  mutable std::mutex mutex;
+};
+
+#endif  // THUMBNAILCACHE_H
@@ -0,0 +1,312 @@
+// fopen без предупреждений C4996 (в проектах включён /sdl)
+#ifdef _MSC_VER
+#define _CRT_SECURE_NO_WARNINGS
+#endif
+
+#include "TileJournal.h"
+#include <algorithm>
+#include <cstring>
+#include <string>
+
+#ifdef _WIN32
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+
+namespace {
+const char JOURNAL_MAGIC[8] = { 'T', 'I', 'L', 'E', 'J', 'R', 'N', '1' };
+const uint32_t JOURNAL_VERSION = 1;
+const uint32_t RECORD_MARKER = 0x454C4954;  // "TILE"
+
+// Журнал меньше этого размера не сжимается, даже если в нём много старых версий плиток
+const uint64_t MIN_COMPACTION_SIZE = 1u << 20;
+
+struct JournalHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t width;
+    uint32_t height;
+    uint32_t tileSize;
+};
+
+struct TileRecord {
+    uint32_t marker;
+    uint32_t tileX;
+    uint32_t tileY;
+    uint32_t width;
+    uint32_t height;
+    uint32_t checksum;  // FNV-1a по полям записи и пикселям
+};
+
+uint32_t Fnv1a(const void* data, size_t size, uint32_t hash) {
+    const uint8_t* bytes = static_cast<const uint8_t*>(data);
+    for (size_t i = 0; i < size; ++i) {
+        hash ^= bytes[i];
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+uint32_t RecordChecksum(const TileRecord& record, const uint8_t* pixels, size_t size) {
+    uint32_t hash = Fnv1a(&record.tileX, sizeof(uint32_t) * 4, 2166136261u);
+    return Fnv1a(pixels, size, hash);
+}
+
+std::FILE* OpenFile(const std::filesystem::path& path, const wchar_t* wideMode, const char* mode) {
+#ifdef _WIN32
+    (void)mode;
+    return _wfopen(path.c_str(), wideMode);
+#else
+    (void)wideMode;
+    return std::fopen(path.c_str(), mode);
+#endif
+}
+
+bool SeekTo(std::FILE* file, uint64_t offset) {
+#ifdef _WIN32
+    return _fseeki64(file, static_cast<__int64>(offset), SEEK_SET) == 0;
+#else
+    return fseeko(file, static_cast<off_t>(offset), SEEK_SET) == 0;
+#endif
+}
+
+int TileExtent(int canvasExtent, int tile) {
+    return std::min(TileJournal::TILE_SIZE, canvasExtent - tile * TileJournal::TILE_SIZE);
+}
+}  // namespace
+
+TileJournal::TileJournal()
+    : file(nullptr), canvasWidth(0), canvasHeight(0), tilesX(0), tilesY(0), fileSize(0), liveBytes(0),
+      bytesWritten(0), recordCount(0), compactionCount(0) {}
+
+TileJournal::~TileJournal() {
+    Close();
+}
+
+bool TileJournal::Sync(std::FILE* target) {
+    if (std::fflush(target) != 0) return false;
+#ifdef _WIN32
+    return _commit(_fileno(target)) == 0;
+#else
+    return fsync(fileno(target)) == 0;
+#endif
+}
+
+bool TileJournal::Start(const std::filesystem::path& journalPath, int width, int height) {
+    Close();
+    path = journalPath;
+    canvasWidth = width;
+    canvasHeight = height;
+    tilesX = (width + TILE_SIZE - 1) / TILE_SIZE;
+    tilesY = (height + TILE_SIZE - 1) / TILE_SIZE;
+    latestRecord.assign(static_cast<size_t>(tilesX) * tilesY, 0);
+    liveBytes = 0;
+
+    std::error_code error;
+    std::filesystem::create_directories(path.parent_path(), error);
+
+    // Новый журнал появляется под своим именем только целиком записанным
+    std::filesystem::path temporary = path;
+    temporary += ".tmp";
+    std::FILE* target = OpenFile(temporary, L"wb", "wb");
+    if (!target) return false;
+
+    JournalHeader header;
+    std::memcpy(header.magic, JOURNAL_MAGIC, sizeof(JOURNAL_MAGIC));
+    header.version = JOURNAL_VERSION;
+    header.width = static_cast<uint32_t>(width);
+    header.height = static_cast<uint32_t>(height);
+    header.tileSize = TILE_SIZE;
+    bool ok = std::fwrite(&header, sizeof(header), 1, target) == 1 && Sync(target);
+    std::fclose(target);
+
+    if (ok) std::filesystem::rename(temporary, path, error);
+    if (!ok || error) {
+        std::filesystem::remove(temporary, error);
+        return false;
+    }
+
+    file = OpenFile(path, L"ab", "ab");
+    fileSize = sizeof(header);
+    bytesWritten += sizeof(header);
+    return file != nullptr;
+}
+
+bool TileJournal::Recover(const std::filesystem::path& journalPath, Surface& canvas, size_t* tilesApplied) {
+    Close();
+    std::FILE* source = OpenFile(journalPath, L"rb", "rb");
+    if (!source) return false;
+
+    JournalHeader header;
+    if (std::fread(&header, sizeof(header), 1, source) != 1 ||
+        std::memcmp(header.magic, JOURNAL_MAGIC, sizeof(JOURNAL_MAGIC)) != 0 || header.version != JOURNAL_VERSION ||
+        header.tileSize != TILE_SIZE || header.width == 0 || header.height == 0 || header.width > 65536 ||
+        header.height > 65536 || !SurfacePool::Instance().Acquire(header.width, header.height, canvas)) {
+        std::fclose(source);
+        return false;
+    }
+
+    path = journalPath;
+    canvasWidth = static_cast<int>(header.width);
+    canvasHeight = static_cast<int>(header.height);
+    tilesX = (canvasWidth + TILE_SIZE - 1) / TILE_SIZE;
+    tilesY = (canvasHeight + TILE_SIZE - 1) / TILE_SIZE;
+    latestRecord.assign(static_cast<size_t>(tilesX) * tilesY, 0);
+    liveBytes = 0;
+    for (int y = 0; y < canvas.height; ++y) {
+        std::memset(canvas.pixels + static_cast<size_t>(y) * canvas.stride, 0xFF, static_cast<size_t>(canvas.width) * 4);
+    }
+
+    // Записи проигрываются до первой неполной или испорченной
+    size_t applied = 0;
+    uint64_t offset = sizeof(header);
+    std::vector<uint8_t> pixels(static_cast<size_t>(TILE_SIZE) * TILE_SIZE * 4);
+    TileRecord record;
+    while (std::fread(&record, sizeof(record), 1, source) == 1) {
+        if (record.marker != RECORD_MARKER || record.tileX >= static_cast<uint32_t>(tilesX) ||
+            record.tileY >= static_cast<uint32_t>(tilesY) ||
+            record.width != static_cast<uint32_t>(TileExtent(canvasWidth, record.tileX)) ||
+            record.height != static_cast<uint32_t>(TileExtent(canvasHeight, record.tileY))) {
+            break;
+        }
+        size_t size = static_cast<size_t>(record.width) * record.height * 4;
+        if (std::fread(pixels.data(), 1, size, source) != size || RecordChecksum(record, pixels.data(), size) != record.checksum) {
+            break;
+        }
+
+        size_t rowBytes = static_cast<size_t>(record.width) * 4;
+        for (uint32_t row = 0; row < record.height; ++row) {
+            uint8_t* destination = canvas.pixels + static_cast<size_t>(record.tileY * TILE_SIZE + row) * canvas.stride +
+                                   static_cast<size_t>(record.tileX) * TILE_SIZE * 4;
+            std::memcpy(destination, pixels.data() + row * rowBytes, rowBytes);
+        }
+        uint64_t& latest = latestRecord[static_cast<size_t>(record.tileY) * tilesX + record.tileX];
+        if (latest == 0) liveBytes += sizeof(record) + size;
+        latest = offset;
+        offset += sizeof(record) + size;
+        ++applied;
+    }
+    std::fclose(source);
+
+    // Оборванный хвост отрезается, чтобы новые записи шли сразу за последней целой
+    std::error_code error;
+    if (std::filesystem::file_size(path, error) != offset && !error) {
+        std::filesystem::resize_file(path, offset, error);
+    }
+    file = OpenFile(path, L"ab", "ab");
+    fileSize = offset;
+    if (tilesApplied) *tilesApplied = applied;
+    return file != nullptr;
+}
+
+bool TileJournal::WriteRecord(std::FILE* target, const TileSnapshot& tile, uint64_t& offset) {
+    TileRecord record;
+    record.marker = RECORD_MARKER;
+    record.tileX = static_cast<uint32_t>(tile.tileX);
+    record.tileY = static_cast<uint32_t>(tile.tileY);
+    record.width = static_cast<uint32_t>(tile.width);
+    record.height = static_cast<uint32_t>(tile.height);
+    size_t size = static_cast<size_t>(tile.width) * tile.height * 4;
+    record.checksum = RecordChecksum(record, tile.pixels.data(), size);
+
+    if (std::fwrite(&record, sizeof(record), 1, target) != 1 || std::fwrite(tile.pixels.data(), 1, size, target) != size) {
+        return false;
+    }
+    offset += sizeof(record) + size;
+    bytesWritten += sizeof(record) + size;
+    return true;
+}
+
+bool TileJournal::Append(const std::vector<TileSnapshot>& tiles, size_t count) {
+    if (!file) return false;
+
+    for (size_t i = 0; i < count; ++i) {
+        const TileSnapshot& tile = tiles[i];
+        if (tile.tileX < 0 || tile.tileX >= tilesX || tile.tileY < 0 || tile.tileY >= tilesY) continue;
+        uint64_t recordOffset = fileSize;
+        if (!WriteRecord(file, tile, fileSize)) return false;
+
+        uint64_t& latest = latestRecord[static_cast<size_t>(tile.tileY) * tilesX + tile.tileX];
+        if (latest == 0) liveBytes += fileSize - recordOffset;
+        latest = recordOffset;
+        ++recordCount;
+    }
+    return Sync(file);
+}
+
+bool TileJournal::NeedsCompaction() const {
+    return file && fileSize > MIN_COMPACTION_SIZE && fileSize > sizeof(JournalHeader) + 2 * liveBytes;
+}
+
+bool TileJournal::Compact() {
+    if (!file || std::fflush(file) != 0) return false;
+
+    std::filesystem::path temporary = path;
+    temporary += ".tmp";
+    std::FILE* source = OpenFile(path, L"rb", "rb");
+    std::FILE* target = source ? OpenFile(temporary, L"wb", "wb") : nullptr;
+    if (!target) {
+        if (source) std::fclose(source);
+        return false;
+    }
+
+    // Заголовок переносится как есть, затем по одной последней записи на плитку
+    JournalHeader header;
+    bool ok = std::fread(&header, sizeof(header), 1, source) == 1 && std::fwrite(&header, sizeof(header), 1, target) == 1;
+    uint64_t offset = sizeof(header);
+    bytesWritten += sizeof(header);
+    std::vector<uint64_t> compacted(latestRecord.size(), 0);
+    TileSnapshot tile;
+    for (size_t index = 0; ok && index < latestRecord.size(); ++index) {
+        if (latestRecord[index] == 0) continue;
+        TileRecord record;
+        ok = SeekTo(source, latestRecord[index]) && std::fread(&record, sizeof(record), 1, source) == 1;
+        if (!ok) break;
+        tile.tileX = static_cast<int>(record.tileX);
+        tile.tileY = static_cast<int>(record.tileY);
+        tile.width = static_cast<int>(record.width);
+        tile.height = static_cast<int>(record.height);
+        tile.pixels.resize(static_cast<size_t>(tile.width) * tile.height * 4);
+        compacted[index] = offset;
+        ok = std::fread(tile.pixels.data(), 1, tile.pixels.size(), source) == tile.pixels.size() &&
+             WriteRecord(target, tile, offset);
+    }
+    ok = ok && Sync(target);
+    std::fclose(target);
+    std::fclose(source);
+
+    std::error_code error;
+    if (!ok) {
+        std::filesystem::remove(temporary, error);
+        return false;
+    }
+
+    // После подмены старый журнал больше не нужен; при сбое до неё остаётся старый
+    std::fclose(file);
+    file = nullptr;
+    std::filesystem::rename(temporary, path, error);
+    if (error) {
+        std::filesystem::remove(temporary, error);
+        file = OpenFile(path, L"ab", "ab");
+        return false;
+    }
+    file = OpenFile(path, L"ab", "ab");
+    latestRecord.swap(compacted);
+    fileSize = offset;
+    ++compactionCount;
+    return file != nullptr;
+}
+
+void TileJournal::Close() {
+    if (file) {
+        std::fclose(file);
+        file = nullptr;
+    }
+}
+
+void TileJournal::Remove() {
+    Close();
+    std::error_code error;
+    if (!path.empty()) std::filesystem::remove(path, error);
+}
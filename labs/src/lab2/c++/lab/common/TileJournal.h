@@ -0,0 +1,72 @@
+#ifndef TILEJOURNAL_H
+#define TILEJOURNAL_H
+
+#include <cstdint>
+#include <cstdio>
+#include <filesystem>
+#include <vector>
+
+#include "SurfacePool.h"
+
+// Копия одной плитки холста, снятая под блокировкой и записываемая позже.
+struct TileSnapshot {
+  int tileX = 0;
+  int tileY = 0;
+  int width = 0;
+  int height = 0;
+  std::vector<uint8_t> pixels;  // 32bpp BGRA, строки без выравнивания
+};
+
+// Журнал автосохранения холста: заголовок с размером холста, затем записи
+// плиток с контрольной суммой. Холст в начале журнала белый; каждая запись
+// заменяет плитку целиком, так что восстановление — это проигрывание записей
+// по порядку до первой испорченной (оборванный хвост после сбоя отрезается).
+// Append() возвращает управление только после сброса данных на диск.
+// Compact() переписывает журнал, оставляя по одной последней записи на плитку,
+// во временный файл и атомарно подменяет им старый; холст для этого не нужен.
+class TileJournal {
+ public:
+  static constexpr int TILE_SIZE = 64;
+
+  TileJournal();
+  ~TileJournal();
+  TileJournal(const TileJournal&) = delete;
+  TileJournal& operator=(const TileJournal&) = delete;
+
+  bool Start(const std::filesystem::path& journalPath, int canvasWidth, int canvasHeight);
+  // Восстанавливает холст (canvas берётся из SurfacePool) и продолжает писать в тот же журнал
+  bool Recover(const std::filesystem::path& journalPath, Surface& canvas, size_t* tilesApplied = nullptr);
+  bool Append(const std::vector<TileSnapshot>& tiles, size_t count);
+  bool NeedsCompaction() const;
+  bool Compact();
+  void Close();
+  void Remove();
+
+  bool IsOpen() const { return file != nullptr; }
+  int GetTilesX() const { return tilesX; }
+  int GetTilesY() const { return tilesY; }
+  uint64_t GetFileSize() const { return fileSize; }
+  uint64_t GetBytesWritten() const { return bytesWritten; }
+  uint64_t GetRecordCount() const { return recordCount; }
+  uint64_t GetCompactionCount() const { return compactionCount; }
+
+ private:
+  bool WriteRecord(std::FILE* target, const TileSnapshot& tile, uint64_t& offset);
+  bool Sync(std::FILE* target);
+
+  std::filesystem::path path;
+  std::FILE* file;
+  int canvasWidth;
+  int canvasHeight;
+  int tilesX;
+  int tilesY;
+  // Смещение последней записи каждой плитки, 0 — плитка не менялась
+  std::vector<uint64_t> latestRecord;
+  uint64_t fileSize;
+  uint64_t liveBytes;
+  uint64_t bytesWritten;
+  uint64_t recordCount;
+  uint64_t compactionCount;
+};
+
+#endif  // TILEJOURNAL_H
@@ -0,0 +1,192 @@
+// fopen/getenv без предупреждений C4996 (в проектах включён /sdl)
+#ifdef _MSC_VER
+#define _CRT_SECURE_NO_WARNINGS
+#endif
+
+#include "Trace.h"
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#ifdef _WIN32
+#include <windows.h>
+#endif
+
+std::atomic<bool> g_traceEnabled(false);
+
+namespace {
+const size_t TRACE_BUFFER_EVENTS = 16384;
+
+struct TraceEvent {
+    const char* name;
+    uint64_t start;
+    uint64_t end;
+};
+
+// Пишет только владелец; читатель берёт события до written (acquire).
+// Экспорт рассчитан на момент, когда остальные потоки не пишут (выход, UI-поток).
+struct TraceBuffer {
+    std::array<TraceEvent, TRACE_BUFFER_EVENTS> events;
+    std::atomic<uint64_t> written{0};
+    uint32_t threadIndex = 0;
+};
+
+std::mutex g_registryMutex;
+std::vector<std::unique_ptr<TraceBuffer>> g_buffers;
+std::vector<TraceBuffer*> g_freeBuffers;  // буферы завершившихся потоков
+std::string g_outputPrefix;
+const auto g_epoch = std::chrono::steady_clock::now();
+
+thread_local TraceBuffer* t_buffer = nullptr;
+
+// Буфер завершившегося потока достаётся следующему новому: память растёт с числом
+// одновременно живущих потоков, а не всех когда-либо запущенных. Старые события
+// остаются в буфере, пока их не перезапишут, и в отчёте идут той же дорожкой
+TraceBuffer* AcquireBuffer() {
+    std::lock_guard<std::mutex> lock(g_registryMutex);
+    if (!g_freeBuffers.empty()) {
+        TraceBuffer* buffer = g_freeBuffers.back();
+        g_freeBuffers.pop_back();
+        return buffer;
+    }
+    g_buffers.push_back(std::make_unique<TraceBuffer>());
+    g_buffers.back()->threadIndex = static_cast<uint32_t>(g_buffers.size());
+    return g_buffers.back().get();
+}
+
+struct ThreadBufferRelease {
+    ~ThreadBufferRelease() {
+        if (!t_buffer) return;
+        std::lock_guard<std::mutex> lock(g_registryMutex);
+        g_freeBuffers.push_back(t_buffer);
+        t_buffer = nullptr;
+    }
+};
+
+void EscapeJson(FILE* file, const char* text) {
+    for (const char* c = text; *c; ++c) {
+        if (*c == '"' || *c == '\\') fputc('\\', file);
+        fputc(*c, file);
+    }
+}
+
+template <typename Visitor>
+void ForEachEvent(Visitor visit) {
+    std::lock_guard<std::mutex> lock(g_registryMutex);
+    for (const auto& buffer : g_buffers) {
+        uint64_t written = buffer->written.load(std::memory_order_acquire);
+        uint64_t first = written > TRACE_BUFFER_EVENTS ? written - TRACE_BUFFER_EVENTS : 0;
+        for (uint64_t i = first; i < written; ++i) {
+            visit(buffer->threadIndex, buffer->events[i % TRACE_BUFFER_EVENTS]);
+        }
+    }
+}
+}  // namespace
+
+uint64_t TraceNow() {
+    auto elapsed = std::chrono::steady_clock::now() - g_epoch;
+    // +1: ноль зарезервирован под «трассировка выключена» в TraceScope
+    return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count()) + 1;
+}
+
+void TraceRecord(const char* name, uint64_t start, uint64_t end) {
+    TraceBuffer* buffer = t_buffer;
+    if (!buffer) {
+        buffer = t_buffer = AcquireBuffer();
+        // Деструктор thread_local — хук выхода потока; заводится один раз на поток
+        thread_local ThreadBufferRelease release;
+        (void)release;
+    }
+    uint64_t index = buffer->written.load(std::memory_order_relaxed);
+    buffer->events[index % TRACE_BUFFER_EVENTS] = { name, start, end };
+    buffer->written.store(index + 1, std::memory_order_release);
+}
+
+void TraceEnable(bool enabled) {
+    g_traceEnabled = enabled;
+}
+
+bool TraceInitFromEnvironment() {
+    const char* prefix = std::getenv("LAB_TRACE");
+    if (!prefix || !*prefix) return false;
+    g_outputPrefix = prefix;
+    TraceEnable(true);
+    return true;
+}
+
+bool TraceWriteChromeJson(const std::string& path) {
+    FILE* file = std::fopen(path.c_str(), "w");
+    if (!file) return false;
+
+    std::fprintf(file, "{\"traceEvents\":[\n");
+    bool first = true;
+    ForEachEvent([&](uint32_t thread, const TraceEvent& event) {
+        std::fprintf(file, "%s{\"name\":\"", first ? "" : ",\n");
+        EscapeJson(file, event.name);
+        std::fprintf(file, "\",\"ph\":\"X\",\"pid\":1,\"tid\":%u,\"ts\":%.3f,\"dur\":%.3f}", thread,
+                     event.start / 1000.0, (event.end - event.start) / 1000.0);
+        first = false;
+    });
+    std::fprintf(file, "\n],\"displayTimeUnit\":\"ms\"}\n");
+    return std::fclose(file) == 0;
+}
+
+bool TraceWriteSummary(const std::string& path) {
+    std::map<std::string, std::vector<uint64_t>> durations;
+    ForEachEvent([&](uint32_t, const TraceEvent& event) { durations[event.name].push_back(event.end - event.start); });
+
+    FILE* file = std::fopen(path.c_str(), "w");
+    if (!file) return false;
+
+    std::fprintf(file, "%-28s %10s %12s %12s %12s %14s\n", "scope", "count", "p50 us", "p99 us", "max us", "total ms");
+    for (auto& item : durations) {
+        std::vector<uint64_t>& values = item.second;
+        std::sort(values.begin(), values.end());
+        uint64_t total = 0;
+        for (uint64_t value : values) total += value;
+        size_t p99 = std::min(values.size() - 1, values.size() * 99 / 100);
+        std::fprintf(file, "%-28s %10zu %12.1f %12.1f %12.1f %14.2f\n", item.first.c_str(), values.size(),
+                     values[values.size() / 2] / 1000.0, values[p99] / 1000.0, values.back() / 1000.0,
+                     total / 1e6);
+    }
+    return std::fclose(file) == 0;
+}
+
+void TraceWriteReports() {
+    if (g_outputPrefix.empty()) return;
+    TraceWriteChromeJson(g_outputPrefix + ".json");
+    TraceWriteSummary(g_outputPrefix + ".txt");
+}
+
+const char* TraceMessageName(unsigned message) {
+#ifdef _WIN32
+    switch (message) {
+    case WM_CREATE: return "WM_CREATE";
+    case WM_COMMAND: return "WM_COMMAND";
+    case WM_PAINT: return "WM_PAINT";
+    case WM_SIZE: return "WM_SIZE";
+    case WM_TIMER: return "WM_TIMER";
+    case WM_MOUSEMOVE: return "WM_MOUSEMOVE";
+    case WM_MOUSEWHEEL: return "WM_MOUSEWHEEL";
+    case WM_LBUTTONDOWN: return "WM_LBUTTONDOWN";
+    case WM_LBUTTONUP: return "WM_LBUTTONUP";
+    case WM_LBUTTONDBLCLK: return "WM_LBUTTONDBLCLK";
+    case WM_KEYDOWN: return "WM_KEYDOWN";
+    case WM_ERASEBKGND: return "WM_ERASEBKGND";
+    case WM_SETCURSOR: return "WM_SETCURSOR";
+    case WM_NCHITTEST: return "WM_NCHITTEST";
+    case WM_EXITSIZEMOVE: return "WM_EXITSIZEMOVE";
+    case WM_DESTROY: return "WM_DESTROY";
+    default: return message >= WM_APP ? "WM_APP" : "WM_other";
+    }
+#else
+    (void)message;
+    return "message";
+#endif
+}
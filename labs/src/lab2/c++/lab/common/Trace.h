@@ -0,0 +1,53 @@
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+
+// Лёгкая трассировка интервалов. TRACE_SCOPE("name") пишет в кольцевой буфер
+// своего потока начало и длительность области; пока трассировка выключена,
+// это одна проверка атомарного флага. Имя должно быть строковым литералом.
+// Буфер (~390 КБ) заводится при первой записи потока и при выходе потока
+// отдаётся следующему, так что короткие потоки памяти не накапливают.
+// Включается переменной окружения LAB_TRACE=<префикс>: при выходе пишутся
+// <префикс>.json (chrome://tracing, Perfetto) и <префикс>.txt (p50/p99 по именам).
+// Сборка с DISABLE_TRACING убирает макросы полностью.
+
+extern std::atomic<bool> g_traceEnabled;
+
+uint64_t TraceNow();
+void TraceRecord(const char* name, uint64_t start, uint64_t end);
+
+void TraceEnable(bool enabled);
+bool TraceInitFromEnvironment();
+bool TraceWriteChromeJson(const std::string& path);
+bool TraceWriteSummary(const std::string& path);
+void TraceWriteReports();
+const char* TraceMessageName(unsigned message);
+
+class TraceScope {
+ public:
+  explicit TraceScope(const char* name)
+      : name(name), start(g_traceEnabled.load(std::memory_order_relaxed) ? TraceNow() : 0) {}
+  ~TraceScope() {
+    if (start) TraceRecord(name, start, TraceNow());
+  }
+  TraceScope(const TraceScope&) = delete;
+  TraceScope& operator=(const TraceScope&) = delete;
+
+ private:
+  const char* name;
+  uint64_t start;
+};
+
+#define TRACE_CONCAT_INNER(a, b) a##b
+#define TRACE_CONCAT(a, b) TRACE_CONCAT_INNER(a, b)
+
+#ifdef DISABLE_TRACING
+#define TRACE_SCOPE(name) ((void)0)
+#else
+#define TRACE_SCOPE(name) TraceScope TRACE_CONCAT(traceScope, __LINE__)(name)
+#endif
+
+#endif  // TRACE_H
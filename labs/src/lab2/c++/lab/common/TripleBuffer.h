@@ -0,0 +1,41 @@
+#ifndef TRIPLEBUFFER_H
+#define TRIPLEBUFFER_H
+
+#include <atomic>
+#include <cstdint>
+
+// Индексы тройной буферизации кадров. Производитель рисует в GetBackIndex()
+// и отдаёт кадр через Publish(); потребитель через Acquire() забирает самый
+// свежий опубликованный кадр в GetFrontIndex(). Ни одна сторона не ждёт другую.
+class TripleBuffer {
+ public:
+  TripleBuffer() : middle(1), back(0), front(2) {}
+
+  uint32_t GetBackIndex() const { return back; }
+  uint32_t GetFrontIndex() const { return front; }
+
+  // Возвращает true, если предыдущий опубликованный кадр так и не был показан
+  bool Publish() {
+    uint32_t previous = middle.exchange(back | FRESH_BIT, std::memory_order_acq_rel);
+    back = previous & INDEX_MASK;
+    return (previous & FRESH_BIT) != 0;
+  }
+
+  bool HasFresh() const { return (middle.load(std::memory_order_acquire) & FRESH_BIT) != 0; }
+
+  bool Acquire() {
+    if (!(middle.load(std::memory_order_acquire) & FRESH_BIT)) return false;
+    front = middle.exchange(front, std::memory_order_acq_rel) & INDEX_MASK;
+    return true;
+  }
+
+ private:
+  static const uint32_t FRESH_BIT = 4;
+  static const uint32_t INDEX_MASK = 3;
+
+  std::atomic<uint32_t> middle;
+  uint32_t back;   // принадлежит производителю
+  uint32_t front;  // принадлежит потребителю
+};
+
+#endif  // TRIPLEBUFFER_H
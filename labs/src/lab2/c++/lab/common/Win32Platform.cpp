@@ -0,0 +1,195 @@
+#include "Win32Platform.h"
+#include <windowsx.h>
+#include <gdiplus.h>
+
+#include "MemoryAccounting.h"
+#include "Trace.h"
+
+bool TranslateWin32Message(HWND hwnd, UINT message, WPARAM wParam, LPARAM lParam, PlatformEvent& event) {
+    event = PlatformEvent();
+    switch (message) {
+    case WM_LBUTTONDOWN:
+        event.type = PlatformEvent::MouseDown;
+        break;
+    case WM_LBUTTONUP:
+        event.type = PlatformEvent::MouseUp;
+        break;
+    case WM_MOUSEMOVE:
+        event.type = PlatformEvent::MouseMove;
+        break;
+    case WM_LBUTTONDBLCLK:
+        event.type = PlatformEvent::DoubleClick;
+        break;
+    case WM_MOUSEWHEEL: {
+        // Колесо приходит в экранных координатах
+        POINT cursor = { GET_X_LPARAM(lParam), GET_Y_LPARAM(lParam) };
+        ScreenToClient(hwnd, &cursor);
+        event.type = PlatformEvent::MouseWheel;
+        event.x = cursor.x;
+        event.y = cursor.y;
+        event.wheelDelta = GET_WHEEL_DELTA_WPARAM(wParam);
+        return true;
+    }
+    case WM_KEYDOWN:
+        event.type = PlatformEvent::KeyDown;
+        event.key = static_cast<int>(wParam);
+        return true;
+    case WM_COMMAND:
+        event.type = PlatformEvent::Command;
+        event.command = LOWORD(wParam);
+        return true;
+    case WM_SIZE:
+        event.type = PlatformEvent::Resize;
+        event.width = LOWORD(lParam);
+        event.height = HIWORD(lParam);
+        return true;
+    default:
+        return false;
+    }
+    event.x = GET_X_LPARAM(lParam);
+    event.y = GET_Y_LPARAM(lParam);
+    return true;
+}
+
+void Win32Canvas::DrawString(int x, int y, const std::wstring& text, uint32_t color) {
+    textRuns.push_back({ x, y, text, color });
+}
+
+void Win32Canvas::FlushText(HDC hdc) {
+    if (textRuns.empty()) return;
+    int oldMode = SetBkMode(hdc, TRANSPARENT);
+    COLORREF oldColor = GetTextColor(hdc);
+    for (const TextRun& run : textRuns) {
+        SetTextColor(hdc, RGB((run.color >> 16) & 0xFF, (run.color >> 8) & 0xFF, run.color & 0xFF));
+        TextOut(hdc, run.x, run.y, run.text.c_str(), static_cast<int>(run.text.length()));
+    }
+    SetTextColor(hdc, oldColor);
+    SetBkMode(hdc, oldMode);
+    textRuns.clear();
+}
+
+Win32Host::Win32Host(HINSTANCE hInstance, const wchar_t* className, const wchar_t* title, int width, int height,
+                     PlatformApp& app, MessageHook hook)
+    : app(app), hook(std::move(hook)), hwnd(nullptr), clientWidth(0), clientHeight(0) {
+    WNDCLASSEX wcex = { sizeof(WNDCLASSEX) };
+    wcex.style = CS_HREDRAW | CS_VREDRAW | CS_DBLCLKS;
+    wcex.lpfnWndProc = Win32Host::WndProc;
+    wcex.hInstance = hInstance;
+    wcex.hCursor = LoadCursor(nullptr, IDC_ARROW);
+    wcex.hbrBackground = (HBRUSH)(COLOR_WINDOW + 1);
+    wcex.lpszClassName = className;
+    RegisterClassEx(&wcex);
+
+    CreateWindow(className, title, WS_OVERLAPPEDWINDOW, CW_USEDEFAULT, CW_USEDEFAULT, width, height, nullptr, nullptr,
+                 hInstance, this);
+}
+
+Win32Host::~Win32Host() {
+    backBuffer.Release();
+}
+
+int Win32Host::Run(int showCommand) {
+    ShowWindow(hwnd, showCommand);
+    UpdateWindow(hwnd);
+
+    MSG msg;
+    while (GetMessage(&msg, nullptr, 0, 0)) {
+        TranslateMessage(&msg);
+        DispatchMessage(&msg);
+    }
+    return static_cast<int>(msg.wParam);
+}
+
+LRESULT CALLBACK Win32Host::WndProc(HWND hwnd, UINT message, WPARAM wParam, LPARAM lParam) {
+    // Указатель на экземпляр сохраняется до WM_CREATE и первого WM_SIZE
+    if (message == WM_NCCREATE) {
+        CREATESTRUCT* pCreate = reinterpret_cast<CREATESTRUCT*>(lParam);
+        Win32Host* pHost = reinterpret_cast<Win32Host*>(pCreate->lpCreateParams);
+        pHost->hwnd = hwnd;
+        SetWindowLongPtr(hwnd, GWLP_USERDATA, reinterpret_cast<LONG_PTR>(pHost));
+    }
+    Win32Host* pThis = reinterpret_cast<Win32Host*>(GetWindowLongPtr(hwnd, GWLP_USERDATA));
+    if (!pThis) {
+        return DefWindowProc(hwnd, message, wParam, lParam);
+    }
+    TRACE_SCOPE(TraceMessageName(message));
+    return pThis->HandleMessage(hwnd, message, wParam, lParam);
+}
+
+LRESULT Win32Host::HandleMessage(HWND hwnd, UINT message, WPARAM wParam, LPARAM lParam) {
+    LRESULT result = 0;
+    if (hook && hook(hwnd, message, wParam, lParam, result)) {
+        return result;
+    }
+
+    PlatformEvent event;
+    if (TranslateWin32Message(hwnd, message, wParam, lParam, event)) {
+        if (event.type == PlatformEvent::Resize) {
+            clientWidth = event.width;
+            clientHeight = event.height;
+        }
+        app.OnEvent(event, *this);
+        return 0;
+    }
+
+    switch (message) {
+    case WM_PAINT:
+        OnPaint(hwnd);
+        return 0;
+    case WM_ERASEBKGND:
+        // Кадр закрывает всю клиентскую область
+        return 1;
+    case WM_DESTROY:
+        PostQuitMessage(0);
+        return 0;
+    default:
+        return DefWindowProc(hwnd, message, wParam, lParam);
+    }
+}
+
+void Win32Host::OnPaint(HWND hwnd) {
+    TRACE_SCOPE("OnPaint");
+    PAINTSTRUCT ps;
+    HDC hdc = BeginPaint(hwnd, &ps);
+
+    // Буфер только растёт; логика видит ровно клиентскую область
+    bool ready = false;
+    {
+        MEMORY_TAG_SCOPE(MEMORY_FRAMES);
+        ready = clientWidth > 0 && clientHeight > 0 && backBuffer.EnsureSize(clientWidth, clientHeight);
+    }
+    if (ready) {
+        Surface view = backBuffer.GetSurface();
+        view.width = clientWidth;
+        view.height = clientHeight;
+        Win32Canvas canvas(view);
+        app.OnPaint(canvas);
+
+        Gdiplus::Graphics graphics(hdc);
+        graphics.DrawImage(backBuffer.Get(), 0, 0, 0, 0, clientWidth, clientHeight, Gdiplus::UnitPixel);
+        canvas.FlushText(hdc);
+    }
+
+    EndPaint(hwnd, &ps);
+}
+
+void Win32Host::Invalidate() {
+    InvalidateRect(hwnd, nullptr, FALSE);
+}
+
+void Win32Host::SetCapture(bool capture) {
+    if (capture) {
+        ::SetCapture(hwnd);
+    }
+    else {
+        ReleaseCapture();
+    }
+}
+
+void Win32Host::SetTitle(const std::wstring& title) {
+    SetWindowText(hwnd, title.c_str());
+}
+
+void Win32Host::ShowMessage(const std::wstring& text, const std::wstring& caption) {
+    MessageBox(hwnd, text.c_str(), caption.c_str(), MB_OK);
+}
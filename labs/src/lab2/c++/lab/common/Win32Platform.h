@@ -0,0 +1,73 @@
+#ifndef WIN32PLATFORM_H
+#define WIN32PLATFORM_H
+
+#include <windows.h>
+#include <functional>
+#include <string>
+#include <vector>
+
+#include "Platform.h"
+#include "PooledBitmap.h"
+
+// Сообщение окна -> PlatformEvent; false, если сообщение не из числа событий платформы.
+// Нужен и окнам, которые ведут свой WndProc, но отдают часть ввода общей логике.
+bool TranslateWin32Message(HWND hwnd, UINT message, WPARAM wParam, LPARAM lParam, PlatformEvent& event);
+
+// Кадр поверх буфера PooledBitmap: пиксели рисует логика, текст копится
+// и выводится GDI после копирования кадра в окно.
+class Win32Canvas : public PlatformCanvas {
+ public:
+  Win32Canvas(const Surface& surface) : surface(surface) {}
+  const Surface& GetSurface() override { return surface; }
+  void DrawString(int x, int y, const std::wstring& text, uint32_t color) override;
+  void FlushText(HDC hdc);
+
+ private:
+  struct TextRun {
+    int x;
+    int y;
+    std::wstring text;
+    uint32_t color;
+  };
+
+  Surface surface;
+  std::vector<TextRun> textRuns;
+};
+
+// Окно Win32 для PlatformApp. GDI+ должен быть запущен вызывающим.
+class Win32Host : public PlatformHost {
+ public:
+  // Сообщения, которых нет среди событий платформы (WM_CREATE, таймеры, WM_APP),
+  // хук видит раньше логики; true — сообщение обработано, result уходит системе.
+  using MessageHook = std::function<bool(HWND hwnd, UINT message, WPARAM wParam, LPARAM lParam, LRESULT& result)>;
+
+  Win32Host(HINSTANCE hInstance, const wchar_t* className, const wchar_t* title, int width, int height,
+            PlatformApp& app, MessageHook hook = nullptr);
+  ~Win32Host() override;
+  Win32Host(const Win32Host&) = delete;
+  Win32Host& operator=(const Win32Host&) = delete;
+
+  int Run(int showCommand);
+  HWND GetHwnd() const { return hwnd; }
+
+  int GetWidth() const override { return clientWidth; }
+  int GetHeight() const override { return clientHeight; }
+  void Invalidate() override;
+  void SetCapture(bool capture) override;
+  void SetTitle(const std::wstring& title) override;
+  void ShowMessage(const std::wstring& text, const std::wstring& caption) override;
+
+ private:
+  static LRESULT CALLBACK WndProc(HWND hwnd, UINT message, WPARAM wParam, LPARAM lParam);
+  LRESULT HandleMessage(HWND hwnd, UINT message, WPARAM wParam, LPARAM lParam);
+  void OnPaint(HWND hwnd);
+
+  PlatformApp& app;
+  MessageHook hook;
+  HWND hwnd;
+  PooledBitmap backBuffer;
+  int clientWidth;
+  int clientHeight;
+};
+
+#endif  // WIN32PLATFORM_H
@@ -0,0 +1,1439 @@
+// Прогон приложений лабораторной без окна: ImageViewport (task_1-), PaintSession (task_2)
+// или AlchemyGame (task_3) получают события из сценария через OffscreenHost,
+// кадры рисуются в память. Печатается время обработки событий и отрисовки
+// и задержка от события до готового кадра; последний кадр можно сохранить.
+// --benchmark recipes меряет граф рецептов task_3 на сгенерированных данных,
+// --benchmark startup — запуск task_3 с декодированием иконок и с атласом,
+// --benchmark animation — проигрывание анимации 4K плеером ImageApp,
+// --benchmark histogram — статистика изображения и её пересчёт при панорамировании,
+// --benchmark selection — копирование и вставка большого выделения в task_2,
+// --benchmark diff — сравнение двух изображений в режиме сравнения ImageApp,
+// --benchmark memory — долгий сеанс всех трёх приложений: живая память по меткам не растёт,
+// --benchmark pool — перетаскивание и смена размера окна после прогрева не обращаются к куче.
+//
+// Сборка под Linux (BMP и PPM):
+//   g++ -std=c++20 -O2 -pthread headless.cpp ../common/OffscreenPlatform.cpp ../common/EventScript.cpp
+//       ../common/SurfaceDraw.cpp ../common/SurfacePool.cpp ../common/Resample.cpp ../common/ImageCodec.cpp
+//       ../common/StrokeLog.cpp ../common/StrokeRaster.cpp ../common/Trace.cpp
+//       ../task_1-/ImageViewport.cpp ../task_2/PaintSession.cpp ../task_3/AlchemyGame.cpp
+//       ../task_3/RecipeGraph.cpp ../task_3/IconAtlas.cpp ../common/MappedFile.cpp
+//       ../common/AnimationPlayer.cpp ../common/AnimationSource.cpp ../common/ImageStats.cpp
+//       ../common/ThreadPool.cpp ../task_1-/ImageStatsPanel.cpp ../common/SharedTiles.cpp
+//       ../task_2/CanvasSelection.cpp ../common/ImageDiff.cpp ../task_1-/ImageCompare.cpp
+//       ../common/MemoryAccounting.cpp -o headless
+// LAB_TRACE=<префикс> включает трассировку (см. common/Trace.h),
+// LAB_MEMORY=<файл> — отчёт о памяти при выходе (см. common/MemoryAccounting.h).
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+#include "../common/AnimationPlayer.h"
+#include "../common/EventScript.h"
+#include "../common/ImageCodec.h"
+#include "../common/ImageDiff.h"
+#include "../common/ImageStats.h"
+#include "../common/MemoryAccounting.h"
+#include "../common/OffscreenPlatform.h"
+#include "../common/SurfaceDraw.h"
+#include "../common/SurfacePool.h"
+#include "../common/ThreadPool.h"
+#include "../common/Trace.h"
+#include "../task_1-/ImageCompare.h"
+#include "../task_1-/ImageStatsPanel.h"
+#include "../task_1-/ImageViewport.h"
+#include "../task_2/CanvasSelection.h"
+#include "../task_2/PaintSession.h"
+#include "../task_3/AlchemyGame.h"
+#include "../task_3/RecipeGraph.h"
+
+namespace fs = std::filesystem;
+
+struct Options
+{
+    std::string app;
+    std::string benchmark;
+    size_t count = 0;  // 0 — по умолчанию для выбранного замера
+    fs::path script;
+    fs::path image;
+    fs::path icons;
+    fs::path recipes;
+    fs::path dump;
+    int width = 800;
+    int height = 600;
+    int repeat = 1;
+};
+
+// Сценарии по умолчанию: то, что пользователь делает с приложением чаще всего
+const char *IMAGE_SCRIPT =
+    "repeat 20\n"
+    "  drag 400 300 600 400 30\n"
+    "  drag 600 400 400 300 30\n"
+    "  repeat 5\n"
+    "    wheel 1 400 300\n"
+    "  end\n"
+    "  repeat 5\n"
+    "    wheel -1 400 300\n"
+    "  end\n"
+    "end\n";
+
+const char *PAINT_SCRIPT =
+    "repeat 10\n"
+    "  drag 50 50 750 550 200\n"
+    "  drag 750 50 50 550 200\n"
+    "  wheel 3 400 300\n"
+    "  drag 100 300 700 300 100\n"
+    "  key 36\n"
+    "end\n"
+    "resize 1024 768\n"
+    "drag 0 0 1023 767 300\n";
+
+// Перетаскивание между двумя размерами окна: каждый ресайз меняет буфер кадра
+const char *POOL_SCRIPT =
+    "drag 400 300 500 350 20\n"
+    "resize 1024 768\n"
+    "drag 500 350 400 300 20\n"
+    "resize 800 600\n";
+
+// Огонь на поле, Вода на поле: объединение в Пар; затем Земля и Воздух, сортировка
+const char *ALCHEMY_SCRIPT =
+    "repeat 50\n"
+    "  drag 30 80 500 30 20\n"
+    "  drag 30 130 500 30 20\n"
+    "  drag 30 30 500 30 20\n"
+    "  drag 30 180 500 30 20\n"
+    "  command 1\n"
+    "  command 2\n"
+    "end\n"
+    "command 3\n";
+
+void PrintUsage()
+{
+    std::cout << "Usage: headless --app image|paint|alchemy [--script file] [--size WxH] [--repeat N]\n"
+                 "                [--image file] [--icons dir] [--recipes file] [--dump file]\n"
+                 "       headless --benchmark recipes|startup|animation|histogram|selection|diff|memory|pool\n"
+                 "                [--count N] [--dump file]\n"
+                 "  --script F   event script (see common/EventScript.h), by default a built-in one\n"
+                 "  --size WxH   window size (default 800x600)\n"
+                 "  --repeat N   run the script N times (default 1)\n"
+                 "  --image F    picture for the image viewer, by default a generated 2048x1536 one\n"
+                 "  --icons D    icon folder for the alchemy game\n"
+                 "  --recipes F  extra recipes for the alchemy game, one 'A + B = C' per line\n"
+                 "  --dump F     write the last frame\n"
+                 "  --count N    recipes (default 100000), elements with icons (default 2000)\n"
+                 "               animation frames to play (default 300), megapixels to analyze (default 100)\n"
+                 "               or to compare (default 50)\n"
+                 "               or side of the copied selection (default 8192)\n"
+                 "               or rounds of the scripted session (default 5)\n"
+                 "               or drag and resize rounds after the pool warm-up (default 50)\n";
+}
+
+bool ParseOptions(int argc, char *argv[], Options &options)
+{
+    for (int i = 1; i < argc; ++i)
+    {
+        std::string arg = argv[i];
+        bool hasValue = i + 1 < argc;
+        if (arg == "--app" && hasValue)
+        {
+            options.app = argv[++i];
+        }
+        else if (arg == "--script" && hasValue)
+        {
+            options.script = argv[++i];
+        }
+        else if (arg == "--size" && hasValue)
+        {
+            if (std::sscanf(argv[++i], "%dx%d", &options.width, &options.height) != 2)
+                return false;
+        }
+        else if (arg == "--repeat" && hasValue)
+        {
+            options.repeat = std::atoi(argv[++i]);
+        }
+        else if (arg == "--image" && hasValue)
+        {
+            options.image = argv[++i];
+        }
+        else if (arg == "--icons" && hasValue)
+        {
+            options.icons = argv[++i];
+        }
+        else if (arg == "--recipes" && hasValue)
+        {
+            options.recipes = argv[++i];
+        }
+        else if (arg == "--benchmark" && hasValue)
+        {
+            options.benchmark = argv[++i];
+        }
+        else if (arg == "--count" && hasValue)
+        {
+            options.count = static_cast<size_t>(std::atoll(argv[++i]));
+        }
+        else if (arg == "--dump" && hasValue)
+        {
+            options.dump = argv[++i];
+        }
+        else
+        {
+            return false;
+        }
+    }
+    if (!options.benchmark.empty())
+        return options.benchmark == "recipes" || options.benchmark == "startup" || options.benchmark == "animation" ||
+               options.benchmark == "histogram" || options.benchmark == "selection" || options.benchmark == "diff" ||
+               options.benchmark == "memory" || options.benchmark == "pool";
+    if (options.app != "image" && options.app != "paint" && options.app != "alchemy")
+        return false;
+    return options.width > 0 && options.height > 0 && options.repeat > 0;
+}
+
+// Тестовое изображение: градиент с полупрозрачной полосой, чтобы видна была подложка
+bool MakeTestImage(int width, int height, Surface &image)
+{
+    if (!SurfacePool::Instance().Acquire(width, height, image))
+        return false;
+    for (int y = 0; y < height; y++)
+    {
+        uint32_t *row = reinterpret_cast<uint32_t *>(image.pixels + (size_t)y * image.stride);
+        for (int x = 0; x < width; x++)
+        {
+            uint32_t alpha = (y / 64) % 4 == 3 ? 0x80u : 0xFFu;
+            row[x] = (alpha << 24) | ((uint32_t)(x * 255 / width) << 16) | ((uint32_t)(y * 255 / height) << 8) |
+                     (uint32_t)((x ^ y) & 0xFF);
+        }
+    }
+    return true;
+}
+
+double ElapsedMs(std::chrono::steady_clock::time_point start)
+{
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+// Фронт с нуля: проход по всем рецептам, как без инкрементального графа
+void RecomputeCraftable(const RecipeGraph &graph, std::vector<uint8_t> &craftable)
+{
+    craftable.assign(graph.GetElementCount(), 0);
+    for (size_t i = 0; i < graph.GetRecipeCount(); i++)
+    {
+        const RecipeGraph::Recipe &recipe = graph.GetRecipe(static_cast<uint32_t>(i));
+        if (graph.IsDiscovered(recipe.first) && graph.IsDiscovered(recipe.second) && !graph.IsDiscovered(recipe.result))
+            craftable[recipe.result] = 1;
+    }
+}
+
+// Граф из recipeCount рецептов на recipeCount / 4 элементах: четыре базовых открыты,
+// каждый следующий получается из случайной пары предыдущих, так что достижимо всё.
+// Элементы открываются в случайном порядке из фронта, как их открывал бы игрок.
+int RunRecipeBenchmark(size_t recipeCount)
+{
+    std::mt19937 random(12345);
+    RecipeGraph graph;
+    size_t elementCount = std::max<size_t>(recipeCount / 4, 8);
+
+    auto start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < elementCount; i++)
+        graph.AddElement(L"e" + std::to_wstring(i));
+    for (size_t i = 0; graph.GetRecipeCount() < recipeCount && i < recipeCount * 4; i++)
+    {
+        uint32_t result = 4 + static_cast<uint32_t>(i % (elementCount - 4));
+        std::uniform_int_distribution<uint32_t> ingredient(0, result - 1);
+        graph.AddRecipe(ingredient(random), ingredient(random), result);
+    }
+    double buildMs = ElapsedMs(start);
+
+    for (uint32_t base = 0; base < 4; base++)
+        graph.Discover(base);
+
+    start = std::chrono::steady_clock::now();
+    std::vector<uint32_t> steps;
+    graph.SolveAll(steps);
+    double solveMs = ElapsedMs(start);
+
+    // Открытие по одному с замером каждого вызова; каждое 256-е сверяется с пересчётом с нуля
+    std::vector<double> discoverUs;
+    std::vector<uint8_t> expected;
+    double recomputeMs = 0.0;
+    size_t recomputes = 0;
+    bool consistent = true;
+    while (!graph.GetCraftable().empty())
+    {
+        const std::vector<uint32_t> &craftable = graph.GetCraftable();
+        uint32_t element = craftable[random() % craftable.size()];
+        auto discoverStart = std::chrono::steady_clock::now();
+        graph.Discover(element);
+        discoverUs.push_back(ElapsedMs(discoverStart) * 1000.0);
+
+        if (discoverUs.size() % 256 == 0)
+        {
+            auto recomputeStart = std::chrono::steady_clock::now();
+            RecomputeCraftable(graph, expected);
+            recomputeMs += ElapsedMs(recomputeStart);
+            recomputes++;
+            size_t expectedCount = std::count(expected.begin(), expected.end(), 1);
+            consistent = consistent && expectedCount == graph.GetCraftable().size();
+            for (uint32_t craftableElement : graph.GetCraftable())
+                consistent = consistent && expected[craftableElement];
+        }
+    }
+
+    std::vector<double> sorted = discoverUs;
+    std::sort(sorted.begin(), sorted.end());
+    double totalUs = 0.0;
+    for (double us : discoverUs)
+        totalUs += us;
+    double meanUs = sorted.empty() ? 0.0 : totalUs / sorted.size();
+    double recomputeMeanUs = recomputes > 0 ? recomputeMs * 1000.0 / recomputes : 0.0;
+
+    std::printf("Recipes: %zu on %zu elements, built in %.1f ms\n", graph.GetRecipeCount(), graph.GetElementCount(),
+                buildMs);
+    std::printf("Solve all: %zu steps in %.3f ms\n", steps.size(), solveMs);
+    if (!sorted.empty())
+        std::printf("Discover: %zu calls, mean %.2f us, p50 %.2f us, p99 %.2f us, max %.2f us\n", sorted.size(),
+                    meanUs, sorted[sorted.size() / 2], sorted[std::min(sorted.size() - 1, sorted.size() * 99 / 100)],
+                    sorted.back());
+    std::printf("Full recompute: mean %.1f us over %zu samples (%.0fx the incremental update)\n", recomputeMeanUs,
+                recomputes, meanUs > 0.0 ? recomputeMeanUs / meanUs : 0.0);
+    std::printf("Discovered %zu of %zu elements, frontier %s the full recompute\n", graph.GetDiscoveredCount(),
+                graph.GetElementCount(), consistent ? "matches" : "DOES NOT MATCH");
+    return consistent && steps.size() == sorted.size() ? 0 : 2;
+}
+
+// Выгрузка файла из страничного кэша, чтобы следующее отображение читало с диска
+bool DropFromPageCache(const fs::path &path)
+{
+#ifdef _WIN32
+    (void)path;
+    return false;
+#else
+    int descriptor = open(path.c_str(), O_RDONLY);
+    if (descriptor < 0)
+        return false;
+    fdatasync(descriptor);
+    bool dropped = posix_fadvise(descriptor, 0, 0, POSIX_FADV_DONTNEED) == 0;
+    close(descriptor);
+    return dropped;
+#endif
+}
+
+// Игра с elementCount элементами: к встроенным добавляются eN, eN+1, ...;
+// каждый получается из предыдущего и базового (так достижимы все) и ещё из
+// случайной пары предыдущих. Граф одинаков при каждом вызове.
+void BuildStartupGraph(AlchemyGame &game, size_t elementCount)
+{
+    std::mt19937 random(777);
+    RecipeGraph &graph = game.GetRecipes();
+    for (size_t i = graph.GetElementCount(); i < elementCount; i++)
+    {
+        uint32_t element = graph.AddElement(L"e" + std::to_wstring(i));
+        std::uniform_int_distribution<uint32_t> ingredient(0, element - 1);
+        graph.AddRecipe(element - 1, element % 4, element);  // 0..3 — базовые
+        graph.AddRecipe(ingredient(random), ingredient(random), element);
+    }
+}
+
+double MeasureFirstFrame(AlchemyGame &game)
+{
+    OffscreenHost host(800, 600);
+    auto start = std::chrono::steady_clock::now();
+    host.Paint(game);
+    return ElapsedMs(start);
+}
+
+// Запуск task_3 на elementCount элементах с иконками 128x128 в BMP: декодирование
+// всех файлов с уменьшением (как без атласа) против открытия атласа, вытесненного
+// из страничного кэша и уже лежащего в нём. Затем сохранение и загрузка прогресса
+// после "открыть всё".
+int RunStartupBenchmark(size_t elementCount)
+{
+    fs::path folder = fs::temp_directory_path() / "alchemy_startup";
+    std::error_code error;
+    fs::remove_all(folder, error);
+    fs::create_directories(folder, error);
+    fs::path atlasPath = folder / "icons.atlas";
+    fs::path savePath = folder / "alchemy.sav";
+
+    // Иконки только у сгенерированных элементов: у встроенных имена не ASCII
+    size_t firstGenerated = AlchemyGame().GetRecipes().GetElementCount();
+    Surface source;
+    if (!SurfacePool::Instance().Acquire(128, 128, source))
+        return 1;
+    for (size_t i = firstGenerated; i < elementCount; i++)
+    {
+        for (int y = 0; y < source.height; y++)
+        {
+            uint32_t *row = reinterpret_cast<uint32_t *>(source.pixels + (size_t)y * source.stride);
+            for (int x = 0; x < source.width; x++)
+                row[x] = 0xFF000000u | (((uint32_t)(i * 2654435761u) & 0xFFFFFF) ^ ((x / 16 + y / 16) % 2 * 0x404040u));
+        }
+        WriteImage(folder / ("e" + std::to_string(i) + ".bmp"), source, ImageFormat::Bmp);
+    }
+    SurfacePool::Instance().Release(source);
+
+    int result = 0;
+    {
+        AlchemyGame decoded;
+        auto start = std::chrono::steady_clock::now();
+        BuildStartupGraph(decoded, elementCount);
+        double graphMs = ElapsedMs(start);
+        start = std::chrono::steady_clock::now();
+        size_t icons = decoded.LoadIcons(folder);
+        double decodeMs = ElapsedMs(start);
+        double decodeFrameMs = MeasureFirstFrame(decoded);
+
+        start = std::chrono::steady_clock::now();
+        uint64_t sourceKey = AlchemyGame::GetIconSourceKey(folder);
+        double sourceKeyMs = ElapsedMs(start);
+        start = std::chrono::steady_clock::now();
+        bool written = decoded.SaveIconAtlas(atlasPath, sourceKey);
+        double atlasWriteMs = ElapsedMs(start);
+        uintmax_t atlasBytes = fs::file_size(atlasPath, error);
+
+        bool dropped = DropFromPageCache(atlasPath);
+        AlchemyGame cold;
+        BuildStartupGraph(cold, elementCount);
+        start = std::chrono::steady_clock::now();
+        bool coldOpened = cold.LoadIconAtlas(atlasPath, sourceKey);
+        double coldOpenMs = ElapsedMs(start);
+        double coldFrameMs = MeasureFirstFrame(cold);
+
+        AlchemyGame warm;
+        BuildStartupGraph(warm, elementCount);
+        start = std::chrono::steady_clock::now();
+        bool warmOpened = warm.LoadIconAtlas(atlasPath, sourceKey);
+        double warmOpenMs = ElapsedMs(start);
+        double warmFrameMs = MeasureFirstFrame(warm);
+
+        // Прогресс: всё открыто, два элемента на поле
+        OffscreenHost host(800, 600);
+        PlatformEvent discoverAll;
+        discoverAll.type = PlatformEvent::Command;
+        discoverAll.command = AlchemyGame::COMMAND_DISCOVER_ALL;
+        decoded.OnEvent(discoverAll, host);
+        host.Run(decoded, {{PlatformEvent::MouseDown, 30, 30}, {PlatformEvent::MouseUp, 500, 30}});
+        start = std::chrono::steady_clock::now();
+        bool saved = decoded.SaveProgress(savePath);
+        double saveMs = ElapsedMs(start);
+        uintmax_t saveBytes = fs::file_size(savePath, error);
+        start = std::chrono::steady_clock::now();
+        bool loaded = warm.LoadProgress(savePath);
+        double loadMs = ElapsedMs(start);
+        bool same = loaded && warm.GetOpenElements() == decoded.GetOpenElements();
+
+        std::printf("Elements: %zu, graph built in %.2f ms\n", elementCount, graphMs);
+        std::printf("Decode icons:  %8.2f ms for %zu files, first frame %.2f ms\n", decodeMs, icons, decodeFrameMs);
+        std::printf("Atlas written: %8.2f ms, %.1f KB%s\n", atlasWriteMs, atlasBytes / 1024.0, written ? "" : " (failed)");
+        std::printf("Atlas cold:    %8.3f ms open, first frame %.2f ms%s\n", coldOpenMs, coldFrameMs,
+                    dropped ? "" : " (page cache not dropped)");
+        std::printf("Atlas warm:    %8.3f ms open, first frame %.2f ms\n", warmOpenMs, warmFrameMs);
+        std::printf("Source key:    %8.3f ms for the icon folder\n", sourceKeyMs);
+        std::printf("Progress: %zu open elements, %ju bytes, saved in %.3f ms, loaded in %.3f ms%s\n",
+                    decoded.GetOpenElements().size(), saveBytes, saveMs, loadMs, same ? "" : " (MISMATCH)");
+        if (!written || !coldOpened || !warmOpened || !saved || !same)
+            result = 2;
+    }
+    fs::remove_all(folder, error);
+    return result;
+}
+
+// Анимация 3840x2160 без файла: кадр 0 — фон во весь холст, дальше спрайт 480x480
+// с полупрозрачной каймой ходит по холсту, утилизация чередуется (None оставляет
+// след, Background стирает, Previous возвращает участок)
+class SyntheticAnimation : public AnimationSource
+{
+public:
+    static const int WIDTH = 3840;
+    static const int HEIGHT = 2160;
+    static const int SPRITE = 480;
+    static const int FRAMES = 120;
+    static const int DELAY_MS = 20;
+
+    int GetWidth() const override { return WIDTH; }
+    int GetHeight() const override { return HEIGHT; }
+    size_t GetFrameCount() const override { return FRAMES; }
+    int GetLoopCount() const override { return 0; }
+
+    bool DecodeFrame(size_t index, AnimationFrame &frame, const Surface &patch) override
+    {
+        frame = Describe(index);
+        for (int y = 0; y < frame.height; y++)
+        {
+            uint32_t *row = reinterpret_cast<uint32_t *>(patch.pixels + (size_t)y * patch.stride);
+            for (int x = 0; x < frame.width; x++)
+                row[x] = index == 0 ? Background(x, y) : Sprite(index, x, y);
+        }
+        return true;
+    }
+
+    static AnimationFrame Describe(size_t index)
+    {
+        AnimationFrame frame;
+        frame.delayMs = DELAY_MS;
+        if (index == 0)
+        {
+            frame.width = WIDTH;
+            frame.height = HEIGHT;
+            frame.blend = FrameBlend::Source;
+            return frame;
+        }
+        frame.left = static_cast<int>(index * 97 % (WIDTH - SPRITE));
+        frame.top = static_cast<int>(index * 53 % (HEIGHT - SPRITE));
+        frame.width = SPRITE;
+        frame.height = SPRITE;
+        frame.disposal = index % 3 == 0 ? FrameDisposal::None : index % 3 == 1 ? FrameDisposal::Background
+                                                                               : FrameDisposal::Previous;
+        frame.blend = FrameBlend::Over;
+        return frame;
+    }
+
+private:
+    static uint32_t Background(int x, int y)
+    {
+        return 0xFF000000u | ((uint32_t)(x * 255 / WIDTH) << 16) | ((uint32_t)(y * 255 / HEIGHT) << 8) | 0x40u;
+    }
+
+    static uint32_t Sprite(size_t index, int x, int y)
+    {
+        int dx = x - SPRITE / 2;
+        int dy = y - SPRITE / 2;
+        int distance = dx * dx + dy * dy;
+        int radius = SPRITE / 2 - 16;
+        if (distance > (radius + 16) * (radius + 16))
+            return 0;
+        uint32_t alpha = distance > radius * radius ? 0x80u : 0xFFu;
+        uint32_t color = (uint32_t)(index * 2654435761u) & 0xFFFFFF;
+        return (alpha << 24) | (color ^ (uint32_t)((x / 32 + y / 32) % 2 * 0x202020));
+    }
+};
+
+// Сборка кадра index с нуля, без инкрементальности: перед каждым кадром копия
+// всего холста, утилизация — по полному холсту
+void ComposeReference(size_t lastFrame, Surface &canvas, Surface &before, Surface &patch)
+{
+    SyntheticAnimation source;
+    AnimationFrame previous;
+    for (size_t index = 0; index <= lastFrame; index++)
+    {
+        if (index == 0)
+            FillSurfaceRect(canvas, 0, 0, canvas.width, canvas.height, 0);
+        else if (previous.disposal == FrameDisposal::Background)
+            FillSurfaceRect(canvas, previous.left, previous.top, previous.width, previous.height, 0);
+        else if (previous.disposal == FrameDisposal::Previous)
+            CopySurfaceRect(canvas, 0, 0, before, 0, 0, canvas.width, canvas.height);
+        CopySurfaceRect(before, 0, 0, canvas, 0, 0, canvas.width, canvas.height);
+
+        source.DecodeFrame(index, previous, patch);
+        if (previous.blend == FrameBlend::Source)
+            CopySurfaceRect(canvas, previous.left, previous.top, patch, 0, 0, previous.width, previous.height);
+        else
+            BlendSurfaceRect(canvas, previous.left, previous.top, patch, 0, 0, previous.width, previous.height);
+    }
+}
+
+bool SameSurface(const Surface &a, const Surface &b)
+{
+    for (int y = 0; y < a.height; y++)
+    {
+        if (std::memcmp(a.pixels + (size_t)y * a.stride, b.pixels + (size_t)y * b.stride, (size_t)a.width * 4) != 0)
+            return false;
+    }
+    return true;
+}
+
+// Проигрывание в реальном времени: поток UI просыпается 60 раз в секунду, как по
+// кадровой развёртке, вызывает Advance() и при изменении перерисовывает окно
+// width x height через ImageViewport. Последний кадр сверяется со сборкой с нуля.
+int RunAnimationBenchmark(size_t frameCount, int width, int height)
+{
+    SurfacePool &pool = SurfacePool::Instance();
+    Surface canvas;
+    Surface window;
+    if (!pool.Acquire(SyntheticAnimation::WIDTH, SyntheticAnimation::HEIGHT, canvas) ||
+        !pool.Acquire(width, height, window))
+        return 1;
+
+    ImageViewport viewport;
+    viewport.SetImage(&canvas, canvas.width, canvas.height, 1.0);
+    viewport.Center(width, height);
+
+    AnimationPlayer player;
+    std::vector<double> tickMs;
+    auto start = std::chrono::steady_clock::now();
+    bool started = player.Start(std::make_unique<SyntheticAnimation>(), canvas, 0.0);
+    const double tickPeriodMs = 1000.0 / 60.0;
+    for (size_t tick = 0; started; tick++)
+    {
+        const AnimationStats &stats = player.GetStats();
+        if (stats.framesShown + stats.framesDropped >= frameCount)
+            break;
+        std::this_thread::sleep_until(start + std::chrono::microseconds((long long)(tick * tickPeriodMs * 1000.0)));
+        auto tickStart = std::chrono::steady_clock::now();
+        if (player.Advance(ElapsedMs(start)))
+            viewport.Render(window, width, height);
+        tickMs.push_back(ElapsedMs(tickStart));
+    }
+    double playMs = ElapsedMs(start);
+    size_t lastFrame = player.GetFrameIndex();
+    player.Stop();
+    AnimationStats stats = player.GetStats();
+
+    Surface reference;
+    Surface before;
+    Surface patch;
+    bool same = false;
+    double referenceMs = 0.0;
+    if (pool.Acquire(canvas.width, canvas.height, reference) && pool.Acquire(canvas.width, canvas.height, before) &&
+        pool.Acquire(canvas.width, canvas.height, patch))
+    {
+        auto referenceStart = std::chrono::steady_clock::now();
+        ComposeReference(lastFrame, reference, before, patch);
+        referenceMs = ElapsedMs(referenceStart);
+        same = SameSurface(canvas, reference);
+    }
+    pool.Release(reference);
+    pool.Release(before);
+    pool.Release(patch);
+
+    std::sort(tickMs.begin(), tickMs.end());
+    size_t composed = stats.framesShown + stats.framesDropped;
+    double canvasPixels = (double)canvas.width * canvas.height;
+    std::printf("Animation: %dx%d, %d frames of %d ms, ring of %zu, window %dx%d\n", canvas.width, canvas.height,
+                SyntheticAnimation::FRAMES, SyntheticAnimation::DELAY_MS, AnimationPlayer::RING_SIZE, width, height);
+    std::printf("Played %zu frames in %.2f s (%.1f fps): shown %zu, dropped %zu, stalls %zu\n", composed,
+                playMs / 1000.0, composed * 1000.0 / playMs, stats.framesShown, stats.framesDropped, stats.stalls);
+    std::printf("Decode (worker): %zu frames, %.2f ms/frame\n", stats.framesDecoded,
+                stats.framesDecoded > 0 ? stats.decodeMs / stats.framesDecoded : 0.0);
+    std::printf("Compose (UI): %.3f ms/frame, %.1f%% of the canvas touched per frame\n",
+                composed > 0 ? stats.composeMs / composed : 0.0,
+                composed > 0 ? stats.pixelsComposed * 100.0 / (canvasPixels * composed) : 0.0);
+    if (!tickMs.empty())
+        std::printf("UI tick with redraw: p50 %.3f ms, p99 %.3f ms, max %.3f ms\n", tickMs[tickMs.size() / 2],
+                    tickMs[std::min(tickMs.size() - 1, tickMs.size() * 99 / 100)], tickMs.back());
+    std::printf("Last frame %zu %s the full recomposition (%.2f ms/frame from scratch)\n", lastFrame,
+                same ? "matches" : "DOES NOT MATCH", referenceMs / (lastFrame + 1));
+
+    pool.Release(canvas);
+    pool.Release(window);
+    return started && same ? 0 : 2;
+}
+
+// Холст без текста: панель статистики рисует столбцы в пиксели, строки только считаются
+class SurfaceCanvas : public PlatformCanvas
+{
+public:
+    explicit SurfaceCanvas(const Surface &surface) : surface(surface) {}
+    const Surface &GetSurface() override { return surface; }
+    void DrawString(int, int, const std::wstring &, uint32_t) override { textRuns++; }
+
+    size_t textRuns = 0;
+
+private:
+    Surface surface;
+};
+
+// Гистограмма в лоб: одна копия, один поток — эталон и для скорости, и для проверки
+void NaiveHistogram(const Surface &image, int x, int y, int width, int height, ImageHistogram &result)
+{
+    result = ImageHistogram();
+    for (int row = y; row < y + height; row++)
+    {
+        const uint32_t *pixels = reinterpret_cast<const uint32_t *>(image.pixels + (size_t)row * image.stride);
+        for (int column = x; column < x + width; column++)
+        {
+            uint32_t p = pixels[column];
+            for (int channel = 0; channel < ImageHistogram::CHANNELS; channel++)
+                result.counts[channel][(p >> (8 * channel)) & 0xFF]++;
+        }
+    }
+    result.pixels = (uint64_t)width * height;
+}
+
+bool SameHistogram(const ImageHistogram &a, const ImageHistogram &b)
+{
+    return a.pixels == b.pixels && std::memcmp(a.counts, b.counts, sizeof(a.counts)) == 0;
+}
+
+template <typename Function>
+double BestOfMs(int runs, Function function)
+{
+    double best = 1e30;
+    for (int i = 0; i < runs; i++)
+    {
+        auto start = std::chrono::steady_clock::now();
+        function();
+        best = std::min(best, ElapsedMs(start));
+    }
+    return best;
+}
+
+// Изображение 10000 x (megapixels * 100): все три способа подсчёта по всему
+// изображению, затем панорамирование окна width x height с пересчётом видимой
+// части через ImageStatsPanel и сверка с подсчётом с нуля
+int RunHistogramBenchmark(size_t megapixels, int width, int height, const fs::path &dump)
+{
+    SurfacePool &pool = SurfacePool::Instance();
+    Surface image;
+    int imageWidth = 10000;
+    int imageHeight = static_cast<int>(megapixels * 100);
+    if (!pool.Acquire(imageWidth, imageHeight, image))
+    {
+        std::cerr << "Cannot allocate " << megapixels << " MP\n";
+        return 1;
+    }
+    // Градиенты с обрезанными краями и мелкой текстурой в синем
+    for (int y = 0; y < imageHeight; y++)
+    {
+        uint32_t *row = reinterpret_cast<uint32_t *>(image.pixels + (size_t)y * image.stride);
+        uint32_t green = (uint32_t)std::clamp((y - imageHeight / 10) * 320 / imageHeight, 0, 255);
+        for (int x = 0; x < imageWidth; x++)
+        {
+            uint32_t red = (uint32_t)std::clamp(x * 300 / imageWidth - 20, 0, 255);
+            row[x] = 0xFF000000u | (red << 16) | (green << 8) | ((uint32_t)(x * 7 + y * 13) & 0xFF);
+        }
+    }
+
+    ThreadPool workers;
+    ImageHistogram naive;
+    ImageHistogram serial;
+    ImageHistogram parallel;
+    double naiveMs = BestOfMs(1, [&]() { NaiveHistogram(image, 0, 0, imageWidth, imageHeight, naive); });
+    double serialMs = BestOfMs(3, [&]() { ComputeHistogram(image, 0, 0, imageWidth, imageHeight, nullptr, serial); });
+    double parallelMs =
+        BestOfMs(3, [&]() { ComputeHistogram(image, 0, 0, imageWidth, imageHeight, &workers, parallel); });
+    bool wholeMatches = SameHistogram(naive, serial) && SameHistogram(naive, parallel);
+
+    // Панорамирование: перетаскивание по диагонали туда и обратно, как рукой
+    ImageViewport viewport;
+    viewport.SetImage(&image, imageWidth, imageHeight, 1.0);
+    viewport.Center(width, height);
+    OffscreenHost host(width, height);
+    ImageStatsPanel panel;
+    panel.Update(viewport, width, height);
+
+    std::vector<double> updateMs;
+    size_t scanned = 0;
+    PlatformEvent event;
+    event.type = PlatformEvent::MouseDown;
+    viewport.OnEvent(event, host);
+    event.type = PlatformEvent::MouseMove;
+    for (int step = 0; step < 600; step++)
+    {
+        int direction = step / 150 % 2 == 0 ? 1 : -1;
+        event.x += direction * 9;
+        event.y += direction * 4;
+        viewport.OnEvent(event, host);
+        auto start = std::chrono::steady_clock::now();
+        scanned += panel.Update(viewport, width, height);
+        updateMs.push_back(ElapsedMs(start));
+    }
+    event.type = PlatformEvent::MouseUp;
+    viewport.OnEvent(event, host);
+
+    const RegionHistogram &visible = panel.GetVisible();
+    ImageHistogram expected;
+    double visibleFullMs = BestOfMs(3, [&]() {
+        ComputeHistogram(image, visible.GetX(), visible.GetY(), visible.GetWidth(), visible.GetHeight(), &workers,
+                         expected);
+    });
+    bool visibleMatches = SameHistogram(expected, visible.Get());
+
+    std::sort(updateMs.begin(), updateMs.end());
+    double totalMs = 0.0;
+    for (double ms : updateMs)
+        totalMs += ms;
+    std::printf("Image: %dx%d (%.1f MP), %zu worker threads\n", imageWidth, imageHeight,
+                imageWidth * (double)imageHeight / 1e6, workers.GetThreadCount());
+    std::printf("Whole image: naive %.1f ms, 4-way single thread %.1f ms, parallel %.1f ms (%.2f GB/s), %s\n", naiveMs,
+                serialMs, parallelMs, imageWidth * (double)imageHeight * 4 / (parallelMs * 1e6),
+                wholeMatches ? "histograms match" : "HISTOGRAMS DIFFER");
+    std::printf("Image stats in panel: %.1f ms\n", panel.GetImageMs());
+    std::printf("Pan %zu steps over %dx%d: mean %.3f ms, p99 %.3f ms, max %.3f ms, %.0f px scanned per step\n",
+                updateMs.size(), visible.GetWidth(), visible.GetHeight(), totalMs / updateMs.size(),
+                updateMs[std::min(updateMs.size() - 1, updateMs.size() * 99 / 100)], updateMs.back(),
+                (double)scanned / updateMs.size());
+    std::printf("Visible region from scratch: %.3f ms; incremental result %s\n", visibleFullMs,
+                visibleMatches ? "matches" : "DOES NOT MATCH");
+    for (int channel : {ImageHistogram::RED, ImageHistogram::GREEN, ImageHistogram::BLUE})
+    {
+        ChannelSummary summary = SummarizeChannel(panel.GetImageHistogram(), channel);
+        std::printf("  %c: min %d, max %d, mean %.2f, clipped %ju / %ju\n", "BGRA"[channel], summary.min, summary.max,
+                    summary.mean, summary.clippedLow, summary.clippedHigh);
+    }
+
+    int result = wholeMatches && visibleMatches ? 0 : 2;
+    if (!dump.empty())
+    {
+        Surface frame;
+        if (pool.Acquire(width, height, frame))
+        {
+            viewport.Render(frame, width, height);
+            SurfaceCanvas canvas(frame);
+            panel.Draw(canvas, width);
+            if (!WriteImage(dump, frame, FormatFromPath(dump)))
+                result = 2;
+            pool.Release(frame);
+        }
+    }
+    pool.Release(image);
+    return result;
+}
+
+uint32_t SelectionPattern(int x, int y)
+{
+    return 0xFF000000u | (((uint32_t)x * 2654435761u ^ (uint32_t)y * 40503u) & 0xFFFFFF);
+}
+
+double LiveMb(size_t baseBytes)
+{
+    return ((double)SurfacePool::Instance().GetStats().liveBytes - (double)baseBytes) / (1024.0 * 1024.0);
+}
+
+// Выделение regionSize x regionSize на холсте чуть больше него: копирование в
+// буфер обмена против обычной копии пикселей, вставка и перетаскивание большого
+// и маленького плавающего выделения (кадры по очереди из трёх, как в task_2),
+// штрих под скопированным участком и вписывание вставки в холст. Память — прирост
+// живых байт SurfacePool; итог сверяется с узором источника.
+int RunSelectionBenchmark(int regionSize)
+{
+    SurfacePool &pool = SurfacePool::Instance();
+    int side = regionSize + 512;
+    Surface canvas;
+    Surface frame;
+    if (!pool.Acquire(side, side, canvas) || !pool.Acquire(side, side, frame))
+    {
+        std::cerr << "Cannot allocate a " << side << "x" << side << " canvas\n";
+        pool.Release(canvas);
+        return 1;
+    }
+    for (int y = 0; y < side; y++)
+    {
+        uint32_t *row = reinterpret_cast<uint32_t *>(canvas.pixels + (size_t)y * canvas.stride);
+        for (int x = 0; x < side; x++)
+            row[x] = SelectionPattern(x, y);
+    }
+
+    CanvasSelection selection;
+    selection.Attach(canvas);
+    size_t totalTiles = selection.Compose(frame, 0);
+    std::printf("Canvas: %dx%d, %zu tiles of %d px\n", side, side, totalTiles, CanvasSelection::TILE_SIZE);
+
+    // Источник не выровнен по плиткам: вид начинается внутри плитки
+    const int sourceX = 100;
+    const int sourceY = 70;
+    size_t baseBytes = pool.GetStats().liveBytes;
+    auto start = std::chrono::steady_clock::now();
+    selection.Select(sourceX, sourceY, sourceX + regionSize, sourceY + regionSize);
+    bool copied = selection.Copy();
+    double copyMs = ElapsedMs(start);
+    std::printf("Copy %dx%d: %.3f ms, %.2f MB pixels, %zu tile references%s\n", regionSize, regionSize, copyMs,
+                LiveMb(baseBytes), selection.GetClipboard().GetTileCount(), copied ? "" : " (failed)");
+
+    Surface flat;
+    start = std::chrono::steady_clock::now();
+    if (pool.Acquire(regionSize, regionSize, flat))
+        CopySurfaceRect(flat, 0, 0, canvas, sourceX, sourceY, regionSize, regionSize);
+    double flatMs = ElapsedMs(start);
+    std::printf("Plain pixel copy for comparison: %.1f ms, %.1f MB\n", flatMs, LiveMb(baseBytes));
+    pool.Release(flat);
+
+    // Перетаскивание: за шаг кадр перерисовывается только под старым и новым положением
+    auto drag = [&](int fromX, int fromY, int steps, int stepX, int stepY, const char *name) {
+        selection.Paste(fromX, fromY);
+        selection.Compose(frame, 1);
+        selection.Compose(frame, 2);
+        size_t composed = 0;
+        start = std::chrono::steady_clock::now();
+        for (int step = 1; step <= steps; step++)
+        {
+            selection.MoveFloating(fromX + step * stepX, fromY + step * stepY);
+            composed += selection.Compose(frame, step % CanvasSelection::FRAME_COUNT);
+        }
+        double ms = ElapsedMs(start);
+        std::printf("Drag %s: %.2f ms per step, %.0f of %zu tiles recomposited per step, %.2f MB pixels\n", name,
+                    ms / steps, (double)composed / steps, totalTiles, LiveMb(baseBytes));
+    };
+    drag(0, 0, 60, 5, 3, "full selection");
+
+    // Штрих по холсту под скопированным участком: копируются только его плитки
+    selection.BeforeCanvasWrite(2000, 2000, 64, 64);
+    FillSurfaceRect(canvas, 2000, 2000, 64, 64, 0xFFFF0000);
+    std::printf("Stroke under the clipboard: %.2f MB pixels\n", LiveMb(baseBytes));
+
+    start = std::chrono::steady_clock::now();
+    bool committed = selection.Commit();
+    double commitMs = ElapsedMs(start);
+    int destinationX = selection.GetX();
+    int destinationY = selection.GetY();
+    std::printf("Commit at (%d, %d): %.1f ms, %.1f MB pixels%s\n", destinationX, destinationY, commitMs,
+                LiveMb(baseBytes), committed ? "" : " (failed)");
+
+    // Вставка не должна увидеть штрих: она вписана поверх него из копии
+    bool matches = committed;
+    for (int y = 0; y < regionSize && matches; y++)
+    {
+        const uint32_t *row =
+            reinterpret_cast<const uint32_t *>(canvas.pixels + (size_t)(destinationY + y) * canvas.stride);
+        for (int x = 0; x < regionSize; x++)
+        {
+            if (row[destinationX + x] != SelectionPattern(sourceX + x, sourceY + y))
+            {
+                matches = false;
+                break;
+            }
+        }
+    }
+
+    selection.Select(1000, 1000, 1512, 1512);
+    selection.Copy();
+    drag(40, 40, 100, 7, 5, "512x512 selection");
+    selection.Deselect();
+    selection.Compose(frame, 0);
+    bool frameMatches = SameSurface(frame, canvas);
+    std::printf("Pasted pixels %s, composed frame %s\n", matches ? "match the source" : "DO NOT MATCH",
+                frameMatches ? "matches the canvas" : "DOES NOT MATCH");
+
+    selection.Clear();
+    std::printf("After clearing the clipboard: %.2f MB pixels\n", LiveMb(baseBytes));
+    pool.Release(frame);
+    pool.Release(canvas);
+    return matches && frameMatches ? 0 : 2;
+}
+
+// Сравнение в лоб: один поток, по пикселю за шаг — эталон для CompareImages
+void NaiveDiff(const Surface &a, const Surface &b, int threshold, ImageDiff &result, uint64_t &sumSquares)
+{
+    result = ImageDiff();
+    sumSquares = 0;
+    for (int y = 0; y < a.height; y++)
+    {
+        const uint32_t *rowA = reinterpret_cast<const uint32_t *>(a.pixels + (size_t)y * a.stride);
+        const uint32_t *rowB = reinterpret_cast<const uint32_t *>(b.pixels + (size_t)y * b.stride);
+        for (int x = 0; x < a.width; x++)
+        {
+            int largest = 0;
+            for (int channel = 0; channel < 3; channel++)
+            {
+                int difference = std::abs((int)((rowA[x] >> (8 * channel)) & 0xFF) -
+                                          (int)((rowB[x] >> (8 * channel)) & 0xFF));
+                sumSquares += (uint64_t)(difference * difference);
+                largest = std::max(largest, difference);
+            }
+            result.maxDifference = std::max(result.maxDifference, largest);
+            if (largest > threshold)
+                result.changedPixels++;
+        }
+    }
+}
+
+bool SameDiff(const ImageDiff &a, const ImageDiff &b)
+{
+    return a.changedPixels == b.changedPixels && a.maxDifference == b.maxDifference && a.mse == b.mse;
+}
+
+// Пара изображений 10001 x (megapixels * 100) (нечётная ширина: хвост строки идёт
+// скалярным циклом): второе — копия первого с шумом на 1 по всему полю, который
+// порог сравнения пропускает, и с несколькими разнесёнными изменёнными
+// прямоугольниками, которые должны найтись ровно как области. Сравнение в лоб,
+// CompareImages в одном потоке и по полосам в пуле, затем ImageCompare как в ImageApp
+// (с буфером разности) и, с --dump, кадр width x height рядом.
+int RunDiffBenchmark(size_t megapixels, int width, int height, const fs::path &dump)
+{
+    SurfacePool &pool = SurfacePool::Instance();
+    int imageWidth = 10001;
+    int imageHeight = std::max(static_cast<int>(megapixels * 100), 100);
+    Surface first;
+    Surface second;
+    if (!pool.Acquire(imageWidth, imageHeight, first) || !pool.Acquire(imageWidth, imageHeight, second))
+    {
+        std::cerr << "Cannot allocate two " << megapixels << " MP images\n";
+        pool.Release(first);
+        return 1;
+    }
+    for (int y = 0; y < imageHeight; y++)
+    {
+        uint32_t *rowFirst = reinterpret_cast<uint32_t *>(first.pixels + (size_t)y * first.stride);
+        uint32_t *rowSecond = reinterpret_cast<uint32_t *>(second.pixels + (size_t)y * second.stride);
+        for (int x = 0; x < imageWidth; x++)
+        {
+            uint32_t red = (uint32_t)(x * 255 / imageWidth);
+            uint32_t green = (uint32_t)(y * 255 / imageHeight);
+            uint32_t blue = (uint32_t)(x * 7 + y * 13) & 0xFF;
+            rowFirst[x] = 0xFF000000u | (red << 16) | (green << 8) | blue;
+            rowSecond[x] = rowFirst[x] ^ ((uint32_t)((x * 31 + y * 17) % 5 == 0) << 8);
+        }
+    }
+    // Прямоугольники не кратны блоку и четвёрке пикселей и разнесены больше чем на блок
+    std::vector<DiffRegion> planted;
+    for (int i = 0; i < 12; i++)
+    {
+        DiffRegion region;
+        region.width = 37 + i * 53;
+        region.height = 21 + i * 29;
+        region.x = 101 + (i % 4) * (imageWidth / 4);
+        region.y = 67 + (i / 4) * std::max(imageHeight / 3, region.height + 2 * ImageDiff::REGION_BLOCK);
+        if (region.x + region.width > imageWidth || region.y + region.height > imageHeight)
+            continue;
+        // Старший бит каждого канала инвертирован: разница ровно 128 в каждом пикселе
+        for (int y = region.y; y < region.y + region.height; y++)
+        {
+            uint32_t *row = reinterpret_cast<uint32_t *>(second.pixels + (size_t)y * second.stride);
+            for (int x = region.x; x < region.x + region.width; x++)
+                row[x] ^= 0x00808080u;
+        }
+        planted.push_back(region);
+    }
+    std::sort(planted.begin(), planted.end(), [](const DiffRegion &a, const DiffRegion &b) {
+        return (int64_t)a.width * a.height > (int64_t)b.width * b.height;
+    });
+
+    ThreadPool workers;
+    ImageDiff naive;
+    ImageDiff serial;
+    ImageDiff parallel;
+    uint64_t naiveSquares = 0;
+    double naiveMs = BestOfMs(1, [&]() { NaiveDiff(first, second, ImageCompare::THRESHOLD, naive, naiveSquares); });
+    naive.mse = naiveSquares / (3.0 * imageWidth * imageHeight);
+    double serialMs = BestOfMs(3, [&]() { CompareImages(first, second, ImageCompare::THRESHOLD, nullptr, serial); });
+    double parallelMs =
+        BestOfMs(3, [&]() { CompareImages(first, second, ImageCompare::THRESHOLD, &workers, parallel); });
+    bool statsMatch = SameDiff(naive, serial) && SameDiff(naive, parallel);
+    bool regionsMatch = serial.regions.size() == planted.size() && parallel.regions.size() == planted.size();
+    for (size_t i = 0; regionsMatch && i < planted.size(); i++)
+    {
+        const DiffRegion &expected = planted[i];
+        for (const DiffRegion *found : {&serial.regions[i], &parallel.regions[i]})
+            regionsMatch = regionsMatch && found->x == expected.x && found->y == expected.y &&
+                           found->width == expected.width && found->height == expected.height;
+    }
+
+    // Сравнение как в ImageApp: второе изображение переходит в ImageCompare
+    ImageCompare compare;
+    bool opened = compare.Open(first, second, L"second");
+    bool differenceMatches = false;
+    if (opened)
+    {
+        const Surface &difference = compare.GetDifference();
+        differenceMatches = true;
+        for (int y = 0; y < imageHeight && differenceMatches; y += 997)
+        {
+            const uint32_t *rowFirst = reinterpret_cast<const uint32_t *>(first.pixels + (size_t)y * first.stride);
+            const uint32_t *rowSecond =
+                reinterpret_cast<const uint32_t *>(compare.GetSecond().pixels + (size_t)y * compare.GetSecond().stride);
+            const uint32_t *rowDifference =
+                reinterpret_cast<const uint32_t *>(difference.pixels + (size_t)y * difference.stride);
+            for (int x = 0; x < imageWidth; x++)
+            {
+                uint32_t expected = 0xFF000000u;
+                for (int channel = 0; channel < 3; channel++)
+                    expected |= (uint32_t)std::abs((int)((rowFirst[x] >> (8 * channel)) & 0xFF) -
+                                                   (int)((rowSecond[x] >> (8 * channel)) & 0xFF))
+                                << (8 * channel);
+                differenceMatches = differenceMatches && rowDifference[x] == expected;
+            }
+        }
+    }
+
+    double pixels = imageWidth * (double)imageHeight;
+    std::printf("Images: 2 x %dx%d (%.1f MP), %zu worker threads, %s\n", imageWidth, imageHeight, pixels / 1e6,
+                workers.GetThreadCount(), IMAGEDIFF_SSE2 ? "SSE2" : "scalar");
+    std::printf("Naive %.1f ms, single thread %.1f ms, parallel %.1f ms (%.2f GB/s read), %s\n", naiveMs, serialMs,
+                parallelMs, pixels * 8 / (parallelMs * 1e6), statsMatch ? "statistics match" : "STATISTICS DIFFER");
+    std::printf("Changed %ju px (%.3f%%), max difference %d, MSE %.4f, PSNR %.2f dB\n", parallel.changedPixels,
+                parallel.changedPixels * 100.0 / pixels, parallel.maxDifference, parallel.mse, parallel.psnr);
+    std::printf("Regions: %zu found, %zu planted, %s\n", parallel.regions.size(), planted.size(),
+                regionsMatch ? "bounds match" : "BOUNDS DIFFER");
+    std::printf("ImageCompare with difference image: %.1f ms, difference pixels %s\n", compare.GetDiffMs(),
+                differenceMatches ? "match" : "DO NOT MATCH");
+
+    int result = statsMatch && regionsMatch && differenceMatches ? 0 : 2;
+    if (!dump.empty() && opened)
+    {
+        Surface frame;
+        if (pool.Acquire(width, height, frame))
+        {
+            // Вписываем изображение в половину кадра
+            ImageViewport viewport;
+            double zoom = std::min((double)(width / 2) / imageWidth, (double)height / imageHeight);
+            viewport.SetImage(&first, imageWidth, imageHeight, zoom);
+            viewport.Center(compare.GetPaneWidth(width), height);
+            SurfaceCanvas canvas(frame);
+            compare.Render(viewport, canvas, width, height);
+            if (!WriteImage(dump, frame, FormatFromPath(dump)))
+                result = 2;
+            pool.Release(frame);
+        }
+    }
+    compare.Close();
+    pool.Release(first);
+    return result;
+}
+
+struct MemorySnapshot
+{
+    size_t liveBytes[MEMORY_TAG_COUNT];
+    size_t poolLiveBytes;
+};
+
+MemorySnapshot TakeMemorySnapshot()
+{
+    MemorySnapshot snapshot;
+    for (int tag = 0; tag < MEMORY_TAG_COUNT; tag++)
+        snapshot.liveBytes[tag] = GetMemoryTagStats((MemoryTag)tag).liveBytes;
+    snapshot.poolLiveBytes = SurfacePool::Instance().GetStats().liveBytes;
+    return snapshot;
+}
+
+// Долгий сеанс: три приложения живут всё время, в каждом круге — их сценарии по
+// умолчанию, сравнение с новым изображением в просмотрщике, копирование и вставка
+// выделения на холсте, перезагрузка иконок алхимии. Метки — как у окон приложений.
+// Первый круг прогревает (кэши, пул, ленивые буферы), после него живые байты по
+// меткам и в SurfacePool должны оставаться теми же до конца; рост — утечка.
+// Штрихи task_2 копятся (это данные рисунка), поэтому круги понемногу дольше.
+int RunMemoryBenchmark(size_t rounds)
+{
+    const size_t ICON_ELEMENTS = 64;
+    fs::path folder = fs::temp_directory_path() / "alchemy_memory";
+    std::error_code error;
+    fs::remove_all(folder, error);
+    fs::create_directories(folder, error);
+
+    std::vector<PlatformEvent> imageScript;
+    std::vector<PlatformEvent> paintScript;
+    std::vector<PlatformEvent> alchemyScript;
+    std::string scriptError;
+    if (!ParseEventScript(IMAGE_SCRIPT, imageScript, scriptError) ||
+        !ParseEventScript(PAINT_SCRIPT, paintScript, scriptError) ||
+        !ParseEventScript(ALCHEMY_SCRIPT, alchemyScript, scriptError))
+    {
+        std::cerr << "Script error: " << scriptError << "\n";
+        return 1;
+    }
+
+    SurfacePool &pool = SurfacePool::Instance();
+    Surface image;
+    Surface canvas;
+    Surface frame;
+    {
+        MEMORY_TAG_SCOPE(MEMORY_VIEWER);
+        MakeTestImage(2048, 1536, image);
+    }
+    {
+        MEMORY_TAG_SCOPE(MEMORY_CANVAS);
+        if (pool.Acquire(1024, 1024, canvas))
+            FillSurfaceRect(canvas, 0, 0, canvas.width, canvas.height, 0xFFFFFFFF);
+    }
+    {
+        MEMORY_TAG_SCOPE(MEMORY_FRAMES);
+        pool.Acquire(800, 600, frame);
+    }
+    {
+        MEMORY_TAG_SCOPE(MEMORY_OTHER);
+        Surface icon;
+        if (pool.Acquire(128, 128, icon))
+        {
+            for (size_t i = 0; i < ICON_ELEMENTS; i++)
+            {
+                FillSurfaceRect(icon, 0, 0, icon.width, icon.height, 0xFF000000u | ((uint32_t)(i * 2654435761u) >> 8));
+                WriteImage(folder / ("e" + std::to_string(i) + ".bmp"), icon, ImageFormat::Bmp);
+            }
+            pool.Release(icon);
+        }
+    }
+    if (!image.pixels || !canvas.pixels || !frame.pixels)
+    {
+        pool.Release(image);
+        pool.Release(canvas);
+        pool.Release(frame);
+        return 1;
+    }
+
+    int result = 0;
+    MemorySnapshot warm = {};
+    MemorySnapshot last = {};
+    size_t icons = 0;
+    size_t regions = 0;
+    double firstRoundMs = 0.0;
+    double lastRoundMs = 0.0;
+    {
+        ImageViewport viewport;
+        viewport.SetImage(&image, image.width, image.height, 1.0);
+        viewport.Center(800, 600);
+        ImageCompare compare;
+        PaintSession session;
+        CanvasSelection selection;
+        selection.Attach(canvas);
+        AlchemyGame game;
+        BuildStartupGraph(game, ICON_ELEMENTS);
+        OffscreenHost imageHost(800, 600);
+        OffscreenHost paintHost(800, 600);
+        OffscreenHost alchemyHost(800, 600);
+
+        for (size_t round = 0; round < rounds; round++)
+        {
+            auto start = std::chrono::steady_clock::now();
+            {
+                MEMORY_TAG_SCOPE(MEMORY_VIEWER);
+                imageHost.Run(viewport, imageScript);
+                Surface second;
+                if (MakeTestImage(image.width, image.height, second))
+                {
+                    FillSurfaceRect(second, 100 + (int)round * 10, 100, 300, 200, 0xFF000000u);
+                    if (compare.Open(image, second, L"second"))
+                    {
+                        regions = compare.GetDiff().regions.size();
+                        SurfaceCanvas target(frame);
+                        compare.SetMode(ImageCompare::DIFFERENCE);
+                        compare.Render(viewport, target, frame.width, frame.height);
+                    }
+                }
+            }
+            {
+                MEMORY_TAG_SCOPE(MEMORY_CANVAS);
+                paintHost.Run(session, paintScript);
+                selection.Select(100, 100, 600, 600);
+                selection.Copy();
+                selection.Paste(200 + (int)round, 300);
+                selection.MoveFloating(250 + (int)round, 350);
+                selection.Commit();
+                selection.BeforeCanvasWrite(0, 0, 512, 512);
+                FillSurfaceRect(canvas, 0, 0, 512, 512, 0xFF808080u + (uint32_t)round);
+                selection.Deselect();
+            }
+            {
+                MEMORY_TAG_SCOPE(MEMORY_ICONS);
+                icons += game.LoadIcons(folder);
+                alchemyHost.Run(game, alchemyScript);
+            }
+            compare.Close();
+
+            if (round == 0)
+            {
+                firstRoundMs = ElapsedMs(start);
+                warm = TakeMemorySnapshot();
+            }
+            lastRoundMs = ElapsedMs(start);
+        }
+        last = TakeMemorySnapshot();
+    }
+
+    std::printf("Session: %zu rounds, first %.1f ms, last %.1f ms; %zu icons loaded, %zu diff regions\n", rounds,
+                firstRoundMs, lastRoundMs, icons, regions);
+    std::printf("Live after warm-up and after the last round:\n");
+    for (int tag = 0; tag < MEMORY_TAG_COUNT; tag++)
+    {
+        bool grew = last.liveBytes[tag] > warm.liveBytes[tag];
+        std::printf("  %-8s %10.2f MB %10.2f MB  %s\n", MemoryTagName((MemoryTag)tag), warm.liveBytes[tag] / 1048576.0,
+                    last.liveBytes[tag] / 1048576.0, grew ? "GROWS" : "ok");
+        if (grew)
+            result = 2;
+    }
+    bool poolGrew = last.poolLiveBytes > warm.poolLiveBytes;
+    std::printf("  %-8s %10.2f MB %10.2f MB  %s\n", "pool", warm.poolLiveBytes / 1048576.0,
+                last.poolLiveBytes / 1048576.0, poolGrew ? "GROWS" : "ok");
+    if (poolGrew)
+        result = 2;
+
+    pool.Release(frame);
+    pool.Release(canvas);
+    pool.Release(image);
+    // После выхода из сеанса всё, кроме кэша пула, отдано
+    MemoryTagStats total = GetMemoryTotalStats();
+    if (total.liveBytes != 0)
+    {
+        std::printf("Still live after the session: %zu bytes\n", total.liveBytes);
+        result = 2;
+    }
+    std::fputs(MemoryReport().c_str(), stdout);
+    fs::remove_all(folder, error);
+    return result;
+}
+
+// Установившийся режим буферов кадра: OffscreenHost::ResizeFrame и кадр PaintSession
+// ведут себя как PooledBitmap::Reset в окнах (тот же размер — ничего, другой — блок
+// обратно в пул и новый из пула). Первый круг сценария прогревает свободные списки,
+// после него перетаскивание и смена размера не должны обращаться к куче вовсе.
+int RunPoolBenchmark(size_t rounds)
+{
+    std::vector<PlatformEvent> script;
+    std::string scriptError;
+    if (!ParseEventScript(POOL_SCRIPT, script, scriptError))
+    {
+        std::cerr << "Script error: " << scriptError << "\n";
+        return 1;
+    }
+
+    SurfacePool &pool = SurfacePool::Instance();
+    Surface image;
+    if (!MakeTestImage(2048, 1536, image))
+        return 1;
+
+    int result = 0;
+    SurfacePoolStats warm;
+    SurfacePoolStats steady;
+    size_t frames = 0;
+    double steadyMs = 0.0;
+    {
+        ImageViewport viewport;
+        viewport.SetImage(&image, image.width, image.height, 1.0);
+        viewport.Center(800, 600);
+        PaintSession session;
+        OffscreenHost imageHost(800, 600);
+        OffscreenHost paintHost(800, 600);
+        imageHost.Paint(viewport);
+        paintHost.Paint(session);
+        imageHost.Run(viewport, script);
+        paintHost.Run(session, script);
+        warm = pool.GetStats();
+
+        pool.ResetCounters();
+        auto start = std::chrono::steady_clock::now();
+        for (size_t round = 0; round < rounds; round++)
+        {
+            frames += imageHost.Run(viewport, script).frames;
+            frames += paintHost.Run(session, script).frames;
+        }
+        steadyMs = ElapsedMs(start);
+        steady = pool.GetStats();
+    }
+    pool.Release(image);
+
+    std::printf("Warm-up: %zu heap allocations, %zu reuses, %.2f MB cached\n", warm.allocations, warm.reuseHits,
+                warm.cachedBytes / 1048576.0);
+    std::printf("Steady state: %zu rounds, %zu frames in %.1f ms, %zu heap allocations, %zu reuses, %s\n", rounds,
+                frames, steadyMs, steady.allocations, steady.reuseHits,
+                steady.allocations == 0 ? "no heap allocations" : "HEAP ALLOCATIONS AFTER WARM-UP");
+    if (steady.allocations != 0 || steady.reuseHits == 0)
+        result = 2;
+    return result;
+}
+
+int main(int argc, char *argv[])
+{
+    Options options;
+    if (!ParseOptions(argc, argv, options))
+    {
+        PrintUsage();
+        return 1;
+    }
+    TraceInitFromEnvironment();
+    MemoryReportInitFromEnvironment();
+    if (options.benchmark == "recipes")
+        return RunRecipeBenchmark(options.count > 0 ? options.count : 100000);
+    if (options.benchmark == "startup")
+        return RunStartupBenchmark(options.count > 0 ? options.count : 2000);
+    if (options.benchmark == "animation")
+        return RunAnimationBenchmark(options.count > 0 ? options.count : 300, options.width, options.height);
+    if (options.benchmark == "histogram")
+        return RunHistogramBenchmark(options.count > 0 ? options.count : 100, options.width, options.height,
+                                     options.dump);
+    if (options.benchmark == "selection")
+        return RunSelectionBenchmark(options.count > 0 ? static_cast<int>(options.count) : 8192);
+    if (options.benchmark == "diff")
+        return RunDiffBenchmark(options.count > 0 ? options.count : 50, options.width, options.height, options.dump);
+    if (options.benchmark == "memory")
+        return RunMemoryBenchmark(options.count > 0 ? options.count : 5);
+    if (options.benchmark == "pool")
+        return RunPoolBenchmark(options.count > 0 ? options.count : 50);
+
+#ifdef _WIN32
+    CoInitializeEx(nullptr, COINIT_MULTITHREADED);
+#endif
+
+    std::vector<PlatformEvent> script;
+    std::string error;
+    bool parsed = options.script.empty()
+                      ? ParseEventScript(options.app == "image"   ? IMAGE_SCRIPT
+                                         : options.app == "paint" ? PAINT_SCRIPT
+                                                                  : ALCHEMY_SCRIPT,
+                                         script, error)
+                      : LoadEventScript(options.script, script, error);
+    if (!parsed)
+    {
+        std::cerr << "Script error: " << error << "\n";
+        return 1;
+    }
+    std::vector<PlatformEvent> events;
+    for (int i = 0; i < options.repeat; i++)
+        events.insert(events.end(), script.begin(), script.end());
+
+    int result = 0;
+    Surface image;
+    {
+        std::unique_ptr<PlatformApp> app;
+        if (options.app == "image")
+        {
+            bool loaded = options.image.empty() ? MakeTestImage(2048, 1536, image) : ReadImage(options.image, 0, 0, image);
+            if (!loaded)
+            {
+                std::cerr << "Cannot load image\n";
+                return 1;
+            }
+            auto viewport = std::make_unique<ImageViewport>();
+            viewport->SetImage(&image, image.width, image.height, 1.0);
+            viewport->Center(options.width, options.height);
+            app = std::move(viewport);
+        }
+        else if (options.app == "paint")
+        {
+            app = std::make_unique<PaintSession>();
+        }
+        else
+        {
+            auto game = std::make_unique<AlchemyGame>();
+            if (!options.icons.empty())
+                std::printf("Icons: %zu loaded\n", game->LoadIcons(options.icons));
+            if (!options.recipes.empty())
+                std::printf("Recipes: %zu added\n", game->LoadRecipes(options.recipes));
+            app = std::move(game);
+        }
+
+        OffscreenHost host(options.width, options.height);
+        host.Paint(*app);
+        OffscreenRunStats stats = host.Run(*app, events);
+
+        std::printf("Events: %zu, frames: %zu, text runs: %zu\n", stats.events, stats.frames, stats.textRuns);
+        std::printf("Time: %.3f ms total, %.3f ms in events, %.3f ms painting, %.1f us/frame\n", stats.totalMs,
+                    stats.eventMs, stats.paintMs, stats.frames > 0 ? stats.paintMs * 1000.0 / stats.frames : 0.0);
+        std::printf("Event to frame: p50 %.3f ms, p99 %.3f ms, max %.3f ms\n", stats.latencyP50Ms, stats.latencyP99Ms,
+                    stats.latencyMaxMs);
+        if (auto *session = dynamic_cast<PaintSession *>(app.get()))
+            std::printf("Paint: %zu strokes, %zu tiles rendered, %zu segments rendered\n",
+                        session->GetStrokes().GetStrokes().size(), session->GetTilesRendered(),
+                        session->GetSegmentsRendered());
+        if (auto *game = dynamic_cast<AlchemyGame *>(app.get()))
+            std::printf("Alchemy: %zu open elements, %zu recipes\n", game->GetOpenElements().size(),
+                        game->GetRecipes().GetRecipeCount());
+
+        if (!options.dump.empty() && !WriteImage(options.dump, host.GetFrame(), FormatFromPath(options.dump)))
+        {
+            std::cerr << "Cannot write " << options.dump.string() << "\n";
+            result = 2;
+        }
+    }
+    SurfacePool::Instance().Release(image);
+
+    TraceWriteReports();
+    MemoryWriteReports();
+#ifdef _WIN32
+    CoUninitialize();
+#endif
+    return result;
+}
@@ -1,8 +1,105 @@
 ﻿#include "ImageApp.h"
+#include <shobjidl.h>
+#include <wrl/client.h>
+#include <algorithm>
 #include <iostream>
 
+#include "../common/MemoryAccounting.h"
+#include "../common/ScaledDecoder.h"
+#include "../common/SurfaceDraw.h"
+#include "../common/Trace.h"
+#include "../common/Win32Platform.h"
+
+namespace {
+const UINT_PTR RESIZE_TIMER_ID = 1;
+const UINT_PTR ANIMATION_TIMER_ID = 2;
+const UINT_PTR FLICKER_TIMER_ID = 3;
+const UINT FLICKER_INTERVAL_MS = 500;
+const UINT WM_APP_IMAGE_REFINED = WM_APP + 1;
+const UINT WM_APP_COMPARE_DECODED = WM_APP + 3;  // WM_APP + 2 — у ThumbnailGrid
+
+ULONGLONG GetProcessCpuTime100ns() {
+    FILETIME creation, exit, kernel, user;
+    GetProcessTimes(GetCurrentProcess(), &creation, &exit, &kernel, &user);
+    ULARGE_INTEGER k, u;
+    k.LowPart = kernel.dwLowDateTime;
+    k.HighPart = kernel.dwHighDateTime;
+    u.LowPart = user.dwLowDateTime;
+    u.HighPart = user.dwHighDateTime;
+    return k.QuadPart + u.QuadPart;
+}
+
+bool AskImagePath(HWND hwnd, std::wstring& path) {
+    OPENFILENAME ofn;
+    wchar_t szFile[260] = { 0 };
+    ZeroMemory(&ofn, sizeof(ofn));
+    ofn.lStructSize = sizeof(ofn);
+    ofn.hwndOwner = hwnd;
+    ofn.lpstrFile = szFile;
+    ofn.nMaxFile = sizeof(szFile);
+    ofn.lpstrFilter = L"Images\0*.bmp;*.jpg;*.png;*.gif\0";
+    ofn.nFilterIndex = 1;
+    ofn.Flags = OFN_PATHMUSTEXIST | OFN_FILEMUSTEXIST;
+
+    if (!GetOpenFileName(&ofn)) return false;
+    path = ofn.lpstrFile;
+    return true;
+}
+
+double NowMs() {
+    LARGE_INTEGER now, frequency;
+    QueryPerformanceCounter(&now);
+    QueryPerformanceFrequency(&frequency);
+    return now.QuadPart * 1000.0 / frequency.QuadPart;
+}
+
+// Пиксели панели статистики пишутся прямо в буфер, текст — через GDI+ того же
+// буфера: TextOut по растру GDI+ затёр бы альфу
+class BackBufferCanvas : public PlatformCanvas {
+ public:
+  BackBufferCanvas(Gdiplus::Graphics& graphics, const Surface& surface)
+      : graphics(graphics), surface(surface), font(L"Segoe UI", 9) {}
+
+  const Surface& GetSurface() override { return surface; }
+
+  void DrawString(int x, int y, const std::wstring& text, uint32_t color) override {
+      Gdiplus::SolidBrush brush(Gdiplus::Color(color));
+      graphics.DrawString(text.c_str(), static_cast<INT>(text.size()), &font,
+                          Gdiplus::PointF(static_cast<Gdiplus::REAL>(x), static_cast<Gdiplus::REAL>(y)), &brush);
+  }
+
+ private:
+  Gdiplus::Graphics& graphics;
+  Surface surface;
+  Gdiplus::Font font;
+};
+}  // namespace
+
+// Полноразмерные изображения для сравнения. Что не дошло до вида и ImageCompare,
+// возвращается в пул вместе со структурой.
+struct ImageApp::CompareDecode {
+    Surface first;  // пусто, если в виде уже полный размер
+    Surface second;
+    std::wstring secondPath;
+    std::wstring failedPath;
+
+    ~CompareDecode() {
+        if (first.pixels) SurfacePool::Instance().Release(first);
+        if (second.pixels) SurfacePool::Instance().Release(second);
+    }
+};
+
 ImageApp::ImageApp(HINSTANCE hInstance)
-    : pBitmap(nullptr), imageOffsetX(0), imageOffsetY(0), isDragging(false), pBackBuffer(nullptr) {
+    : viewWidth(0), viewHeight(0), backBufferDirty(true), resizeTimerActive(false),
+      frameIntervalMs(16), rebuildCount(0), loadGeneration(0), refineRequested(false),
+      decodeWorkers(1), firstFrameReported(true), grid(thumbnailCache), browseMode(false), animationReportMs(0.0),
+      statsVisible(false) {
+    TraceInitFromEnvironment();
+    MemoryReportInitFromEnvironment();
+
+    // WIC-декодер и диалоги работают через COM
+    CoInitializeEx(nullptr, COINIT_APARTMENTTHREADED);
+
     // Инициализация GDI+
     Gdiplus::GdiplusStartupInput gdiplusStartupInput;
     ULONG_PTR gdiplusToken;
@@ -10,7 +107,7 @@ ImageApp::ImageApp(HINSTANCE hInstance)
 
     // Регистрация класса окна
     WNDCLASSEX wcex = { sizeof(WNDCLASSEX) };
-    wcex.style = CS_HREDRAW | CS_VREDRAW;
+    wcex.style = CS_HREDRAW | CS_VREDRAW | CS_DBLCLKS;
     wcex.lpfnWndProc = ImageApp::WndProc;
     wcex.hInstance = hInstance;
     wcex.hCursor = LoadCursor(nullptr, IDC_ARROW);
@@ -18,18 +115,32 @@ ImageApp::ImageApp(HINSTANCE hInstance)
     wcex.lpszClassName = L"Image Viewer";
     RegisterClassEx(&wcex);
 
+    // Кэш миниатюр общий для всех папок и переживает перезапуск
+    wchar_t localAppData[MAX_PATH];
+    DWORD length = GetEnvironmentVariable(L"LOCALAPPDATA", localAppData, MAX_PATH);
+    std::filesystem::path cacheDir = length > 0 && length < MAX_PATH ? std::filesystem::path(localAppData)
+                                                                     : std::filesystem::temp_directory_path();
+    thumbnailCache.Open(cacheDir / L"ImageViewer" / L"thumbnails.pack");
+
     // Создание окна
     hWnd = CreateWindow(wcex.lpszClassName, L"Image Viewer", WS_OVERLAPPEDWINDOW,
-                        CW_USEDEFAULT, CW_USEDEFAULT, 800, 600, nullptr, nullptr, hInstance, nullptr);
-
-    // Установка указателя на экземпляр класса в пользовательские данные окна
-    SetWindowLongPtr(hWnd, GWLP_USERDATA, reinterpret_cast<LONG_PTR>(this));
+                        CW_USEDEFAULT, CW_USEDEFAULT, 800, 600, nullptr, nullptr, hInstance, this);
 }
 
 ImageApp::~ImageApp() {
-    if (pBitmap) delete pBitmap;
-    if (pBackBuffer) delete pBackBuffer;
+    // Начатое декодирование досчитывается, ещё не начатые задачи выходят сразу
+    loadGeneration++;
+    decodeWorkers.WaitIdle();
+    animation.Stop();
+    refinedImage.reset();
+    decodedCompare.reset();
+    compare.Close();
+    image.Release();
+    backBuffer.Release();
+    // Миниатюры кэша ещё живы: члены разрушаются после тела деструктора
+    MemoryWriteReports();
     Gdiplus::GdiplusShutdown(0);
+    CoUninitialize();
 }
 
 void ImageApp::Run() {
@@ -41,30 +152,55 @@ void ImageApp::Run() {
         TranslateMessage(&msg);
         DispatchMessage(&msg);
     }
+    TraceWriteReports();
 }
 
 LRESULT CALLBACK ImageApp::WndProc(HWND hwnd, UINT message, WPARAM wParam, LPARAM lParam) {
+    // Указатель на экземпляр сохраняется до WM_CREATE и первого WM_SIZE
+    if (message == WM_NCCREATE) {
+        CREATESTRUCT* pCreate = reinterpret_cast<CREATESTRUCT*>(lParam);
+        SetWindowLongPtr(hwnd, GWLP_USERDATA, reinterpret_cast<LONG_PTR>(pCreate->lpCreateParams));
+        // hWnd нужен окну платформы (Invalidate, SetCapture) ещё до возврата из CreateWindow
+        reinterpret_cast<ImageApp*>(pCreate->lpCreateParams)->hWnd = hwnd;
+    }
     ImageApp* pThis = reinterpret_cast<ImageApp*>(GetWindowLongPtr(hwnd, GWLP_USERDATA));
+    if (!pThis) {
+        return DefWindowProc(hwnd, message, wParam, lParam);
+    }
+    TRACE_SCOPE(TraceMessageName(message));
+    MEMORY_TAG_SCOPE(MEMORY_VIEWER);
 
     switch (message) {
     case WM_CREATE:
         pThis->OnCreate(hwnd);
         break;
     case WM_COMMAND:
-        if (LOWORD(wParam) == 1) {
-            OPENFILENAME ofn;
-            wchar_t szFile[260] = { 0 };
-            ZeroMemory(&ofn, sizeof(ofn));
-            ofn.lStructSize = sizeof(ofn);
-            ofn.hwndOwner = hwnd;
-            ofn.lpstrFile = szFile;
-            ofn.nMaxFile = sizeof(szFile);
-            ofn.lpstrFilter = L"Images\0*.bmp;*.jpg;*.png\0";
-            ofn.nFilterIndex = 1;
-            ofn.Flags = OFN_PATHMUSTEXIST | OFN_FILEMUSTEXIST;
-
-            if (GetOpenFileName(&ofn)) {
-                pThis->LoadImage(hwnd, ofn.lpstrFile);
+        if (LOWORD(wParam) == 2) {
+            pThis->RunResizeBenchmark(hwnd);
+        }
+        else if (LOWORD(wParam) == 3) {
+            pThis->BrowseFolder(hwnd);
+        }
+        else if (LOWORD(wParam) == 4) {
+            pThis->ToggleStats(hwnd);
+        }
+        else if (LOWORD(wParam) == 5) {
+            std::wstring path;
+            if (AskImagePath(hwnd, path)) {
+                pThis->CompareWith(hwnd, path);
+            }
+        }
+        else if (LOWORD(wParam) == 9) {
+            MessageBoxA(hwnd, MemoryReport().c_str(), "Memory", MB_OK);
+        }
+        else if (LOWORD(wParam) >= 6 && LOWORD(wParam) <= 8) {
+            pThis->SetCompareMode(hwnd, static_cast<ImageCompare::Mode>(LOWORD(wParam) - 6));
+        }
+        else if (LOWORD(wParam) == 1) {
+            std::wstring path;
+            if (AskImagePath(hwnd, path)) {
+                pThis->browseMode = false;
+                pThis->LoadImage(hwnd, path);
                 pThis->CenterImage(hwnd);
             }
         }
@@ -73,34 +209,75 @@ LRESULT CALLBACK ImageApp::WndProc(HWND hwnd, UINT message, WPARAM wParam, LPARA
         pThis->OnPaint(hwnd);
         break;
     case WM_SIZE:
-        pThis->CreateBackBuffer(hwnd);
-        pThis->CenterImage(hwnd);
-        InvalidateRect(hwnd, nullptr, TRUE);
+        pThis->OnSize(hwnd, LOWORD(lParam), HIWORD(lParam));
         break;
-    case WM_LBUTTONDOWN:
-        pThis->isDragging = true;
-        pThis->dragStart.x = LOWORD(lParam);
-        pThis->dragStart.y = HIWORD(lParam);
-        SetCapture(hwnd);
+    case WM_TIMER:
+        if (wParam == RESIZE_TIMER_ID) {
+            pThis->OnResizeTimer(hwnd);
+        }
+        else if (wParam == ANIMATION_TIMER_ID) {
+            pThis->OnAnimationTimer(hwnd);
+        }
+        else if (wParam == FLICKER_TIMER_ID) {
+            pThis->compare.Flip();
+            pThis->backBufferDirty = true;
+            InvalidateRect(hwnd, nullptr, FALSE);
+        }
         break;
-    case WM_LBUTTONUP:
-        pThis->isDragging = false;
-        ReleaseCapture();
+    case WM_MOUSEWHEEL:
+        if (pThis->browseMode) {
+            pThis->grid.Scroll(GET_WHEEL_DELTA_WPARAM(wParam), pThis->viewWidth, pThis->viewHeight);
+            pThis->backBufferDirty = true;
+            InvalidateRect(hwnd, nullptr, FALSE);
+        }
+        else {
+            pThis->OnViewportEvent(hwnd, message, wParam, lParam);
+        }
         break;
-    case WM_MOUSEMOVE:
-        if (pThis->isDragging) {
-            int dx = LOWORD(lParam) - pThis->dragStart.x;
-            int dy = HIWORD(lParam) - pThis->dragStart.y;
-            pThis->imageOffsetX += dx;
-            pThis->imageOffsetY += dy;
-            pThis->dragStart.x = LOWORD(lParam);
-            pThis->dragStart.y = HIWORD(lParam);
-
-            pThis->CreateBackBuffer(hwnd);
+    case ThumbnailGrid::WM_APP_THUMBNAILS_READY:
+        pThis->grid.OnThumbnailsReady();
+        if (pThis->browseMode) {
+            pThis->backBufferDirty = true;
             InvalidateRect(hwnd, nullptr, FALSE);
-            UpdateWindow(hwnd);
         }
         break;
+    case WM_LBUTTONDBLCLK:
+        if (pThis->browseMode) {
+            pThis->OpenFromGrid(hwnd, LOWORD(lParam), HIWORD(lParam));
+        }
+        break;
+    case WM_KEYDOWN:
+        // Escape закрывает сравнение, затем возвращает из просмотра к сетке папки
+        if (wParam == VK_ESCAPE && pThis->compare.IsOpen()) {
+            pThis->CloseCompare(hwnd);
+        }
+        else if (wParam == VK_ESCAPE && !pThis->browseMode && pThis->grid.GetCount() > 0) {
+            pThis->StopAnimation(hwnd);
+            pThis->browseMode = true;
+            pThis->backBufferDirty = true;
+            InvalidateRect(hwnd, nullptr, FALSE);
+        }
+        break;
+    case WM_APP_IMAGE_REFINED:
+        pThis->OnImageRefined(hwnd, static_cast<unsigned>(wParam));
+        break;
+    case WM_APP_COMPARE_DECODED:
+        pThis->OnCompareDecoded(hwnd, static_cast<unsigned>(wParam));
+        break;
+    case WM_EXITSIZEMOVE:
+        // Финальный кадр после отпускания рамки не ждёт таймера
+        if (pThis->resizeTimerActive) {
+            pThis->OnResizeTimer(hwnd);
+        }
+        break;
+    case WM_LBUTTONDOWN:
+        if (pThis->browseMode) break;
+        pThis->OnViewportEvent(hwnd, message, wParam, lParam);
+        break;
+    case WM_LBUTTONUP:
+    case WM_MOUSEMOVE:
+        pThis->OnViewportEvent(hwnd, message, wParam, lParam);
+        break;
     case WM_ERASEBKGND:
         return 1;
     case WM_DESTROY:
@@ -112,81 +289,538 @@ LRESULT CALLBACK ImageApp::WndProc(HWND hwnd, UINT message, WPARAM wParam, LPARA
     return 0;
 }
 
+void ImageApp::OnCreate(HWND hwnd) {
+    HMENU hMenu = CreateMenu();
+    HMENU hFileMenu = CreatePopupMenu();
+    AppendMenu(hFileMenu, MF_STRING, 1, L"Open");
+    AppendMenu(hFileMenu, MF_STRING, 3, L"Browse folder");
+    AppendMenu(hFileMenu, MF_STRING, 5, L"Compare with...");
+    AppendMenu(hMenu, MF_POPUP, (UINT_PTR)hFileMenu, L"File");
+
+    HMENU hViewMenu = CreatePopupMenu();
+    AppendMenu(hViewMenu, MF_STRING, 4, L"Statistics");
+    AppendMenu(hViewMenu, MF_SEPARATOR, 0, nullptr);
+    AppendMenu(hViewMenu, MF_STRING | MF_GRAYED, 6, L"Compare side by side");
+    AppendMenu(hViewMenu, MF_STRING | MF_GRAYED, 7, L"Compare flicker");
+    AppendMenu(hViewMenu, MF_STRING | MF_GRAYED, 8, L"Compare difference");
+    AppendMenu(hMenu, MF_POPUP, (UINT_PTR)hViewMenu, L"View");
+
+    HMENU hDebugMenu = CreatePopupMenu();
+    AppendMenu(hDebugMenu, MF_STRING, 2, L"Resize benchmark");
+    AppendMenu(hDebugMenu, MF_STRING, 9, L"Memory report");
+    AppendMenu(hMenu, MF_POPUP, (UINT_PTR)hDebugMenu, L"Debug");
+    SetMenu(hwnd, hMenu);
+
+    // Перестраиваем буфер не чаще одного раза за период обновления экрана
+    HDC hdc = GetDC(hwnd);
+    int refreshRate = GetDeviceCaps(hdc, VREFRESH);
+    ReleaseDC(hwnd, hdc);
+    if (refreshRate > 1) {
+        frameIntervalMs = std::max<UINT>(1, 1000 / refreshRate);
+    }
+}
+
 void ImageApp::OnPaint(HWND hwnd) {
+    TRACE_SCOPE("OnPaint");
     PAINTSTRUCT ps;
     HDC hdc = BeginPaint(hwnd, &ps);
 
-    if (pBackBuffer) {
+    // Во время живого ресайза рисуем прежний кадр, новый соберёт таймер
+    if (backBufferDirty && !resizeTimerActive) {
+        CreateBackBuffer(hwnd);
+    }
+
+    if (backBuffer) {
+        int width = std::min<int>(viewWidth, backBuffer.GetWidth());
+        int height = std::min<int>(viewHeight, backBuffer.GetHeight());
         Gdiplus::Graphics graphics(hdc);
-        graphics.DrawImage(pBackBuffer, 0, 0);
+        graphics.DrawImage(backBuffer.Get(), 0, 0, 0, 0, width, height, Gdiplus::UnitPixel);
+
+        HBRUSH background = reinterpret_cast<HBRUSH>(COLOR_WINDOW + 1);
+        RECT right = { width, 0, viewWidth, viewHeight };
+        RECT bottom = { 0, height, width, viewHeight };
+        if (right.left < right.right) FillRect(hdc, &right, background);
+        if (bottom.top < bottom.bottom) FillRect(hdc, &bottom, background);
     }
 
     EndPaint(hwnd, &ps);
+
+    if (!firstFrameReported && image) {
+        ReportFirstFrame(hwnd);
+    }
 }
 
 void ImageApp::LoadImage(HWND hwnd, const std::wstring& filePath) {
-    if (pBitmap) {
-        delete pBitmap;
-        pBitmap = nullptr;
+    TRACE_SCOPE("LoadImage");
+    QueryPerformanceCounter(&loadStart);
+    StopAnimation(hwnd);
+    CloseCompare(hwnd);
+    statsPanel.InvalidatePixels();
+
+    // Результат фонового уточнения прежнего файла больше не нужен
+    loadGeneration++;
+    refineRequested = false;
+    {
+        std::lock_guard<std::mutex> lock(refineMutex);
+        refinedImage.reset();
+        decodedCompare.reset();
+    }
+
+    if (StartAnimation(hwnd, filePath)) {
+        backBufferDirty = true;
+        InvalidateRect(hwnd, nullptr, FALSE);
+        return;
     }
-    pBitmap = new Gdiplus::Bitmap(filePath.c_str());
-    if (pBitmap->GetLastStatus() != Gdiplus::Ok) {
-        delete pBitmap;
-        pBitmap = nullptr;
+
+    // Сразу декодируем под размер окна; полный размер понадобится только при увеличении
+    DecodeInfo info;
+    Surface decoded;
+    if (DecodeImageToSurface(filePath, viewWidth, viewHeight, decoded, &info) && image.Adopt(decoded)) {
+        imagePath = filePath;
+        viewport.SetImage(&image.GetSurface(), info.fullWidth, info.fullHeight,
+                          static_cast<double>(info.decodedWidth) / info.fullWidth);
+        firstFrameReported = false;
+        // Статистика — по полному изображению: превью показывается лишь до его прихода
+        if (statsVisible && image.GetWidth() < viewport.GetImageWidth()) StartRefine(hwnd);
+    }
+    else {
+        image.Release();
+        imagePath.clear();
+        viewport.SetImage(nullptr, 0, 0, 1.0);
     }
-    CreateBackBuffer(hwnd);
-    InvalidateRect(hwnd, nullptr, TRUE);
+    backBufferDirty = true;
+    InvalidateRect(hwnd, nullptr, FALSE);
 }
 
 void ImageApp::CenterImage(HWND hwnd) {
-    if (!pBitmap) return;
+    if (!image) return;
+
+    RECT rect;
+    GetClientRect(hwnd, &rect);
+
+    viewport.Center(compare.GetPaneWidth(rect.right - rect.left), rect.bottom - rect.top);
+
+    backBufferDirty = true;
+    InvalidateRect(hwnd, nullptr, FALSE);
+}
 
+void ImageApp::CreateBackBuffer(HWND hwnd) {
+    TRACE_SCOPE("CreateBackBuffer");
     RECT rect;
     GetClientRect(hwnd, &rect);
+    int width = rect.right - rect.left;
+    int height = rect.bottom - rect.top;
+    viewWidth = width;
+    viewHeight = height;
+
+    // Буфер только растёт; при уменьшении окна рисуем в его левый верхний угол
+    bool ready = false;
+    {
+        MEMORY_TAG_SCOPE(MEMORY_FRAMES);
+        ready = width > 0 && height > 0 && backBuffer.EnsureSize(width, height);
+    }
+    if (ready) {
+        backBufferDirty = false;
+        rebuildCount++;
+        Gdiplus::Graphics graphics(backBuffer.Get());
+
+        if (browseMode) {
+            grid.Draw(graphics, width, height);
+            return;
+        }
+
+        if (compare.IsOpen()) {
+            BackBufferCanvas canvas(graphics, backBuffer.GetSurface());
+            compare.Render(viewport, canvas, width, height);
+        }
+        else {
+            viewport.Render(backBuffer.GetSurface(), width, height);
+        }
+        if (statsVisible && viewport.HasImage()) {
+            statsPanel.Update(viewport, width, height);
+            BackBufferCanvas canvas(graphics, backBuffer.GetSurface());
+            statsPanel.Draw(canvas, width);
+        }
+    }
+}
 
-    int windowWidth = rect.right - rect.left;
-    int windowHeight = rect.bottom - rect.top;
+void ImageApp::ToggleStats(HWND hwnd) {
+    statsVisible = !statsVisible;
+    CheckMenuItem(GetMenu(hwnd), 4, MF_BYCOMMAND | (statsVisible ? MF_CHECKED : MF_UNCHECKED));
+    // Гистограмма превью зависит от размера окна; до полного изображения панель помечена как превью
+    if (statsVisible && image && !refineRequested && image.GetWidth() < viewport.GetImageWidth()) {
+        StartRefine(hwnd);
+    }
+    backBufferDirty = true;
+    InvalidateRect(hwnd, nullptr, FALSE);
+}
 
-    int imageWidth = pBitmap->GetWidth();
-    int imageHeight = pBitmap->GetHeight();
+// Первое изображение — открытое в виде, оба сравниваются в полном размере:
+// превью под окно отличалось бы от второго уже из-за масштаба. Оба декодируются
+// в фоне, окно тем временем показывает прежний вид.
+void ImageApp::CompareWith(HWND hwnd, const std::wstring& secondPath) {
+    TRACE_SCOPE("CompareWith");
+    if (browseMode || !image) return;
+    StopAnimation(hwnd);
+    CloseCompare(hwnd);
 
-    imageOffsetX = (windowWidth - imageWidth) / 2;
-    imageOffsetY = (windowHeight - imageHeight) / 2;
+    // Уточнение больше не нужно и не должно подменить image под сравнением
+    loadGeneration++;
+    refineRequested = true;
+    {
+        std::lock_guard<std::mutex> lock(refineMutex);
+        refinedImage.reset();
+        decodedCompare.reset();
+    }
 
-    CreateBackBuffer(hwnd);
-    InvalidateRect(hwnd, nullptr, TRUE);
+    unsigned generation = loadGeneration;
+    bool needFirst = image.GetWidth() < viewport.GetImageWidth();
+    std::wstring firstPath = imagePath;
+    SetWindowText(hwnd, L"Image Viewer - decoding images to compare...");
+    decodeWorkers.Submit([this, hwnd, generation, needFirst, firstPath, secondPath]() {
+        if (generation != loadGeneration) return;
+        TRACE_SCOPE("CompareDecode");
+        CoInitializeEx(nullptr, COINIT_MULTITHREADED);
+        std::unique_ptr<CompareDecode> decoded = std::make_unique<CompareDecode>();
+        decoded->secondPath = secondPath;
+        if (needFirst && !DecodeImageToSurface(firstPath, 0, 0, decoded->first)) {
+            decoded->failedPath = firstPath;
+        }
+        else if (generation == loadGeneration && !DecodeImageToSurface(secondPath, 0, 0, decoded->second)) {
+            decoded->failedPath = secondPath;
+        }
+        CoUninitialize();
+        if (generation != loadGeneration) return;
+        {
+            std::lock_guard<std::mutex> lock(refineMutex);
+            decodedCompare = std::move(decoded);
+        }
+        PostMessage(hwnd, WM_APP_COMPARE_DECODED, generation, 0);
+    });
 }
 
-void ImageApp::DrawChessboard(Gdiplus::Graphics& graphics, int width, int height) {
-    const int tileSize = 20;
-    for (int y = 0; y < height; y += tileSize) {
-        for (int x = 0; x < width; x += tileSize) {
-            bool isDark = ((x / tileSize) + (y / tileSize)) % 2 == 0;
-            Gdiplus::SolidBrush brush(isDark ? Gdiplus::Color(200, 200, 200) : Gdiplus::Color(255, 255, 255));
-            graphics.FillRectangle(&brush, x, y, tileSize, tileSize);
+void ImageApp::OnCompareDecoded(HWND hwnd, unsigned generation) {
+    if (generation != loadGeneration) return;
+
+    std::unique_ptr<CompareDecode> decoded;
+    {
+        std::lock_guard<std::mutex> lock(refineMutex);
+        decoded = std::move(decodedCompare);
+    }
+    if (!decoded || !image || browseMode) return;
+    if (!decoded->failedPath.empty()) {
+        SetWindowText(hwnd, L"Image Viewer");
+        ShowMessage(L"Cannot decode " + decoded->failedPath, L"Compare");
+        return;
+    }
+    if (decoded->first.pixels) {
+        // Adopt освобождает прежний image и при неудаче: вид не должен на него смотреть
+        if (!image.Adopt(decoded->first)) {
+            viewport.SetImage(nullptr, 0, 0, 1.0);
+            imagePath.clear();
+            Invalidate();
+            return;
         }
+        viewport.SetImage(&image.GetSurface(), image.GetWidth(), image.GetHeight(), viewport.GetZoom());
+        statsPanel.InvalidatePixels();
     }
+
+    // second переходит в ImageCompare и при неудаче им же освобождается
+    Surface second = decoded->second;
+    decoded->second = Surface();
+    std::wstring name = std::filesystem::path(decoded->secondPath).filename().wstring();
+    if (!compare.Open(image.GetSurface(), second, name)) {
+        ShowMessage(L"Not enough memory to compare with " + name, L"Compare");
+        return;
+    }
+    SetCompareMode(hwnd, compare.GetMode());
+
+    const ImageDiff& diff = compare.GetDiff();
+    wchar_t title[256];
+    swprintf_s(title, L"Image Viewer - compare %dx%d: %llu px changed, PSNR %.2f dB, %.1f ms", diff.width,
+               diff.height, static_cast<unsigned long long>(diff.changedPixels), diff.psnr, compare.GetDiffMs());
+    SetWindowText(hwnd, title);
 }
 
-void ImageApp::CreateBackBuffer(HWND hwnd) {
-    if (pBackBuffer) {
-        delete pBackBuffer;
-        pBackBuffer = nullptr;
+void ImageApp::SetCompareMode(HWND hwnd, ImageCompare::Mode mode) {
+    if (!compare.IsOpen()) return;
+    compare.SetMode(mode);
+    HMENU menu = GetMenu(hwnd);
+    for (int i = 0; i < 3; ++i) {
+        EnableMenuItem(menu, 6 + i, MF_BYCOMMAND | MF_ENABLED);
+        CheckMenuItem(menu, 6 + i, MF_BYCOMMAND | (i == mode ? MF_CHECKED : MF_UNCHECKED));
     }
+    KillTimer(hwnd, FLICKER_TIMER_ID);
+    if (mode == ImageCompare::FLICKER) {
+        SetTimer(hwnd, FLICKER_TIMER_ID, FLICKER_INTERVAL_MS, nullptr);
+    }
+    viewport.CancelDrag();
+    CenterImage(hwnd);
+}
 
-    RECT rect;
-    GetClientRect(hwnd, &rect);
-    int width = rect.right - rect.left;
-    int height = rect.bottom - rect.top;
+void ImageApp::CloseCompare(HWND hwnd) {
+    if (!compare.IsOpen()) return;
+    KillTimer(hwnd, FLICKER_TIMER_ID);
+    compare.Close();
+    HMENU menu = GetMenu(hwnd);
+    for (int i = 0; i < 3; ++i) {
+        EnableMenuItem(menu, 6 + i, MF_BYCOMMAND | MF_GRAYED);
+        CheckMenuItem(menu, 6 + i, MF_BYCOMMAND | MF_UNCHECKED);
+    }
+    // Дальше image снова можно уточнять; он уже в полном размере
+    refineRequested = false;
+    CenterImage(hwnd);
+    backBufferDirty = true;
+    InvalidateRect(hwnd, nullptr, FALSE);
+}
 
-    if (width > 0 && height > 0) {
-        pBackBuffer = new Gdiplus::Bitmap(width, height, PixelFormat32bppARGB);
-        Gdiplus::Graphics graphics(pBackBuffer);
+void ImageApp::OnSize(HWND hwnd, int width, int height) {
+    viewWidth = width;
+    viewHeight = height;
+    CenterImage(hwnd);
+    ScheduleRebuild(hwnd);
+}
+
+void ImageApp::ScheduleRebuild(HWND hwnd) {
+    backBufferDirty = true;
+    if (!resizeTimerActive) {
+        resizeTimerActive = SetTimer(hwnd, RESIZE_TIMER_ID, frameIntervalMs, nullptr) != 0;
+    }
+    if (!resizeTimerActive) {
+        InvalidateRect(hwnd, nullptr, FALSE);
+    }
+}
+
+void ImageApp::OnResizeTimer(HWND hwnd) {
+    KillTimer(hwnd, RESIZE_TIMER_ID);
+    resizeTimerActive = false;
+
+    // Все WM_SIZE за период сливаются в одну перестройку
+    if (backBufferDirty) {
+        CreateBackBuffer(hwnd);
+        InvalidateRect(hwnd, nullptr, FALSE);
+    }
+}
+
+void ImageApp::RunResizeBenchmark(HWND hwnd) {
+    RECT startRect;
+    GetWindowRect(hwnd, &startRect);
+    int startWidth = startRect.right - startRect.left;
+    int startHeight = startRect.bottom - startRect.top;
+
+    size_t startRebuilds = rebuildCount;
+    ULONGLONG startCpu = GetProcessCpuTime100ns();
+    ULONGLONG startTick = GetTickCount64();
+    size_t sizeEvents = 0;
 
-        DrawChessboard(graphics, width, height);
+    // Две секунды тянем правый нижний угол туда и обратно, как при живом ресайзе
+    for (ULONGLONG elapsed = 0; elapsed < 2000; elapsed = GetTickCount64() - startTick) {
+        double phase = static_cast<double>(elapsed % 1000) / 1000.0;
+        double swing = phase < 0.5 ? phase * 2.0 : (1.0 - phase) * 2.0;
+        int width = startWidth + static_cast<int>(swing * 400);
+        int height = startHeight + static_cast<int>(swing * 300);
+        SetWindowPos(hwnd, nullptr, 0, 0, width, height, SWP_NOMOVE | SWP_NOZORDER);
+        sizeEvents++;
 
-        if (pBitmap) {
-            graphics.DrawImage(pBitmap, imageOffsetX, imageOffsetY, pBitmap->GetWidth(), pBitmap->GetHeight());
+        MSG msg;
+        while (PeekMessage(&msg, nullptr, 0, 0, PM_REMOVE)) {
+            TranslateMessage(&msg);
+            DispatchMessage(&msg);
         }
+        Sleep(1);
     }
-}
\ No newline at end of file
+    SetWindowPos(hwnd, nullptr, 0, 0, startWidth, startHeight, SWP_NOMOVE | SWP_NOZORDER);
+    SendMessage(hwnd, WM_EXITSIZEMOVE, 0, 0);
+    UpdateWindow(hwnd);
+
+    ULONGLONG cpuMs = (GetProcessCpuTime100ns() - startCpu) / 10000;
+    wchar_t report[256];
+    swprintf_s(report, L"Size events: %zu\nBack buffer rebuilds: %zu\nCPU time: %llu ms",
+               sizeEvents, rebuildCount - startRebuilds, cpuMs);
+    MessageBox(hwnd, report, L"Resize benchmark", MB_OK);
+}
+
+void ImageApp::OnViewportEvent(HWND hwnd, UINT message, WPARAM wParam, LPARAM lParam) {
+    PlatformEvent event;
+    if (!TranslateWin32Message(hwnd, message, wParam, lParam, event)) return;
+    if (event.type == PlatformEvent::MouseWheel) {
+        event.x = compare.ToPaneX(event.x, viewWidth);
+    }
+    viewport.OnEvent(event, *this);
+
+    if (event.type == PlatformEvent::MouseMove && viewport.IsDragging()) {
+        // Кадр при перетаскивании собирается сразу, не дожидаясь очереди сообщений
+        UpdateWindow(hwnd);
+    }
+    if (event.type == PlatformEvent::MouseWheel && !refineRequested && viewport.NeedsFullResolution()) {
+        StartRefine(hwnd);
+    }
+}
+
+void ImageApp::Invalidate() {
+    backBufferDirty = true;
+    InvalidateRect(hWnd, nullptr, FALSE);
+}
+
+void ImageApp::SetCapture(bool capture) {
+    if (capture) {
+        ::SetCapture(hWnd);
+    }
+    else {
+        ReleaseCapture();
+    }
+}
+
+void ImageApp::SetTitle(const std::wstring& title) {
+    SetWindowText(hWnd, title.c_str());
+}
+
+void ImageApp::ShowMessage(const std::wstring& text, const std::wstring& caption) {
+    MessageBox(hWnd, text.c_str(), caption.c_str(), MB_OK);
+}
+
+// Окно не ждёт прежнего уточнения: оно в очереди decodeWorkers и, если уже
+// устарело по loadGeneration, выходит без декодирования
+void ImageApp::StartRefine(HWND hwnd) {
+    refineRequested = true;
+
+    unsigned generation = loadGeneration;
+    std::wstring path = imagePath;
+    decodeWorkers.Submit([this, hwnd, path, generation]() {
+        if (generation != loadGeneration) return;
+        TRACE_SCOPE("RefineDecode");
+        CoInitializeEx(nullptr, COINIT_MULTITHREADED);
+        Surface decoded;
+        bool ok = DecodeImageToSurface(path, 0, 0, decoded);
+        CoUninitialize();
+        if (!ok) return;
+
+        std::unique_ptr<PooledBitmap> refined = std::make_unique<PooledBitmap>();
+        if (!refined->Adopt(decoded) || generation != loadGeneration) return;
+        {
+            std::lock_guard<std::mutex> lock(refineMutex);
+            refinedImage = std::move(refined);
+        }
+        PostMessage(hwnd, WM_APP_IMAGE_REFINED, generation, 0);
+    });
+}
+
+void ImageApp::OnImageRefined(HWND hwnd, unsigned generation) {
+    if (generation != loadGeneration) return;
+
+    std::unique_ptr<PooledBitmap> refined;
+    {
+        std::lock_guard<std::mutex> lock(refineMutex);
+        refined = std::move(refinedImage);
+    }
+    if (!refined) return;
+
+    // Превью уходит обратно в пул вместе с unique_ptr
+    image.Swap(*refined);
+    statsPanel.InvalidatePixels();
+    backBufferDirty = true;
+    InvalidateRect(hwnd, nullptr, FALSE);
+}
+
+void ImageApp::ReportFirstFrame(HWND hwnd) {
+    firstFrameReported = true;
+
+    LARGE_INTEGER now, frequency;
+    QueryPerformanceCounter(&now);
+    QueryPerformanceFrequency(&frequency);
+    double ms = (now.QuadPart - loadStart.QuadPart) * 1000.0 / frequency.QuadPart;
+
+    wchar_t title[256];
+    swprintf_s(title, L"Image Viewer - %dx%d (decoded %dx%d), first frame %.1f ms",
+               viewport.GetImageWidth(), viewport.GetImageHeight(), image.GetWidth(), image.GetHeight(), ms);
+    SetWindowText(hwnd, title);
+}
+
+void ImageApp::BrowseFolder(HWND hwnd) {
+    Microsoft::WRL::ComPtr<IFileOpenDialog> dialog;
+    if (FAILED(CoCreateInstance(CLSID_FileOpenDialog, nullptr, CLSCTX_INPROC_SERVER, IID_PPV_ARGS(&dialog)))) {
+        return;
+    }
+    DWORD options = 0;
+    dialog->GetOptions(&options);
+    dialog->SetOptions(options | FOS_PICKFOLDERS | FOS_PATHMUSTEXIST);
+    if (FAILED(dialog->Show(hwnd))) return;
+
+    Microsoft::WRL::ComPtr<IShellItem> item;
+    PWSTR folder = nullptr;
+    if (FAILED(dialog->GetResult(&item)) || FAILED(item->GetDisplayName(SIGDN_FILESYSPATH, &folder))) return;
+
+    grid.SetFolder(hwnd, folder);
+    CoTaskMemFree(folder);
+    StopAnimation(hwnd);
+    CloseCompare(hwnd);
+
+    browseMode = true;
+    viewport.CancelDrag();
+    backBufferDirty = true;
+    InvalidateRect(hwnd, nullptr, FALSE);
+}
+
+void ImageApp::OpenFromGrid(HWND hwnd, int x, int y) {
+    int index = grid.HitTest(x, y, viewWidth);
+    if (index < 0) return;
+
+    browseMode = false;
+    LoadImage(hwnd, grid.GetPath(index).wstring());
+    CenterImage(hwnd);
+}
+
+// Анимированный GIF или APNG играет в полном размере: холст и есть image,
+// кадры на него переносит плеер в потоке UI, декодирует его рабочий поток
+bool ImageApp::StartAnimation(HWND hwnd, const std::wstring& filePath) {
+    std::unique_ptr<AnimationSource> source = OpenAnimation(filePath);
+    if (!source) return false;
+
+    int width = source->GetWidth();
+    int height = source->GetHeight();
+    Surface canvas;
+    if (!SurfacePool::Instance().Acquire(width, height, canvas)) return false;
+    FillSurfaceRect(canvas, 0, 0, width, height, 0);
+    if (!image.Adopt(canvas)) return false;
+    if (!animation.Start(std::move(source), image.GetSurface(), NowMs())) {
+        image.Release();
+        return false;
+    }
+
+    imagePath = filePath;
+    viewport.SetImage(&image.GetSurface(), width, height, 1.0);
+    firstFrameReported = false;
+    animationReportMs = NowMs();
+    SetTimer(hwnd, ANIMATION_TIMER_ID, frameIntervalMs, nullptr);
+    return true;
+}
+
+void ImageApp::StopAnimation(HWND hwnd) {
+    KillTimer(hwnd, ANIMATION_TIMER_ID);
+    animation.Stop();
+}
+
+void ImageApp::OnAnimationTimer(HWND hwnd) {
+    double now = NowMs();
+    if (animation.Advance(now)) {
+        statsPanel.InvalidatePixels();
+        backBufferDirty = true;
+        InvalidateRect(hwnd, nullptr, FALSE);
+    }
+
+    // Раз в секунду и по окончании — счётчики плеера в заголовке
+    bool finished = !animation.IsPlaying();
+    if (finished || now - animationReportMs >= 1000.0) {
+        animationReportMs = now;
+        const AnimationStats& stats = animation.GetStats();
+        wchar_t title[256];
+        swprintf_s(title, L"Image Viewer - %dx%d, frame %zu/%zu, dropped %zu, decoder stalls %zu",
+                   viewport.GetImageWidth(), viewport.GetImageHeight(), animation.GetFrameIndex() + 1,
+                   animation.GetFrameCount(), stats.framesDropped, stats.stalls);
+        SetWindowText(hwnd, title);
+    }
+    // Последний кадр остаётся на холсте, кольцо и рабочий поток больше не нужны
+    if (finished) {
+        StopAnimation(hwnd);
+    }
+}
@@ -4,31 +4,96 @@
 #include <commdlg.h>
 #include <gdiplus.h>
 #include <windows.h>
+#include <atomic>
+#include <memory>
+#include <mutex>
 #include <string>
 
+#include "../common/AnimationPlayer.h"
+#include "../common/Platform.h"
+#include "../common/PooledBitmap.h"
+#include "../common/ThreadPool.h"
+#include "../common/ThumbnailCache.h"
+#include "ImageCompare.h"
+#include "ImageStatsPanel.h"
+#include "ImageViewport.h"
+#include "ThumbnailGrid.h"
+
 #pragma comment(lib, "gdiplus.lib")
 
-class ImageApp {
+// Окно просмотрщика. Перетаскивание и масштаб живут в ImageViewport, для него
+// ImageApp — окно платформы (PlatformHost); остальное (декодирование, уточнение,
+// сетка папки, таймер ресайза, проигрывание анимации) остаётся здесь.
+class ImageApp : public PlatformHost {
  public:
   ImageApp(HINSTANCE hInstance);
-  ~ImageApp();
+  ~ImageApp() override;
   void Run();
 
+  int GetWidth() const override { return viewWidth; }
+  int GetHeight() const override { return viewHeight; }
+  void Invalidate() override;
+  void SetCapture(bool capture) override;
+  void SetTitle(const std::wstring& title) override;
+  void ShowMessage(const std::wstring& text, const std::wstring& caption) override;
+
  private:
   HWND hWnd;
-  Gdiplus::Bitmap* pBitmap;
-  int imageOffsetX;
-  int imageOffsetY;
-  bool isDragging;
-  POINT dragStart;
-  Gdiplus::Bitmap* pBackBuffer;
+  PooledBitmap image;  // декодированное изображение: превью под окно или полный размер
+  std::wstring imagePath;
+  ImageViewport viewport;
+  PooledBitmap backBuffer;
+  int viewWidth;
+  int viewHeight;
+  bool backBufferDirty;
+  bool resizeTimerActive;
+  UINT frameIntervalMs;
+  size_t rebuildCount;
+  struct CompareDecode;
+  std::mutex refineMutex;
+  std::unique_ptr<PooledBitmap> refinedImage;
+  std::unique_ptr<CompareDecode> decodedCompare;  // оба изображения для сравнения, из фона
+  std::atomic<unsigned> loadGeneration;
+  bool refineRequested;
+  // Полноразмерное декодирование (уточнение, сравнение) — один поток в фоне; UI его
+  // не ждёт, устаревшие по loadGeneration задачи выходят сразу. Разрушается раньше
+  // результатов, в которые пишет.
+  ThreadPool decodeWorkers;
+  LARGE_INTEGER loadStart;
+  bool firstFrameReported;
+  ThumbnailCache thumbnailCache;
+  ThumbnailGrid grid;  // объявлен после кэша: использует его
+  bool browseMode;
+  AnimationPlayer animation;  // рисует в image; останавливается раньше, чем image освобождается
+  double animationReportMs;
+  ImageStatsPanel statsPanel;  // View > Statistics
+  bool statsVisible;
+  ImageCompare compare;  // File > Compare with...; держит второе изображение до закрытия
 
   static LRESULT CALLBACK WndProc(HWND, UINT, WPARAM, LPARAM);
+  void OnCreate(HWND hwnd);
   void OnPaint(HWND hwnd);
   void LoadImage(HWND hwnd, const std::wstring& filePath);
   void CenterImage(HWND hwnd);
-  void DrawChessboard(Gdiplus::Graphics& graphics, int width, int height);
   void CreateBackBuffer(HWND hwnd);
+  void OnSize(HWND hwnd, int width, int height);
+  void OnResizeTimer(HWND hwnd);
+  void ScheduleRebuild(HWND hwnd);
+  void RunResizeBenchmark(HWND hwnd);
+  void OnViewportEvent(HWND hwnd, UINT message, WPARAM wParam, LPARAM lParam);
+  void StartRefine(HWND hwnd);
+  void OnImageRefined(HWND hwnd, unsigned generation);
+  void ReportFirstFrame(HWND hwnd);
+  void BrowseFolder(HWND hwnd);
+  void OpenFromGrid(HWND hwnd, int x, int y);
+  bool StartAnimation(HWND hwnd, const std::wstring& filePath);
+  void StopAnimation(HWND hwnd);
+  void OnAnimationTimer(HWND hwnd);
+  void ToggleStats(HWND hwnd);
+  void CompareWith(HWND hwnd, const std::wstring& secondPath);
+  void OnCompareDecoded(HWND hwnd, unsigned generation);
+  void SetCompareMode(HWND hwnd, ImageCompare::Mode mode);
+  void CloseCompare(HWND hwnd);
 };
 
 #endif  // IMAGEAPP_H
\ No newline at end of file
@@ -0,0 +1,146 @@
+#include "ImageCompare.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cwchar>
+
+#include "../common/SurfaceDraw.h"
+#include "../common/Trace.h"
+
+namespace {
+const uint32_t BACKGROUND = 0xFF202020;
+const uint32_t TEXT_COLOR = 0xFFE0E0E0;
+const uint32_t OUTLINE_COLOR = 0xFFFF3030;
+const uint32_t SEPARATOR_COLOR = 0xFF404040;
+const wchar_t* const MODE_NAMES[3] = { L"Side by side", L"Flicker", L"Difference" };
+
+double MillisecondsSince(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+// Рамка в 1 пиксель снаружи прямоугольника
+void DrawOutline(const Surface& target, int x, int y, int width, int height, uint32_t color) {
+    FillSurfaceRect(target, x - 1, y - 1, width + 2, 1, color);
+    FillSurfaceRect(target, x - 1, y + height, width + 2, 1, color);
+    FillSurfaceRect(target, x - 1, y, 1, height, color);
+    FillSurfaceRect(target, x + width, y, 1, height, color);
+}
+}  // namespace
+
+ImageCompare::~ImageCompare() {
+    Close();
+}
+
+ThreadPool* ImageCompare::GetWorkers() {
+    if (!workers) workers = std::make_unique<ThreadPool>();
+    return workers.get();
+}
+
+bool ImageCompare::Open(const Surface& first, const Surface& newSecond, const std::wstring& name) {
+    Close();
+    second = newSecond;
+    auto start = std::chrono::steady_clock::now();
+    if (!CompareImages(first, second, THRESHOLD, GetWorkers(), diff, &difference)) {
+        Close();
+        return false;
+    }
+    diffMs = MillisecondsSince(start);
+    secondName = name;
+    showSecond = false;
+    return true;
+}
+
+void ImageCompare::Close() {
+    if (second.pixels) SurfacePool::Instance().Release(second);
+    if (difference.pixels) SurfacePool::Instance().Release(difference);
+    second = Surface();
+    difference = Surface();
+    diff = ImageDiff();
+    secondName.clear();
+}
+
+void ImageCompare::SetMode(Mode newMode) {
+    mode = newMode;
+    showSecond = false;
+}
+
+int ImageCompare::GetPaneWidth(int viewWidth) const {
+    return IsOpen() && mode == SIDE_BY_SIDE ? viewWidth / 2 : viewWidth;
+}
+
+int ImageCompare::ToPaneX(int x, int viewWidth) const {
+    int paneWidth = GetPaneWidth(viewWidth);
+    return paneWidth < viewWidth && x >= paneWidth ? x - paneWidth : x;
+}
+
+void ImageCompare::Render(const ImageViewport& viewport, PlatformCanvas& canvas, int width, int height) const {
+    TRACE_SCOPE("RenderCompare");
+    const Surface& target = canvas.GetSurface();
+    if (!IsOpen() || !viewport.HasImage()) return;
+
+    switch (mode) {
+    case SIDE_BY_SIDE: {
+        int half = GetPaneWidth(width);
+        RenderPane(viewport, *viewport.GetImage(), target, 0, half, height);
+        RenderPane(viewport, second, target, half, width - half, height);
+        FillSurfaceRect(target, half - 1, 0, 2, height, SEPARATOR_COLOR);
+        break;
+    }
+    case FLICKER:
+        RenderPane(viewport, showSecond ? second : *viewport.GetImage(), target, 0, width, height);
+        break;
+    case DIFFERENCE:
+        RenderPane(viewport, difference, target, 0, width, height);
+        break;
+    }
+    DrawSummary(canvas, height);
+}
+
+void ImageCompare::RenderPane(const ImageViewport& viewport, const Surface& source, const Surface& target, int left,
+                              int width, int height) const {
+    // Половина окна — отдельная поверхность: отсечение рисования по её краю бесплатно
+    if (left >= target.width) return;
+    Surface pane = target;
+    pane.pixels += static_cast<size_t>(left) * 4;
+    pane.width = std::min(width, target.width - left);
+    pane.height = std::min(height, target.height);
+    viewport.RenderSource(pane, source, pane.width, pane.height);
+
+    // Области — в пикселях первого изображения, его и показывает вид
+    const Surface* image = viewport.GetImage();
+    double scaleX = static_cast<double>(viewport.GetDisplayWidth()) / image->width;
+    double scaleY = static_cast<double>(viewport.GetDisplayHeight()) / image->height;
+    size_t count = std::min<size_t>(diff.regions.size(), MAX_OUTLINES);
+    for (size_t i = 0; i < count; ++i) {
+        const DiffRegion& region = diff.regions[i];
+        int x0 = viewport.GetOffsetX() + static_cast<int>(std::floor(region.x * scaleX));
+        int y0 = viewport.GetOffsetY() + static_cast<int>(std::floor(region.y * scaleY));
+        int x1 = viewport.GetOffsetX() + static_cast<int>(std::ceil((region.x + region.width) * scaleX));
+        int y1 = viewport.GetOffsetY() + static_cast<int>(std::ceil((region.y + region.height) * scaleY));
+        if (x1 < 0 || y1 < 0 || x0 > pane.width || y0 > pane.height) continue;
+        DrawOutline(pane, x0, y0, x1 - x0, y1 - y0, OUTLINE_COLOR);
+    }
+}
+
+void ImageCompare::DrawSummary(PlatformCanvas& canvas, int height) const {
+    const Surface& target = canvas.GetSurface();
+    uint64_t pixels = static_cast<uint64_t>(diff.width) * diff.height;
+    wchar_t lines[2][200];
+    if (std::isinf(diff.psnr)) {
+        std::swprintf(lines[0], 200, L"%ls: identical %dx%d", MODE_NAMES[mode], diff.width, diff.height);
+    }
+    else {
+        std::swprintf(lines[0], 200, L"%ls: changed %.3f%% (%llu px), max %d, PSNR %.2f dB, %zu regions",
+                      MODE_NAMES[mode], pixels > 0 ? diff.changedPixels * 100.0 / pixels : 0.0,
+                      static_cast<unsigned long long>(diff.changedPixels), diff.maxDifference, diff.psnr,
+                      diff.regions.size());
+    }
+    std::swprintf(lines[1], 200, L"vs %ls, %dx%d compared in %.1f ms%ls", secondName.c_str(), diff.width,
+                  diff.height, diffMs, mode == FLICKER ? (showSecond ? L" - second" : L" - first") : L"");
+
+    int top = std::max(0, height - 2 * LINE_HEIGHT - 2 * MARGIN);
+    FillSurfaceRect(target, MARGIN, top, 480, 2 * LINE_HEIGHT + MARGIN, BACKGROUND);
+    for (int i = 0; i < 2; ++i) {
+        canvas.DrawString(2 * MARGIN, top + MARGIN / 2 + i * LINE_HEIGHT, lines[i], TEXT_COLOR);
+    }
+}
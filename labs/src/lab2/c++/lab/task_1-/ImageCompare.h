@@ -0,0 +1,70 @@
+#ifndef IMAGECOMPARE_H
+#define IMAGECOMPARE_H
+
+#include <memory>
+#include <string>
+
+#include "../common/ImageDiff.h"
+#include "../common/Platform.h"
+#include "../common/ThreadPool.h"
+#include "ImageViewport.h"
+
+// Режим сравнения просмотрщика: изображение вида (первое) против второго того же
+// или другого размера. Разность, PSNR и области изменений считаются один раз при
+// открытии (CompareImages, параллельно по полосам строк), дальше только рисуются.
+// Оба изображения показываются одним ImageViewport — общий сдвиг и масштаб:
+// рядом (каждое в своей половине окна), попеременно по Flip() или разностью.
+// Области изменений обводятся рамками. Без оконной системы: рисует в PlatformCanvas.
+class ImageCompare {
+ public:
+  enum Mode { SIDE_BY_SIDE, FLICKER, DIFFERENCE };
+
+  static const int THRESHOLD = 2;  // разница не больше — шум сжатия, не изменение
+  static const int MAX_OUTLINES = 256;
+  static const int LINE_HEIGHT = 16;
+  static const int MARGIN = 8;
+
+  ImageCompare() = default;
+  ~ImageCompare();
+  ImageCompare(const ImageCompare&) = delete;
+  ImageCompare& operator=(const ImageCompare&) = delete;
+
+  // second — буфер из SurfacePool, переходит сюда (и при неудаче освобождается)
+  bool Open(const Surface& first, const Surface& second, const std::wstring& secondName);
+  void Close();
+  bool IsOpen() const { return second.pixels != nullptr; }
+
+  void SetMode(Mode newMode);
+  Mode GetMode() const { return mode; }
+  // Следующая фаза мерцания: первое <-> второе
+  void Flip() { showSecond = !showSecond; }
+  bool IsShowingSecond() const { return showSecond; }
+  // Ширина, по которой центрируется вид: в режиме рядом — половина окна
+  int GetPaneWidth(int viewWidth) const;
+  // x окна -> x в своей половине, чтобы масштаб колесом держал точку под курсором
+  int ToPaneX(int x, int viewWidth) const;
+
+  void Render(const ImageViewport& viewport, PlatformCanvas& canvas, int width, int height) const;
+
+  const ImageDiff& GetDiff() const { return diff; }
+  const Surface& GetSecond() const { return second; }
+  const Surface& GetDifference() const { return difference; }
+  double GetDiffMs() const { return diffMs; }
+
+ private:
+  ThreadPool* GetWorkers();
+  void RenderPane(const ImageViewport& viewport, const Surface& source, const Surface& target, int left, int width,
+                  int height) const;
+  void DrawSummary(PlatformCanvas& canvas, int height) const;
+
+  std::unique_ptr<ThreadPool> workers;  // создаётся при первом сравнении
+  Surface second;
+  Surface difference;
+  std::wstring secondName;
+  ImageDiff diff;
+  double diffMs = 0.0;
+  Mode mode = SIDE_BY_SIDE;
+  bool showSecond = false;
+};
+
+#endif  // IMAGECOMPARE_H
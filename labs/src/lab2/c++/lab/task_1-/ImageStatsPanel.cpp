@@ -0,0 +1,138 @@
+#include "ImageStatsPanel.h"
+#include <algorithm>
+#include <chrono>
+#include <cwchar>
+
+#include "../common/SurfaceDraw.h"
+#include "../common/Trace.h"
+
+namespace {
+const uint32_t BACKGROUND = 0xFF202020;
+const uint32_t TEXT_COLOR = 0xFFE0E0E0;
+// Столбцы каналов складываются по ИЛИ: пересечения дают смешанный цвет
+const uint32_t CHANNEL_COLORS[3] = { 0x00D00000, 0x0000D000, 0x000000D0 };
+const int CHANNEL_ORDER[3] = { ImageHistogram::RED, ImageHistogram::GREEN, ImageHistogram::BLUE };
+const wchar_t CHANNEL_NAMES[3] = { L'R', L'G', L'B' };
+
+double MillisecondsSince(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+double Percent(uint64_t part, uint64_t total) {
+    return total > 0 ? part * 100.0 / total : 0.0;
+}
+}  // namespace
+
+ThreadPool* ImageStatsPanel::GetWorkers() {
+    if (!workers) workers = std::make_unique<ThreadPool>();
+    return workers.get();
+}
+
+void ImageStatsPanel::InvalidatePixels() {
+    imageValid = false;
+    visible.Reset();
+}
+
+size_t ImageStatsPanel::Update(const ImageViewport& viewport, int viewWidth, int viewHeight) {
+    TRACE_SCOPE("UpdateImageStats");
+    const Surface* image = viewport.GetImage();
+    if (!viewport.HasImage()) return 0;
+
+    size_t scanned = 0;
+    if (!imageValid || image->width != imageWidth || image->height != imageHeight) {
+        auto start = std::chrono::steady_clock::now();
+        ComputeHistogram(*image, 0, 0, image->width, image->height, GetWorkers(), imageHistogram);
+        imageMs = MillisecondsSince(start);
+        imageWidth = image->width;
+        imageHeight = image->height;
+        imageValid = true;
+        fullWidth = viewport.GetImageWidth();
+        fullHeight = viewport.GetImageHeight();
+        preview = imageWidth < fullWidth || imageHeight < fullHeight;
+        visible.Reset();
+        scanned += imageHistogram.pixels;
+    }
+
+    int x = 0;
+    int y = 0;
+    int width = 0;
+    int height = 0;
+    viewport.GetVisibleRect(viewWidth, viewHeight, x, y, width, height);
+    auto start = std::chrono::steady_clock::now();
+    size_t region = visible.Update(*image, x, y, width, height, GetWorkers());
+    if (region > 0) {
+        visibleMs = MillisecondsSince(start);
+        visibleScanned = region;
+    }
+    return scanned + region;
+}
+
+void ImageStatsPanel::Draw(PlatformCanvas& canvas, int viewWidth) const {
+    if (!imageValid) return;
+    const Surface& target = canvas.GetSurface();
+    const ImageHistogram& region = visible.Get();
+    bool hasAlpha = SummarizeChannel(imageHistogram, ImageHistogram::ALPHA).min < 255;
+    int lines = 6 + (hasAlpha ? 1 : 0);
+    int left = std::max(0, viewWidth - WIDTH - MARGIN);
+    int top = MARGIN;
+    FillSurfaceRect(target, left, top, WIDTH, 2 * MARGIN + HISTOGRAM_HEIGHT + lines * LINE_HEIGHT + MARGIN / 2,
+                    BACKGROUND);
+
+    // Высота столбца — от самого высокого столбца без 0 и 255: пики обрезанных
+    // значений иначе прижали бы всё остальное к оси
+    uint64_t peak = 1;
+    for (int channel : CHANNEL_ORDER) {
+        for (int value = 1; value < 255; ++value) peak = std::max(peak, region.counts[channel][value]);
+    }
+    int histogramLeft = left + (WIDTH - 256) / 2;
+    int histogramBottom = top + MARGIN + HISTOGRAM_HEIGHT;
+    for (int value = 0; value < 256; ++value) {
+        int x = histogramLeft + value;
+        if (x < 0 || x >= target.width) continue;
+        int heights[3];
+        for (int i = 0; i < 3; ++i) {
+            uint64_t count = region.counts[CHANNEL_ORDER[i]][value];
+            heights[i] = static_cast<int>(std::min<uint64_t>(count * HISTOGRAM_HEIGHT / peak, HISTOGRAM_HEIGHT));
+        }
+        for (int row = 0; row < HISTOGRAM_HEIGHT; ++row) {
+            int y = histogramBottom - 1 - row;
+            if (y < 0 || y >= target.height) continue;
+            uint32_t color = BACKGROUND;
+            for (int i = 0; i < 3; ++i) {
+                if (row < heights[i]) color |= CHANNEL_COLORS[i];
+            }
+            reinterpret_cast<uint32_t*>(target.pixels + static_cast<size_t>(y) * target.stride)[x] = color;
+        }
+    }
+
+    wchar_t text[160];
+    int textLeft = left + MARGIN;
+    int y = histogramBottom + MARGIN / 2;
+    std::swprintf(text, 160, L"Visible %dx%d: %.2f ms, %zu px scanned", visible.GetWidth(), visible.GetHeight(),
+                  visibleMs, visibleScanned);
+    canvas.DrawString(textLeft, y, text, TEXT_COLOR);
+    y += LINE_HEIGHT;
+    for (int i = 0; i < 3 + (hasAlpha ? 1 : 0); ++i) {
+        int channel = i < 3 ? CHANNEL_ORDER[i] : static_cast<int>(ImageHistogram::ALPHA);
+        ChannelSummary summary = SummarizeChannel(region, channel);
+        std::swprintf(text, 160, L"%lc  %3d-%3d  mean %5.1f  clip %.2f%% / %.2f%%", i < 3 ? CHANNEL_NAMES[i] : L'A',
+                      summary.min, summary.max, summary.mean, Percent(summary.clippedLow, region.pixels),
+                      Percent(summary.clippedHigh, region.pixels));
+        canvas.DrawString(textLeft, y, text, TEXT_COLOR);
+        y += LINE_HEIGHT;
+    }
+    if (preview) {
+        std::swprintf(text, 160, L"Preview %dx%d of %dx%d: %.1f ms", imageWidth, imageHeight, fullWidth, fullHeight,
+                      imageMs);
+    }
+    else {
+        std::swprintf(text, 160, L"Image %dx%d: %.1f ms", imageWidth, imageHeight, imageMs);
+    }
+    canvas.DrawString(textLeft, y, text, TEXT_COLOR);
+    y += LINE_HEIGHT;
+    std::swprintf(text, 160, L"mean R %.1f  G %.1f  B %.1f",
+                  SummarizeChannel(imageHistogram, ImageHistogram::RED).mean,
+                  SummarizeChannel(imageHistogram, ImageHistogram::GREEN).mean,
+                  SummarizeChannel(imageHistogram, ImageHistogram::BLUE).mean);
+    canvas.DrawString(textLeft, y, text, TEXT_COLOR);
+}
@@ -0,0 +1,55 @@
+#ifndef IMAGESTATSPANEL_H
+#define IMAGESTATSPANEL_H
+
+#include <memory>
+
+#include "../common/ImageStats.h"
+#include "../common/Platform.h"
+#include "../common/ThreadPool.h"
+#include "ImageViewport.h"
+
+// Панель статистики в правом верхнем углу вида: гистограммы R, G, B видимой части,
+// min/max/среднее и доля обрезанных (0 и 255) значений по каналам, ниже — среднее
+// по всему изображению. Видимая часть при панорамировании пересчитывается только
+// по вошедшим и вышедшим полосам (RegionHistogram), всё изображение — один раз,
+// параллельно по полосам строк. Без оконной системы: рисует в PlatformCanvas.
+// Считается по тому, что лежит в виде; пока там превью меньше полного размера,
+// панель подписана как превью — полное изображение подгружает окно.
+class ImageStatsPanel {
+ public:
+  static const int WIDTH = 272;
+  static const int MARGIN = 8;
+  static const int HISTOGRAM_HEIGHT = 80;
+  static const int LINE_HEIGHT = 16;
+
+  // Пиксели изображения поменялись на месте или пришло другое изображение
+  // (пул может выдать тот же буфер)
+  void InvalidatePixels();
+  // Возвращает число просканированных пикселей
+  size_t Update(const ImageViewport& viewport, int viewWidth, int viewHeight);
+  void Draw(PlatformCanvas& canvas, int viewWidth) const;
+
+  const ImageHistogram& GetImageHistogram() const { return imageHistogram; }
+  const RegionHistogram& GetVisible() const { return visible; }
+  double GetImageMs() const { return imageMs; }
+  double GetVisibleMs() const { return visibleMs; }
+  bool IsPreview() const { return preview; }
+
+ private:
+  ThreadPool* GetWorkers();
+
+  std::unique_ptr<ThreadPool> workers;  // создаётся при первом пересчёте
+  ImageHistogram imageHistogram;
+  bool imageValid = false;
+  int imageWidth = 0;
+  int imageHeight = 0;
+  double imageMs = 0.0;
+  bool preview = false;  // посчитано по уменьшенной копии, а не по полному изображению
+  int fullWidth = 0;
+  int fullHeight = 0;
+  RegionHistogram visible;
+  double visibleMs = 0.0;
+  size_t visibleScanned = 0;
+};
+
+#endif  // IMAGESTATSPANEL_H
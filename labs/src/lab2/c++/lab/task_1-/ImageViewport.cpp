@@ -0,0 +1,120 @@
+#include "ImageViewport.h"
+#include <algorithm>
+#include <cmath>
+
+#include "../common/SurfaceDraw.h"
+#include "../common/Trace.h"
+
+ImageViewport::ImageViewport()
+    : image(nullptr), imageWidth(0), imageHeight(0), zoom(1.0), imageOffsetX(0), imageOffsetY(0),
+      isDragging(false), dragStartX(0), dragStartY(0) {}
+
+void ImageViewport::SetImage(const Surface* newImage, int fullWidth, int fullHeight, double newZoom) {
+    image = newImage;
+    imageWidth = newImage ? fullWidth : 0;
+    imageHeight = newImage ? fullHeight : 0;
+    zoom = newImage ? newZoom : 1.0;
+}
+
+void ImageViewport::Center(int viewWidth, int viewHeight) {
+    if (!HasImage()) return;
+    imageOffsetX = (viewWidth - GetDisplayWidth()) / 2;
+    imageOffsetY = (viewHeight - GetDisplayHeight()) / 2;
+}
+
+int ImageViewport::GetDisplayWidth() const {
+    return static_cast<int>(imageWidth * zoom + 0.5);
+}
+
+int ImageViewport::GetDisplayHeight() const {
+    return static_cast<int>(imageHeight * zoom + 0.5);
+}
+
+bool ImageViewport::NeedsFullResolution() const {
+    return HasImage() && GetDisplayWidth() > image->width && image->width < imageWidth;
+}
+
+bool ImageViewport::GetVisibleRect(int viewWidth, int viewHeight, int& x, int& y, int& width, int& height) const {
+    if (!HasImage() || GetDisplayWidth() <= 0 || GetDisplayHeight() <= 0) return false;
+    // Показываемый размер растягивает image, который может быть меньше файла
+    double scaleX = static_cast<double>(GetDisplayWidth()) / image->width;
+    double scaleY = static_cast<double>(GetDisplayHeight()) / image->height;
+    int left = std::max(0, static_cast<int>(std::floor(-imageOffsetX / scaleX)));
+    int top = std::max(0, static_cast<int>(std::floor(-imageOffsetY / scaleY)));
+    int right = std::min(image->width, static_cast<int>(std::ceil((viewWidth - imageOffsetX) / scaleX)));
+    int bottom = std::min(image->height, static_cast<int>(std::ceil((viewHeight - imageOffsetY) / scaleY)));
+    x = left;
+    y = top;
+    width = std::max(right - left, 0);
+    height = std::max(bottom - top, 0);
+    return width > 0 && height > 0;
+}
+
+void ImageViewport::Render(const Surface& target, int width, int height) const {
+    RenderSource(target, HasImage() ? *image : Surface(), width, height);
+}
+
+void ImageViewport::RenderSource(const Surface& target, const Surface& source, int width, int height) const {
+    TRACE_SCOPE("RenderViewport");
+    DrawSurfaceChessboard(target, width, height, 20, 0xFFC8C8C8, 0xFFFFFFFF);
+    if (HasImage() && source.pixels) {
+        // Кадр может быть меньше поверхности: рисуем только в его пределах
+        Surface view = target;
+        view.width = std::min(width, target.width);
+        view.height = std::min(height, target.height);
+        int displayWidth = static_cast<int>(static_cast<int64_t>(GetDisplayWidth()) * source.width / image->width);
+        int displayHeight = static_cast<int>(static_cast<int64_t>(GetDisplayHeight()) * source.height / image->height);
+        DrawSurfaceScaled(view, source, imageOffsetX, imageOffsetY, displayWidth, displayHeight);
+    }
+}
+
+void ImageViewport::Zoom(int delta, int x, int y) {
+    double factor = delta > 0 ? 1.25 : 1.0 / 1.25;
+    double newZoom = std::clamp(zoom * factor, MIN_ZOOM, MAX_ZOOM);
+
+    // Точка под курсором остаётся на месте
+    imageOffsetX = x - static_cast<int>((x - imageOffsetX) * newZoom / zoom);
+    imageOffsetY = y - static_cast<int>((y - imageOffsetY) * newZoom / zoom);
+    zoom = newZoom;
+}
+
+void ImageViewport::OnEvent(const PlatformEvent& event, PlatformHost& host) {
+    switch (event.type) {
+    case PlatformEvent::MouseDown:
+        isDragging = true;
+        dragStartX = event.x;
+        dragStartY = event.y;
+        host.SetCapture(true);
+        break;
+    case PlatformEvent::MouseUp:
+        isDragging = false;
+        host.SetCapture(false);
+        break;
+    case PlatformEvent::MouseMove:
+        if (isDragging) {
+            imageOffsetX += event.x - dragStartX;
+            imageOffsetY += event.y - dragStartY;
+            dragStartX = event.x;
+            dragStartY = event.y;
+            host.Invalidate();
+        }
+        break;
+    case PlatformEvent::MouseWheel:
+        if (HasImage() && event.wheelDelta != 0) {
+            Zoom(event.wheelDelta, event.x, event.y);
+            host.Invalidate();
+        }
+        break;
+    case PlatformEvent::Resize:
+        Center(event.width, event.height);
+        host.Invalidate();
+        break;
+    default:
+        break;
+    }
+}
+
+void ImageViewport::OnPaint(PlatformCanvas& canvas) {
+    const Surface& target = canvas.GetSurface();
+    Render(target, target.width, target.height);
+}
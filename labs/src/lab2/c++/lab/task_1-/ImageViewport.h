@@ -0,0 +1,61 @@
+#ifndef IMAGEVIEWPORT_H
+#define IMAGEVIEWPORT_H
+
+#include "../common/Platform.h"
+
+// Вид на одно изображение: перетаскивание мышью, масштаб колесом вокруг курсора,
+// центрирование, шахматная подложка под прозрачностью. Без оконной системы:
+// ImageApp отдаёт сюда ввод своего окна, headless — события из сценария.
+class ImageViewport : public PlatformApp {
+ public:
+  static constexpr double MIN_ZOOM = 0.01;
+  static constexpr double MAX_ZOOM = 32.0;
+
+  ImageViewport();
+
+  // image принадлежит вызывающему и должен жить, пока вид его показывает; он может
+  // быть уменьшенным превью файла размером fullWidth x fullHeight. zoom — экранных
+  // пикселей на пиксель файла. nullptr — изображения нет.
+  void SetImage(const Surface* image, int fullWidth, int fullHeight, double zoom);
+  void Center(int viewWidth, int viewHeight);
+  void CancelDrag() { isDragging = false; }
+  // Кадр width x height в левом верхнем углу target
+  void Render(const Surface& target, int width, int height) const;
+  // То же для другого изображения с тем же сдвигом и масштабом: так сравнение
+  // показывает второе изображение и разность. Показываемый размер — в той же
+  // пропорции к размеру image, что и размер source.
+  void RenderSource(const Surface& target, const Surface& source, int width, int height) const;
+
+  bool HasImage() const { return image && image->pixels; }
+  const Surface* GetImage() const { return image; }
+  // Часть image, видимая в окне viewWidth x viewHeight, в пикселях image
+  bool GetVisibleRect(int viewWidth, int viewHeight, int& x, int& y, int& width, int& height) const;
+  bool IsDragging() const { return isDragging; }
+  // Показываемый размер больше декодированного: стоит декодировать полный размер
+  bool NeedsFullResolution() const;
+  int GetImageWidth() const { return imageWidth; }
+  int GetImageHeight() const { return imageHeight; }
+  int GetDisplayWidth() const;
+  int GetDisplayHeight() const;
+  double GetZoom() const { return zoom; }
+  int GetOffsetX() const { return imageOffsetX; }
+  int GetOffsetY() const { return imageOffsetY; }
+
+  void OnEvent(const PlatformEvent& event, PlatformHost& host) override;
+  void OnPaint(PlatformCanvas& canvas) override;
+
+ private:
+  void Zoom(int delta, int x, int y);
+
+  const Surface* image;
+  int imageWidth;  // полный размер файла
+  int imageHeight;
+  double zoom;
+  int imageOffsetX;
+  int imageOffsetY;
+  bool isDragging;
+  int dragStartX;
+  int dragStartY;
+};
+
+#endif  // IMAGEVIEWPORT_H
@@ -0,0 +1,194 @@
+#include "ThumbnailGrid.h"
+#include <algorithm>
+
+#include "../common/ImageCodec.h"
+#include "../common/MemoryAccounting.h"
+#include "../common/Resample.h"
+#include "../common/Trace.h"
+
+namespace {
+const int CELL_WIDTH = 150;
+const int CELL_HEIGHT = 170;
+const int LABEL_HEIGHT = 20;
+
+size_t BackgroundThreadCount() {
+    size_t cores = ThreadPool::DefaultThreadCount();
+    return cores > 1 ? cores - 1 : 1;
+}
+}  // namespace
+
+ThumbnailGrid::ThumbnailGrid(ThumbnailCache& cache)
+    : cache(cache), workers(BackgroundThreadCount()), notifyWindow(nullptr), scrollY(0), firstVisible(0),
+      lastVisible(0), folderGeneration(0), notifyPosted(false) {}
+
+ThumbnailGrid::~ThumbnailGrid() {
+    folderGeneration++;
+    workers.WaitIdle();
+}
+
+void ThumbnailGrid::SetFolder(HWND hwnd, const std::filesystem::path& folder) {
+    // Задачи прежней папки доработают вхолостую: поколение уже другое
+    folderGeneration++;
+    {
+        std::lock_guard<std::mutex> lock(pendingMutex);
+        pending.clear();
+        failed.clear();
+    }
+    workers.WaitIdle();
+
+    notifyWindow = hwnd;
+    entries.clear();
+    scrollY = 0;
+
+    std::error_code error;
+    for (const auto& entry : std::filesystem::directory_iterator(folder, error)) {
+        if (!entry.is_regular_file(error)) continue;
+        ImageFormat format = FormatFromPath(entry.path());
+        if (format == ImageFormat::Unknown || format == ImageFormat::Ppm) continue;
+
+        Entry item;
+        item.path = entry.path();
+        item.label = entry.path().filename().wstring();
+        if (!ThumbnailCache::MakeKey(entry, item.key)) continue;
+        entries.push_back(std::move(item));
+    }
+    std::sort(entries.begin(), entries.end(), [](const Entry& a, const Entry& b) { return a.label < b.label; });
+}
+
+int ThumbnailGrid::GetColumns(int viewWidth) const {
+    return std::max(1, viewWidth / CELL_WIDTH);
+}
+
+void ThumbnailGrid::Scroll(int delta, int viewWidth, int viewHeight) {
+    int rows = (static_cast<int>(entries.size()) + GetColumns(viewWidth) - 1) / GetColumns(viewWidth);
+    int maxScroll = std::max(0, rows * CELL_HEIGHT - viewHeight);
+    scrollY = std::clamp(scrollY - delta, 0, maxScroll);
+}
+
+int ThumbnailGrid::HitTest(int x, int y, int viewWidth) const {
+    int columns = GetColumns(viewWidth);
+    int column = x / CELL_WIDTH;
+    if (x < 0 || column >= columns) return -1;
+    int row = (y + scrollY) / CELL_HEIGHT;
+    size_t index = static_cast<size_t>(row) * columns + column;
+    return y >= 0 && index < entries.size() ? static_cast<int>(index) : -1;
+}
+
+void ThumbnailGrid::Draw(Gdiplus::Graphics& graphics, int width, int height) {
+    TRACE_SCOPE("ThumbnailGrid::Draw");
+    Gdiplus::SolidBrush background(Gdiplus::Color(255, 48, 48, 48));
+    graphics.FillRectangle(&background, 0, 0, width, height);
+    if (entries.empty()) return;
+
+    int columns = GetColumns(width);
+    size_t firstRow = static_cast<size_t>(scrollY / CELL_HEIGHT);
+    size_t lastRow = static_cast<size_t>((scrollY + height) / CELL_HEIGHT);
+    size_t first = firstRow * columns;
+    size_t last = std::min(entries.size() - 1, (lastRow + 1) * columns - 1);
+    firstVisible = first;
+    lastVisible = last;
+
+    Gdiplus::SolidBrush placeholder(Gdiplus::Color(255, 80, 80, 80));
+    Gdiplus::SolidBrush failedPlaceholder(Gdiplus::Color(255, 96, 56, 56));
+    Gdiplus::SolidBrush textBrush(Gdiplus::Color(255, 230, 230, 230));
+    Gdiplus::Font font(L"Segoe UI", 9);
+    Gdiplus::StringFormat format;
+    format.SetAlignment(Gdiplus::StringAlignmentCenter);
+    format.SetTrimming(Gdiplus::StringTrimmingEllipsisCharacter);
+    format.SetFormatFlags(Gdiplus::StringFormatFlagsNoWrap);
+
+    for (size_t i = first; i <= last; ++i) {
+        int cellX = static_cast<int>(i % columns) * CELL_WIDTH;
+        int cellY = static_cast<int>(i / columns) * CELL_HEIGHT - scrollY;
+        int boxX = cellX + (CELL_WIDTH - THUMBNAIL_SIZE) / 2;
+        int boxY = cellY + (CELL_HEIGHT - LABEL_HEIGHT - THUMBNAIL_SIZE) / 2;
+
+        ThumbnailView view;
+        if (cache.Find(entries[i].key, view)) {
+            // Обёртка над памятью кэша: пиксели не копируются
+            Gdiplus::Bitmap thumbnail(view.width, view.height, view.stride, PixelFormat32bppARGB,
+                                      const_cast<BYTE*>(view.pixels));
+            graphics.DrawImage(&thumbnail, boxX + (THUMBNAIL_SIZE - view.width) / 2,
+                               boxY + (THUMBNAIL_SIZE - view.height) / 2, view.width, view.height);
+        }
+        else if (IsFailed(i)) {
+            graphics.FillRectangle(&failedPlaceholder, boxX, boxY, THUMBNAIL_SIZE, THUMBNAIL_SIZE);
+        }
+        else {
+            graphics.FillRectangle(&placeholder, boxX, boxY, THUMBNAIL_SIZE, THUMBNAIL_SIZE);
+            RequestThumbnail(i);
+        }
+
+        Gdiplus::RectF labelRect(static_cast<Gdiplus::REAL>(cellX + 4),
+                                 static_cast<Gdiplus::REAL>(cellY + CELL_HEIGHT - LABEL_HEIGHT),
+                                 static_cast<Gdiplus::REAL>(CELL_WIDTH - 8), static_cast<Gdiplus::REAL>(LABEL_HEIGHT));
+        graphics.DrawString(entries[i].label.c_str(), -1, &font, labelRect, &format, &textBrush);
+    }
+}
+
+bool ThumbnailGrid::IsFailed(size_t index) {
+    std::lock_guard<std::mutex> lock(pendingMutex);
+    return failed.count(index) != 0;
+}
+
+void ThumbnailGrid::RequestThumbnail(size_t index) {
+    {
+        std::lock_guard<std::mutex> lock(pendingMutex);
+        if (failed.count(index) || !pending.insert(index).second) return;
+    }
+    unsigned generation = folderGeneration;
+    workers.Submit([this, index, generation]() { BuildThumbnail(index, generation); });
+}
+
+void ThumbnailGrid::BuildThumbnail(size_t index, unsigned generation) {
+    if (generation != folderGeneration) return;
+
+    // Ячейку успели прокрутить — забываем запрос, при следующем показе он придёт снова
+    if (index < firstVisible || index > lastVisible) {
+        std::lock_guard<std::mutex> lock(pendingMutex);
+        pending.erase(index);
+        return;
+    }
+
+    TRACE_SCOPE("BuildThumbnail");
+    MEMORY_TAG_SCOPE(MEMORY_CACHES);
+    static thread_local bool comReady = SUCCEEDED(CoInitializeEx(nullptr, COINIT_MULTITHREADED));
+    (void)comReady;
+
+    // JPEG и PNG приходят уже уменьшенными, BMP доуменьшаем сами
+    SurfacePool& pool = SurfacePool::Instance();
+    const Entry& entry = entries[index];
+    Surface decoded;
+    bool built = false;
+    if (ReadImage(entry.path, THUMBNAIL_SIZE, THUMBNAIL_SIZE, decoded)) {
+        int width = 0;
+        int height = 0;
+        FitSize(decoded.width, decoded.height, THUMBNAIL_SIZE, THUMBNAIL_SIZE, width, height);
+        Surface thumbnail;
+        if (width == decoded.width && height == decoded.height) {
+            built = cache.Insert(entry.key, decoded);
+        }
+        else if (ResampleSurface(decoded, width, height, thumbnail)) {
+            built = cache.Insert(entry.key, thumbnail);
+            pool.Release(thumbnail);
+        }
+        pool.Release(decoded);
+    }
+
+    // Миниатюра уже в кэше, а битый файл рисуется отдельной плашкой и больше не декодируется
+    {
+        std::lock_guard<std::mutex> lock(pendingMutex);
+        if (generation == folderGeneration) {
+            pending.erase(index);
+            if (!built) failed.insert(index);
+        }
+    }
+
+    if (generation == folderGeneration && !notifyPosted.exchange(true)) {
+        PostMessage(notifyWindow, WM_APP_THUMBNAILS_READY, 0, 0);
+    }
+}
+
+void ThumbnailGrid::OnThumbnailsReady() {
+    notifyPosted = false;
+}
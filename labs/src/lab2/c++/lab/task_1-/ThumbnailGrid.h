@@ -0,0 +1,62 @@
+#ifndef THUMBNAILGRID_H
+#define THUMBNAILGRID_H
+
+#include <windows.h>
+#include <gdiplus.h>
+#include <atomic>
+#include <filesystem>
+#include <mutex>
+#include <string>
+#include <unordered_set>
+#include <vector>
+
+#include "../common/ThreadPool.h"
+#include "../common/ThumbnailCache.h"
+
+// Сетка миниатюр папки. Рисуются только видимые ячейки; недостающие
+// миниатюры строятся фоном и сохраняются в ThumbnailCache, после чего окну
+// уходит WM_APP_THUMBNAILS_READY.
+class ThumbnailGrid {
+ public:
+  static const UINT WM_APP_THUMBNAILS_READY = WM_APP + 2;
+  static const int THUMBNAIL_SIZE = 128;
+
+  explicit ThumbnailGrid(ThumbnailCache& cache);
+  ~ThumbnailGrid();
+
+  void SetFolder(HWND hwnd, const std::filesystem::path& folder);
+  void Draw(Gdiplus::Graphics& graphics, int width, int height);
+  void Scroll(int delta, int viewWidth, int viewHeight);
+  int HitTest(int x, int y, int viewWidth) const;
+  void OnThumbnailsReady();
+
+  size_t GetCount() const { return entries.size(); }
+  const std::filesystem::path& GetPath(int index) const { return entries[index].path; }
+
+ private:
+  struct Entry {
+    std::filesystem::path path;
+    std::wstring label;
+    uint64_t key;
+  };
+
+  int GetColumns(int viewWidth) const;
+  bool IsFailed(size_t index);
+  void RequestThumbnail(size_t index);
+  void BuildThumbnail(size_t index, unsigned generation);
+
+  ThumbnailCache& cache;
+  ThreadPool workers;
+  HWND notifyWindow;
+  std::vector<Entry> entries;
+  int scrollY;
+  std::mutex pendingMutex;
+  std::unordered_set<size_t> pending;
+  std::unordered_set<size_t> failed;  // не декодировались; до смены папки не запрашиваются
+  std::atomic<size_t> firstVisible;
+  std::atomic<size_t> lastVisible;
+  std::atomic<unsigned> folderGeneration;
+  std::atomic<bool> notifyPosted;
+};
+
+#endif  // THUMBNAILGRID_H
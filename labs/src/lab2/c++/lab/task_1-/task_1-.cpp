@@ -4,18 +4,21 @@
 #include <iostream>
 #include <string>
 
+#include "../common/MemoryAccounting.h"
+#include "../common/PooledBitmap.h"
+
 #pragma comment(lib, "gdiplus.lib")
 
 using namespace Gdiplus;
 
 //не использовать глобальные переменные
 HWND hWnd;
-Bitmap *g_pBitmap = nullptr;
+PooledBitmap g_image;  // пиксели в SurfacePool: учитываются как память просмотрщика
 int g_imageOffsetX = 0;
 int g_imageOffsetY = 0;
 bool g_isDragging = false;
 POINT g_dragStart;
-Bitmap *g_pBackBuffer = nullptr;
+PooledBitmap g_backBuffer;
 
 LRESULT CALLBACK WndProc(HWND, UINT, WPARAM, LPARAM);
 void OnPaint(HWND hwnd);
@@ -26,6 +29,8 @@ void CreateBackBuffer(HWND hwnd);
 
 int APIENTRY wWinMain(_In_ HINSTANCE hInstance, _In_opt_ HINSTANCE hPrevInstance, _In_ LPWSTR lpCmdLine, _In_ int nCmdShow)
 {
+    MemoryReportInitFromEnvironment();
+
     GdiplusStartupInput gdiplusStartupInput;
     ULONG_PTR gdiplusToken;
     GdiplusStartup(&gdiplusToken, &gdiplusStartupInput, nullptr);
@@ -52,7 +57,11 @@ int APIENTRY wWinMain(_In_ HINSTANCE hInstance, _In_opt_ HINSTANCE hPrevInstance
         DispatchMessage(&msg);
     }
 
+    // Оба Bitmap удаляются до GdiplusShutdown; изображение раньше не удалялось вовсе
+    g_image.Release();
+    g_backBuffer.Release();
     GdiplusShutdown(gdiplusToken);
+    MemoryWriteReports();
     return (int)msg.wParam;
 }
 
@@ -155,10 +164,10 @@ void OnPaint(HWND hwnd)
     PAINTSTRUCT ps;
     HDC hdc = BeginPaint(hwnd, &ps);
 
-    if (g_pBackBuffer)
+    if (g_backBuffer)
     {
         Graphics graphics(hdc);
-        graphics.DrawImage(g_pBackBuffer, 0, 0);
+        graphics.DrawImage(g_backBuffer.Get(), 0, 0);
     }
 
     EndPaint(hwnd, &ps);
@@ -166,24 +175,15 @@ void OnPaint(HWND hwnd)
 
 void LoadImage(HWND hwnd, const std::wstring &filePath)
 {
-    if (g_pBitmap)
-    {
-        delete g_pBitmap;
-        g_pBitmap = nullptr;
-    }
-    g_pBitmap = new Bitmap(filePath.c_str());
-    if (g_pBitmap->GetLastStatus() != Ok)
-    {
-        delete g_pBitmap;
-        g_pBitmap = nullptr;
-    }
+    MEMORY_TAG_SCOPE(MEMORY_VIEWER);
+    g_image.LoadFromFile(filePath);
     CreateBackBuffer(hwnd);
     InvalidateRect(hwnd, nullptr, TRUE);
 }
 
 void CenterImage(HWND hwnd)
 {
-    if (!g_pBitmap)
+    if (!g_image)
         return;
 
     RECT rect;
@@ -192,8 +192,8 @@ void CenterImage(HWND hwnd)
     int windowWidth = rect.right - rect.left;
     int windowHeight = rect.bottom - rect.top;
 
-    int imageWidth = g_pBitmap->GetWidth();
-    int imageHeight = g_pBitmap->GetHeight();
+    int imageWidth = g_image.GetWidth();
+    int imageHeight = g_image.GetHeight();
 
     g_imageOffsetX = (windowWidth - imageWidth) / 2;
     g_imageOffsetY = (windowHeight - imageHeight) / 2;
@@ -218,28 +218,22 @@ void DrawChessboard(Graphics &graphics, int width, int height)
 
 void CreateBackBuffer(HWND hwnd)
 {
-    // использовать умные указатели
-    if (g_pBackBuffer)
-    {
-        delete g_pBackBuffer;
-        g_pBackBuffer = nullptr;
-    }
-
     RECT rect;
     GetClientRect(hwnd, &rect);
     int width = rect.right - rect.left;
     int height = rect.bottom - rect.top;
 
-    if (width > 0 && height > 0)
+    // Буфер того же размера переиспользуется, новый берётся из пула
+    MEMORY_TAG_SCOPE(MEMORY_FRAMES);
+    if (width > 0 && height > 0 && g_backBuffer.Reset(width, height))
     {
-        g_pBackBuffer = new Bitmap(width, height, PixelFormat32bppARGB);
-        Graphics graphics(g_pBackBuffer);
+        Graphics graphics(g_backBuffer.Get());
 
         DrawChessboard(graphics, width, height);
 
-        if (g_pBitmap)
+        if (g_image)
         {
-            graphics.DrawImage(g_pBitmap, g_imageOffsetX, g_imageOffsetY, g_pBitmap->GetWidth(), g_pBitmap->GetHeight());
+            graphics.DrawImage(g_image.Get(), g_imageOffsetX, g_imageOffsetY, g_image.GetWidth(), g_image.GetHeight());
         }
     }
 }
\ No newline at end of file
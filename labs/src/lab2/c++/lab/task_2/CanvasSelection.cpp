@@ -0,0 +1,310 @@
+#include "CanvasSelection.h"
+#include <algorithm>
+#include <cstdlib>
+
+#include "../common/SurfaceDraw.h"
+#include "../common/Trace.h"
+
+namespace
+{
+    const uint8_t ALL_FRAMES = (1u << CanvasSelection::FRAME_COUNT) - 1;
+    const uint32_t OUTLINE_DARK = 0xFF000000;
+    const uint32_t OUTLINE_LIGHT = 0xFFFFFFFF;
+
+    bool Intersect(int &rectX, int &rectY, int &rectWidth, int &rectHeight, int width, int height)
+    {
+        int left = std::max(rectX, 0);
+        int top = std::max(rectY, 0);
+        int right = std::min(rectX + rectWidth, width);
+        int bottom = std::min(rectY + rectHeight, height);
+        rectX = left;
+        rectY = top;
+        rectWidth = std::max(right - left, 0);
+        rectHeight = std::max(bottom - top, 0);
+        return rectWidth > 0 && rectHeight > 0;
+    }
+}
+
+CanvasSelection::CanvasSelection()
+    : x(0), y(0), width(0), height(0), canvasEdited(false), writeLeft(0), writeTop(0), writeRight(0), writeBottom(0),
+      tilesX(0), tilesY(0)
+{
+}
+
+CanvasSelection::~CanvasSelection()
+{
+    Clear();
+}
+
+void CanvasSelection::Attach(const Surface &newCanvas)
+{
+    Release();
+    canvas = newCanvas;
+    tiles.Attach(canvas);
+    tilesX = (canvas.width + TILE_SIZE - 1) / TILE_SIZE;
+    tilesY = (canvas.height + TILE_SIZE - 1) / TILE_SIZE;
+    staleFrames.assign((size_t)tilesX * tilesY, ALL_FRAMES);
+    canvasEdited = false;
+    writeRight = writeLeft;
+}
+
+void CanvasSelection::Release()
+{
+    floating.Clear();
+    tiles.Release();
+    canvas = Surface();
+    width = 0;
+    height = 0;
+    tilesX = 0;
+    tilesY = 0;
+    staleFrames.clear();
+}
+
+void CanvasSelection::Clear()
+{
+    clipboard.Clear();
+    Release();
+}
+
+void CanvasSelection::BeforeCanvasWrite(int rectX, int rectY, int rectWidth, int rectHeight)
+{
+    tiles.Detach(rectX, rectY, rectWidth, rectHeight);
+    MarkRect(rectX, rectY, rectWidth, rectHeight);
+}
+
+void CanvasSelection::Select(int x0, int y0, int x1, int y1)
+{
+    Commit();
+    MarkOutline();
+    x = std::min(x0, x1);
+    y = std::min(y0, y1);
+    width = std::abs(x1 - x0);
+    height = std::abs(y1 - y0);
+    Intersect(x, y, width, height, canvas.width, canvas.height);
+    MarkOutline();
+}
+
+void CanvasSelection::Deselect()
+{
+    Commit();
+    MarkOutline();
+    width = 0;
+    height = 0;
+}
+
+bool CanvasSelection::Copy()
+{
+    if (!HasSelection())
+        return false;
+    if (HasFloating())
+    {
+        clipboard = floating;
+        return true;
+    }
+    return tiles.View(x, y, width, height, clipboard);
+}
+
+bool CanvasSelection::Cut(uint32_t background)
+{
+    if (!Copy())
+        return false;
+    // Плавающее выделение ещё не в холсте: достаточно его убрать
+    if (HasFloating())
+    {
+        floating.Clear();
+    }
+    else
+    {
+        tiles.Detach(x, y, width, height);
+        FillSurfaceRect(canvas, x, y, width, height, background);
+        AddCanvasWrite(x, y, width, height);
+    }
+    MarkRect(x, y, width, height);
+    width = 0;
+    height = 0;
+    return true;
+}
+
+bool CanvasSelection::Paste(int pasteX, int pasteY)
+{
+    if (!HasClipboard() || !canvas.pixels)
+        return false;
+    Commit();
+    MarkOutline();
+    floating = clipboard;
+    x = pasteX;
+    y = pasteY;
+    width = floating.GetWidth();
+    height = floating.GetHeight();
+    MarkRect(x, y, width, height);
+    return true;
+}
+
+void CanvasSelection::MoveFloating(int newX, int newY)
+{
+    if (!HasFloating() || (newX == x && newY == y))
+        return;
+    MarkRect(x, y, width, height);
+    x = newX;
+    y = newY;
+    MarkRect(x, y, width, height);
+}
+
+bool CanvasSelection::Commit()
+{
+    if (!HasFloating())
+        return false;
+
+    // Кадр уже показывает выделение поверх холста, перерисовывать нужно только
+    // рамку, если её обрезает край холста
+    MarkOutline();
+    int targetX = x;
+    int targetY = y;
+    int targetWidth = width;
+    int targetHeight = height;
+    if (Intersect(targetX, targetY, targetWidth, targetHeight, canvas.width, canvas.height))
+    {
+        // Плитки под вставкой, на которые смотрит и само выделение, копируются до записи
+        tiles.Detach(targetX, targetY, targetWidth, targetHeight);
+        floating.CopyRectTo(canvas, targetX, targetY, targetX - x, targetY - y, targetWidth, targetHeight);
+        AddCanvasWrite(targetX, targetY, targetWidth, targetHeight);
+    }
+    floating.Clear();
+    x = targetX;
+    y = targetY;
+    width = targetWidth;
+    height = targetHeight;
+    MarkOutline();
+    return true;
+}
+
+bool CanvasSelection::Contains(int pointX, int pointY) const
+{
+    return HasSelection() && pointX >= x && pointX < x + width && pointY >= y && pointY < y + height;
+}
+
+bool CanvasSelection::TakeCanvasWrites(int &writeX, int &writeY, int &writeWidth, int &writeHeight)
+{
+    if (writeRight <= writeLeft)
+        return false;
+    writeX = writeLeft;
+    writeY = writeTop;
+    writeWidth = writeRight - writeLeft;
+    writeHeight = writeBottom - writeTop;
+    writeRight = writeLeft;
+    return true;
+}
+
+void CanvasSelection::AddCanvasWrite(int rectX, int rectY, int rectWidth, int rectHeight)
+{
+    canvasEdited = true;
+    if (writeRight <= writeLeft)
+    {
+        writeLeft = rectX;
+        writeTop = rectY;
+        writeRight = rectX + rectWidth;
+        writeBottom = rectY + rectHeight;
+        return;
+    }
+    writeLeft = std::min(writeLeft, rectX);
+    writeTop = std::min(writeTop, rectY);
+    writeRight = std::max(writeRight, rectX + rectWidth);
+    writeBottom = std::max(writeBottom, rectY + rectHeight);
+}
+
+void CanvasSelection::MarkRect(int rectX, int rectY, int rectWidth, int rectHeight)
+{
+    if (!Intersect(rectX, rectY, rectWidth, rectHeight, canvas.width, canvas.height))
+        return;
+    for (int tileY = rectY / TILE_SIZE; tileY <= (rectY + rectHeight - 1) / TILE_SIZE; tileY++)
+        for (int tileX = rectX / TILE_SIZE; tileX <= (rectX + rectWidth - 1) / TILE_SIZE; tileX++)
+            staleFrames[(size_t)tileY * tilesX + tileX] = ALL_FRAMES;
+}
+
+// Рамка занимает только крайние строки и столбцы: при её смене внутренние плитки не трогаются
+void CanvasSelection::MarkOutline()
+{
+    if (!HasSelection())
+        return;
+    MarkRect(x, y, width, 1);
+    MarkRect(x, y + height - 1, width, 1);
+    MarkRect(x, y, 1, height);
+    MarkRect(x + width - 1, y, 1, height);
+}
+
+void CanvasSelection::InvalidateFrame(int frameIndex)
+{
+    frames[frameIndex] = FrameState();
+}
+
+size_t CanvasSelection::Compose(const Surface &frame, int frameIndex)
+{
+    TRACE_SCOPE("CanvasSelection::Compose");
+    if (!canvas.pixels || frame.width != canvas.width || frame.height != canvas.height)
+        return 0;
+
+    // Новый буфер кадра (или его перерисовал вид с масштабом) собирается целиком
+    uint8_t bit = (uint8_t)(1u << frameIndex);
+    FrameState &state = frames[frameIndex];
+    if (state.pixels != frame.pixels || state.width != frame.width || state.height != frame.height)
+    {
+        for (uint8_t &stale : staleFrames)
+            stale |= bit;
+        state.pixels = frame.pixels;
+        state.width = frame.width;
+        state.height = frame.height;
+    }
+
+    size_t composed = 0;
+    for (int tileY = 0; tileY < tilesY; tileY++)
+    {
+        for (int tileX = 0; tileX < tilesX; tileX++)
+        {
+            uint8_t &stale = staleFrames[(size_t)tileY * tilesX + tileX];
+            if (stale & bit)
+            {
+                ComposeTile(frame, tileX, tileY);
+                stale &= (uint8_t)~bit;
+                composed++;
+            }
+        }
+    }
+    return composed;
+}
+
+void CanvasSelection::ComposeTile(const Surface &frame, int tileX, int tileY)
+{
+    int left = tileX * TILE_SIZE;
+    int top = tileY * TILE_SIZE;
+    int tileWidth = std::min(TILE_SIZE, canvas.width - left);
+    int tileHeight = std::min(TILE_SIZE, canvas.height - top);
+    // Плитку целиком под плавающим выделением холст не видно
+    bool covered = HasFloating() && x <= left && y <= top && x + width >= left + tileWidth &&
+                   y + height >= top + tileHeight;
+    if (!covered)
+        CopySurfaceRect(frame, left, top, canvas, left, top, tileWidth, tileHeight);
+    if (HasFloating())
+        floating.CopyRectTo(frame, left, top, left - x, top - y, tileWidth, tileHeight);
+    if (!HasSelection())
+        return;
+
+    // Пунктирная рамка по краю выделения, штрих 4 пикселя
+    int right = x + width - 1;
+    int bottom = y + height - 1;
+    auto plot = [&](int pointX, int pointY) {
+        if (pointX < left || pointX >= left + tileWidth || pointY < top || pointY >= top + tileHeight)
+            return;
+        uint32_t *pixel = (uint32_t *)(frame.pixels + (size_t)pointY * frame.stride) + pointX;
+        *pixel = ((pointX + pointY) >> 2) & 1 ? OUTLINE_DARK : OUTLINE_LIGHT;
+    };
+    for (int pointX = std::max(x, left); pointX <= std::min(right, left + tileWidth - 1); pointX++)
+    {
+        plot(pointX, y);
+        plot(pointX, bottom);
+    }
+    for (int pointY = std::max(y, top); pointY <= std::min(bottom, top + tileHeight - 1); pointY++)
+    {
+        plot(x, pointY);
+        plot(right, pointY);
+    }
+}
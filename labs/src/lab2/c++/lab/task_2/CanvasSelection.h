@@ -0,0 +1,99 @@
+#ifndef CANVASSELECTION_H
+#define CANVASSELECTION_H
+
+#include <cstdint>
+#include <vector>
+
+#include "../common/SharedTiles.h"
+
+// Прямоугольное выделение на растровом холсте task_2: копирование, вырезание и
+// вставка. Буфер обмена и плавающее (вставленное, ещё не вписанное в холст)
+// выделение — виды TileView на плитки холста, пиксели копируются только когда
+// холст пишет поверх них. Кадр для показа — копия холста с плавающим выделением
+// и рамкой поверх; для каждого из FRAME_COUNT кадров помнится, какие плитки в
+// нём устарели, и Compose() перерисовывает только их. Всё, кроме Compose(), —
+// в координатах холста; вызывающий отвечает за блокировку.
+class CanvasSelection
+{
+ public:
+  static constexpr int TILE_SIZE = CanvasTiles::TILE_SIZE;
+  static const int FRAME_COUNT = 3;
+
+  CanvasSelection();
+  ~CanvasSelection();
+  CanvasSelection(const CanvasSelection &) = delete;
+  CanvasSelection &operator=(const CanvasSelection &) = delete;
+
+  // После замены холста: выделение снимается, буфер обмена остаётся
+  void Attach(const Surface &canvas);
+  // До замены или освобождения буфера холста: виды получают свои копии
+  void Release();
+  // Всё вместе с буфером обмена; перед выходом, пока жив SurfacePool
+  void Clear();
+  // До записи в холст помимо выделения (штрихи)
+  void BeforeCanvasWrite(int x, int y, int width, int height);
+
+  // Рамка по двум углам; плавающее выделение сначала вписывается в холст
+  void Select(int x0, int y0, int x1, int y1);
+  // Вписывает плавающее выделение и снимает рамку
+  void Deselect();
+  bool Copy();
+  bool Cut(uint32_t background);
+  // Буфер обмена плавающим выделением с левым верхним углом (x, y)
+  bool Paste(int x, int y);
+  void MoveFloating(int x, int y);
+  bool Commit();
+
+  bool HasSelection() const { return width > 0 && height > 0; }
+  bool HasFloating() const { return !floating.IsEmpty(); }
+  bool HasClipboard() const { return !clipboard.IsEmpty(); }
+  bool Contains(int pointX, int pointY) const;
+  int GetX() const { return x; }
+  int GetY() const { return y; }
+  int GetWidth() const { return width; }
+  int GetHeight() const { return height; }
+  const TileView &GetClipboard() const { return clipboard; }
+  // Холст правился выделением после Attach(): штрихи его больше не описывают
+  bool IsCanvasEdited() const { return canvasEdited; }
+  // Объединение прямоугольников, записанных в холст с прошлого вызова; false — записей не было
+  bool TakeCanvasWrites(int &writeX, int &writeY, int &writeWidth, int &writeHeight);
+
+  // frame — буфер размером с холст, frameIndex < FRAME_COUNT. Возвращает число перерисованных плиток.
+  size_t Compose(const Surface &frame, int frameIndex);
+  // Кадр перерисован кем-то другим (вид с масштабом), в следующий раз — целиком
+  void InvalidateFrame(int frameIndex);
+
+ private:
+  struct FrameState
+  {
+    const uint8_t *pixels = nullptr;
+    int width = 0;
+    int height = 0;
+  };
+
+  void MarkRect(int rectX, int rectY, int rectWidth, int rectHeight);
+  void MarkOutline();
+  void AddCanvasWrite(int rectX, int rectY, int rectWidth, int rectHeight);
+  void ComposeTile(const Surface &frame, int tileX, int tileY);
+
+  CanvasTiles tiles;
+  Surface canvas;
+  TileView clipboard;
+  TileView floating;
+  int x;  // рамка выделения, у плавающего — его положение
+  int y;
+  int width;
+  int height;
+  bool canvasEdited;
+  int writeLeft;  // writeRight <= writeLeft — записей нет
+  int writeTop;
+  int writeRight;
+  int writeBottom;
+
+  int tilesX;
+  int tilesY;
+  std::vector<uint8_t> staleFrames;  // по плитке: бит i — кадр i устарел
+  FrameState frames[FRAME_COUNT];
+};
+
+#endif  // CANVASSELECTION_H
@@ -0,0 +1,182 @@
+#include "PaintSession.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+#include "../common/SurfaceDraw.h"
+#include "../common/Trace.h"
+
+namespace
+{
+    const uint32_t OUTSIDE_COLOR = 0xFFA0A0A0;  // вне страницы, как в BuildFrame у task_2
+    const uint32_t PAGE_COLOR = 0xFFFFFFFF;
+}
+
+void ViewToDocument(const StrokeView &view, int x, int y, float &documentX, float &documentY)
+{
+    documentX = (float)(view.originX + x / view.scale);
+    documentY = (float)(view.originY + y / view.scale);
+}
+
+StrokeView ZoomViewAt(const StrokeView &view, int wheelDelta, int x, int y)
+{
+    double zoom = view.scale * std::pow(1.25, wheelDelta / (double)PlatformEvent::WHEEL_STEP);
+    zoom = std::max<double>(0.25, std::min<double>(32.0, zoom));
+    return {view.originX + x / view.scale - x / zoom, view.originY + y / view.scale - y / zoom, zoom};
+}
+
+PaintSession::PaintSession(int pageWidth, int pageHeight)
+    : pageWidth(pageWidth), pageHeight(pageHeight), view{0.0, 0.0, 1.0}, color(0xFF000000), brushSize(5.0f),
+      isDrawing(false), lastX(0.0f), lastY(0.0f), tilesX(0), tilesY(0), allDirty(true), tilesRendered(0),
+      segmentsRendered(0)
+{
+}
+
+PaintSession::~PaintSession()
+{
+    SurfacePool::Instance().Release(frame);
+}
+
+void PaintSession::SetBrush(uint32_t newColor, float size)
+{
+    color = newColor;
+    brushSize = size;
+}
+
+void PaintSession::OnEvent(const PlatformEvent &event, PlatformHost &host)
+{
+    float x, y;
+    ViewToDocument(view, event.x, event.y, x, y);
+    switch (event.type)
+    {
+    case PlatformEvent::MouseDown:
+        strokes.BeginStroke(color, brushSize, x, y);
+        isDrawing = true;
+        lastX = x;
+        lastY = y;
+        break;
+    case PlatformEvent::MouseMove:
+        if (isDrawing)
+        {
+            strokes.AddPoint(x, y);
+            float radius = brushSize * 0.5f + 1.0f;
+            MarkDocumentRect(std::min(lastX, x) - radius, std::min(lastY, y) - radius, std::max(lastX, x) + radius,
+                             std::max(lastY, y) + radius);
+            lastX = x;
+            lastY = y;
+            host.Invalidate();
+        }
+        break;
+    case PlatformEvent::MouseUp:
+        isDrawing = false;
+        break;
+    case PlatformEvent::MouseWheel:
+        SetView(ZoomViewAt(view, event.wheelDelta, event.x, event.y), host);
+        break;
+    case PlatformEvent::KeyDown:
+        if (event.key == KEY_HOME)
+            SetView({0.0, 0.0, 1.0}, host);
+        break;
+    case PlatformEvent::Command:
+        if (event.command == COMMAND_NEW)
+        {
+            strokes.Clear();
+            isDrawing = false;
+            MarkAllDirty();
+            host.Invalidate();
+        }
+        break;
+    case PlatformEvent::Resize:
+        MarkAllDirty();
+        host.Invalidate();
+        break;
+    default:
+        break;
+    }
+}
+
+void PaintSession::SetView(const StrokeView &newView, PlatformHost &host)
+{
+    view = newView;
+    MarkAllDirty();
+    host.Invalidate();
+}
+
+void PaintSession::MarkAllDirty()
+{
+    allDirty = true;
+}
+
+void PaintSession::MarkDocumentRect(float left, float top, float right, float bottom)
+{
+    if (allDirty || tilesX == 0 || tilesY == 0)
+        return;
+    int firstX = (int)std::floor((left - view.originX) * view.scale) / TILE_SIZE;
+    int firstY = (int)std::floor((top - view.originY) * view.scale) / TILE_SIZE;
+    int lastX = (int)std::floor((right - view.originX) * view.scale) / TILE_SIZE;
+    int lastY = (int)std::floor((bottom - view.originY) * view.scale) / TILE_SIZE;
+    firstX = std::max(firstX, 0);
+    firstY = std::max(firstY, 0);
+    lastX = std::min(lastX, tilesX - 1);
+    lastY = std::min(lastY, tilesY - 1);
+    for (int tileY = firstY; tileY <= lastY; tileY++)
+        for (int tileX = firstX; tileX <= lastX; tileX++)
+            dirtyTiles[(size_t)tileY * tilesX + tileX] = 1;
+}
+
+void PaintSession::OnPaint(PlatformCanvas &canvas)
+{
+    TRACE_SCOPE("PaintSession::OnPaint");
+    const Surface &target = canvas.GetSurface();
+    if (target.width <= 0 || target.height <= 0)
+        return;
+
+    if (!frame.pixels || frame.width != target.width || frame.height != target.height)
+    {
+        SurfacePool::Instance().Release(frame);
+        if (!SurfacePool::Instance().Acquire(target.width, target.height, frame))
+            return;
+        tilesX = (frame.width + TILE_SIZE - 1) / TILE_SIZE;
+        tilesY = (frame.height + TILE_SIZE - 1) / TILE_SIZE;
+        allDirty = true;
+    }
+    if (allDirty)
+        dirtyTiles.assign((size_t)tilesX * tilesY, 1);
+
+    for (int tileY = 0; tileY < tilesY; tileY++)
+    {
+        for (int tileX = 0; tileX < tilesX; tileX++)
+        {
+            uint8_t &dirty = dirtyTiles[(size_t)tileY * tilesX + tileX];
+            if (dirty)
+            {
+                RenderTile(tileX, tileY);
+                dirty = 0;
+            }
+        }
+    }
+    allDirty = false;
+
+    for (int y = 0; y < frame.height; y++)
+        memcpy(target.pixels + (size_t)y * target.stride, frame.pixels + (size_t)y * frame.stride, (size_t)frame.width * 4);
+}
+
+void PaintSession::RenderTile(int tileX, int tileY)
+{
+    int left = tileX * TILE_SIZE;
+    int top = tileY * TILE_SIZE;
+    int right = std::min(left + TILE_SIZE, frame.width);
+    int bottom = std::min(top + TILE_SIZE, frame.height);
+
+    // Фон плитки: страница документа белая, всё вне её серое
+    FillSurfaceRect(frame, left, top, right - left, bottom - top, OUTSIDE_COLOR);
+    int pageLeft = std::max(left, (int)std::ceil(-view.originX * view.scale));
+    int pageTop = std::max(top, (int)std::ceil(-view.originY * view.scale));
+    int pageRight = std::min(right, (int)std::ceil((pageWidth - view.originX) * view.scale));
+    int pageBottom = std::min(bottom, (int)std::ceil((pageHeight - view.originY) * view.scale));
+    if (pageLeft < pageRight && pageTop < pageBottom)
+        FillSurfaceRect(frame, pageLeft, pageTop, pageRight - pageLeft, pageBottom - pageTop, PAGE_COLOR);
+
+    segmentsRendered += RasterizeStrokes(strokes, view, frame, left, top, right, bottom, scratch);
+    tilesRendered++;
+}
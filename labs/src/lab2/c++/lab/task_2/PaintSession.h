@@ -0,0 +1,71 @@
+#ifndef PAINTSESSION_H
+#define PAINTSESSION_H
+
+#include <cstdint>
+#include <vector>
+
+#include "../common/Platform.h"
+#include "../common/StrokeLog.h"
+#include "../common/StrokeRaster.h"
+
+// Точка окна -> координаты документа при виде view
+void ViewToDocument(const StrokeView &view, int x, int y, float &documentX, float &documentY);
+
+// Вид после поворота колеса на wheelDelta (PlatformEvent::WHEEL_STEP на щелчок)
+// вокруг точки окна (x, y): точка документа под ней остаётся на месте.
+// Масштаб ограничен [0.25, 32].
+StrokeView ZoomViewAt(const StrokeView &view, int wheelDelta, int x, int y);
+
+// Рисование без оконной системы: мышь ведёт штрихи в журнал StrokeLog, колесо
+// масштабирует вид, Home возвращает масштаб 1. Кадр собирается из журнала по
+// плиткам TILE_SIZE, и перерисовываются только плитки, которых коснулся ввод
+// с прошлого кадра. Это тот же журнал и растеризатор, что у task_2 при
+// масштабе, отличном от 1; headless гоняет здесь сценарии рисования.
+class PaintSession : public PlatformApp
+{
+ public:
+  static constexpr int TILE_SIZE = 64;
+  static const int COMMAND_NEW = 1;
+
+  PaintSession(int pageWidth = 800, int pageHeight = 600);
+  ~PaintSession() override;
+  PaintSession(const PaintSession &) = delete;
+  PaintSession &operator=(const PaintSession &) = delete;
+
+  void SetBrush(uint32_t color, float size);
+
+  void OnEvent(const PlatformEvent &event, PlatformHost &host) override;
+  void OnPaint(PlatformCanvas &canvas) override;
+
+  const StrokeLog &GetStrokes() const { return strokes; }
+  const StrokeView &GetView() const { return view; }
+  size_t GetTilesRendered() const { return tilesRendered; }
+  size_t GetSegmentsRendered() const { return segmentsRendered; }
+
+ private:
+  void SetView(const StrokeView &newView, PlatformHost &host);
+  void MarkAllDirty();
+  void MarkDocumentRect(float left, float top, float right, float bottom);
+  void RenderTile(int tileX, int tileY);
+
+  int pageWidth;
+  int pageHeight;
+  StrokeLog strokes;
+  StrokeView view;
+  uint32_t color;
+  float brushSize;
+  bool isDrawing;
+  float lastX;
+  float lastY;
+
+  Surface frame;  // собранный кадр; в холст окна копируется целиком
+  int tilesX;
+  int tilesY;
+  std::vector<uint8_t> dirtyTiles;
+  bool allDirty;
+  StrokeRasterScratch scratch;
+  size_t tilesRendered;
+  size_t segmentsRendered;
+};
+
+#endif  // PAINTSESSION_H
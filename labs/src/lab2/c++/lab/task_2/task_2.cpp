@@ -1,30 +1,156 @@
 ﻿#include <windows.h>
 #include <commdlg.h>
+#include <windowsx.h>
 #include <gdiplus.h>
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <filesystem>
 #include <iostream>
+#include <mutex>
 #include <string>
+#include <thread>
+#include <vector>
+
+#include "CanvasSelection.h"
+#include "PaintSession.h"
+#include "../common/MemoryAccounting.h"
+#include "../common/PooledBitmap.h"
+#include "../common/SpscQueue.h"
+#include "../common/StrokeLog.h"
+#include "../common/StrokeRaster.h"
+#include "../common/SurfaceDraw.h"
+#include "../common/TileJournal.h"
+#include "../common/Trace.h"
+#include "../common/TripleBuffer.h"
 
 #pragma comment(lib, "gdiplus.lib")
 
 using namespace Gdiplus;
 
 HWND hWnd;
-Bitmap *g_pBitmap = nullptr;
+PooledBitmap g_canvas;
 bool g_isDrawing = false;
 POINT g_lastPoint;
 Color g_drawingColor = Color(0, 0, 0);
 int g_brushSize = 5;
 
+// Ввод с мыши идёт через очередь в поток отрисовки; UI-поток только кладёт
+// события и показывает готовые кадры
+struct StrokeEvent
+{
+    enum Type : uint8_t { Begin, Move, End } type;
+    float x, y;  // координаты документа
+    ARGB color;
+    int size;
+    LONGLONG timestamp;
+};
+
+const UINT WM_APP_SYNTHETIC_DONE = WM_APP + 1;
+const size_t LATENCY_RING_SIZE = 8192;
+
+SpscQueue<StrokeEvent, 4096> g_inputQueue;
+std::atomic<long> g_droppedSamples(0);
+HANDLE g_inputEvent = nullptr;
+std::thread g_renderThread;
+std::atomic<bool> g_renderStop(false);
+std::atomic<bool> g_canvasChanged(false);
+std::mutex g_canvasMutex;
+
+// Под g_canvasMutex: векторная запись штрихов, загруженное изображение-подложка
+// и параметры вида. При масштабе 1 показывается холст, иначе кадр собирается
+// из подложки и штрихов, перерисованных по плиткам в нужном масштабе.
+StrokeLog g_strokes;
+PooledBitmap g_background;
+StrokeView g_view = {0.0, 0.0, 1.0};
+int g_clientWidth = 0;
+int g_clientHeight = 0;
+const int VIEW_TILE_SIZE = 256;
+
+// Под g_canvasMutex: рамка, вставка и буфер обмена смотрят в плитки g_canvas без
+// копирования пикселей. Кадр в масштабе 1 собирается здесь же по плиткам: заново
+// копируются только те, что изменились с прошлой сборки этого кадра.
+CanvasSelection g_selection;
+
+// Инструмент выделения, только поток UI: мышь тянет рамку или тащит вставку
+enum class SelectionDrag { None, Frame, Move };
+bool g_selectMode = false;
+SelectionDrag g_selectionDrag = SelectionDrag::None;
+POINT g_selectionAnchor;  // угол рамки или точка захвата внутри вставки
+
+// Автосохранение: раз в AUTOSAVE_INTERVAL_MS поток копирует изменённые плитки
+// под g_canvasMutex и уже без блокировки дописывает их в журнал. Журнал живёт
+// до нормального выхода; если он остался, прошлый сеанс завершился аварийно.
+const DWORD AUTOSAVE_INTERVAL_MS = 2000;
+
+struct AutosaveStats
+{
+    std::atomic<uint64_t> bytesWritten{0};
+    std::atomic<uint64_t> records{0};
+    std::atomic<uint64_t> compactions{0};
+    std::atomic<uint64_t> journalSize{0};
+    std::atomic<long> activeIntervals{0};
+    std::atomic<long> failures{0};
+    std::atomic<long long> maxSnapshotUs{0};
+    std::atomic<long long> maxWriteUs{0};
+};
+
+TileJournal g_journal;
+std::filesystem::path g_journalPath;
+std::vector<uint8_t> g_dirtyTiles;  // под g_canvasMutex
+int g_dirtyTilesX = 0;
+int g_dirtyTilesY = 0;
+bool g_journalRestart = false;  // под g_canvasMutex: холст заменён, журнал начинается заново
+std::thread g_autosaveThread;
+HANDLE g_autosaveEvent = nullptr;
+std::atomic<bool> g_autosaveStop(false);
+AutosaveStats g_autosaveStats;
+
+// Кадры для показа: поток отрисовки копирует в них холст, OnPaint рисует последний
+PooledBitmap g_frames[3];
+TripleBuffer g_frameIndices;
+LONGLONG g_frameInputTime[3];
+std::atomic<long> g_framesSkipped(0);
+
+// Задержки ввод -> кадр на экране, заполняются только в OnPaint
+std::vector<double> g_latencyMs;
+size_t g_latencyNext = 0;
+LONGLONG g_qpcFrequency = 1;
+
+std::thread g_syntheticThread;
+std::atomic<bool> g_syntheticActive(false);
+
 LRESULT CALLBACK WndProc(HWND, UINT, WPARAM, LPARAM);
 void OnPaint(HWND hwnd);
 void CreateNewImage(HWND hwnd, int width, int height);
 void LoadImage(HWND hwnd, const std::wstring &filePath);
 void SaveImage(HWND hwnd, const std::wstring &filePath);
-void DrawLine(int x1, int y1, int x2, int y2);
 void ChooseColor(HWND hwnd);
+void PushStrokeEvent(StrokeEvent::Type type, float x, float y);
+void PushStrokeEvent(StrokeEvent::Type type, float x, float y, ARGB color, int size);
+void RenderThreadMain();
+bool BuildFrame(PooledBitmap &frame, uint32_t frameIndex, StrokeRasterScratch &scratch);
+void SetView(const StrokeView &view);
+void SetSelectMode(HWND hwnd, bool enabled);
+void OnSelectionMouse(HWND hwnd, UINT message, LPARAM lParam);
+void EditSelection(HWND hwnd, int command);
+void FlushSelectionWrites();
+void LoadStrokes(HWND hwnd, const std::wstring &filePath);
+void SaveStrokes(HWND hwnd, const std::wstring &filePath);
+void RunStrokeBenchmark(HWND hwnd);
+void ResetDirtyTiles(bool restartJournal, bool allDirty);
+void MarkDirtyTiles(float left, float top, float right, float bottom);
+void AutosaveThreadMain();
+void RecoverAutosave(HWND hwnd);
+void ShowAutosaveReport(HWND hwnd);
+void StartSyntheticTest(HWND hwnd);
+void ShowLatencyReport(HWND hwnd, const wchar_t *title);
 
 int APIENTRY wWinMain(_In_ HINSTANCE hInstance, _In_opt_ HINSTANCE hPrevInstance, _In_ LPWSTR lpCmdLine, _In_ int nCmdShow)
 {
+    TraceInitFromEnvironment();
+    MemoryReportInitFromEnvironment();
+
     GdiplusStartupInput gdiplusStartupInput;
     ULONG_PTR gdiplusToken;
     GdiplusStartup(&gdiplusToken, &gdiplusStartupInput, nullptr);
@@ -41,9 +167,20 @@ int APIENTRY wWinMain(_In_ HINSTANCE hInstance, _In_opt_ HINSTANCE hPrevInstance
     hWnd = CreateWindow(wcex.lpszClassName, L"Drawing Application", WS_OVERLAPPEDWINDOW,
                         CW_USEDEFAULT, CW_USEDEFAULT, 800, 600, nullptr, nullptr, hInstance, nullptr);
 
+    LARGE_INTEGER frequency;
+    QueryPerformanceFrequency(&frequency);
+    g_qpcFrequency = frequency.QuadPart;
+    g_latencyMs.reserve(LATENCY_RING_SIZE);
+    g_inputEvent = CreateEvent(nullptr, FALSE, FALSE, nullptr);
+    g_renderThread = std::thread(RenderThreadMain);
+
     ShowWindow(hWnd, nCmdShow);
     UpdateWindow(hWnd);
 
+    RecoverAutosave(hWnd);
+    g_autosaveEvent = CreateEvent(nullptr, FALSE, FALSE, nullptr);
+    g_autosaveThread = std::thread(AutosaveThreadMain);
+
     MSG msg;
     while (GetMessage(&msg, nullptr, 0, 0))
     {
@@ -51,12 +188,35 @@ int APIENTRY wWinMain(_In_ HINSTANCE hInstance, _In_opt_ HINSTANCE hPrevInstance
         DispatchMessage(&msg);
     }
 
+    if (g_syntheticThread.joinable())
+        g_syntheticThread.join();
+    g_renderStop = true;
+    SetEvent(g_inputEvent);
+    g_renderThread.join();
+    CloseHandle(g_inputEvent);
+
+    // Нормальный выход: восстанавливать нечего
+    g_autosaveStop = true;
+    SetEvent(g_autosaveEvent);
+    g_autosaveThread.join();
+    CloseHandle(g_autosaveEvent);
+    g_journal.Remove();
+
+    for (PooledBitmap &frame : g_frames)
+        frame.Release();
+    g_selection.Clear();
+    g_background.Release();
+    g_canvas.Release();
     GdiplusShutdown(gdiplusToken);
+    TraceWriteReports();
+    MemoryWriteReports();
     return (int)msg.wParam;
 }
 
 LRESULT CALLBACK WndProc(HWND hwnd, UINT message, WPARAM wParam, LPARAM lParam)
 {
+    TRACE_SCOPE(TraceMessageName(message));
+    MEMORY_TAG_SCOPE(MEMORY_CANVAS);
     switch (message)
     {
     case WM_CREATE:
@@ -67,13 +227,32 @@ LRESULT CALLBACK WndProc(HWND hwnd, UINT message, WPARAM wParam, LPARAM lParam)
         AppendMenu(hFileMenu, MF_STRING, 2, L"Open");
         AppendMenu(hFileMenu, MF_STRING, 3, L"Save As");
         AppendMenu(hFileMenu, MF_SEPARATOR, 0, nullptr);
+        AppendMenu(hFileMenu, MF_STRING, 8, L"Open Strokes");
+        AppendMenu(hFileMenu, MF_STRING, 9, L"Save Strokes");
+        AppendMenu(hFileMenu, MF_SEPARATOR, 0, nullptr);
         AppendMenu(hFileMenu, MF_STRING, 4, L"Exit");
         AppendMenu(hMenu, MF_POPUP, (UINT_PTR)hFileMenu, L"File");
 
+        HMENU hEditMenu = CreatePopupMenu();
+        AppendMenu(hEditMenu, MF_STRING, 14, L"Cut\tCtrl+X");
+        AppendMenu(hEditMenu, MF_STRING, 13, L"Copy\tCtrl+C");
+        AppendMenu(hEditMenu, MF_STRING, 15, L"Paste\tCtrl+V");
+        AppendMenu(hEditMenu, MF_STRING, 16, L"Deselect\tEsc");
+        AppendMenu(hMenu, MF_POPUP, (UINT_PTR)hEditMenu, L"Edit");
+
         HMENU hToolsMenu = CreatePopupMenu();
         AppendMenu(hToolsMenu, MF_STRING, 5, L"Choose Color");
+        AppendMenu(hToolsMenu, MF_STRING, 12, L"Select");
         AppendMenu(hMenu, MF_POPUP, (UINT_PTR)hToolsMenu, L"Tools");
 
+        HMENU hDebugMenu = CreatePopupMenu();
+        AppendMenu(hDebugMenu, MF_STRING, 6, L"Latency report");
+        AppendMenu(hDebugMenu, MF_STRING, 7, L"Synthetic stroke test");
+        AppendMenu(hDebugMenu, MF_STRING, 10, L"Stroke tile benchmark");
+        AppendMenu(hDebugMenu, MF_STRING, 11, L"Autosave report");
+        AppendMenu(hDebugMenu, MF_STRING, 17, L"Memory report");
+        AppendMenu(hMenu, MF_POPUP, (UINT_PTR)hDebugMenu, L"Debug");
+
         SetMenu(hwnd, hMenu);
         break;
     }
@@ -128,9 +307,68 @@ LRESULT CALLBACK WndProc(HWND hwnd, UINT message, WPARAM wParam, LPARAM lParam)
         case 5:
             ChooseColor(hwnd);
             break;
+        case 6:
+            ShowLatencyReport(hwnd, L"Latency report");
+            break;
+        case 7:
+            StartSyntheticTest(hwnd);
+            break;
+        case 8:
+        case 9:
+        {
+            OPENFILENAME ofn;
+            wchar_t szFile[260] = {0};
+            ZeroMemory(&ofn, sizeof(ofn));
+            ofn.lStructSize = sizeof(ofn);
+            ofn.hwndOwner = hwnd;
+            ofn.lpstrFile = szFile;
+            ofn.nMaxFile = sizeof(szFile);
+            ofn.lpstrFilter = L"Stroke log\0*.strk\0";
+            ofn.lpstrDefExt = L"strk";
+            ofn.nFilterIndex = 1;
+            if (LOWORD(wParam) == 8)
+            {
+                ofn.Flags = OFN_PATHMUSTEXIST | OFN_FILEMUSTEXIST;
+                if (GetOpenFileName(&ofn))
+                    LoadStrokes(hwnd, ofn.lpstrFile);
+            }
+            else
+            {
+                ofn.Flags = OFN_PATHMUSTEXIST | OFN_OVERWRITEPROMPT;
+                if (GetSaveFileName(&ofn))
+                    SaveStrokes(hwnd, ofn.lpstrFile);
+            }
+        }
+        break;
+        case 10:
+            RunStrokeBenchmark(hwnd);
+            break;
+        case 11:
+            ShowAutosaveReport(hwnd);
+            break;
+        case 17:
+            MessageBoxA(hwnd, MemoryReport().c_str(), "Memory", MB_OK);
+            break;
+        case 12:
+            SetSelectMode(hwnd, !g_selectMode);
+            break;
+        case 13:
+        case 14:
+        case 15:
+        case 16:
+            EditSelection(hwnd, LOWORD(wParam));
+            break;
         }
         break;
     }
+    case WM_APP_SYNTHETIC_DONE:
+    {
+        // Флаг снимается только здесь: до join новый тест не должен перезаписать поток
+        g_syntheticThread.join();
+        g_syntheticActive = false;
+        ShowLatencyReport(hwnd, L"Synthetic stroke test");
+        break;
+    }
     case WM_PAINT:
     {
         OnPaint(hwnd);
@@ -138,30 +376,85 @@ LRESULT CALLBACK WndProc(HWND hwnd, UINT message, WPARAM wParam, LPARAM lParam)
     }
     case WM_LBUTTONDOWN:
     {
+        if (g_selectMode)
+        {
+            OnSelectionMouse(hwnd, message, lParam);
+            break;
+        }
+        // Во время синтетического теста писатель очереди — генератор
+        if (g_syntheticActive)
+            break;
         g_isDrawing = true;
         g_lastPoint.x = LOWORD(lParam);
         g_lastPoint.y = HIWORD(lParam);
+        float x, y;
+        ViewToDocument(g_view, g_lastPoint.x, g_lastPoint.y, x, y);
+        PushStrokeEvent(StrokeEvent::Begin, x, y);
         break;
     }
     case WM_LBUTTONUP:
     {
+        if (g_selectMode)
+        {
+            OnSelectionMouse(hwnd, message, lParam);
+            break;
+        }
+        if (g_isDrawing && !g_syntheticActive)
+        {
+            float x, y;
+            ViewToDocument(g_view, LOWORD(lParam), HIWORD(lParam), x, y);
+            PushStrokeEvent(StrokeEvent::End, x, y);
+        }
         g_isDrawing = false;
         break;
     }
     case WM_MOUSEMOVE:
     {
-        if (g_isDrawing)
+        if (g_selectMode)
+        {
+            OnSelectionMouse(hwnd, message, lParam);
+            break;
+        }
+        if (g_isDrawing && !g_syntheticActive)
         {
-            int x = LOWORD(lParam);
-            int y = HIWORD(lParam);
-            DrawLine(g_lastPoint.x, g_lastPoint.y, x, y);
-            g_lastPoint.x = x;
-            g_lastPoint.y = y;
-            InvalidateRect(hwnd, nullptr, FALSE);
-            UpdateWindow(hwnd);
+            g_lastPoint.x = LOWORD(lParam);
+            g_lastPoint.y = HIWORD(lParam);
+            float x, y;
+            ViewToDocument(g_view, g_lastPoint.x, g_lastPoint.y, x, y);
+            PushStrokeEvent(StrokeEvent::Move, x, y);
         }
         break;
     }
+    case WM_MOUSEWHEEL:
+    {
+        // Масштаб вокруг курсора: точка документа под ним остаётся на месте
+        POINT cursor = {GET_X_LPARAM(lParam), GET_Y_LPARAM(lParam)};
+        ScreenToClient(hwnd, &cursor);
+        SetView(ZoomViewAt(g_view, GET_WHEEL_DELTA_WPARAM(wParam), cursor.x, cursor.y));
+        break;
+    }
+    case WM_KEYDOWN:
+    {
+        if (wParam == VK_HOME)
+            SetView({0.0, 0.0, 1.0});
+        else if (wParam == VK_ESCAPE || wParam == VK_RETURN)
+            EditSelection(hwnd, 16);
+        else if (GetKeyState(VK_CONTROL) < 0 && (wParam == 'X' || wParam == 'C' || wParam == 'V'))
+            EditSelection(hwnd, wParam == 'X' ? 14 : (wParam == 'C' ? 13 : 15));
+        break;
+    }
+    case WM_SIZE:
+    {
+        {
+            std::lock_guard<std::mutex> lock(g_canvasMutex);
+            g_clientWidth = LOWORD(lParam);
+            g_clientHeight = HIWORD(lParam);
+        }
+        g_canvasChanged = true;
+        if (g_inputEvent)
+            SetEvent(g_inputEvent);
+        break;
+    }
     case WM_DESTROY:
     {
         PostQuitMessage(0);
@@ -175,44 +468,406 @@ LRESULT CALLBACK WndProc(HWND hwnd, UINT message, WPARAM wParam, LPARAM lParam)
 
 void OnPaint(HWND hwnd)
 {
+    TRACE_SCOPE("OnPaint");
     PAINTSTRUCT ps;
     HDC hdc = BeginPaint(hwnd, &ps);
 
-    if (g_pBitmap)
+    bool freshFrame = g_frameIndices.Acquire();
+    uint32_t front = g_frameIndices.GetFrontIndex();
+    if (g_frames[front])
     {
         Graphics graphics(hdc);
-        graphics.DrawImage(g_pBitmap, 0, 0);
+        graphics.DrawImage(g_frames[front].Get(), 0, 0);
     }
 
     EndPaint(hwnd, &ps);
+
+    // Кадр ушёл на экран: считаем задержку от самого раннего вошедшего в него события
+    if (freshFrame && g_frameInputTime[front] != 0)
+    {
+        LARGE_INTEGER now;
+        QueryPerformanceCounter(&now);
+        double latency = (now.QuadPart - g_frameInputTime[front]) * 1000.0 / g_qpcFrequency;
+        if (g_latencyMs.size() < LATENCY_RING_SIZE)
+            g_latencyMs.push_back(latency);
+        else
+            g_latencyMs[g_latencyNext] = latency;
+        g_latencyNext = (g_latencyNext + 1) % LATENCY_RING_SIZE;
+    }
+}
+
+void PushStrokeEvent(StrokeEvent::Type type, float x, float y)
+{
+    PushStrokeEvent(type, x, y, g_drawingColor.GetValue(), g_brushSize);
+}
+
+// Цвет и кисть передаются явно: генератор синтетического теста не читает глобальные
+// переменные, которые UI меняет в это время
+void PushStrokeEvent(StrokeEvent::Type type, float x, float y, ARGB color, int size)
+{
+    LARGE_INTEGER now;
+    QueryPerformanceCounter(&now);
+    StrokeEvent event = {type, x, y, color, size, now.QuadPart};
+    // Очередь полна — поток отрисовки не успевает; событие теряется, но UI не ждёт
+    if (!g_inputQueue.TryPush(event))
+        g_droppedSamples++;
+    SetEvent(g_inputEvent);
+}
+
+void RenderThreadMain()
+{
+    PointF lastPoint(0.0f, 0.0f);
+    LONGLONG lastPublishedInput = 0;
+    std::vector<StrokeEvent> batch;
+    batch.reserve(4096);
+    StrokeRasterScratch scratch;
+    // Копии плиток под штрихом (BeforeCanvasWrite) — память холста, кадры — своя метка в BuildFrame
+    MEMORY_TAG_SCOPE(MEMORY_CANVAS);
+
+    while (!g_renderStop)
+    {
+        WaitForSingleObject(g_inputEvent, INFINITE);
+
+        batch.clear();
+        StrokeEvent event;
+        while (g_inputQueue.TryPop(event))
+            batch.push_back(event);
+        bool canvasChanged = g_canvasChanged.exchange(false);
+        if (batch.empty() && !canvasChanged)
+            continue;
+
+        TRACE_SCOPE("RenderBatch");
+        uint32_t back = g_frameIndices.GetBackIndex();
+        LONGLONG oldestInput = 0;
+        {
+            std::lock_guard<std::mutex> lock(g_canvasMutex);
+            if (!g_canvas)
+                continue;
+
+            // Один Graphics на всю пачку событий; каждое событие ещё и пишется в журнал штрихов
+            Graphics graphics(g_canvas.Get());
+            graphics.SetSmoothingMode(SmoothingModeAntiAlias);
+            for (const StrokeEvent &e : batch)
+            {
+                if (oldestInput == 0)
+                    oldestInput = e.timestamp;
+                if (e.type == StrokeEvent::Begin)
+                {
+                    g_strokes.BeginStroke(e.color, (float)e.size, e.x, e.y);
+                }
+                else if (e.type == StrokeEvent::Move)
+                {
+                    float radius = e.size * 0.5f + 1.0f;
+                    float left = std::min<float>(lastPoint.X, e.x) - radius;
+                    float top = std::min<float>(lastPoint.Y, e.y) - radius;
+                    float right = std::max<float>(lastPoint.X, e.x) + radius;
+                    float bottom = std::max<float>(lastPoint.Y, e.y) + radius;
+                    // Плитки под отрезком, на которые смотрят выделение или буфер обмена, отдают им копию
+                    int x0 = (int)std::floor(left);
+                    int y0 = (int)std::floor(top);
+                    g_selection.BeforeCanvasWrite(x0, y0, (int)std::ceil(right) - x0 + 1,
+                                                  (int)std::ceil(bottom) - y0 + 1);
+                    Pen pen(Color(e.color), (REAL)e.size);
+                    pen.SetStartCap(LineCapRound);
+                    pen.SetEndCap(LineCapRound);
+                    graphics.DrawLine(&pen, lastPoint.X, lastPoint.Y, e.x, e.y);
+                    g_strokes.AddPoint(e.x, e.y);
+                    MarkDirtyTiles(left, top, right, bottom);
+                }
+                lastPoint.X = e.x;
+                lastPoint.Y = e.y;
+            }
+            graphics.Flush(FlushIntentionSync);
+
+            // Задний кадр принадлежит только этому потоку, его можно пересоздать без блокировок
+            if (!BuildFrame(g_frames[back], back, scratch))
+                continue;
+        }
+
+        // Если прошлый кадр ещё не показан, этот его заменит вместе с его вводом
+        if (lastPublishedInput != 0 && g_frameIndices.HasFresh())
+            oldestInput = oldestInput == 0 ? lastPublishedInput : std::min<LONGLONG>(oldestInput, lastPublishedInput);
+        g_frameInputTime[back] = oldestInput;
+        lastPublishedInput = oldestInput;
+        if (g_frameIndices.Publish())
+            g_framesSkipped++;
+        InvalidateRect(hWnd, nullptr, FALSE);
+    }
+}
+
+// Вызывается под g_canvasMutex
+bool BuildFrame(PooledBitmap &frame, uint32_t frameIndex, StrokeRasterScratch &scratch)
+{
+    MEMORY_TAG_SCOPE(MEMORY_FRAMES);
+    if (g_view.scale == 1.0 && g_view.originX == 0.0 && g_view.originY == 0.0)
+    {
+        if (!frame.Reset(g_canvas.GetWidth(), g_canvas.GetHeight()))
+            return false;
+        g_selection.Compose(frame.GetSurface(), (int)frameIndex);
+        return true;
+    }
+
+    TRACE_SCOPE("BuildZoomedFrame");
+    if (g_clientWidth <= 0 || g_clientHeight <= 0 || !frame.Reset(g_clientWidth, g_clientHeight))
+        return false;
+    g_selection.InvalidateFrame((int)frameIndex);
+
+    // Подложка масштабируется как растр, штрихи перерисовываются из журнала и остаются чёткими.
+    // После правки выделением журнал холст уже не описывает, и масштабируется сам холст.
+    bool edited = g_selection.IsCanvasEdited();
+    PooledBitmap &source = edited ? g_canvas : g_background;
+    {
+        Graphics graphics(frame.Get());
+        graphics.Clear(Color(160, 160, 160));
+        RectF page((REAL)(-g_view.originX * g_view.scale), (REAL)(-g_view.originY * g_view.scale),
+                   (REAL)(g_canvas.GetWidth() * g_view.scale), (REAL)(g_canvas.GetHeight() * g_view.scale));
+        if (source)
+        {
+            graphics.SetInterpolationMode(g_view.scale > 1.0 ? InterpolationModeNearestNeighbor : InterpolationModeHighQualityBilinear);
+            graphics.SetPixelOffsetMode(PixelOffsetModeHalf);
+            graphics.DrawImage(source.Get(), page);
+        }
+        else
+        {
+            SolidBrush white(Color(255, 255, 255));
+            graphics.FillRectangle(&white, page);
+        }
+    }
+
+    if (edited)
+        return true;
+    StrokeView view = g_view;
+    const Surface &target = frame.GetSurface();
+    for (int top = 0; top < target.height; top += VIEW_TILE_SIZE)
+        for (int left = 0; left < target.width; left += VIEW_TILE_SIZE)
+            RasterizeStrokes(g_strokes, view, target, left, top, left + VIEW_TILE_SIZE, top + VIEW_TILE_SIZE, scratch);
+    return true;
+}
+
+void SetView(const StrokeView &view)
+{
+    {
+        std::lock_guard<std::mutex> lock(g_canvasMutex);
+        g_view = view;
+        // Выделение есть только в масштабе 1: при смене вида вставка вписывается в холст
+        if (view.scale != 1.0 || view.originX != 0.0 || view.originY != 0.0)
+        {
+            g_selection.Deselect();
+            FlushSelectionWrites();
+        }
+    }
+    g_canvasChanged = true;
+    SetEvent(g_inputEvent);
+}
+
+void SetSelectMode(HWND hwnd, bool enabled)
+{
+    g_selectMode = enabled;
+    g_selectionDrag = SelectionDrag::None;
+    CheckMenuItem(GetMenu(hwnd), 12, MF_BYCOMMAND | (enabled ? MF_CHECKED : MF_UNCHECKED));
+    if (!enabled)
+        EditSelection(hwnd, 16);
+}
+
+// Мышь в режиме выделения. Точка окна совпадает с точкой холста только в масштабе 1,
+// при другом виде мышь выделение не трогает.
+void OnSelectionMouse(HWND hwnd, UINT message, LPARAM lParam)
+{
+    int x = GET_X_LPARAM(lParam);
+    int y = GET_Y_LPARAM(lParam);
+    {
+        std::lock_guard<std::mutex> lock(g_canvasMutex);
+        if (!g_canvas || g_view.scale != 1.0 || g_view.originX != 0.0 || g_view.originY != 0.0)
+            return;
+        if (message == WM_LBUTTONDOWN)
+        {
+            // Внутри вставки её тащат, снаружи начинается новая рамка
+            if (g_selection.HasFloating() && g_selection.Contains(x, y))
+            {
+                g_selectionDrag = SelectionDrag::Move;
+                g_selectionAnchor = {x - g_selection.GetX(), y - g_selection.GetY()};
+            }
+            else
+            {
+                g_selectionDrag = SelectionDrag::Frame;
+                g_selectionAnchor = {x, y};
+                g_selection.Select(x, y, x, y);
+            }
+            SetCapture(hwnd);
+        }
+        else if (message == WM_MOUSEMOVE && g_selectionDrag == SelectionDrag::Move)
+        {
+            g_selection.MoveFloating(x - g_selectionAnchor.x, y - g_selectionAnchor.y);
+        }
+        else if (message == WM_MOUSEMOVE && g_selectionDrag == SelectionDrag::Frame)
+        {
+            g_selection.Select(g_selectionAnchor.x, g_selectionAnchor.y, x, y);
+        }
+        else if (message == WM_LBUTTONUP && g_selectionDrag != SelectionDrag::None)
+        {
+            g_selectionDrag = SelectionDrag::None;
+            ReleaseCapture();
+        }
+        else
+        {
+            return;
+        }
+        FlushSelectionWrites();
+    }
+    g_canvasChanged = true;
+    SetEvent(g_inputEvent);
+}
+
+// 13 — копировать, 14 — вырезать, 15 — вставить, 16 — снять выделение
+void EditSelection(HWND hwnd, int command)
+{
+    bool pasted = false;
+    {
+        std::lock_guard<std::mutex> lock(g_canvasMutex);
+        switch (command)
+        {
+        case 13:
+            g_selection.Copy();
+            break;
+        case 14:
+            g_selection.Cut(0xFFFFFFFF);
+            break;
+        case 15:
+            // Как в Paint: в левый верхний угол холста, дальше вставку тащат мышью.
+            // Выделение показывается только в масштабе 1.
+            pasted = g_selection.Paste(0, 0);
+            if (pasted)
+                g_view = {0.0, 0.0, 1.0};
+            break;
+        case 16:
+            g_selection.Deselect();
+            break;
+        }
+        FlushSelectionWrites();
+    }
+    g_canvasChanged = true;
+    SetEvent(g_inputEvent);
+    if (pasted && !g_selectMode)
+        SetSelectMode(hwnd, true);
+}
+
+// Вызывается под g_canvasMutex: записи выделения в холст уходят в автосохранение
+void FlushSelectionWrites()
+{
+    int x, y, width, height;
+    if (g_selection.TakeCanvasWrites(x, y, width, height))
+        MarkDirtyTiles((float)x, (float)y, (float)(x + width - 1), (float)(y + height - 1));
+}
+
+void StartSyntheticTest(HWND hwnd)
+{
+    if (g_syntheticActive || !g_canvas)
+        return;
+    if (g_syntheticThread.joinable())
+        g_syntheticThread.join();
+
+    g_latencyMs.clear();
+    g_latencyNext = 0;
+    g_droppedSamples = 0;
+    g_framesSkipped = 0;
+    g_isDrawing = false;
+    g_syntheticActive = true;
+
+    // Около 1000 событий в секунду в течение 3 секунд: спираль толстой кистью
+    int width = g_canvas.GetWidth();
+    int height = g_canvas.GetHeight();
+    ARGB color = g_drawingColor.GetValue();
+    int size = g_brushSize;
+    g_syntheticThread = std::thread([hwnd, width, height, color, size]() {
+        LARGE_INTEGER start, now;
+        QueryPerformanceCounter(&start);
+        LONGLONG step = g_qpcFrequency / 1000;
+        LONGLONG next = start.QuadPart;
+        int count = 3000;
+        for (int i = 0; i < count; i++)
+        {
+            do
+            {
+                std::this_thread::yield();
+                QueryPerformanceCounter(&now);
+            } while (now.QuadPart < next);
+            next += step;
+
+            double t = i / (double)count;
+            double angle = t * 40.0;
+            int x = width / 2 + (int)(std::cos(angle) * t * width * 0.45);
+            int y = height / 2 + (int)(std::sin(angle) * t * height * 0.45);
+            StrokeEvent::Type type = i == 0 ? StrokeEvent::Begin : (i == count - 1 ? StrokeEvent::End : StrokeEvent::Move);
+            PushStrokeEvent(type, x, y, color, size);
+        }
+        PostMessage(hwnd, WM_APP_SYNTHETIC_DONE, 0, 0);
+    });
+}
+
+void ShowLatencyReport(HWND hwnd, const wchar_t *title)
+{
+    std::vector<double> sorted = g_latencyMs;
+    std::sort(sorted.begin(), sorted.end());
+    wchar_t text[256];
+    if (sorted.empty())
+    {
+        swprintf_s(text, L"No frames presented yet\nDropped input samples: %ld", g_droppedSamples.load());
+    }
+    else
+    {
+        double p50 = sorted[sorted.size() / 2];
+        double p99 = sorted[std::min<size_t>(sorted.size() - 1, sorted.size() * 99 / 100)];
+        swprintf_s(text,
+                   L"Input-to-pixel latency over %u frames\n"
+                   L"p50: %.2f ms\np99: %.2f ms\nmax: %.2f ms\n\n"
+                   L"Dropped input samples: %ld\nFrames replaced before display: %ld",
+                   (unsigned)sorted.size(), p50, p99, sorted.back(), g_droppedSamples.load(), g_framesSkipped.load());
+    }
+    MessageBox(hwnd, text, title, MB_OK);
 }
 
 void CreateNewImage(HWND hwnd, int width, int height)
 {
-    if (g_pBitmap)
+    TRACE_SCOPE("CreateNewImage");
     {
-        delete g_pBitmap;
-        g_pBitmap = nullptr;
+        std::lock_guard<std::mutex> lock(g_canvasMutex);
+        g_selection.Release();
+        // Холст того же размера очищается на месте, без нового выделения
+        if (!g_canvas.Reset(width, height))
+            return;
+        Graphics graphics(g_canvas.Get());
+        graphics.Clear(Color(255, 255, 255));
+        g_strokes.Clear();
+        g_background.Release();
+        g_selection.Attach(g_canvas.GetSurface());
+        ResetDirtyTiles(true, false);
     }
-    g_pBitmap = new Bitmap(width, height, PixelFormat32bppARGB);
-    Graphics graphics(g_pBitmap);
-    graphics.Clear(Color(255, 255, 255));
+    g_canvasChanged = true;
+    SetEvent(g_inputEvent);
     InvalidateRect(hwnd, nullptr, TRUE);
 }
 
 void LoadImage(HWND hwnd, const std::wstring &filePath)
 {
-    if (g_pBitmap)
-    {
-        delete g_pBitmap;
-        g_pBitmap = nullptr;
-    }
-    g_pBitmap = new Bitmap(filePath.c_str());
-    if (g_pBitmap->GetLastStatus() != Ok)
+    TRACE_SCOPE("LoadImage");
     {
-        delete g_pBitmap;
-        g_pBitmap = nullptr;
+        std::lock_guard<std::mutex> lock(g_canvasMutex);
+        g_strokes.Clear();
+        g_background.Release();
+        g_selection.Release();
+        if (g_canvas.LoadFromFile(filePath) && g_background.Reset(g_canvas.GetWidth(), g_canvas.GetHeight()))
+        {
+            // Подложка нужна виду с масштабом: холст уже содержит растровые штрихи
+            const Surface &src = g_canvas.GetSurface();
+            const Surface &dst = g_background.GetSurface();
+            for (int y = 0; y < src.height; y++)
+                memcpy(dst.pixels + (size_t)y * dst.stride, src.pixels + (size_t)y * src.stride, (size_t)src.width * 4);
+        }
+        g_selection.Attach(g_canvas.GetSurface());
+        ResetDirtyTiles(true, true);
     }
+    g_canvasChanged = true;
+    SetEvent(g_inputEvent);
     InvalidateRect(hwnd, nullptr, TRUE);
 }
 
@@ -246,9 +901,7 @@ int GetEncoderClsid(const WCHAR *format, CLSID *pClsid)
 
 void SaveImage(HWND hwnd, const std::wstring &filePath)
 {
-    if (!g_pBitmap)
-        return;
-
+    TRACE_SCOPE("SaveImage");
     CLSID clsid;
     if (filePath.find(L".png") != std::wstring::npos)
     {
@@ -268,17 +921,340 @@ void SaveImage(HWND hwnd, const std::wstring &filePath)
         return;
     }
 
-    g_pBitmap->Save(filePath.c_str(), &clsid, nullptr);
+    // Под замком только копия пикселей: кодирование PNG/JPEG большого холста долгое,
+    // и всё это время поток отрисовки и автосохранение ждали бы холст
+    PooledBitmap snapshot;
+    {
+        std::lock_guard<std::mutex> lock(g_canvasMutex);
+        if (!g_canvas)
+            return;
+        const Surface &canvas = g_canvas.GetSurface();
+        if (!snapshot.Reset(canvas.width, canvas.height))
+            return;
+        CopySurfaceRect(snapshot.GetSurface(), 0, 0, canvas, 0, 0, canvas.width, canvas.height);
+    }
+    snapshot.Get()->Save(filePath.c_str(), &clsid, nullptr);
+}
+
+void LoadStrokes(HWND hwnd, const std::wstring &filePath)
+{
+    TRACE_SCOPE("LoadStrokes");
+    {
+        std::lock_guard<std::mutex> lock(g_canvasMutex);
+        if (!g_strokes.Load(filePath))
+        {
+            MessageBox(hwnd, L"Cannot read stroke log", L"Error", MB_ICONERROR);
+            return;
+        }
+
+        // Холст по размеру рисунка, но не меньше окна по умолчанию
+        int width = 800;
+        int height = 600;
+        float left, top, right, bottom;
+        if (g_strokes.GetBounds(left, top, right, bottom))
+        {
+            width = std::max<int>(width, (int)std::ceil(right));
+            height = std::max<int>(height, (int)std::ceil(bottom));
+        }
+        g_background.Release();
+        g_selection.Release();
+        if (!g_canvas.Reset(width, height))
+            return;
+        {
+            Graphics graphics(g_canvas.Get());
+            graphics.Clear(Color(255, 255, 255));
+        }
+
+        StrokeRasterScratch scratch;
+        StrokeView view = {0.0, 0.0, 1.0};
+        for (int y = 0; y < height; y += VIEW_TILE_SIZE)
+            for (int x = 0; x < width; x += VIEW_TILE_SIZE)
+                RasterizeStrokes(g_strokes, view, g_canvas.GetSurface(), x, y, x + VIEW_TILE_SIZE, y + VIEW_TILE_SIZE, scratch);
+        g_selection.Attach(g_canvas.GetSurface());
+        ResetDirtyTiles(true, true);
+    }
+    g_canvasChanged = true;
+    SetEvent(g_inputEvent);
+    InvalidateRect(hwnd, nullptr, TRUE);
+}
+
+void SaveStrokes(HWND hwnd, const std::wstring &filePath)
+{
+    TRACE_SCOPE("SaveStrokes");
+    std::lock_guard<std::mutex> lock(g_canvasMutex);
+    if (!g_strokes.Save(filePath))
+        MessageBox(hwnd, L"Cannot write stroke log", L"Error", MB_ICONERROR);
+}
+
+// Документ 8192x8192 из 1000 штрихов по 1000 отрезков; перерисовка плитками
+// при отдалении, в масштабе 1 и при увеличении, плюс сохранение и загрузка журнала
+void RunStrokeBenchmark(HWND hwnd)
+{
+    HCURSOR oldCursor = SetCursor(LoadCursor(nullptr, IDC_WAIT));
+
+    LARGE_INTEGER start, end;
+    QueryPerformanceCounter(&start);
+    StrokeLog log;
+    uint32_t seed = 12345;
+    auto random = [&seed]() {
+        seed = seed * 1664525u + 1013904223u;
+        return (seed >> 8) / 16777216.0f;
+    };
+    for (int stroke = 0; stroke < 1000; stroke++)
+    {
+        float x = random() * 8192.0f;
+        float y = random() * 8192.0f;
+        log.BeginStroke(0xFF000000u | (seed & 0xFFFFFF), 2.0f + stroke % 8, x, y);
+        for (int i = 0; i < 1000; i++)
+        {
+            x += random() * 12.0f - 6.0f;
+            y += random() * 12.0f - 6.0f;
+            log.AddPoint(x, y);
+        }
+    }
+    QueryPerformanceCounter(&end);
+    double buildMs = (end.QuadPart - start.QuadPart) * 1000.0 / g_qpcFrequency;
+
+    Surface tile;
+    if (!SurfacePool::Instance().Acquire(VIEW_TILE_SIZE, VIEW_TILE_SIZE, tile))
+        return;
+    StrokeRasterScratch scratch;
+    std::wstring report = L"1M segments, 256x256 tiles, 8x8 tiles per scale\n";
+    wchar_t line[256];
+    swprintf_s(line, L"Build + index: %.1f ms\n\n", buildMs);
+    report += line;
+
+    const double scales[] = {0.25, 1.0, 4.0};
+    for (double scale : scales)
+    {
+        std::vector<double> tileMs;
+        size_t segments = 0;
+        // Плитки вокруг центра документа
+        double originX = 4096.0 - 4 * VIEW_TILE_SIZE / scale;
+        double originY = 4096.0 - 4 * VIEW_TILE_SIZE / scale;
+        for (int ty = 0; ty < 8; ty++)
+        {
+            for (int tx = 0; tx < 8; tx++)
+            {
+                for (int y = 0; y < tile.height; y++)
+                    memset(tile.pixels + (size_t)y * tile.stride, 0xFF, (size_t)tile.width * 4);
+                StrokeView view = {originX + tx * VIEW_TILE_SIZE / scale, originY + ty * VIEW_TILE_SIZE / scale, scale};
+                QueryPerformanceCounter(&start);
+                segments += RasterizeStrokes(log, view, tile, 0, 0, VIEW_TILE_SIZE, VIEW_TILE_SIZE, scratch);
+                QueryPerformanceCounter(&end);
+                tileMs.push_back((end.QuadPart - start.QuadPart) * 1000.0 / g_qpcFrequency);
+            }
+        }
+        std::sort(tileMs.begin(), tileMs.end());
+        double total = 0.0;
+        for (double ms : tileMs)
+            total += ms;
+        swprintf_s(line, L"Scale %.2f: total %.1f ms, tile p50 %.2f ms, p99 %.2f ms, %.1fM segments/s\n", scale, total,
+                   tileMs[tileMs.size() / 2], tileMs[std::min<size_t>(tileMs.size() - 1, tileMs.size() * 99 / 100)],
+                   segments / (total * 1000.0));
+        report += line;
+    }
+    SurfacePool::Instance().Release(tile);
+
+    wchar_t tempDir[MAX_PATH];
+    GetTempPath(MAX_PATH, tempDir);
+    std::wstring path = std::wstring(tempDir) + L"stroke_benchmark.strk";
+    QueryPerformanceCounter(&start);
+    bool saved = log.Save(path);
+    QueryPerformanceCounter(&end);
+    double saveMs = (end.QuadPart - start.QuadPart) * 1000.0 / g_qpcFrequency;
+    StrokeLog loaded;
+    QueryPerformanceCounter(&start);
+    bool loadedOk = saved && loaded.Load(path);
+    QueryPerformanceCounter(&end);
+    double loadMs = (end.QuadPart - start.QuadPart) * 1000.0 / g_qpcFrequency;
+    WIN32_FILE_ATTRIBUTE_DATA attributes = {};
+    GetFileAttributesEx(path.c_str(), GetFileExInfoStandard, &attributes);
+    DeleteFile(path.c_str());
+
+    swprintf_s(line, L"\nSave: %.1f ms, load + reindex: %.1f ms%s\nFile size: %.1f MB\n", saveMs, loadMs,
+               loadedOk ? L"" : L" (failed)", attributes.nFileSizeLow / (1024.0 * 1024.0));
+    report += line;
+
+    SetCursor(oldCursor);
+    MessageBox(hwnd, report.c_str(), L"Stroke tile benchmark", MB_OK);
+}
+
+// Вызывается под g_canvasMutex после замены холста
+void ResetDirtyTiles(bool restartJournal, bool allDirty)
+{
+    g_dirtyTilesX = (g_canvas.GetWidth() + TileJournal::TILE_SIZE - 1) / TileJournal::TILE_SIZE;
+    g_dirtyTilesY = (g_canvas.GetHeight() + TileJournal::TILE_SIZE - 1) / TileJournal::TILE_SIZE;
+    g_dirtyTiles.assign((size_t)g_dirtyTilesX * g_dirtyTilesY, allDirty ? 1 : 0);
+    g_journalRestart = restartJournal;
 }
 
-void DrawLine(int x1, int y1, int x2, int y2)
+// Вызывается под g_canvasMutex; координаты документа, за пределами холста обрезаются
+void MarkDirtyTiles(float left, float top, float right, float bottom)
 {
-    if (!g_pBitmap)
+    int x0 = std::max<int>(0, (int)std::floor(left) / TileJournal::TILE_SIZE);
+    int y0 = std::max<int>(0, (int)std::floor(top) / TileJournal::TILE_SIZE);
+    int x1 = std::min<int>(g_dirtyTilesX - 1, (int)std::floor(right) / TileJournal::TILE_SIZE);
+    int y1 = std::min<int>(g_dirtyTilesY - 1, (int)std::floor(bottom) / TileJournal::TILE_SIZE);
+    for (int y = y0; y <= y1; y++)
+        for (int x = x0; x <= x1; x++)
+            g_dirtyTiles[(size_t)y * g_dirtyTilesX + x] = 1;
+}
+
+void AutosaveThreadMain()
+{
+    std::vector<TileSnapshot> staging;
+    while (!g_autosaveStop)
+    {
+        WaitForSingleObject(g_autosaveEvent, AUTOSAVE_INTERVAL_MS);
+        if (g_autosaveStop)
+            break;
+
+        bool restart = false;
+        int width = 0;
+        int height = 0;
+        size_t count = 0;
+        LARGE_INTEGER start, end;
+        QueryPerformanceCounter(&start);
+        {
+            // Под блокировкой только копирование изменённых плиток, без ввода-вывода
+            TRACE_SCOPE("AutosaveSnapshot");
+            std::lock_guard<std::mutex> lock(g_canvasMutex);
+            if (!g_canvas)
+                continue;
+            restart = g_journalRestart;
+            g_journalRestart = false;
+            width = g_canvas.GetWidth();
+            height = g_canvas.GetHeight();
+
+            const Surface &canvas = g_canvas.GetSurface();
+            for (int ty = 0; ty < g_dirtyTilesY; ty++)
+            {
+                for (int tx = 0; tx < g_dirtyTilesX; tx++)
+                {
+                    uint8_t &dirty = g_dirtyTiles[(size_t)ty * g_dirtyTilesX + tx];
+                    if (!dirty)
+                        continue;
+                    dirty = 0;
+                    if (count == staging.size())
+                        staging.emplace_back();
+                    TileSnapshot &tile = staging[count++];
+                    tile.tileX = tx;
+                    tile.tileY = ty;
+                    tile.width = std::min<int>(TileJournal::TILE_SIZE, width - tx * TileJournal::TILE_SIZE);
+                    tile.height = std::min<int>(TileJournal::TILE_SIZE, height - ty * TileJournal::TILE_SIZE);
+                    tile.pixels.resize((size_t)tile.width * tile.height * 4);
+                    size_t rowBytes = (size_t)tile.width * 4;
+                    for (int y = 0; y < tile.height; y++)
+                        memcpy(tile.pixels.data() + y * rowBytes,
+                               canvas.pixels + (size_t)(ty * TileJournal::TILE_SIZE + y) * canvas.stride +
+                                   (size_t)tx * TileJournal::TILE_SIZE * 4,
+                               rowBytes);
+                }
+            }
+        }
+        QueryPerformanceCounter(&end);
+        long long snapshotUs = (end.QuadPart - start.QuadPart) * 1000000 / g_qpcFrequency;
+        if (snapshotUs > g_autosaveStats.maxSnapshotUs)
+            g_autosaveStats.maxSnapshotUs = snapshotUs;
+
+        TRACE_SCOPE("AutosaveWrite");
+        QueryPerformanceCounter(&start);
+        bool ok = true;
+        if (restart)
+            ok = g_journal.Start(g_journalPath, width, height);
+        if (ok && count > 0)
+        {
+            ok = g_journal.Append(staging, count);
+            g_autosaveStats.activeIntervals++;
+        }
+        if (ok && g_journal.NeedsCompaction())
+            ok = g_journal.Compact();
+        if (!ok)
+            g_autosaveStats.failures++;
+        QueryPerformanceCounter(&end);
+        long long writeUs = (end.QuadPart - start.QuadPart) * 1000000 / g_qpcFrequency;
+        if (writeUs > g_autosaveStats.maxWriteUs)
+            g_autosaveStats.maxWriteUs = writeUs;
+
+        g_autosaveStats.bytesWritten = g_journal.GetBytesWritten();
+        g_autosaveStats.records = g_journal.GetRecordCount();
+        g_autosaveStats.compactions = g_journal.GetCompactionCount();
+        g_autosaveStats.journalSize = g_journal.GetFileSize();
+    }
+}
+
+void RecoverAutosave(HWND hwnd)
+{
+    wchar_t localAppData[MAX_PATH];
+    DWORD length = GetEnvironmentVariable(L"LOCALAPPDATA", localAppData, MAX_PATH);
+    std::filesystem::path dataDir = length > 0 && length < MAX_PATH ? std::filesystem::path(localAppData)
+                                                                    : std::filesystem::temp_directory_path();
+    g_journalPath = dataDir / L"DrawingApp" / L"autosave.journal";
+
+    std::error_code error;
+    if (!std::filesystem::exists(g_journalPath, error))
         return;
+    if (MessageBox(hwnd, L"The previous session did not exit normally.\nRecover the autosaved drawing?", L"Autosave",
+                   MB_YESNO | MB_ICONQUESTION) != IDYES)
+    {
+        std::filesystem::remove(g_journalPath, error);
+        return;
+    }
+
+    TRACE_SCOPE("RecoverAutosave");
+    MEMORY_TAG_SCOPE(MEMORY_CANVAS);
+    Surface recovered;
+    if (!g_journal.Recover(g_journalPath, recovered))
+    {
+        if (recovered.pixels)
+            SurfacePool::Instance().Release(recovered);
+        g_journal.Close();
+        std::filesystem::remove(g_journalPath, error);
+        MessageBox(hwnd, L"The autosave journal is damaged and was discarded", L"Autosave", MB_ICONWARNING);
+        return;
+    }
 
-    Graphics graphics(g_pBitmap);
-    Pen pen(g_drawingColor, g_brushSize);
-    graphics.DrawLine(&pen, x1, y1, x2, y2);
+    {
+        std::lock_guard<std::mutex> lock(g_canvasMutex);
+        g_strokes.Clear();
+        g_background.Release();
+        g_selection.Release();
+        if (g_canvas.Adopt(recovered) && g_background.Reset(g_canvas.GetWidth(), g_canvas.GetHeight()))
+        {
+            const Surface &src = g_canvas.GetSurface();
+            const Surface &dst = g_background.GetSurface();
+            for (int y = 0; y < src.height; y++)
+                memcpy(dst.pixels + (size_t)y * dst.stride, src.pixels + (size_t)y * src.stride, (size_t)src.width * 4);
+        }
+        g_selection.Attach(g_canvas.GetSurface());
+        // Журнал продолжается с восстановленного состояния
+        ResetDirtyTiles(false, false);
+    }
+    g_canvasChanged = true;
+    SetEvent(g_inputEvent);
+    InvalidateRect(hwnd, nullptr, TRUE);
+}
+
+void ShowAutosaveReport(HWND hwnd)
+{
+    double activeMinutes = g_autosaveStats.activeIntervals * (AUTOSAVE_INTERVAL_MS / 60000.0);
+    double bytes = (double)g_autosaveStats.bytesWritten;
+    wchar_t text[512];
+    swprintf_s(text,
+               L"Journal: %s\n\n"
+               L"Written: %.2f MB in %llu tile records, %llu compactions\n"
+               L"Journal size: %.2f MB\n"
+               L"Drawing time with changes: %.1f min\n"
+               L"I/O per minute of drawing: %.2f MB/min\n\n"
+               L"Max snapshot (under canvas lock): %.2f ms\n"
+               L"Max write + sync (background): %.2f ms\n"
+               L"Failures: %ld",
+               g_journalPath.c_str(), bytes / (1024.0 * 1024.0), (unsigned long long)g_autosaveStats.records,
+               (unsigned long long)g_autosaveStats.compactions, g_autosaveStats.journalSize / (1024.0 * 1024.0),
+               activeMinutes, activeMinutes > 0.0 ? bytes / (1024.0 * 1024.0) / activeMinutes : 0.0,
+               g_autosaveStats.maxSnapshotUs / 1000.0, g_autosaveStats.maxWriteUs / 1000.0, g_autosaveStats.failures.load());
+    MessageBox(hwnd, text, L"Autosave report", MB_OK);
 }
 
 void ChooseColor(HWND hwnd)
@@ -0,0 +1,489 @@
+﻿#include "AlchemyGame.h"
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+
+#include "../common/ImageCodec.h"
+#include "../common/MemoryAccounting.h"
+#include "../common/Resample.h"
+#include "../common/SurfaceDraw.h"
+#include "../common/Trace.h"
+
+namespace {
+const int DELETE_ZONE_X = 700;
+const int DELETE_ZONE_Y = 500;
+const int DELETE_ZONE_SIZE = 50;
+const uint32_t BACKGROUND_COLOR = 0xFFFFFFFF;
+const uint32_t TEXT_COLOR = 0xFF000000;
+const wchar_t DELETE_ICON_NAME[] = L"#delete";  // в атласе; элементы так называться не могут — # в файле рецептов комментарий
+
+const char SAVE_MAGIC[8] = { 'A', 'L', 'C', 'H', 'S', 'A', 'V', '1' };
+const uint32_t SAVE_VERSION = 2;
+const uint32_t SAVE_VERSION_IDS = 1;  // номера элементов графа; читается, только если рецепты не менялись
+const uint32_t MAX_SAVED_NAME = 1024;
+
+// Заголовок сохранения; за ним, в LEB128, открытые элементы по именам (длина, затем коды
+// символов) и поле — номерами в списке открытых. В версии 1 вместо имён были номера элементов
+// графа, а elementCount и namesKey привязывали файл к рецептам
+struct SaveHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t elementCount;
+    uint64_t namesKey;
+    uint32_t openCount;
+    uint32_t fieldCount;
+};
+
+void WriteVarint(std::vector<uint8_t>& out, uint32_t value) {
+    while (value >= 0x80) {
+        out.push_back(static_cast<uint8_t>(value | 0x80));
+        value >>= 7;
+    }
+    out.push_back(static_cast<uint8_t>(value));
+}
+
+bool ReadVarint(const uint8_t*& data, const uint8_t* end, uint32_t& value) {
+    value = 0;
+    for (int shift = 0; shift < 35 && data < end; shift += 7) {
+        uint8_t byte = *data++;
+        value |= static_cast<uint32_t>(byte & 0x7F) << shift;
+        if (!(byte & 0x80)) return true;
+    }
+    return false;
+}
+
+// Иконка под фиксированный размер: масштабируется один раз при загрузке, а не в каждом кадре
+bool LoadIconSurface(const std::filesystem::path& path, Surface& icon) {
+    Surface decoded;
+    if (!ReadImage(path, AlchemyGame::ICON_WIDTH, AlchemyGame::ICON_HEIGHT, decoded)) return false;
+    if (decoded.width == AlchemyGame::ICON_WIDTH && decoded.height == AlchemyGame::ICON_HEIGHT) {
+        icon = decoded;
+        return true;
+    }
+    bool ok = ResampleSurface(decoded, AlchemyGame::ICON_WIDTH, AlchemyGame::ICON_HEIGHT, icon);
+    SurfacePool::Instance().Release(decoded);
+    return ok;
+}
+
+// Имя файла иконки элемента. На Windows путь и так в UTF-16; в остальных системах
+// имя собирается в UTF-8 само, чтобы не зависеть от текущей локали
+std::filesystem::path IconFileName(const std::wstring& element, const wchar_t* extension) {
+#ifdef _WIN32
+    return element + extension;
+#else
+    std::string name;
+    for (wchar_t c : element + extension) {
+        uint32_t code = static_cast<uint32_t>(c);
+        if (code < 0x80) {
+            name.push_back(static_cast<char>(code));
+        }
+        else if (code < 0x800) {
+            name.push_back(static_cast<char>(0xC0 | (code >> 6)));
+            name.push_back(static_cast<char>(0x80 | (code & 0x3F)));
+        }
+        else if (code < 0x10000) {
+            name.push_back(static_cast<char>(0xE0 | (code >> 12)));
+            name.push_back(static_cast<char>(0x80 | ((code >> 6) & 0x3F)));
+            name.push_back(static_cast<char>(0x80 | (code & 0x3F)));
+        }
+        else {
+            name.push_back(static_cast<char>(0xF0 | (code >> 18)));
+            name.push_back(static_cast<char>(0x80 | ((code >> 12) & 0x3F)));
+            name.push_back(static_cast<char>(0x80 | ((code >> 6) & 0x3F)));
+            name.push_back(static_cast<char>(0x80 | (code & 0x3F)));
+        }
+    }
+    return name;
+#endif
+}
+
+// Плашка для элемента без иконки: цвет выводится из имени и не меняется между запусками
+uint32_t PlaceholderColor(const std::wstring& element) {
+    uint32_t hash = 2166136261u;
+    for (wchar_t c : element) {
+        hash = (hash ^ static_cast<uint32_t>(c)) * 16777619u;
+    }
+    return 0xFF000000u | (hash & 0x007F7F7Fu) | 0x00404040u;
+}
+}  // namespace
+
+AlchemyGame::AlchemyGame() : selectedElement(-1), dragElement(-1), cursorX(-1), cursorY(-1) {
+    for (const wchar_t* element : { L"Земля", L"Огонь", L"Вода", L"Воздух" }) {
+        OpenElement(recipes.AddElement(element));
+    }
+    recipes.AddRecipe(L"Огонь", L"Вода", L"Пар");
+    recipes.AddRecipe(L"Огонь", L"Земля", L"Лава");
+    recipes.AddRecipe(L"Воздух", L"Земля", L"Пыль");
+}
+
+AlchemyGame::~AlchemyGame() {
+    for (auto& entry : elementIcons) {
+        SurfacePool::Instance().Release(entry.second);
+    }
+    SurfacePool::Instance().Release(deleteIcon);
+}
+
+size_t AlchemyGame::LoadIcons(const std::filesystem::path& folder) {
+    TRACE_SCOPE("LoadIcons");
+    MEMORY_TAG_SCOPE(MEMORY_ICONS);
+    const std::pair<const wchar_t*, const wchar_t*> files[] = {
+        { L"Земля", L"earth.jpg" }, { L"Огонь", L"fire.jpg" }, { L"Вода", L"water.jpg" }, { L"Воздух", L"air.jpg" },
+    };
+    size_t loaded = 0;
+    for (const auto& file : files) {
+        Surface icon;
+        if (LoadIconSurface(folder / file.second, icon)) {
+            SurfacePool::Instance().Release(elementIcons[file.first]);
+            elementIcons[file.first] = icon;
+            loaded++;
+        }
+    }
+    // Повторная загрузка заменяет иконки: прежние возвращаются в пул, а не теряются
+    Surface deleteSurface;
+    if (LoadIconSurface(folder / L"delete.jpg", deleteSurface)) {
+        SurfacePool::Instance().Release(deleteIcon);
+        deleteIcon = deleteSurface;
+        loaded++;
+    }
+
+    const wchar_t* extensions[] = { L".jpg", L".png", L".bmp" };
+    for (size_t id = 0; id < recipes.GetElementCount(); ++id) {
+        const std::wstring& name = recipes.GetName(static_cast<uint32_t>(id));
+        if (elementIcons.count(name)) continue;
+        for (const wchar_t* extension : extensions) {
+            std::error_code error;
+            std::filesystem::path path = folder / IconFileName(name, extension);
+            Surface icon;
+            if (std::filesystem::exists(path, error) && LoadIconSurface(path, icon)) {
+                elementIcons[name] = icon;
+                loaded++;
+                break;
+            }
+        }
+    }
+    return loaded;
+}
+
+uint64_t AlchemyGame::GetIconSourceKey(const std::filesystem::path& folder) {
+    // Одно чтение каталога, а не проверка файла на каждый элемент рецептов
+    std::vector<std::filesystem::path> files;
+    std::error_code error;
+    for (std::filesystem::directory_iterator it(folder, error), end; !error && it != end; it.increment(error)) {
+        std::filesystem::path extension = it->path().extension();
+        if (extension == L".jpg" || extension == L".png" || extension == L".bmp") files.push_back(it->path());
+    }
+    return IconAtlas::MakeSourceKey(files);
+}
+
+bool AlchemyGame::LoadIconAtlas(const std::filesystem::path& path, uint64_t sourceKey) {
+    TRACE_SCOPE("LoadIconAtlas");
+    return iconAtlas.Open(path, ICON_WIDTH, ICON_HEIGHT, sourceKey);
+}
+
+bool AlchemyGame::SaveIconAtlas(const std::filesystem::path& path, uint64_t sourceKey) const {
+    std::vector<std::pair<std::wstring, Surface>> icons(elementIcons.begin(), elementIcons.end());
+    if (deleteIcon.pixels) icons.emplace_back(DELETE_ICON_NAME, deleteIcon);
+    return IconAtlas::Write(path, ICON_WIDTH, ICON_HEIGHT, icons, sourceKey);
+}
+
+bool AlchemyGame::SaveProgress(const std::filesystem::path& path) const {
+    SaveHeader header = {};
+    std::memcpy(header.magic, SAVE_MAGIC, sizeof(SAVE_MAGIC));
+    header.version = SAVE_VERSION;
+    header.openCount = static_cast<uint32_t>(openElements.size());
+
+    std::vector<uint8_t> ids;
+    std::map<std::wstring, uint32_t> openIndex;
+    for (const std::wstring& element : openElements) {
+        openIndex.emplace(element, static_cast<uint32_t>(openIndex.size()));
+        WriteVarint(ids, static_cast<uint32_t>(element.size()));
+        for (wchar_t c : element) {
+            WriteVarint(ids, static_cast<uint32_t>(c));
+        }
+    }
+    // На поле только открытые элементы; остальное не сохраняется
+    for (const std::wstring& element : experimentElements) {
+        auto found = openIndex.find(element);
+        if (found == openIndex.end()) continue;
+        WriteVarint(ids, found->second);
+        header.fieldCount++;
+    }
+
+    std::filesystem::path temporary = path;
+    temporary += L".tmp";
+    {
+        std::ofstream stream(temporary, std::ios::binary | std::ios::trunc);
+        if (!stream) return false;
+        stream.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        stream.write(reinterpret_cast<const char*>(ids.data()), static_cast<std::streamsize>(ids.size()));
+        if (!stream) return false;
+    }
+    std::error_code error;
+    std::filesystem::rename(temporary, path, error);
+    return !error;
+}
+
+bool AlchemyGame::LoadProgress(const std::filesystem::path& path) {
+    TRACE_SCOPE("LoadProgress");
+    std::ifstream stream(path, std::ios::binary);
+    if (!stream) return false;
+    std::vector<uint8_t> bytes((std::istreambuf_iterator<char>(stream)), std::istreambuf_iterator<char>());
+
+    SaveHeader header;
+    if (bytes.size() < sizeof(header)) return false;
+    std::memcpy(&header, bytes.data(), sizeof(header));
+    if (std::memcmp(header.magic, SAVE_MAGIC, sizeof(SAVE_MAGIC)) != 0) return false;
+    if (header.version == SAVE_VERSION_IDS &&
+        (header.elementCount != recipes.GetElementCount() || header.namesKey != recipes.GetNamesKey())) {
+        return false;
+    }
+    if (header.version != SAVE_VERSION && header.version != SAVE_VERSION_IDS) return false;
+
+    // Сначала разбор целиком: испорченный файл не должен оставить игру наполовину загруженной.
+    // Открытые элементы переводятся в номера текущего графа; пропавшие из рецептов дают NONE
+    std::vector<uint32_t> open;
+    std::vector<uint32_t> field;
+    const uint8_t* data = bytes.data() + sizeof(header);
+    const uint8_t* end = bytes.data() + bytes.size();
+    size_t total = static_cast<size_t>(header.openCount) + header.fieldCount;
+    if (total > static_cast<size_t>(end - data)) return false;
+    open.reserve(header.openCount);
+    field.reserve(header.fieldCount);
+    for (size_t i = 0; i < header.openCount; ++i) {
+        uint32_t id;
+        if (header.version == SAVE_VERSION_IDS) {
+            if (!ReadVarint(data, end, id) || id >= header.elementCount) return false;
+        }
+        else {
+            uint32_t length;
+            if (!ReadVarint(data, end, length) || length == 0 || length > MAX_SAVED_NAME) return false;
+            std::wstring name;
+            name.reserve(length);
+            for (uint32_t j = 0; j < length; ++j) {
+                uint32_t code;
+                if (!ReadVarint(data, end, code) || code == 0 || code > 0x10FFFF) return false;
+                name.push_back(static_cast<wchar_t>(code));
+            }
+            id = recipes.FindElement(name);
+        }
+        open.push_back(id);
+    }
+    for (size_t i = 0; i < header.fieldCount; ++i) {
+        uint32_t id;
+        if (!ReadVarint(data, end, id)) return false;
+        if (header.version == SAVE_VERSION_IDS) {
+            if (id >= header.elementCount) return false;
+        }
+        else {
+            if (id >= open.size()) return false;
+            id = open[id];
+        }
+        field.push_back(id);
+    }
+
+    recipes.ResetDiscoveries();
+    openElements.clear();
+    experimentElements.clear();
+    for (uint32_t id : open) {
+        if (id != RecipeGraph::NONE) OpenElement(id);
+    }
+    for (uint32_t id : field) {
+        if (id != RecipeGraph::NONE) experimentElements.push_back(recipes.GetName(id));
+    }
+    selectedElement = -1;
+    dragElement = -1;
+    message.clear();
+    return true;
+}
+
+size_t AlchemyGame::LoadRecipes(const std::filesystem::path& path) {
+    TRACE_SCOPE("LoadRecipes");
+    // Строки до ошибки в файле остаются добавленными
+    size_t added = 0;
+    std::string error;
+    recipes.LoadRecipes(path, added, error);
+    return added;
+}
+
+void AlchemyGame::OnEvent(const PlatformEvent& event, PlatformHost& host) {
+    switch (event.type) {
+    case PlatformEvent::MouseDown:
+        OnMouseDown(event.x, event.y, host);
+        break;
+    case PlatformEvent::MouseMove:
+        cursorX = event.x;
+        cursorY = event.y;
+        if (dragElement != -1) {
+            // Перерисовываем окно, чтобы обновить позицию перетаскиваемого элемента
+            host.Invalidate();
+        }
+        break;
+    case PlatformEvent::MouseUp:
+        OnMouseUp(event.x, event.y, host);
+        break;
+    case PlatformEvent::Command:
+        if (event.command == COMMAND_SORT) {
+            SortElements();
+        }
+        else if (event.command == COMMAND_HINT) {
+            ShowHint();
+        }
+        else if (event.command == COMMAND_DISCOVER_ALL) {
+            DiscoverAll();
+        }
+        host.Invalidate();
+        break;
+    case PlatformEvent::Resize:
+        host.Invalidate();
+        break;
+    default:
+        break;
+    }
+}
+
+void AlchemyGame::OnMouseDown(int x, int y, PlatformHost& host) {
+    cursorX = x;
+    cursorY = y;
+
+    // Проверка, выбран ли элемент из списка открытых элементов
+    if (x >= 0 && x < 400 && y >= 0 && y < 500) {
+        int index = y / ICON_HEIGHT;
+        if (index < static_cast<int>(openElements.size())) {
+            dragElement = index;
+            host.SetCapture(true);  // Захватываем мышь
+        }
+    }
+
+    // Проверка, выбран ли элемент на поле для экспериментов
+    if (x >= 400 && x < 800 && y >= 0 && y < 500) {
+        int index = (x - 400) / ICON_WIDTH;
+        if (index < static_cast<int>(experimentElements.size())) {
+            selectedElement = index;
+        }
+    }
+}
+
+void AlchemyGame::OnMouseUp(int x, int y, PlatformHost& host) {
+    if (dragElement != -1) {
+        // Перенос элемента на поле для экспериментов
+        if (x >= 400 && x < 800 && y >= 0 && y < 500) {
+            experimentElements.push_back(openElements[dragElement]);
+        }
+        dragElement = -1;
+        host.SetCapture(false);  // Освобождаем мышь
+    }
+
+    if (selectedElement != -1) {
+        // Удаление элемента с поля для экспериментов
+        if (x >= DELETE_ZONE_X && x <= DELETE_ZONE_X + DELETE_ZONE_SIZE &&
+            y >= DELETE_ZONE_Y && y <= DELETE_ZONE_Y + DELETE_ZONE_SIZE) {
+            experimentElements.erase(experimentElements.begin() + selectedElement);
+        }
+        selectedElement = -1;
+    }
+
+    // Проверка комбинации элементов
+    if (experimentElements.size() == 2) {
+        CombineElements(experimentElements[0], experimentElements[1]);
+        experimentElements.clear();
+    }
+
+    host.Invalidate();
+}
+
+void AlchemyGame::OnPaint(PlatformCanvas& canvas) {
+    TRACE_SCOPE("OnPaint");
+    const Surface& target = canvas.GetSurface();
+    FillSurfaceRect(target, 0, 0, target.width, target.height, BACKGROUND_COLOR);
+
+    for (size_t i = 0; i < openElements.size(); i++) {
+        int row = static_cast<int>(i) * ICON_HEIGHT;
+        if (10 + row >= target.height) break;  // ниже окна списка не видно
+        DrawIcon(target, openElements[i], 10, 10 + row);
+        canvas.DrawString(70, 20 + row, openElements[i], TEXT_COLOR);
+    }
+
+    for (size_t i = 0; i < experimentElements.size(); i++) {
+        DrawIcon(target, experimentElements[i], 410 + static_cast<int>(i) * ICON_WIDTH, 10);
+    }
+
+    Surface trash = deleteIcon;
+    if (trash.pixels || iconAtlas.Find(DELETE_ICON_NAME, trash)) {
+        DrawSurfaceScaled(target, trash, DELETE_ZONE_X, DELETE_ZONE_Y, ICON_WIDTH, ICON_HEIGHT);
+    }
+
+    // Рисуем перетаскиваемый элемент, если он есть
+    if (dragElement != -1) {
+        DrawIcon(target, openElements[dragElement], cursorX - ICON_WIDTH / 2, cursorY - ICON_HEIGHT / 2);
+    }
+
+    if (!message.empty()) {
+        canvas.DrawString(10, 550, message, TEXT_COLOR);
+    }
+}
+
+bool AlchemyGame::FindIcon(const std::wstring& element, Surface& icon) const {
+    auto it = elementIcons.find(element);
+    if (it != elementIcons.end()) {
+        icon = it->second;
+        return true;
+    }
+    return iconAtlas.Find(element, icon);
+}
+
+void AlchemyGame::DrawIcon(const Surface& target, const std::wstring& element, int x, int y) const {
+    Surface icon;
+    if (FindIcon(element, icon)) {
+        DrawSurfaceScaled(target, icon, x, y, ICON_WIDTH, ICON_HEIGHT);
+    }
+    else {
+        FillSurfaceRect(target, x, y, ICON_WIDTH, ICON_HEIGHT, PlaceholderColor(element));
+    }
+}
+
+void AlchemyGame::CombineElements(const std::wstring& element1, const std::wstring& element2) {
+    TRACE_SCOPE("CombineElements");
+    uint32_t result = recipes.Combine(recipes.FindElement(element1), recipes.FindElement(element2));
+
+    if (result == RecipeGraph::NONE) {
+        message = L"Ничего не произошло.";
+    }
+    else if (recipes.IsDiscovered(result)) {
+        message = L"Элемент уже открыт: " + recipes.GetName(result);
+    }
+    else {
+        OpenElement(result);
+        message = L"Создан новый элемент: " + recipes.GetName(result);
+    }
+}
+
+void AlchemyGame::OpenElement(uint32_t element) {
+    if (recipes.IsDiscovered(element)) return;
+    recipes.Discover(element);
+    openElements.push_back(recipes.GetName(element));
+}
+
+void AlchemyGame::ShowHint() {
+    uint32_t hint = recipes.GetHint();
+    if (hint == RecipeGraph::NONE) {
+        message = L"Из открытых элементов больше ничего не получить.";
+        return;
+    }
+    const RecipeGraph::Recipe& recipe = recipes.GetRecipe(hint);
+    message = L"Подсказка: " + recipes.GetName(recipe.first) + L" + " + recipes.GetName(recipe.second);
+}
+
+void AlchemyGame::DiscoverAll() {
+    TRACE_SCOPE("DiscoverAll");
+    std::vector<uint32_t> steps;
+    recipes.SolveAll(steps);
+    for (uint32_t step : steps) {
+        OpenElement(recipes.GetRecipe(step).result);
+    }
+    message = L"Открыто элементов: " + std::to_wstring(steps.size());
+}
+
+void AlchemyGame::SortElements() {
+    std::sort(openElements.begin(), openElements.end());
+}
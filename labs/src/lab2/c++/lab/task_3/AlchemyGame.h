@@ -0,0 +1,83 @@
+#ifndef ALCHEMYGAME_H
+#define ALCHEMYGAME_H
+
+#include <filesystem>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "../common/Platform.h"
+#include "IconAtlas.h"
+#include "RecipeGraph.h"
+
+// Логика "Алхимии" без оконной системы: элементы перетаскиваются из списка
+// открытых на поле для экспериментов, два элемента на поле объединяются,
+// элемент с поля можно бросить в зону удаления. Рецепты — RecipeGraph: встроенные
+// и загруженные из файла; он же подсказывает следующий рецепт и открывает всё
+// достижимое. Окно — Win32Host в игре и OffscreenHost в нагрузочных прогонах.
+class AlchemyGame : public PlatformApp {
+ public:
+  static const int ICON_WIDTH = 50;   // Фиксированная ширина иконки
+  static const int ICON_HEIGHT = 50;  // Фиксированная высота иконки
+  static const int COMMAND_SORT = 1;
+  static const int COMMAND_HINT = 2;
+  static const int COMMAND_DISCOVER_ALL = 3;
+
+  AlchemyGame();
+  ~AlchemyGame() override;
+  AlchemyGame(const AlchemyGame&) = delete;
+  AlchemyGame& operator=(const AlchemyGame&) = delete;
+
+  // Иконки стихий и зоны удаления из папки, сразу уменьшенные до размера иконки;
+  // для остальных элементов — файлы "<имя>.jpg" (.png, .bmp), если есть.
+  // Возвращает число загруженных; элементы без иконки рисуются цветной плашкой.
+  size_t LoadIcons(const std::filesystem::path& folder);
+  // Ключ файлов иконок в папке; меняется, когда иконку добавили, удалили или заменили
+  static uint64_t GetIconSourceKey(const std::filesystem::path& folder);
+  // Готовый атлас вместо декодирования: открытие не зависит от числа иконок.
+  // Атлас, собранный из других файлов (ключ не совпал), не открывается.
+  // Иконки, загруженные LoadIcons, важнее атласа.
+  bool LoadIconAtlas(const std::filesystem::path& path, uint64_t sourceKey);
+  // Атлас из иконок, загруженных LoadIcons, — для следующего запуска; без иконок не пишется
+  bool SaveIconAtlas(const std::filesystem::path& path, uint64_t sourceKey) const;
+  // Прогресс: открытые элементы в порядке списка и поле экспериментов. Элементы
+  // хранятся по именам, поэтому правка рецептов прогресс не сбрасывает; элементы,
+  // которых больше нет в рецептах, пропускаются.
+  bool SaveProgress(const std::filesystem::path& path) const;
+  bool LoadProgress(const std::filesystem::path& path);
+  // Дополнительные рецепты (формат — RecipeGraph::LoadRecipes); возвращает число добавленных
+  size_t LoadRecipes(const std::filesystem::path& path);
+
+  void OnEvent(const PlatformEvent& event, PlatformHost& host) override;
+  void OnPaint(PlatformCanvas& canvas) override;
+
+  const std::vector<std::wstring>& GetOpenElements() const { return openElements; }
+  const std::wstring& GetStatusMessage() const { return message; }
+  const RecipeGraph& GetRecipes() const { return recipes; }
+  RecipeGraph& GetRecipes() { return recipes; }
+
+ private:
+  void OnMouseDown(int x, int y, PlatformHost& host);
+  void OnMouseUp(int x, int y, PlatformHost& host);
+  void CombineElements(const std::wstring& element1, const std::wstring& element2);
+  void OpenElement(uint32_t element);
+  void ShowHint();
+  void DiscoverAll();
+  void SortElements();
+  void DrawIcon(const Surface& target, const std::wstring& element, int x, int y) const;
+  bool FindIcon(const std::wstring& element, Surface& icon) const;
+
+  RecipeGraph recipes;
+  std::vector<std::wstring> openElements;  // в порядке открытия, пока их не отсортируют
+  std::vector<std::wstring> experimentElements;
+  std::map<std::wstring, Surface> elementIcons;  // иконка по имени элемента, переживает сортировку
+  Surface deleteIcon;
+  IconAtlas iconAtlas;
+  int selectedElement;
+  int dragElement;
+  int cursorX;  // последняя позиция мыши, у неё рисуется перетаскиваемый элемент
+  int cursorY;
+  std::wstring message;  // итог последнего объединения, строка внизу окна
+};
+
+#endif  // ALCHEMYGAME_H
@@ -0,0 +1,173 @@
+#include "IconAtlas.h"
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+
+namespace {
+const char ATLAS_MAGIC[8] = { 'A', 'L', 'C', 'H', 'I', 'C', 'O', '1' };
+const uint32_t ATLAS_VERSION = 2;
+
+struct AtlasHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t iconWidth;
+    uint32_t iconHeight;
+    uint32_t count;
+    uint64_t pixelsOffset;  // от начала файла, кратно 16
+    uint64_t sourceKey;
+};
+}  // namespace
+
+IconAtlas::IconAtlas() : entries(nullptr), pixels(nullptr), count(0), width(0), height(0) {}
+
+uint64_t IconAtlas::MakeKey(const std::wstring& name) {
+    // FNV-1a по кодам символов, а не по байтам wchar_t: ключ одинаков на Windows и Linux
+    uint64_t hash = 14695981039346656037ull;
+    for (wchar_t c : name) {
+        uint32_t code = static_cast<uint32_t>(c);
+        for (int shift = 0; shift < 32; shift += 8) {
+            hash ^= (code >> shift) & 0xFF;
+            hash *= 1099511628211ull;
+        }
+    }
+    return hash;
+}
+
+uint64_t IconAtlas::MakeSourceKey(const std::vector<std::filesystem::path>& files) {
+    std::vector<uint64_t> keys;
+    keys.reserve(files.size());
+    for (const std::filesystem::path& file : files) {
+        std::error_code error;
+        uintmax_t size = std::filesystem::file_size(file, error);
+        if (error) continue;
+        auto modified = std::filesystem::last_write_time(file, error);
+        if (error) continue;
+        keys.push_back(MakeKey(file.filename().wstring() + L'|' + std::to_wstring(size) + L'|' +
+                               std::to_wstring(modified.time_since_epoch().count())));
+    }
+    std::sort(keys.begin(), keys.end());
+
+    uint64_t hash = 14695981039346656037ull;
+    for (uint64_t key : keys) {
+        for (int shift = 0; shift < 64; shift += 8) {
+            hash ^= (key >> shift) & 0xFF;
+            hash *= 1099511628211ull;
+        }
+    }
+    return hash;
+}
+
+bool IconAtlas::Write(const std::filesystem::path& path, int iconWidth, int iconHeight,
+                      const std::vector<std::pair<std::wstring, Surface>>& icons, uint64_t sourceKey) {
+    std::vector<Entry> table;
+    std::vector<const Surface*> sources;
+    for (const auto& icon : icons) {
+        if (!icon.second.pixels || icon.second.width != iconWidth || icon.second.height != iconHeight) continue;
+        table.push_back({ MakeKey(icon.first), static_cast<uint32_t>(sources.size()), 0 });
+        sources.push_back(&icon.second);
+    }
+    std::sort(table.begin(), table.end(), [](const Entry& a, const Entry& b) { return a.key < b.key; });
+    table.erase(std::unique(table.begin(), table.end(), [](const Entry& a, const Entry& b) { return a.key == b.key; }),
+                table.end());
+    // Пустой атлас открылся бы при следующем запуске и спрятал бы иконки, появившиеся в папке
+    if (table.empty()) return false;
+
+    // Иконки ложатся в файл в порядке таблицы
+    std::vector<const Surface*> ordered(table.size());
+    for (uint32_t i = 0; i < table.size(); ++i) {
+        ordered[i] = sources[table[i].icon];
+        table[i].icon = i;
+    }
+
+    AtlasHeader header = {};
+    std::memcpy(header.magic, ATLAS_MAGIC, sizeof(ATLAS_MAGIC));
+    header.version = ATLAS_VERSION;
+    header.iconWidth = static_cast<uint32_t>(iconWidth);
+    header.iconHeight = static_cast<uint32_t>(iconHeight);
+    header.count = static_cast<uint32_t>(table.size());
+    header.sourceKey = sourceKey;
+    size_t tableEnd = sizeof(header) + table.size() * sizeof(Entry);
+    header.pixelsOffset = (tableEnd + 15) & ~static_cast<uint64_t>(15);
+
+    // Пишем рядом и подменяем: открытый старый атлас не увидит полузаписанный файл
+    std::filesystem::path temporary = path;
+    temporary += L".tmp";
+    {
+        std::ofstream stream(temporary, std::ios::binary | std::ios::trunc);
+        if (!stream) return false;
+        stream.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        stream.write(reinterpret_cast<const char*>(table.data()), table.size() * sizeof(Entry));
+        const char padding[16] = {};
+        stream.write(padding, static_cast<std::streamsize>(header.pixelsOffset - tableEnd));
+
+        // Строки без выравнивания
+        size_t rowSize = static_cast<size_t>(iconWidth) * 4;
+        for (const Surface* icon : ordered) {
+            const Surface& source = *icon;
+            for (int y = 0; y < iconHeight; ++y) {
+                stream.write(reinterpret_cast<const char*>(source.pixels + static_cast<size_t>(y) * source.stride),
+                             static_cast<std::streamsize>(rowSize));
+            }
+        }
+        if (!stream) return false;
+    }
+    std::error_code error;
+    std::filesystem::rename(temporary, path, error);
+    return !error;
+}
+
+bool IconAtlas::Open(const std::filesystem::path& path, int iconWidth, int iconHeight, uint64_t sourceKey) {
+    Close();
+    if (!mapped.Open(path)) return false;
+
+    const uint8_t* data = mapped.GetData();
+    size_t size = mapped.GetSize();
+    AtlasHeader header;
+    if (size < sizeof(header)) {
+        Close();
+        return false;
+    }
+    std::memcpy(&header, data, sizeof(header));
+    uint64_t iconBytes = static_cast<uint64_t>(header.iconWidth) * header.iconHeight * 4;
+    if (std::memcmp(header.magic, ATLAS_MAGIC, sizeof(ATLAS_MAGIC)) != 0 || header.version != ATLAS_VERSION ||
+        header.iconWidth != static_cast<uint32_t>(iconWidth) || header.iconHeight != static_cast<uint32_t>(iconHeight) ||
+        header.sourceKey != sourceKey || header.count == 0 ||
+        header.pixelsOffset < sizeof(header) + static_cast<uint64_t>(header.count) * sizeof(Entry) ||
+        header.pixelsOffset > size || (size - header.pixelsOffset) / iconBytes < header.count) {
+        Close();
+        return false;
+    }
+
+    // Таблица идёт сразу за заголовком и выровнена по 8: читается прямо из отображения
+    entries = reinterpret_cast<const Entry*>(data + sizeof(header));
+    pixels = data + header.pixelsOffset;
+    count = header.count;
+    width = iconWidth;
+    height = iconHeight;
+    return true;
+}
+
+void IconAtlas::Close() {
+    mapped.Close();
+    entries = nullptr;
+    pixels = nullptr;
+    count = 0;
+}
+
+bool IconAtlas::Find(const std::wstring& name, Surface& icon) const {
+    if (!entries) return false;
+    uint64_t key = MakeKey(name);
+    const Entry* end = entries + count;
+    const Entry* found = std::lower_bound(entries, end, key, [](const Entry& entry, uint64_t value) {
+        return entry.key < value;
+    });
+    if (found == end || found->key != key || found->icon >= count) return false;
+
+    size_t iconBytes = static_cast<size_t>(width) * height * 4;
+    icon = Surface();
+    icon.pixels = const_cast<uint8_t*>(pixels + iconBytes * found->icon);
+    icon.width = width;
+    icon.height = height;
+    icon.stride = width * 4;
+    return true;
+}
@@ -0,0 +1,59 @@
+#ifndef ICONATLAS_H
+#define ICONATLAS_H
+
+#include <cstdint>
+#include <filesystem>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "../common/MappedFile.h"
+#include "../common/SurfacePool.h"
+
+// Иконки одного размера, собранные заранее в один файл: заголовок, таблица
+// [ключ имени, номер иконки] по возрастанию ключа, затем пиксели подряд.
+// Файл отображается в память целиком и не разбирается при открытии, поэтому
+// открытие стоит одинаково для десятка и для тысяч иконок; поиск — двоичный
+// по таблице в файле, страницы пикселей подгружаются при первой отрисовке.
+// В заголовке хранится ключ исходных файлов (MakeSourceKey): по нему видно,
+// что иконки в папке поменялись и атлас пора пересобрать.
+class IconAtlas {
+ public:
+  IconAtlas();
+  IconAtlas(const IconAtlas&) = delete;
+  IconAtlas& operator=(const IconAtlas&) = delete;
+
+  static uint64_t MakeKey(const std::wstring& name);
+  // Ключ по именам, размерам и времени изменения файлов; порядок файлов не важен
+  static uint64_t MakeSourceKey(const std::vector<std::filesystem::path>& files);
+  // Иконки другого размера и повторы имён пропускаются; файл заменяется целиком.
+  // Если не осталось ни одной иконки, файл не пишется и возвращается false
+  static bool Write(const std::filesystem::path& path, int iconWidth, int iconHeight,
+                    const std::vector<std::pair<std::wstring, Surface>>& icons, uint64_t sourceKey);
+
+  // false, если файла нет, он испорчен, иконки в нём другого размера
+  // или он собран из других исходных файлов
+  bool Open(const std::filesystem::path& path, int iconWidth, int iconHeight, uint64_t sourceKey);
+  void Close();
+
+  // Пиксели живут до Close(); Surface только для чтения
+  bool Find(const std::wstring& name, Surface& icon) const;
+  size_t GetIconCount() const { return count; }
+  bool IsOpen() const { return mapped.IsOpen(); }
+
+ private:
+  struct Entry {
+    uint64_t key;
+    uint32_t icon;
+    uint32_t reserved;
+  };
+
+  MappedFile mapped;
+  const Entry* entries;
+  const uint8_t* pixels;
+  uint32_t count;
+  int width;
+  int height;
+};
+
+#endif  // ICONATLAS_H
@@ -0,0 +1,197 @@
+#include "RecipeGraph.h"
+#include <algorithm>
+#include <fstream>
+#include <iterator>
+#include <utility>
+
+namespace {
+// UTF-8 -> wstring; на Windows символы вне BMP кодируются суррогатной парой
+std::wstring DecodeUtf8(const std::string& text) {
+    std::wstring result;
+    result.reserve(text.size());
+    size_t i = 0;
+    while (i < text.size()) {
+        uint32_t c = static_cast<uint8_t>(text[i]);
+        int extra = c >= 0xF0 ? 3 : c >= 0xE0 ? 2 : c >= 0xC0 ? 1 : 0;
+        if (extra > 0) c &= 0x3F >> extra;
+        i++;
+        for (int k = 0; k < extra && i < text.size(); ++k, ++i) {
+            c = (c << 6) | (static_cast<uint8_t>(text[i]) & 0x3F);
+        }
+        if (sizeof(wchar_t) == 2 && c > 0xFFFF) {
+            c -= 0x10000;
+            result.push_back(static_cast<wchar_t>(0xD800 + (c >> 10)));
+            result.push_back(static_cast<wchar_t>(0xDC00 + (c & 0x3FF)));
+        }
+        else {
+            result.push_back(static_cast<wchar_t>(c));
+        }
+    }
+    return result;
+}
+
+std::wstring Trim(const std::wstring& text) {
+    size_t first = text.find_first_not_of(L" \t\r");
+    if (first == std::wstring::npos) return std::wstring();
+    size_t last = text.find_last_not_of(L" \t\r");
+    return text.substr(first, last - first + 1);
+}
+}  // namespace
+
+uint32_t RecipeGraph::AddElement(const std::wstring& name) {
+    auto it = elementIds.find(name);
+    if (it != elementIds.end()) return it->second;
+
+    uint32_t id = static_cast<uint32_t>(names.size());
+    names.push_back(name);
+    elementIds.emplace(name, id);
+    // FNV-1a по кодам символов и нулю-разделителю после имени
+    for (size_t i = 0; i <= name.size(); ++i) {
+        namesKey ^= i < name.size() ? static_cast<uint32_t>(name[i]) : 0u;
+        namesKey *= 1099511628211ull;
+    }
+    uses.emplace_back();
+    state.discovered.push_back(0);
+    state.frontierSlot.push_back(NONE);
+    state.readyRecipe.push_back(NONE);
+    return id;
+}
+
+uint32_t RecipeGraph::FindElement(const std::wstring& name) const {
+    auto it = elementIds.find(name);
+    return it != elementIds.end() ? it->second : NONE;
+}
+
+uint64_t RecipeGraph::PairKey(uint32_t first, uint32_t second) {
+    if (first > second) std::swap(first, second);
+    return (static_cast<uint64_t>(first) << 32) | second;
+}
+
+uint32_t RecipeGraph::AddRecipe(uint32_t first, uint32_t second, uint32_t result) {
+    if (first >= names.size() || second >= names.size() || result >= names.size()) return NONE;
+    uint32_t index = static_cast<uint32_t>(recipes.size());
+    if (!pairs.emplace(PairKey(first, second), index).second) return NONE;
+
+    recipes.push_back({ first, second, result });
+    uses[first].push_back(index);
+    if (second != first) uses[second].push_back(index);
+
+    uint8_t missing = static_cast<uint8_t>(!state.discovered[first] + (second != first && !state.discovered[second]));
+    state.missing.push_back(missing);
+    if (missing == 0 && !state.discovered[result] && state.frontierSlot[result] == NONE) {
+        AddToFrontier(state, result, index);
+    }
+    return index;
+}
+
+uint32_t RecipeGraph::AddRecipe(const std::wstring& first, const std::wstring& second, const std::wstring& result) {
+    return AddRecipe(AddElement(first), AddElement(second), AddElement(result));
+}
+
+bool RecipeGraph::LoadRecipes(const std::filesystem::path& path, size_t& added, std::string& error) {
+    added = 0;
+    std::ifstream file(path, std::ios::binary);
+    if (!file) {
+        error = "cannot open " + path.string();
+        return false;
+    }
+    std::string bytes((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+    if (bytes.compare(0, 3, "\xEF\xBB\xBF") == 0) bytes.erase(0, 3);
+    std::wstring text = DecodeUtf8(bytes);
+
+    size_t lineNumber = 0;
+    size_t start = 0;
+    while (start <= text.size()) {
+        size_t end = text.find(L'\n', start);
+        if (end == std::wstring::npos) end = text.size();
+        std::wstring line = text.substr(start, end - start);
+        start = end + 1;
+        lineNumber++;
+
+        size_t comment = line.find(L'#');
+        if (comment != std::wstring::npos) line.erase(comment);
+        if (Trim(line).empty()) continue;
+
+        size_t plus = line.find(L'+');
+        size_t equals = line.find(L'=', plus == std::wstring::npos ? 0 : plus);
+        std::wstring first = plus != std::wstring::npos ? Trim(line.substr(0, plus)) : std::wstring();
+        std::wstring second = equals != std::wstring::npos ? Trim(line.substr(plus + 1, equals - plus - 1)) : std::wstring();
+        std::wstring result = equals != std::wstring::npos ? Trim(line.substr(equals + 1)) : std::wstring();
+        if (first.empty() || second.empty() || result.empty()) {
+            error = "line " + std::to_string(lineNumber) + ": expected 'A + B = C'";
+            return false;
+        }
+        if (AddRecipe(first, second, result) != NONE) added++;
+    }
+    return true;
+}
+
+uint32_t RecipeGraph::Combine(uint32_t first, uint32_t second) const {
+    if (first == NONE || second == NONE) return NONE;
+    auto it = pairs.find(PairKey(first, second));
+    return it != pairs.end() ? recipes[it->second].result : NONE;
+}
+
+void RecipeGraph::AddToFrontier(State& target, uint32_t element, uint32_t recipe) {
+    target.frontierSlot[element] = static_cast<uint32_t>(target.craftable.size());
+    target.craftable.push_back(element);
+    target.readyRecipe[element] = recipe;
+}
+
+size_t RecipeGraph::DiscoverIn(State& target, uint32_t element) const {
+    if (element >= names.size() || target.discovered[element]) return 0;
+    target.discovered[element] = 1;
+    target.discoveredCount++;
+
+    // Открытый элемент уходит из фронта: на его место встаёт последний
+    uint32_t slot = target.frontierSlot[element];
+    if (slot != NONE) {
+        uint32_t moved = target.craftable.back();
+        target.craftable[slot] = moved;
+        target.frontierSlot[moved] = slot;
+        target.craftable.pop_back();
+        target.frontierSlot[element] = NONE;
+        target.readyRecipe[element] = NONE;
+    }
+
+    size_t added = 0;
+    for (uint32_t recipe : uses[element]) {
+        if (--target.missing[recipe] != 0) continue;
+        uint32_t result = recipes[recipe].result;
+        if (!target.discovered[result] && target.frontierSlot[result] == NONE) {
+            AddToFrontier(target, result, recipe);
+            added++;
+        }
+    }
+    return added;
+}
+
+size_t RecipeGraph::Discover(uint32_t element) {
+    return DiscoverIn(state, element);
+}
+
+void RecipeGraph::ResetDiscoveries() {
+    std::fill(state.discovered.begin(), state.discovered.end(), 0);
+    std::fill(state.frontierSlot.begin(), state.frontierSlot.end(), NONE);
+    std::fill(state.readyRecipe.begin(), state.readyRecipe.end(), NONE);
+    state.craftable.clear();
+    state.discoveredCount = 0;
+    for (size_t i = 0; i < recipes.size(); ++i) {
+        state.missing[i] = static_cast<uint8_t>(recipes[i].first == recipes[i].second ? 1 : 2);
+    }
+}
+
+uint32_t RecipeGraph::GetHint() const {
+    return state.craftable.empty() ? NONE : state.readyRecipe[state.craftable.front()];
+}
+
+size_t RecipeGraph::SolveAll(std::vector<uint32_t>& steps) const {
+    steps.clear();
+    State copy = state;
+    while (!copy.craftable.empty()) {
+        uint32_t element = copy.craftable.back();
+        steps.push_back(copy.readyRecipe[element]);
+        DiscoverIn(copy, element);
+    }
+    return steps.size();
+}
@@ -0,0 +1,81 @@
+#ifndef RECIPEGRAPH_H
+#define RECIPEGRAPH_H
+
+#include <cstdint>
+#include <filesystem>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// Граф рецептов "Алхимии": элемент + элемент = элемент. Помимо поиска результата
+// по паре хранит множество элементов, которые уже можно получить, но ещё не открыты
+// (фронт). Фронт поддерживается инкрементально: открытие элемента обходит только
+// рецепты с ним в составе, поэтому стоит O(число таких рецептов), а не O(всех рецептов).
+class RecipeGraph {
+ public:
+  static constexpr uint32_t NONE = 0xFFFFFFFFu;
+
+  struct Recipe {
+    uint32_t first;
+    uint32_t second;
+    uint32_t result;
+  };
+
+  // Элементы идентифицируются индексом; имя регистрируется один раз
+  uint32_t AddElement(const std::wstring& name);
+  uint32_t FindElement(const std::wstring& name) const;
+
+  // Рецепт для уже занятой пары не добавляется (NONE); порядок ингредиентов не важен.
+  // Рецепт можно добавить и после открытий — фронт обновится.
+  uint32_t AddRecipe(uint32_t first, uint32_t second, uint32_t result);
+  uint32_t AddRecipe(const std::wstring& first, const std::wstring& second, const std::wstring& result);
+  // Текстовый файл UTF-8, по рецепту в строке: "Огонь + Вода = Пар"; # — комментарий
+  bool LoadRecipes(const std::filesystem::path& path, size_t& added, std::string& error);
+
+  // Результат пары или NONE, открытость не проверяется
+  uint32_t Combine(uint32_t first, uint32_t second) const;
+  // Возвращает, сколько элементов попало во фронт
+  size_t Discover(uint32_t element);
+  void ResetDiscoveries();
+
+  // Рецепт, дающий ещё не открытый элемент из уже открытых, или NONE
+  uint32_t GetHint() const;
+  // Порядок рецептов, открывающий всё достижимое из текущего состояния; само состояние не меняется
+  size_t SolveAll(std::vector<uint32_t>& steps) const;
+
+  bool IsDiscovered(uint32_t element) const { return state.discovered[element] != 0; }
+  const std::vector<uint32_t>& GetCraftable() const { return state.craftable; }
+  const Recipe& GetRecipe(uint32_t recipe) const { return recipes[recipe]; }
+  const std::wstring& GetName(uint32_t element) const { return names[element]; }
+  size_t GetElementCount() const { return names.size(); }
+  size_t GetRecipeCount() const { return recipes.size(); }
+  size_t GetDiscoveredCount() const { return state.discoveredCount; }
+  // Отпечаток имён в порядке регистрации: номера элементов в сохранении значат
+  // то же самое, только если он совпал
+  uint64_t GetNamesKey() const { return namesKey; }
+
+ private:
+  // Всё, что меняется при открытии; SolveAll работает на копии
+  struct State {
+    std::vector<uint8_t> discovered;     // по элементу
+    std::vector<uint8_t> missing;        // по рецепту: сколько разных ингредиентов ещё не открыто
+    std::vector<uint32_t> craftable;     // фронт
+    std::vector<uint32_t> frontierSlot;  // по элементу: позиция во фронте или NONE
+    std::vector<uint32_t> readyRecipe;   // по элементу фронта: рецепт, которым он получается
+    size_t discoveredCount = 0;
+  };
+
+  static uint64_t PairKey(uint32_t first, uint32_t second);
+  size_t DiscoverIn(State& target, uint32_t element) const;
+  static void AddToFrontier(State& target, uint32_t element, uint32_t recipe);
+
+  std::vector<std::wstring> names;
+  std::unordered_map<std::wstring, uint32_t> elementIds;
+  uint64_t namesKey = 14695981039346656037ull;
+  std::vector<Recipe> recipes;
+  std::unordered_map<uint64_t, uint32_t> pairs;  // пара ингредиентов -> рецепт
+  std::vector<std::vector<uint32_t>> uses;       // по элементу: рецепты с ним в составе
+  State state;
+};
+
+#endif  // RECIPEGRAPH_H
@@ -0,0 +1,261 @@
+// Пакетное создание миниатюр и конвертация форматов без окна.
+// Каждый файл проходит конвейер декодирование -> уменьшение -> кодирование
+// на пуле потоков с ограниченной очередью, поэтому в памяти одновременно
+// держится не больше нескольких изображений на поток.
+//
+// Сборка под Linux (BMP и PPM):
+//   g++ -std=c++20 -O2 -pthread thumbnailer.cpp ../common/SurfacePool.cpp ../common/Resample.cpp
+//       ../common/ImageCodec.cpp ../common/ThreadPool.cpp ../common/Trace.cpp ../common/MemoryAccounting.cpp
+//       -o thumbnailer
+// LAB_TRACE=<префикс> включает трассировку этапов конвейера (см. common/Trace.h),
+// LAB_MEMORY=<файл> — отчёт о памяти при выходе (см. common/MemoryAccounting.h).
+// Под Windows проект thumbnailer.vcxproj дополнительно читает и пишет PNG и JPEG через WIC.
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#ifdef _WIN32
+#include <windows.h>
+#include <psapi.h>
+#pragma comment(lib, "psapi.lib")
+#else
+#include <sys/resource.h>
+#endif
+
+#include "../common/ImageCodec.h"
+#include "../common/MemoryAccounting.h"
+#include "../common/Resample.h"
+#include "../common/SurfacePool.h"
+#include "../common/ThreadPool.h"
+#include "../common/Trace.h"
+
+namespace fs = std::filesystem;
+
+struct Options
+{
+    fs::path inputDir;
+    fs::path outputDir;
+    int maxSize = 256;
+    ImageFormat format = ImageFormat::Unknown;  // Unknown — тот же формат, что у исходника
+    size_t threads = 0;
+    bool recursive = false;
+};
+
+struct Counters
+{
+    std::atomic<size_t> processed{0};
+    std::atomic<size_t> failed{0};
+    std::atomic<unsigned long long> inputPixels{0};
+};
+
+void PrintUsage()
+{
+    std::cout << "Usage: thumbnailer <input-dir> <output-dir> [--size N] [--format bmp|ppm|png|jpg]\n"
+                 "                   [--threads N] [--recursive]\n"
+                 "  --size N     longest side of the result, 0 keeps the original size (default 256)\n"
+                 "  --format F   output format, by default the input format is kept\n"
+                 "  --threads N  worker threads, by default one per core\n";
+}
+
+bool ParseOptions(int argc, char *argv[], Options &options)
+{
+    std::vector<std::string> positional;
+    for (int i = 1; i < argc; ++i)
+    {
+        std::string arg = argv[i];
+        bool hasValue = i + 1 < argc;
+        if (arg == "--size" && hasValue)
+        {
+            options.maxSize = std::atoi(argv[++i]);
+        }
+        else if (arg == "--format" && hasValue)
+        {
+            options.format = FormatFromName(argv[++i]);
+            if (!IsFormatSupported(options.format))
+            {
+                std::cerr << "Unsupported output format: " << argv[i] << "\n";
+                return false;
+            }
+        }
+        else if (arg == "--threads" && hasValue)
+        {
+            options.threads = static_cast<size_t>(std::atoi(argv[++i]));
+        }
+        else if (arg == "--recursive")
+        {
+            options.recursive = true;
+        }
+        else if (!arg.empty() && arg[0] == '-')
+        {
+            return false;
+        }
+        else
+        {
+            positional.push_back(arg);
+        }
+    }
+    if (positional.size() != 2 || options.maxSize < 0)
+        return false;
+
+    options.inputDir = positional[0];
+    options.outputDir = positional[1];
+    return true;
+}
+
+size_t GetPeakResidentBytes()
+{
+#ifdef _WIN32
+    PROCESS_MEMORY_COUNTERS counters;
+    if (GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters)))
+        return counters.PeakWorkingSetSize;
+    return 0;
+#else
+    rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) == 0)
+        return static_cast<size_t>(usage.ru_maxrss) * 1024;
+    return 0;
+#endif
+}
+
+void ProcessImage(const fs::path &source, const fs::path &target, ImageFormat format, int maxSize,
+                  Counters &counters)
+{
+    SurfacePool &pool = SurfacePool::Instance();
+
+    Surface decoded;
+    bool read = false;
+    {
+        TRACE_SCOPE("Decode");
+        read = ReadImage(source, maxSize, maxSize, decoded);
+    }
+    if (!read)
+    {
+        counters.failed++;
+        return;
+    }
+    counters.inputPixels += static_cast<unsigned long long>(decoded.width) * decoded.height;
+
+    int width = 0;
+    int height = 0;
+    FitSize(decoded.width, decoded.height, maxSize, maxSize, width, height);
+
+    // Исходник возвращается в пул сразу после уменьшения, до кодирования
+    if (width != decoded.width || height != decoded.height)
+    {
+        TRACE_SCOPE("Resize");
+        Surface resized;
+        bool ok = ResampleSurface(decoded, width, height, resized);
+        pool.Release(decoded);
+        if (!ok)
+        {
+            counters.failed++;
+            return;
+        }
+        decoded = resized;
+    }
+
+    bool written = false;
+    {
+        TRACE_SCOPE("Encode");
+        written = WriteImage(target, decoded, format);
+    }
+    pool.Release(decoded);
+    if (written)
+        counters.processed++;
+    else
+        counters.failed++;
+}
+
+std::vector<fs::path> CollectImages(const Options &options)
+{
+    std::vector<fs::path> files;
+    std::error_code error;
+    auto accept = [&files](const fs::directory_entry &entry)
+    {
+        if (entry.is_regular_file() && IsFormatSupported(FormatFromPath(entry.path())))
+            files.push_back(entry.path());
+    };
+
+    if (options.recursive)
+    {
+        for (const auto &entry : fs::recursive_directory_iterator(options.inputDir, error))
+            accept(entry);
+    }
+    else
+    {
+        for (const auto &entry : fs::directory_iterator(options.inputDir, error))
+            accept(entry);
+    }
+    return files;
+}
+
+int main(int argc, char *argv[])
+{
+    Options options;
+    if (!ParseOptions(argc, argv, options))
+    {
+        PrintUsage();
+        return 1;
+    }
+    TraceInitFromEnvironment();
+    MemoryReportInitFromEnvironment();
+
+#ifdef _WIN32
+    CoInitializeEx(nullptr, COINIT_MULTITHREADED);
+#endif
+
+    std::vector<fs::path> files = CollectImages(options);
+    std::error_code error;
+    fs::create_directories(options.outputDir, error);
+
+    Counters counters;
+    auto start = std::chrono::steady_clock::now();
+    size_t steals = 0;
+    size_t threadCount = 0;
+    {
+        // Очередь на два файла на поток: перечисление каталога не убегает вперёд декодирования
+        size_t threads = options.threads > 0 ? options.threads : ThreadPool::DefaultThreadCount();
+        ThreadPool pool(threads, threads * 2);
+        threadCount = pool.GetThreadCount();
+
+        for (const fs::path &source : files)
+        {
+            ImageFormat format = options.format != ImageFormat::Unknown ? options.format : FormatFromPath(source);
+            fs::path relative = source.lexically_relative(options.inputDir);
+            fs::path target = options.outputDir / relative;
+            target.replace_extension(FormatExtension(format));
+            if (options.recursive)
+                fs::create_directories(target.parent_path(), error);
+
+            int maxSize = options.maxSize;
+            pool.Submit([source, target, format, maxSize, &counters]()
+                        { ProcessImage(source, target, format, maxSize, counters); });
+        }
+        pool.WaitIdle();
+        steals = pool.GetStealCount();
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    SurfacePoolStats stats = SurfacePool::Instance().GetStats();
+    std::printf("Images: %zu ok, %zu failed, %zu threads, %zu steals\n", counters.processed.load(),
+                counters.failed.load(), threadCount, steals);
+    std::printf("Time: %.3f s, %.1f images/s, %.1f MP/s decoded\n", seconds,
+                seconds > 0 ? counters.processed / seconds : 0.0,
+                seconds > 0 ? counters.inputPixels / seconds / 1e6 : 0.0);
+    std::printf("Memory: surface pool peak %.1f MB (%zu allocations, %zu reused), process peak %.1f MB\n",
+                stats.peakBytes / 1048576.0, stats.allocations, stats.reuseHits,
+                GetPeakResidentBytes() / 1048576.0);
+
+    TraceWriteReports();
+    MemoryWriteReports();
+#ifdef _WIN32
+    CoUninitialize();
+#endif
+    return counters.failed > 0 ? 2 : 0;
+}